@@ -6,7 +6,7 @@ const char *ssid = "YOUR_SSID";
 const char *password = "YOUR_PASSWORD";
 
 EspCam::Camera camera;
-EspCam::WebServer server(camera);
+EspCam::WebServer server(&camera);
 
 void setup()
 {
@@ -33,7 +33,7 @@ void setup()
     camera.setBrownout(false);
     camera.setFrameSize(FRAMESIZE_HD);
     camera.setPixelFormat(PIXFORMAT_JPEG);
-    camera.setJPEGQuality(24);
+    camera.setJpegQuality(24);
     camera.setFramebufferCount(3);
 
     if (!camera.begin())
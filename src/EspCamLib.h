@@ -2,7 +2,13 @@
 #define ESPCAMLIB
 
 #include "./EspCamLib/Camera.h"
+#include "./EspCamLib/FrameBroker.h"
+#include "./EspCamLib/SyntheticSource.h"
+#include "./EspCamLib/MotionDetector.h"
+#include "./EspCamLib/RateController.h"
 #include "./EspCamLib/Recorder.h"
+#include "./EspCamLib/RtspServer.h"
+#include "./EspCamLib/StripExecutor.h"
 #include "./EspCamLib/WebServer.h"
 #include "./EspCamLib/WebStream.h"
 
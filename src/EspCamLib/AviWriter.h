@@ -0,0 +1,286 @@
+#ifndef ESPCAMLIB_AVIWRITER_H
+#define ESPCAMLIB_AVIWRITER_H
+#include <Arduino.h>
+#include "FS.h"
+
+// RIFF/AVI muxer for MJPEG at a constant frame rate, frames go into 'movi' and the index is kept in PSRAM until
+// finish() writes 'idx1', output goes to any Print (a File or a WriteBuffer) and the final header is patched into
+// the file afterwards. Timing is up to the caller, see FramePacer
+namespace EspCam
+{
+    class AviWriter
+    {
+    public:
+        static const size_t HEADER_SIZE = 224;
+        // RIFF and LIST sizes are 32 bit, a file has to end before the RIFF size would wrap
+        static const uint32_t MAX_FILE_SIZE = 0xFFFFFFFF;
+
+    private:
+        static const size_t INDEX_BLOCK = 4096;
+        static const size_t AVIH_OFFSET = 32;
+        static const size_t STRH_OFFSET = 108;
+        static const size_t MOVI_OFFSET = 220;
+
+        Print *m_out = nullptr;
+        uint16_t m_width = 0;
+        uint16_t m_height = 0;
+        int m_frameRate = 30;
+        // one entry per frame holding the chunk size, offsets are rebuilt from the sizes when writing idx1
+        uint32_t *m_index = nullptr;
+        size_t m_indexCapacity = 0;
+        uint32_t m_frames = 0;
+        uint32_t m_moviSize = 4;
+        uint32_t m_maxFrameSize = 0;
+        uint32_t m_repeats = 0;
+        uint32_t m_maxFileSize = MAX_FILE_SIZE;
+
+        static void put16(uint8_t *p, uint16_t v)
+        {
+            p[0] = v & 0xFF;
+            p[1] = v >> 8;
+        }
+
+        static void put32(uint8_t *p, uint32_t v)
+        {
+            p[0] = v & 0xFF;
+            p[1] = (v >> 8) & 0xFF;
+            p[2] = (v >> 16) & 0xFF;
+            p[3] = v >> 24;
+        }
+
+        static void putTag(uint8_t *p, const char *tag)
+        {
+            memcpy(p, tag, 4);
+        }
+
+        bool growIndex()
+        {
+            size_t capacity = m_indexCapacity + INDEX_BLOCK;
+            void *index = psramFound() ? ps_realloc(m_index, capacity * sizeof(uint32_t)) : realloc(m_index, capacity * sizeof(uint32_t));
+            if (!index)
+                return false;
+
+            m_index = (uint32_t *)index;
+            m_indexCapacity = capacity;
+            return true;
+        }
+
+        void buildHeader(uint8_t *h)
+        {
+            memset(h, 0, HEADER_SIZE);
+            int fps = m_frameRate > 0 ? m_frameRate : 1;
+            uint32_t interval = 1000000 / fps;
+            uint32_t riffSize = HEADER_SIZE - 8 + m_moviSize - 4 + 8 + m_frames * 16;
+
+            putTag(h + 0, "RIFF");
+            put32(h + 4, riffSize);
+            putTag(h + 8, "AVI ");
+            putTag(h + 12, "LIST");
+            put32(h + 16, 192);
+            putTag(h + 20, "hdrl");
+
+            putTag(h + 24, "avih");
+            put32(h + 28, 56);
+            uint8_t *avih = h + AVIH_OFFSET;
+            put32(avih + 0, interval);
+            put32(avih + 4, (uint32_t)((uint64_t)m_maxFrameSize * 1000000 / interval));
+            put32(avih + 12, 0x10);
+            put32(avih + 16, m_frames);
+            put32(avih + 24, 1);
+            put32(avih + 28, m_maxFrameSize);
+            put32(avih + 32, m_width);
+            put32(avih + 36, m_height);
+
+            putTag(h + 88, "LIST");
+            put32(h + 92, 116);
+            putTag(h + 96, "strl");
+
+            putTag(h + 100, "strh");
+            put32(h + 104, 56);
+            uint8_t *strh = h + STRH_OFFSET;
+            putTag(strh + 0, "vids");
+            putTag(strh + 4, "MJPG");
+            put32(strh + 20, 1);
+            put32(strh + 24, fps);
+            put32(strh + 32, m_frames);
+            put32(strh + 36, m_maxFrameSize);
+            put32(strh + 40, 0xFFFFFFFF);
+            put16(strh + 52, m_width);
+            put16(strh + 54, m_height);
+
+            putTag(h + 164, "strf");
+            put32(h + 168, 40);
+            uint8_t *strf = h + 172;
+            put32(strf + 0, 40);
+            put32(strf + 4, m_width);
+            put32(strf + 8, m_height);
+            put16(strf + 12, 1);
+            put16(strf + 14, 24);
+            putTag(strf + 16, "MJPG");
+            put32(strf + 20, (uint32_t)m_width * m_height * 3);
+
+            putTag(h + 212, "LIST");
+            put32(h + 216, m_moviSize);
+            putTag(h + MOVI_OFFSET, "movi");
+        }
+
+    public:
+        ~AviWriter()
+        {
+            free(m_index);
+        }
+
+        uint32_t getFrameCount()
+        {
+            return m_frames;
+        }
+
+        // frames that repeat the previous one, included in getFrameCount()
+        uint32_t getRepeatCount()
+        {
+            return m_repeats;
+        }
+
+        // bytes written to the file so far, not counting the idx1 written by finish()
+        uint32_t getSize()
+        {
+            return MOVI_OFFSET + m_moviSize;
+        }
+
+        // the finished file, idx1 included, stays at or below `bytes`, addFrame() refuses frames past that
+        void setMaxFileSize(uint32_t bytes)
+        {
+            m_maxFileSize = bytes;
+        }
+
+        // whether a frame of `len` bytes after `repeats` repeats still fits under the file size limit
+        bool hasRoomFor(size_t len, uint32_t repeats = 0)
+        {
+            uint64_t size = (uint64_t)getFileSize() + (uint64_t)repeats * (8 + 16) + 8 + len + (len & 1) + 16;
+            return size <= m_maxFileSize;
+        }
+
+        bool begin(Print *out, uint16_t width, uint16_t height, int fps)
+        {
+            m_out = out;
+            m_width = width;
+            m_height = height;
+            m_frameRate = fps;
+            m_frames = 0;
+            m_moviSize = 4;
+            m_maxFrameSize = 0;
+            m_repeats = 0;
+
+            if (!m_index && !growIndex())
+                return false;
+
+            uint8_t header[HEADER_SIZE];
+            buildHeader(header);
+            return m_out->write(header, HEADER_SIZE) == HEADER_SIZE;
+        }
+
+        bool addFrame(const uint8_t *data, size_t len)
+        {
+            if (!hasRoomFor(len))
+                return false;
+            if (m_frames >= m_indexCapacity && !growIndex())
+                return false;
+
+            uint8_t chunk[8];
+            putTag(chunk, "00dc");
+            put32(chunk + 4, len);
+            if (m_out->write(chunk, 8) != 8 || m_out->write(data, len) != len)
+                return false;
+
+            uint32_t padded = len + (len & 1);
+            if (len & 1)
+            {
+                m_out->write((uint8_t)0);
+            }
+
+            m_index[m_frames++] = len;
+            m_moviSize += 8 + padded;
+            if (len > m_maxFrameSize)
+                m_maxFrameSize = len;
+            return true;
+        }
+
+        // one frame interval showing the previous frame again, an empty chunk players treat as a dropped frame
+        bool addRepeat()
+        {
+            if (m_frames == 0)
+                return false;
+            if (!addFrame(nullptr, 0))
+                return false;
+            m_repeats++;
+            return true;
+        }
+
+        bool isStarted()
+        {
+            return m_out != nullptr;
+        }
+
+        // drops a file that will not be finished, the next begin() writes a new header
+        void reset()
+        {
+            m_out = nullptr;
+        }
+
+        // size of the complete file once finish() has added idx1
+        uint32_t getFileSize()
+        {
+            return getSize() + 8 + m_frames * 16;
+        }
+
+        // writes idx1 after the last frame to `out`, which is normally the file the buffered frames ended up in
+        bool finish(Print *out)
+        {
+            if (!m_out)
+                return false;
+
+            uint8_t entries[32 * 16];
+            size_t used = 0;
+            uint32_t offset = 4;
+            bool ok = true;
+
+            uint8_t idxHeader[8];
+            putTag(idxHeader, "idx1");
+            put32(idxHeader + 4, m_frames * 16);
+            ok &= out->write(idxHeader, 8) == 8;
+
+            for (uint32_t i = 0; i < m_frames; i++)
+            {
+                uint8_t *e = entries + used;
+                putTag(e, "00dc");
+                put32(e + 4, 0x10);
+                put32(e + 8, offset);
+                put32(e + 12, m_index[i]);
+                used += 16;
+                offset += 8 + m_index[i] + (m_index[i] & 1);
+
+                if (used == sizeof(entries))
+                {
+                    ok &= out->write(entries, used) == used;
+                    used = 0;
+                }
+            }
+            if (used)
+            {
+                ok &= out->write(entries, used) == used;
+            }
+
+            m_out = nullptr;
+            return ok;
+        }
+
+        // patches sizes and frame count into the header of the finished file
+        bool writeHeader(File &file)
+        {
+            uint8_t header[HEADER_SIZE];
+            buildHeader(header);
+            return file.seek(0) && file.write(header, HEADER_SIZE) == HEADER_SIZE;
+        }
+    };
+}
+#endif
@@ -2,19 +2,140 @@
 #define ESPCAMLIB_CAMERA_H
 #include <Arduino.h>
 #include "esp_camera.h"
+#include "esp_timer.h"
 #include "./BoardDefs.h"
+#include "./SensorProfile.h"
+#include "./SensorQueue.h"
+#include "./SensorWindow.h"
 #include "soc/soc.h"
 #include "soc/rtc_cntl_reg.h"
 
 namespace EspCam
 {
+    class FrameBroker;
+
+    // replaces the esp_camera driver as the origin of frames, e.g. for simulation on boards without a sensor
+    class FrameSource
+    {
+    public:
+        virtual ~FrameSource() {}
+        virtual bool begin(const camera_config_t *config) = 0;
+        virtual camera_fb_t *get() = 0;
+        virtual void release(camera_fb_t *fb) = 0;
+    };
+
+    // where the time of the last begin() went, all in microseconds from the start of begin()
+    struct CameraStartup
+    {
+        // a stored profile was restored
+        bool warm;
+        uint32_t initUs;
+        uint32_t restoreUs;
+        // first frame handed out by getFrame(), 0 until there is one
+        uint32_t firstFrameUs;
+    };
+
     class Camera
     {
 
     private:
         BoardDef boardDef;
         camera_config_t config;
-        int flashPin;
+        int flashPin = -1;
+        FrameBroker *broker = nullptr;
+        FrameSource *source = nullptr;
+        SensorQueue sensorQueue;
+        // while frames are being captured, sensor writes wait for the capture task
+        volatile bool deferSensor = false;
+        volatile framesize_t sensorFrameSize = FRAMESIZE_VGA;
+        volatile pixformat_t sensorPixelFormat = PIXFORMAT_JPEG;
+        int flashLevel = 0;
+        ProfileStore *profileStore = nullptr;
+        // last profile read or written, saveProfile() skips the flash write when nothing changed
+        SensorProfile profile;
+        int64_t beginStart = 0;
+        CameraStartup startup = {};
+        // region of interest as adjusted to the sensor, read by the capture task when it programs the window
+        CameraRegion region = {};
+        SensorWindow window = {};
+        // as asked for, before the adjustment
+        CameraRegion requested = {};
+        portMUX_TYPE regionMux = portMUX_INITIALIZER_UNLOCKED;
+
+        // the window goes in after the frame size, which sets the output size the driver reports and
+        // resets the sensor to the full field
+        int applySetting(sensor_t *s, int setting, int value)
+        {
+            if (setting != SENSOR_WINDOW && setting != SENSOR_FRAMESIZE)
+                return SensorQueue::apply(s, setting, value);
+
+            portENTER_CRITICAL(&regionMux);
+            CameraRegion r = region;
+            CameraRegion want = requested;
+            SensorWindow w = window;
+            portEXIT_CRITICAL(&regionMux);
+
+            if (setting == SENSOR_FRAMESIZE || !r.active)
+            {
+                int res = s->set_framesize(s, (framesize_t)(setting == SENSOR_FRAMESIZE ? value : sensorFrameSize));
+                if (!r.active || res != 0)
+                    return res;
+                // a sensor only size change, e.g. from the rate controller, keeps the region at the new size
+                r = want;
+                r.output = (framesize_t)value;
+                if (!SensorWindowMapper::map(r, w))
+                    return -1;
+                portENTER_CRITICAL(&regionMux);
+                region = r;
+                window = w;
+                portEXIT_CRITICAL(&regionMux);
+            }
+
+            if (s->id.PID != OV2640_PID || !s->set_res_raw)
+                return -1;
+            if (s->status.framesize != r.output && s->set_framesize(s, r.output) != 0)
+                return -1;
+            return s->set_res_raw(s, w.mode, 0, 0, 0, w.offsetX, w.offsetY, w.width, w.height,
+                                  w.outputWidth, w.outputHeight, false, false);
+        }
+
+        // takes the stored config over the one set up before begin()
+        bool loadProfile()
+        {
+            memset(&profile, 0, sizeof(profile));
+            if (!profileStore->load(&profile, sizeof(profile)) || !profile.isValid())
+            {
+                memset(&profile, 0, sizeof(profile));
+                return false;
+            }
+
+            config.pixel_format = (pixformat_t)profile.pixelFormat;
+            config.frame_size = (framesize_t)profile.frameSize;
+            config.jpeg_quality = profile.jpegQuality;
+            config.fb_count = profile.fbCount;
+            config.fb_location = (camera_fb_location_t)profile.fbLocation;
+            config.grab_mode = (camera_grab_mode_t)profile.grabMode;
+            config.xclk_freq_hz = profile.xclkFreqHz;
+            return true;
+        }
+
+        // format, size and quality already came in through the config, the rest is written in one pass,
+        // skipping the ones the driver already has at the stored value
+        void restoreSensor()
+        {
+            sensor_t *s = esp_camera_sensor_get();
+            if (s && s->id.PID == profile.sensorPid)
+            {
+                for (int i = SENSOR_QUALITY + 1; i < SENSOR_SETTING_COUNT; i++)
+                {
+                    if (SensorQueue::read(s, i) != profile.settings[i])
+                        SensorQueue::apply(s, i, profile.settings[i]);
+                }
+                if (profile.hasExposure)
+                    SensorProfile::writeExposure(s, profile.exposure, profile.gain);
+            }
+            setFlash(profile.flash);
+        }
 
     public:
         Camera()
@@ -38,13 +159,86 @@ namespace EspCam
 
         bool begin()
         {
-            if (config.pin_pwdn != -1)
+            beginStart = esp_timer_get_time();
+            memset(&startup, 0, sizeof(startup));
+            startup.warm = profileStore && loadProfile();
+
+            sensorFrameSize = config.frame_size;
+            sensorPixelFormat = config.pixel_format;
+            bool ok;
+            if (source)
+            {
+                ok = source->begin(&config);
+            }
+            else
+            {
+                if (config.pin_pwdn != -1)
+                {
+                    digitalWrite(config.pin_pwdn, LOW);
+                    delay(10);
+                }
+                ok = esp_camera_init(&config) == ESP_OK;
+            }
+            startup.initUs = esp_timer_get_time() - beginStart;
+
+            if (ok && startup.warm)
             {
-                digitalWrite(config.pin_pwdn, LOW);
-                delay(10);
+                restoreSensor();
+                startup.restoreUs = esp_timer_get_time() - beginStart - startup.initUs;
             }
-            esp_err_t err = esp_camera_init(&config);
-            return err == ESP_OK;
+            return ok;
+        }
+
+        // must be called before begin(). A valid stored profile then replaces the format, size, quality,
+        // framebuffer and clock settings made before begin() and is written to the sensor right after init
+        void setProfileStore(ProfileStore *store)
+        {
+            profileStore = store;
+        }
+
+        // stores the current config, sensor settings, flash level and exposure, e.g. right before deep sleep.
+        // Nothing is written when it matches what is already stored
+        bool saveProfile()
+        {
+            sensor_t *s = esp_camera_sensor_get();
+            if (!profileStore || !s)
+                return false;
+
+            SensorProfile current;
+            memset(&current, 0, sizeof(current));
+            current.sensorPid = s->id.PID;
+            current.flash = flashLevel;
+            current.pixelFormat = config.pixel_format;
+            current.frameSize = config.frame_size;
+            current.jpegQuality = config.jpeg_quality;
+            current.fbCount = config.fb_count;
+            current.fbLocation = config.fb_location;
+            current.grabMode = config.grab_mode;
+            current.xclkFreqHz = config.xclk_freq_hz;
+            for (int i = 0; i < SENSOR_SETTING_COUNT; i++)
+            {
+                current.settings[i] = SensorQueue::read(s, i);
+            }
+            current.hasExposure = SensorProfile::readExposure(s, current.exposure, current.gain);
+            current.seal();
+
+            if (memcmp(&current, &profile, sizeof(profile)) == 0)
+                return true;
+            if (!profileStore->save(&current, sizeof(current)))
+                return false;
+            profile = current;
+            return true;
+        }
+
+        bool eraseProfile()
+        {
+            memset(&profile, 0, sizeof(profile));
+            return profileStore && profileStore->erase();
+        }
+
+        CameraStartup getStartup()
+        {
+            return startup;
         }
 
         void setPinout(void (*boardDefFunc)(BoardDef *))
@@ -84,33 +278,135 @@ namespace EspCam
             }
         }
 
-        void setFrameSize(framesize_t frameSize)
+        // back to the full field, any region of interest is dropped
+        uint32_t setFrameSize(framesize_t frameSize)
         {
+            portENTER_CRITICAL(&regionMux);
+            region.active = false;
+            requested.active = false;
+            portEXIT_CRITICAL(&regionMux);
             config.frame_size = frameSize;
-            sensor_t *s = esp_camera_sensor_get();
-            if (s) {
-                s->set_framesize(s, frameSize);
+            return setSensor(SENSOR_FRAMESIZE, frameSize);
+        }
+
+        // streams only `width` x `height` full field pixels at `x`,`y` (see SensorWindowMapper, OV2640 only),
+        // scaled to `output`. The region is widened to the output's aspect and to at least its size,
+        // getRegionOfInterest() has the result. False when the region was rejected, the current one then
+        // stays and `ticket` is left alone, otherwise `ticket` is set like setSensor() returns it
+        bool setRegionOfInterest(uint16_t x, uint16_t y, uint16_t width, uint16_t height, framesize_t output, uint32_t &ticket)
+        {
+            CameraRegion next = {true, x, y, width, height, output};
+            SensorWindow nextWindow;
+            if (!supportsRegionOfInterest() || !SensorWindowMapper::map(next, nextWindow))
+                return false;
+
+            portENTER_CRITICAL(&regionMux);
+            requested = {true, x, y, width, height, output};
+            region = next;
+            window = nextWindow;
+            portEXIT_CRITICAL(&regionMux);
+            config.frame_size = output;
+            sensorFrameSize = output;
+            ticket = setSensor(SENSOR_WINDOW, 1);
+            return true;
+        }
+
+        bool setRegionOfInterest(uint16_t x, uint16_t y, uint16_t width, uint16_t height, framesize_t output)
+        {
+            uint32_t ticket;
+            return setRegionOfInterest(x, y, width, height, output, ticket);
+        }
+
+        bool setRegionOfInterest(const CameraRegion &roi, uint32_t &ticket)
+        {
+            if (!roi.active)
+            {
+                clearRegionOfInterest(ticket);
+                return true;
             }
+            return setRegionOfInterest(roi.x, roi.y, roi.width, roi.height, roi.output, ticket);
         }
 
-        void setPixelFormat(pixformat_t format)
+        // digital zoom: the central 1/`factor` of the field, or around `centerX`,`centerY` given as fractions
+        // of it, at the current output size. The output size limits how far it goes, the DSP does not scale up.
+        // False when the region was rejected, like setRegionOfInterest()
+        bool setZoom(float factor, float centerX, float centerY, uint32_t &ticket)
         {
-            config.pixel_format = format;
-            sensor_t *s = esp_camera_sensor_get();
-            if (s) {
-                s->set_pixformat(s, format);
+            if (factor <= 1.0f)
+            {
+                clearRegionOfInterest(ticket);
+                return true;
             }
+
+            uint16_t width = SensorWindowMapper::FIELD_WIDTH / factor;
+            uint16_t height = SensorWindowMapper::FIELD_HEIGHT / factor;
+            int x = (int)(centerX * SensorWindowMapper::FIELD_WIDTH) - width / 2;
+            int y = (int)(centerY * SensorWindowMapper::FIELD_HEIGHT) - height / 2;
+            return setRegionOfInterest(x < 0 ? 0 : x, y < 0 ? 0 : y, width, height, config.frame_size, ticket);
         }
 
-        void setJpegQuality(int quality)
+        bool setZoom(float factor, float centerX = 0.5f, float centerY = 0.5f)
         {
-            config.jpeg_quality = quality;
-            sensor_t *s = esp_camera_sensor_get();
-            if (s) {
-                s->set_quality(s, quality);
+            uint32_t ticket;
+            return setZoom(factor, centerX, centerY, ticket);
+        }
+
+        // `ticket` is only set when a region was active and the sensor goes back to the full field
+        void clearRegionOfInterest(uint32_t &ticket)
+        {
+            portENTER_CRITICAL(&regionMux);
+            bool active = region.active;
+            region.active = false;
+            requested.active = false;
+            portEXIT_CRITICAL(&regionMux);
+            if (active)
+            {
+                ticket = setSensor(SENSOR_WINDOW, 0);
             }
         }
 
+        void clearRegionOfInterest()
+        {
+            uint32_t ticket;
+            clearRegionOfInterest(ticket);
+        }
+
+        bool supportsRegionOfInterest()
+        {
+            sensor_t *s = source ? nullptr : esp_camera_sensor_get();
+            return s && s->id.PID == OV2640_PID && s->set_res_raw;
+        }
+
+        // the region as the sensor delivers it, `active` is false for the full field
+        CameraRegion getRegionOfInterest()
+        {
+            portENTER_CRITICAL(&regionMux);
+            CameraRegion current = region;
+            portEXIT_CRITICAL(&regionMux);
+            return current;
+        }
+
+        // the region as last passed to setRegionOfInterest(), for changing one edge of it at a time
+        CameraRegion getRequestedRegion()
+        {
+            portENTER_CRITICAL(&regionMux);
+            CameraRegion current = requested;
+            portEXIT_CRITICAL(&regionMux);
+            return current;
+        }
+
+        uint32_t setPixelFormat(pixformat_t format)
+        {
+            config.pixel_format = format;
+            return setSensor(SENSOR_PIXFORMAT, format);
+        }
+
+        uint32_t setJpegQuality(int quality)
+        {
+            config.jpeg_quality = quality;
+            return setSensor(SENSOR_QUALITY, quality);
+        }
+
         void setFramebufferCount(size_t count)
         {
             config.fb_count = count;
@@ -122,6 +418,7 @@ namespace EspCam
             {
                 return;
             }
+            flashLevel = brightness;
             ledcWrite(LEDC_CHANNEL_1, brightness);
         }
 
@@ -135,13 +432,9 @@ namespace EspCam
             return false;
         }
 
-        void setVFlip(bool vflip)
+        uint32_t setVFlip(bool vflip)
         {
-            sensor_t *s = esp_camera_sensor_get();
-            if (s)
-            {
-                s->set_vflip(s, vflip ? 1 : 0);
-            }
+            return setSensor(SENSOR_VFLIP, vflip ? 1 : 0);
         }
 
         bool getHFlip()
@@ -154,23 +447,106 @@ namespace EspCam
             return false;
         }
 
-        void setHFlip(bool hmirror)
+        uint32_t setHFlip(bool hmirror)
+        {
+            return setSensor(SENSOR_HMIRROR, hmirror ? 1 : 0);
+        }
+
+        // writes a sensor register setting without touching the stored config. While the FrameBroker
+        // captures it is queued for the capture task, which applies it between frames; the returned
+        // ticket can be passed to waitForSensor(), 0 means it was applied right away
+        uint32_t setSensor(SensorSetting setting, int value)
         {
+            if (setting == SENSOR_FRAMESIZE)
+                sensorFrameSize = (framesize_t)value;
+            else if (setting == SENSOR_PIXFORMAT)
+                sensorPixelFormat = (pixformat_t)value;
+
+            if (deferSensor)
+            {
+                return sensorQueue.post(setting, value);
+            }
             sensor_t *s = esp_camera_sensor_get();
             if (s)
             {
-                s->set_hmirror(s, hmirror ? 1 : 0);
+                applySetting(s, setting, value);
             }
+            return 0;
+        }
+
+        // true once the frames coming out of the broker reflect the change behind `ticket`
+        bool waitForSensor(uint32_t ticket, TickType_t timeout = pdMS_TO_TICKS(1000))
+        {
+            return ticket == 0 || sensorQueue.waitApplied(ticket, timeout);
+        }
+
+        // capture task side, see FrameBroker
+        void setSensorDeferred(bool defer)
+        {
+            deferSensor = defer;
+        }
+
+        // applies every queued setting in SensorSetting order, returns the bits that were applied. `ticket`
+        // is the one to complete once a frame shows them, 0 when nothing is outstanding. It can come
+        // with no bits, for settings an earlier call took before their ticket was counted
+        uint32_t applySensorQueue(uint32_t &ticket)
+        {
+            ticket = 0;
+            if (!sensorQueue.pending())
+                return 0;
+
+            int values[SENSOR_SETTING_COUNT];
+            uint32_t mask = sensorQueue.take(values, ticket);
+            sensor_t *s = esp_camera_sensor_get();
+            for (int i = 0; s && i < SENSOR_SETTING_COUNT; i++)
+            {
+                if (mask & (1u << i))
+                    applySetting(s, i, values[i]);
+            }
+            return mask;
+        }
+
+        void completeSensorQueue(uint32_t ticket)
+        {
+            sensorQueue.complete(ticket);
+        }
+
+        // false for frames still in the previous size or format after a geometry change
+        bool frameMatchesSensor(camera_fb_t *fb)
+        {
+            // a frame source keeps its own geometry
+            if (source)
+                return true;
+            if (fb->format != sensorPixelFormat)
+                return false;
+            framesize_t size = sensorFrameSize;
+            return size >= FRAMESIZE_INVALID || (fb->width == resolution[size].width && fb->height == resolution[size].height);
+        }
+
+        // must be called before begin()
+        void setFrameSource(FrameSource *frameSource)
+        {
+            source = frameSource;
         }
 
         camera_fb_t *getFrame()
         {
-            return esp_camera_fb_get();
+            camera_fb_t *fb = source ? source->get() : esp_camera_fb_get();
+            if (fb && !startup.firstFrameUs)
+            {
+                startup.firstFrameUs = esp_timer_get_time() - beginStart;
+            }
+            return fb;
         }
 
         void releaseFrame(camera_fb_t *fb)
         {   
             if(!fb) return;
+            if (source)
+            {
+                source->release(fb);
+                return;
+            }
             esp_camera_fb_return(fb);
         }
 
@@ -178,6 +554,19 @@ namespace EspCam
         {
             return config.pixel_format;
         }
+
+        framesize_t getFrameSize()
+        {
+            return config.frame_size;
+        }
+
+        int getJpegQuality()
+        {
+            return config.jpeg_quality;
+        }
+
+        // shared frame source for every consumer of this camera, defined in FrameBroker.h
+        FrameBroker *getBroker();
     };
 }
 #endif
\ No newline at end of file
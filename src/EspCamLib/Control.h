@@ -0,0 +1,184 @@
+#ifndef ESPCAMLIB_CONTROL_H
+#define ESPCAMLIB_CONTROL_H
+#include <Arduino.h>
+#include "esp_camera.h"
+
+#include "Camera.h"
+
+// name to setting dispatch for the camera settings exposed over HTTP. Keys are switched on a compile
+// time FNV-1a hash, so a lookup is one hash and one string compare, and two keys with the same hash
+// fail to compile as duplicate case labels. Sensor settings go through Camera::setSensor(), so they
+// are applied by the capture task between frames
+namespace EspCam
+{
+    enum ControlResult
+    {
+        CONTROL_OK,
+        CONTROL_UNKNOWN,
+        CONTROL_UNSUPPORTED,
+        CONTROL_FAILED
+    };
+
+    constexpr uint32_t controlHash(const char *key, uint32_t hash = 2166136261u)
+    {
+        return *key ? controlHash(key + 1, (hash ^ (uint8_t)*key) * 16777619u) : hash;
+    }
+
+    class CameraControl
+    {
+    private:
+        static ControlResult postSensor(Camera *camera, SensorSetting setting, int value, uint32_t &ticket)
+        {
+            sensor_t *s = esp_camera_sensor_get();
+            if (!s || !SensorQueue::supported(s, setting))
+                return CONTROL_UNSUPPORTED;
+            ticket = camera->setSensor(setting, value);
+            return CONTROL_OK;
+        }
+
+        // changes one field of the requested region, starting from the full field at the current size
+        static ControlResult postRegion(Camera *camera, char field, int value, uint32_t &ticket)
+        {
+            if (!camera->supportsRegionOfInterest())
+                return CONTROL_UNSUPPORTED;
+            if (value < 0)
+                return CONTROL_FAILED;
+
+            CameraRegion roi = camera->getRequestedRegion();
+            if (!roi.active)
+                roi = {true, 0, 0, SensorWindowMapper::FIELD_WIDTH, SensorWindowMapper::FIELD_HEIGHT, camera->getFrameSize()};
+            switch (field)
+            {
+            case 'x':
+                roi.x = value;
+                break;
+            case 'y':
+                roi.y = value;
+                break;
+            case 'w':
+                roi.width = value;
+                break;
+            case 'h':
+                roi.height = value;
+                break;
+            default:
+                if (value >= FRAMESIZE_INVALID)
+                    return CONTROL_FAILED;
+                roi.output = (framesize_t)value;
+                break;
+            }
+            return camera->setRegionOfInterest(roi, ticket) ? CONTROL_OK : CONTROL_FAILED;
+        }
+
+    public:
+        static const char *resultName(ControlResult result)
+        {
+            switch (result)
+            {
+            case CONTROL_OK:
+                return "ok";
+            case CONTROL_UNKNOWN:
+                return "unknown";
+            case CONTROL_UNSUPPORTED:
+                return "unsupported";
+            default:
+                return "failed";
+            }
+        }
+
+        // applies one setting, `camera` keeps track of the ones it also stores in its own config.
+        // `ticket` is set for queued sensor writes, see Camera::waitForSensor()
+        static ControlResult apply(Camera *camera, const char *key, int value, uint32_t &ticket)
+        {
+#define ESPCAM_CONTROL(name) \
+    case controlHash(name):  \
+        if (strcmp(key, name) != 0) \
+            return CONTROL_UNKNOWN;
+#define ESPCAM_SENSOR_CONTROL(name, setting) \
+    ESPCAM_CONTROL(name)                     \
+    return postSensor(camera, setting, value, ticket);
+
+            switch (controlHash(key))
+            {
+                ESPCAM_CONTROL("framesize")
+                if (value < 0 || value >= FRAMESIZE_INVALID)
+                    return CONTROL_FAILED;
+                ticket = camera->setFrameSize((framesize_t)value);
+                return CONTROL_OK;
+
+                ESPCAM_CONTROL("quality")
+                if (value < 0 || value > 63)
+                    return CONTROL_FAILED;
+                ticket = camera->setJpegQuality(value);
+                return CONTROL_OK;
+
+                // region of interest in full field pixels, roi=0 goes back to the full field
+                ESPCAM_CONTROL("roi")
+                if (value != 0)
+                    return CONTROL_FAILED;
+                camera->clearRegionOfInterest(ticket);
+                return CONTROL_OK;
+
+                ESPCAM_CONTROL("roi_x")
+                return postRegion(camera, 'x', value, ticket);
+                ESPCAM_CONTROL("roi_y")
+                return postRegion(camera, 'y', value, ticket);
+                ESPCAM_CONTROL("roi_w")
+                return postRegion(camera, 'w', value, ticket);
+                ESPCAM_CONTROL("roi_h")
+                return postRegion(camera, 'h', value, ticket);
+                ESPCAM_CONTROL("roi_size")
+                return postRegion(camera, 's', value, ticket);
+
+                // digital zoom in percent around the centre of the current region, 100 is the full field
+                ESPCAM_CONTROL("zoom")
+                {
+                    if (!camera->supportsRegionOfInterest())
+                        return CONTROL_UNSUPPORTED;
+                    CameraRegion roi = camera->getRegionOfInterest();
+                    float centerX = roi.active ? (roi.x + roi.width / 2) / (float)SensorWindowMapper::FIELD_WIDTH : 0.5f;
+                    float centerY = roi.active ? (roi.y + roi.height / 2) / (float)SensorWindowMapper::FIELD_HEIGHT : 0.5f;
+                    return camera->setZoom(value / 100.0f, centerX, centerY, ticket) ? CONTROL_OK : CONTROL_FAILED;
+                }
+
+                ESPCAM_CONTROL("flash")
+                camera->setFlash(value);
+                return CONTROL_OK;
+
+                // negative values flip the current state, which is what the UI buttons send
+                ESPCAM_SENSOR_CONTROL("vflip", SENSOR_VFLIP)
+                ESPCAM_SENSOR_CONTROL("hmirror", SENSOR_HMIRROR)
+
+                ESPCAM_SENSOR_CONTROL("contrast", SENSOR_CONTRAST)
+                ESPCAM_SENSOR_CONTROL("brightness", SENSOR_BRIGHTNESS)
+                ESPCAM_SENSOR_CONTROL("saturation", SENSOR_SATURATION)
+                ESPCAM_SENSOR_CONTROL("sharpness", SENSOR_SHARPNESS)
+                ESPCAM_SENSOR_CONTROL("denoise", SENSOR_DENOISE)
+                ESPCAM_SENSOR_CONTROL("gainceiling", SENSOR_GAINCEILING)
+                ESPCAM_SENSOR_CONTROL("colorbar", SENSOR_COLORBAR)
+                ESPCAM_SENSOR_CONTROL("awb", SENSOR_AWB)
+                ESPCAM_SENSOR_CONTROL("agc", SENSOR_AGC)
+                ESPCAM_SENSOR_CONTROL("aec", SENSOR_AEC)
+                ESPCAM_SENSOR_CONTROL("aec2", SENSOR_AEC2)
+                ESPCAM_SENSOR_CONTROL("awb_gain", SENSOR_AWB_GAIN)
+                ESPCAM_SENSOR_CONTROL("agc_gain", SENSOR_AGC_GAIN)
+                ESPCAM_SENSOR_CONTROL("aec_value", SENSOR_AEC_VALUE)
+                ESPCAM_SENSOR_CONTROL("special_effect", SENSOR_SPECIAL_EFFECT)
+                ESPCAM_SENSOR_CONTROL("wb_mode", SENSOR_WB_MODE)
+                ESPCAM_SENSOR_CONTROL("ae_level", SENSOR_AE_LEVEL)
+                ESPCAM_SENSOR_CONTROL("dcw", SENSOR_DCW)
+                ESPCAM_SENSOR_CONTROL("bpc", SENSOR_BPC)
+                ESPCAM_SENSOR_CONTROL("wpc", SENSOR_WPC)
+                ESPCAM_SENSOR_CONTROL("raw_gma", SENSOR_RAW_GMA)
+                ESPCAM_SENSOR_CONTROL("lenc", SENSOR_LENC)
+
+            default:
+                return CONTROL_UNKNOWN;
+            }
+
+#undef ESPCAM_SENSOR_CONTROL
+#undef ESPCAM_CONTROL
+        }
+    };
+}
+#endif
@@ -0,0 +1,626 @@
+#ifndef ESPCAMLIB_FRAMEBROKER_H
+#define ESPCAMLIB_FRAMEBROKER_H
+#include <Arduino.h>
+#include <atomic>
+#include "esp_camera.h"
+#include "esp_timer.h"
+
+#include "Camera.h"
+#include "JpegEncoder.h"
+#include "Latency.h"
+#include "Metrics.h"
+
+// captures once per sensor frame and shares it between every consumer. Each frame is copied out of the
+// driver's buffer into one the broker owns and the driver gets its buffer back right away, so consumers
+// that hold on to frames never starve the capture. Raw frames are JPEG encoded in software the first time
+// a consumer asks for the data, once per frame however many consumers there are
+namespace EspCam
+{
+    class FrameBroker;
+
+    struct FrameSlot
+    {
+        // &frame while the slot holds a frame, null while it is free
+        std::atomic<camera_fb_t *> fb;
+        std::atomic<int> refs;
+        // the copy of the driver's frame, the buffer is kept and reused by the next frame in this slot
+        camera_fb_t frame;
+        uint8_t *buffer;
+        size_t capacity;
+        uint32_t sequence;
+        int64_t timestamp;
+        FrameBroker *owner;
+        // software JPEG of a raw frame, the buffer is kept and reused by the next frame in this slot
+        std::atomic<int> encodeState;
+        uint8_t *jpeg;
+        size_t jpegCapacity;
+        size_t jpegLength;
+        // the second band of a strip-parallel encode
+        uint8_t *spill;
+        size_t spillCapacity;
+    };
+
+    // ref-counted handle on a brokered frame, the slot is free again when the last handle is dropped
+    class FrameRef
+    {
+    private:
+        FrameSlot *m_slot = nullptr;
+
+        void retain()
+        {
+            if (m_slot)
+            {
+                m_slot->refs.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+    public:
+        FrameRef() {}
+
+        explicit FrameRef(FrameSlot *slot) : m_slot(slot)
+        {
+            retain();
+        }
+
+        FrameRef(const FrameRef &other) : m_slot(other.m_slot)
+        {
+            retain();
+        }
+
+        FrameRef(FrameRef &&other) : m_slot(other.m_slot)
+        {
+            other.m_slot = nullptr;
+        }
+
+        FrameRef &operator=(const FrameRef &other)
+        {
+            if (this != &other)
+            {
+                reset();
+                m_slot = other.m_slot;
+                retain();
+            }
+            return *this;
+        }
+
+        FrameRef &operator=(FrameRef &&other)
+        {
+            if (this != &other)
+            {
+                reset();
+                m_slot = other.m_slot;
+                other.m_slot = nullptr;
+            }
+            return *this;
+        }
+
+        ~FrameRef()
+        {
+            reset();
+        }
+
+        inline void reset();
+
+        // hands the reference over as a raw slot, e.g. to pass it through a FreeRTOS queue
+        FrameSlot *detach()
+        {
+            FrameSlot *slot = m_slot;
+            m_slot = nullptr;
+            return slot;
+        }
+
+        // takes back a reference previously given away with detach()
+        static FrameRef adopt(FrameSlot *slot)
+        {
+            FrameRef ref;
+            ref.m_slot = slot;
+            return ref;
+        }
+
+        explicit operator bool() const
+        {
+            return m_slot != nullptr;
+        }
+
+        camera_fb_t *fb() const
+        {
+            return m_slot ? m_slot->fb.load(std::memory_order_relaxed) : nullptr;
+        }
+
+        // the frame as JPEG, for a raw frame the encoded copy. fb() keeps pointing at the raw pixels.
+        // Null with a length of 0 when the frame could not be encoded
+        inline const uint8_t *data() const;
+        inline size_t length() const;
+
+        uint32_t sequence() const
+        {
+            return m_slot ? m_slot->sequence : 0;
+        }
+
+        // capture time in microseconds since boot (esp_timer_get_time)
+        int64_t timestamp() const
+        {
+            return m_slot ? m_slot->timestamp : 0;
+        }
+    };
+
+    class FrameBroker
+    {
+    public:
+        // a broadcast client can hold the frame it is still writing besides the newest one, which all of
+        // them share. Enough for every client stalled on a different frame, plus the other consumers
+        static const int MAX_SLOTS = 12;
+        static const int MAX_WAITERS = 8;
+        static const int MAX_STALE_FRAMES = 4;
+
+        enum EncodeState
+        {
+            ENCODE_NONE,
+            ENCODE_BUSY,
+            ENCODE_DONE,
+            ENCODE_FAILED
+        };
+
+    private:
+        Camera *m_camera;
+        FrameSlot m_slots[MAX_SLOTS];
+        FrameSlot *m_latest = nullptr;
+        uint32_t m_sequence = 0;
+        TaskHandle_t m_waiters[MAX_WAITERS];
+        int m_waiterCount = 0;
+        std::atomic<int> m_demand{0};
+        SemaphoreHandle_t m_lock = NULL;
+        TaskHandle_t m_captureHandle = NULL;
+        volatile bool m_running = false;
+        int m_core = 1;
+        PipelineLatency m_latency;
+        Metrics m_metrics;
+        JpegEncoder m_encoder;
+        StripExecutor *m_encodeExecutor = nullptr;
+
+        // copies the driver's frame into a free slot, null when all are in use or there is no memory
+        FrameSlot *allocSlot(camera_fb_t *fb)
+        {
+            for (int i = 0; i < MAX_SLOTS; i++)
+            {
+                FrameSlot &slot = m_slots[i];
+                camera_fb_t *expected = nullptr;
+                if (slot.refs.load() != 0 || !slot.fb.compare_exchange_strong(expected, &slot.frame))
+                    continue;
+
+                // JPEG sizes vary from frame to frame, some headroom saves growing the buffer every time
+                if (slot.capacity < fb->len)
+                {
+                    free(slot.buffer);
+                    slot.capacity = fb->len + fb->len / 4;
+                    slot.buffer = (uint8_t *)(psramFound() ? ps_malloc(slot.capacity) : malloc(slot.capacity));
+                    if (!slot.buffer)
+                    {
+                        slot.capacity = 0;
+                        slot.fb.store(nullptr);
+                        return nullptr;
+                    }
+                }
+                memcpy(slot.buffer, fb->buf, fb->len);
+                slot.frame = *fb;
+                slot.frame.buf = slot.buffer;
+                slot.refs.store(1);
+                return &slot;
+            }
+            return nullptr;
+        }
+
+        void publish(FrameSlot *slot)
+        {
+            xSemaphoreTake(m_lock, portMAX_DELAY);
+            FrameSlot *previous = m_latest;
+            slot->sequence = ++m_sequence;
+            m_latest = slot;
+            for (int i = 0; i < m_waiterCount; i++)
+            {
+                xTaskNotifyGive(m_waiters[i]);
+            }
+            m_waiterCount = 0;
+            xSemaphoreGive(m_lock);
+
+            if (previous)
+            {
+                FrameRef::adopt(previous).reset();
+            }
+        }
+
+        static void captureTask(void *param)
+        {
+            FrameBroker *self = static_cast<FrameBroker *>(param);
+            Camera *camera = self->m_camera;
+            // sensor changes applied but not yet seen in a published frame
+            uint32_t pendingTicket = 0;
+            bool geometryChanged = false;
+            int staleFrames = 0;
+
+            while (self->m_running)
+            {
+                // sensor writes only happen here, between two frames
+                uint32_t ticket;
+                uint32_t applied = camera->applySensorQueue(ticket);
+                if (ticket)
+                {
+                    pendingTicket = ticket;
+                }
+                if (applied & SensorQueue::GEOMETRY_MASK)
+                {
+                    geometryChanged = true;
+                    staleFrames = 0;
+                }
+
+                // only pull frames from the sensor while somebody is waiting for one, or has said it will be
+                xSemaphoreTake(self->m_lock, portMAX_DELAY);
+                bool wanted = self->m_waiterCount > 0 || self->m_demand.load() > 0;
+                xSemaphoreGive(self->m_lock);
+                if (!wanted)
+                {
+                    if (pendingTicket)
+                    {
+                        camera->completeSensorQueue(pendingTicket);
+                        pendingTicket = 0;
+                        geometryChanged = false;
+                    }
+                    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+                    continue;
+                }
+
+                int64_t waitStart = esp_timer_get_time();
+                camera_fb_t *fb = self->m_camera->getFrame();
+                if (!fb)
+                {
+                    vTaskDelay(1);
+                    continue;
+                }
+                // frames captured before a size or format change are still queued in the driver, they
+                // never reach a consumer. Bounded in case the sensor rejected the change
+                if (geometryChanged && !camera->frameMatchesSensor(fb) && ++staleFrames <= MAX_STALE_FRAMES)
+                {
+                    camera->releaseFrame(fb);
+                    continue;
+                }
+                geometryChanged = false;
+
+                int64_t now = esp_timer_get_time();
+                self->m_latency.record(PipelineLatency::FRAME_WAIT, (uint32_t)(now - waitStart));
+                // the driver stamps frames with esp_timer time at the end of the transfer
+                self->m_latency.recordSince(PipelineLatency::BUFFERED, (int64_t)fb->timestamp.tv_sec * 1000000 + fb->timestamp.tv_usec, now);
+
+                FrameSlot *slot = self->allocSlot(fb);
+                self->m_camera->releaseFrame(fb);
+                if (!slot)
+                {
+                    vTaskDelay(1);
+                    continue;
+                }
+                slot->timestamp = now;
+                self->publish(slot);
+                self->m_metrics.addFrameCaptured();
+                if (pendingTicket)
+                {
+                    camera->completeSensorQueue(pendingTicket);
+                    pendingTicket = 0;
+                }
+            }
+
+            self->m_captureHandle = NULL;
+            vTaskDelete(NULL);
+        }
+
+        void recycle(FrameSlot *slot)
+        {
+            slot->encodeState.store(ENCODE_NONE);
+            slot->fb.store(nullptr);
+        }
+
+        // the first consumer encodes, the others wait for it and share the result
+        bool encode(FrameSlot *slot)
+        {
+            int state = slot->encodeState.load(std::memory_order_acquire);
+            if (state == ENCODE_NONE && slot->encodeState.compare_exchange_strong(state, ENCODE_BUSY, std::memory_order_acq_rel))
+            {
+                camera_fb_t *fb = slot->fb.load(std::memory_order_relaxed);
+                int64_t start = esp_timer_get_time();
+                bool ok = m_encodeExecutor
+                              ? m_encoder.encode(fb->buf, fb->width, fb->height, fb->format, slot->jpeg, slot->jpegCapacity,
+                                                 slot->jpegLength, *m_encodeExecutor, slot->spill, slot->spillCapacity)
+                              : m_encoder.encode(fb->buf, fb->width, fb->height, fb->format, slot->jpeg, slot->jpegCapacity,
+                                                 slot->jpegLength);
+                if (ok)
+                    m_latency.record(PipelineLatency::ENCODE, (uint32_t)(esp_timer_get_time() - start));
+                slot->encodeState.store(ok ? ENCODE_DONE : ENCODE_FAILED, std::memory_order_release);
+                return ok;
+            }
+
+            while ((state = slot->encodeState.load(std::memory_order_acquire)) == ENCODE_BUSY)
+            {
+                vTaskDelay(1);
+            }
+            return state == ENCODE_DONE;
+        }
+
+        friend class FrameRef;
+
+    public:
+        FrameBroker(Camera *camera) : m_camera(camera)
+        {
+            for (int i = 0; i < MAX_SLOTS; i++)
+            {
+                m_slots[i].fb.store(nullptr);
+                m_slots[i].refs.store(0);
+                memset(&m_slots[i].frame, 0, sizeof(camera_fb_t));
+                m_slots[i].buffer = nullptr;
+                m_slots[i].capacity = 0;
+                m_slots[i].sequence = 0;
+                m_slots[i].timestamp = 0;
+                m_slots[i].owner = this;
+                m_slots[i].encodeState.store(ENCODE_NONE);
+                m_slots[i].jpeg = nullptr;
+                m_slots[i].jpegCapacity = 0;
+                m_slots[i].jpegLength = 0;
+                m_slots[i].spill = nullptr;
+                m_slots[i].spillCapacity = 0;
+            }
+        }
+
+        ~FrameBroker()
+        {
+            stop();
+            if (m_lock)
+            {
+                vSemaphoreDelete(m_lock);
+            }
+            for (int i = 0; i < MAX_SLOTS; i++)
+            {
+                free(m_slots[i].buffer);
+                free(m_slots[i].jpeg);
+                free(m_slots[i].spill);
+            }
+        }
+
+        void setCore(int core)
+        {
+            m_core = core;
+        }
+
+        // 1..100, for frames the sensor delivers raw. Set it before begin()
+        void setEncodeQuality(int quality)
+        {
+            m_encoder.setQuality(quality);
+        }
+
+        int getEncodeQuality()
+        {
+            return m_encoder.getQuality();
+        }
+
+        // encodes raw frames in two bands on `executor`, set before begin(). The consumer that encodes runs
+        // one band, so the executor's helper should sit on the other core than the stream tasks
+        void setEncodeExecutor(StripExecutor *executor)
+        {
+            m_encodeExecutor = executor;
+        }
+
+        bool begin()
+        {
+            if (m_running)
+                return true;
+
+            if (!m_lock)
+            {
+                m_lock = xSemaphoreCreateMutex();
+                if (!m_lock)
+                    return false;
+            }
+
+            m_running = true;
+            m_camera->setSensorDeferred(true);
+            if (xTaskCreatePinnedToCore(captureTask, "FrameBroker", 3072, this, 12, &m_captureHandle, m_core) != pdPASS)
+            {
+                m_running = false;
+                m_camera->setSensorDeferred(false);
+                return false;
+            }
+            return true;
+        }
+
+        void stop()
+        {
+            if (!m_running)
+                return;
+
+            m_running = false;
+            xTaskNotifyGive(m_captureHandle);
+
+            unsigned long startWait = millis();
+            while (m_captureHandle != NULL && millis() - startWait < 2000)
+            {
+                vTaskDelay(10);
+            }
+
+            // nobody captures anymore, anything still queued can go straight to the sensor
+            m_camera->setSensorDeferred(false);
+            uint32_t ticket;
+            m_camera->applySensorQueue(ticket);
+            if (ticket)
+            {
+                m_camera->completeSensorQueue(ticket);
+            }
+
+            xSemaphoreTake(m_lock, portMAX_DELAY);
+            FrameSlot *latest = m_latest;
+            m_latest = nullptr;
+            xSemaphoreGive(m_lock);
+
+            if (latest)
+            {
+                FrameRef::adopt(latest).reset();
+            }
+        }
+
+        bool isRunning()
+        {
+            return m_running;
+        }
+
+        // returns the newest frame with a sequence number greater than `after`, waiting up to `timeout` for one
+        FrameRef acquire(uint32_t after = 0, TickType_t timeout = portMAX_DELAY)
+        {
+            if (!m_running)
+                return FrameRef();
+
+            TickType_t start = xTaskGetTickCount();
+            TaskHandle_t self = xTaskGetCurrentTaskHandle();
+
+            while (m_running)
+            {
+                xSemaphoreTake(m_lock, portMAX_DELAY);
+                if (m_latest && m_latest->sequence > after)
+                {
+                    FrameRef ref(m_latest);
+                    xSemaphoreGive(m_lock);
+                    return ref;
+                }
+
+                bool registered = false;
+                for (int i = 0; i < m_waiterCount; i++)
+                {
+                    if (m_waiters[i] == self)
+                    {
+                        registered = true;
+                        break;
+                    }
+                }
+                if (!registered)
+                {
+                    if (m_waiterCount >= MAX_WAITERS)
+                    {
+                        xSemaphoreGive(m_lock);
+                        return FrameRef();
+                    }
+                    m_waiters[m_waiterCount++] = self;
+                }
+                xSemaphoreGive(m_lock);
+                xTaskNotifyGive(m_captureHandle);
+
+                TickType_t elapsed = xTaskGetTickCount() - start;
+                if (timeout != portMAX_DELAY && elapsed >= timeout)
+                    break;
+
+                TickType_t wait = timeout == portMAX_DELAY ? pdMS_TO_TICKS(100) : timeout - elapsed;
+                ulTaskNotifyTake(pdTRUE, wait);
+            }
+
+            xSemaphoreTake(m_lock, portMAX_DELAY);
+            for (int i = 0; i < m_waiterCount; i++)
+            {
+                if (m_waiters[i] == self)
+                {
+                    m_waiters[i] = m_waiters[--m_waiterCount];
+                    break;
+                }
+            }
+            xSemaphoreGive(m_lock);
+            return FrameRef();
+        }
+
+        // keeps the sensor running for a consumer that polls acquire() with a zero timeout while it is busy,
+        // it would otherwise only be a waiter for an instant. Each call needs a matching removeDemand()
+        void addDemand()
+        {
+            m_demand++;
+            if (m_captureHandle)
+            {
+                xTaskNotifyGive(m_captureHandle);
+            }
+        }
+
+        void removeDemand()
+        {
+            m_demand--;
+        }
+
+        // newest published frame without waiting, may be empty
+        FrameRef latest()
+        {
+            if (!m_lock)
+                return FrameRef();
+
+            xSemaphoreTake(m_lock, portMAX_DELAY);
+            FrameRef ref(m_latest);
+            xSemaphoreGive(m_lock);
+            return ref;
+        }
+
+        // newest frame if it is at most `maxAgeMs` old, otherwise waits for the next one. The broker only
+        // captures while someone waits, so a frame left over from the last viewer can be arbitrarily old
+        FrameRef recent(uint32_t maxAgeMs, TickType_t timeout = pdMS_TO_TICKS(2000))
+        {
+            FrameRef frame = latest();
+            if (frame && esp_timer_get_time() - frame.timestamp() <= (int64_t)maxAgeMs * 1000)
+                return frame;
+
+            FrameRef fresh = acquire(frame.sequence(), timeout);
+            return fresh ? fresh : frame;
+        }
+
+        uint32_t sequence()
+        {
+            return m_sequence;
+        }
+
+        // stage timings shared by every consumer of this broker's frames
+        PipelineLatency *getLatency()
+        {
+            return &m_latency;
+        }
+
+        // counters shared by every consumer of this broker's frames
+        Metrics *getMetrics()
+        {
+            return &m_metrics;
+        }
+    };
+
+    inline const uint8_t *FrameRef::data() const
+    {
+        camera_fb_t *f = fb();
+        if (!f || f->format == PIXFORMAT_JPEG)
+            return f ? f->buf : nullptr;
+        return m_slot->owner->encode(m_slot) ? m_slot->jpeg : nullptr;
+    }
+
+    inline size_t FrameRef::length() const
+    {
+        camera_fb_t *f = fb();
+        if (!f || f->format == PIXFORMAT_JPEG)
+            return f ? f->len : 0;
+        return m_slot->owner->encode(m_slot) ? m_slot->jpegLength : 0;
+    }
+
+    inline void FrameRef::reset()
+    {
+        if (!m_slot)
+            return;
+
+        if (m_slot->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            m_slot->owner->recycle(m_slot);
+        }
+        m_slot = nullptr;
+    }
+
+    inline FrameBroker *Camera::getBroker()
+    {
+        if (!broker)
+        {
+            broker = new FrameBroker(this);
+        }
+        return broker;
+    }
+}
+#endif
@@ -0,0 +1,165 @@
+#ifndef ESPCAMLIB_FRAMEPACER_H
+#define ESPCAMLIB_FRAMEPACER_H
+#include <Arduino.h>
+
+// maps capture timestamps onto the slots of a constant rate output. A frame takes the slot nearest to its
+// timestamp, a second frame for the same slot is dropped and empty slots in front of a frame are filled by
+// repeating the previous one, so a file written at the target rate plays back at true speed
+namespace EspCam
+{
+    struct FramePacerStats
+    {
+        uint32_t framesIn;
+        uint32_t framesOut;
+        uint32_t dropped;
+        uint32_t duplicated;
+        // distance between a frame's capture time and the time of the slot it was given
+        uint32_t jitterAvgUs;
+        uint32_t jitterMaxUs;
+        float inputFps;
+    };
+
+    class FramePacer
+    {
+    public:
+        // a longer gap, e.g. a stalled sensor, starts a new timeline instead of being filled with repeats
+        static const uint32_t MAX_GAP_SECONDS = 10;
+
+    private:
+        int m_fps = 30;
+        bool m_started = false;
+        int64_t m_start = 0;
+        uint32_t m_nextSlot = 0;
+
+        uint32_t m_framesIn = 0;
+        uint32_t m_framesOut = 0;
+        uint32_t m_dropped = 0;
+        uint32_t m_duplicated = 0;
+        uint64_t m_jitterSum = 0;
+        uint32_t m_jitterMax = 0;
+        int64_t m_firstInput = 0;
+        int64_t m_lastInput = 0;
+
+        int64_t slotTime(uint32_t slot) const
+        {
+            return (int64_t)slot * 1000000 / m_fps;
+        }
+
+        // slot for `timestamp`, -1 when it is older than the timeline. `rebase` is set when it starts a new timeline
+        int64_t slotOf(int64_t timestamp, bool &rebase) const
+        {
+            rebase = !m_started;
+            if (rebase)
+                return 0;
+
+            int64_t offset = timestamp - m_start;
+            if (offset < 0)
+                return -1;
+            int64_t slot = (offset * m_fps + 500000) / 1000000;
+            if (slot - m_nextSlot > (int64_t)MAX_GAP_SECONDS * m_fps)
+            {
+                rebase = true;
+                return 0;
+            }
+            return slot;
+        }
+
+    public:
+        FramePacer(int fps = 30)
+        {
+            setRate(fps);
+        }
+
+        void setRate(int fps)
+        {
+            m_fps = fps > 0 ? fps : 1;
+        }
+
+        int getRate()
+        {
+            return m_fps;
+        }
+
+        // the next frame becomes slot 0 of a new timeline, e.g. at the start of a file
+        void restart()
+        {
+            m_started = false;
+        }
+
+        void resetStats()
+        {
+            m_framesIn = 0;
+            m_framesOut = 0;
+            m_dropped = 0;
+            m_duplicated = 0;
+            m_jitterSum = 0;
+            m_jitterMax = 0;
+            m_firstInput = 0;
+            m_lastInput = 0;
+        }
+
+        // output slots `timestamp` would take without placing it: 0 when it would be dropped,
+        // otherwise the frame itself plus the repeats of the previous frame in front of it
+        uint32_t slotsFor(int64_t timestamp) const
+        {
+            bool rebase;
+            int64_t slot = slotOf(timestamp, rebase);
+            if (rebase)
+                return 1;
+            if (slot < m_nextSlot)
+                return 0;
+            return (uint32_t)(slot - m_nextSlot) + 1;
+        }
+
+        // places the frame, returns the same as slotsFor()
+        uint32_t place(int64_t timestamp)
+        {
+            if (!m_framesIn)
+                m_firstInput = timestamp;
+            m_lastInput = timestamp;
+            m_framesIn++;
+
+            bool rebase;
+            int64_t slot = slotOf(timestamp, rebase);
+            if (rebase)
+            {
+                m_started = true;
+                m_start = timestamp;
+                m_nextSlot = 0;
+            }
+            if (slot < m_nextSlot)
+            {
+                m_dropped++;
+                return 0;
+            }
+
+            int64_t error = timestamp - m_start - slotTime(slot);
+            uint32_t jitter = (uint32_t)(error < 0 ? -error : error);
+            m_jitterSum += jitter;
+            if (jitter > m_jitterMax)
+                m_jitterMax = jitter;
+
+            uint32_t repeats = (uint32_t)(slot - m_nextSlot);
+            m_duplicated += repeats;
+            m_framesOut += repeats + 1;
+            m_nextSlot = slot + 1;
+            return repeats + 1;
+        }
+
+        FramePacerStats getStats()
+        {
+            FramePacerStats stats;
+            stats.framesIn = m_framesIn;
+            stats.framesOut = m_framesOut;
+            stats.dropped = m_dropped;
+            stats.duplicated = m_duplicated;
+            uint32_t placed = m_framesIn - m_dropped;
+            stats.jitterAvgUs = placed ? (uint32_t)(m_jitterSum / placed) : 0;
+            stats.jitterMaxUs = m_jitterMax;
+            int64_t span = m_lastInput - m_firstInput;
+            stats.inputFps = m_framesIn > 1 && span > 0 ? (m_framesIn - 1) * 1000000.0f / span : 0;
+            return stats;
+        }
+    };
+}
+#endif
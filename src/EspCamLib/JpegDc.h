@@ -0,0 +1,502 @@
+#ifndef ESPCAMLIB_JPEGDC_H
+#define ESPCAMLIB_JPEGDC_H
+#include <Arduino.h>
+
+// baseline JPEG header parser and entropy decoder that only keeps the DC coefficient of every block,
+// which gives a 1/8 scale image for the cost of walking the Huffman stream without any IDCT
+namespace EspCam
+{
+    class JpegDcDecoder
+    {
+    public:
+        static const int MAX_COMPS = 3;
+
+        struct Component
+        {
+            uint8_t id;
+            uint8_t h;
+            uint8_t v;
+            uint8_t tq;
+            uint8_t td;
+            uint8_t ta;
+            int pred;
+        };
+
+    private:
+        struct HuffTable
+        {
+            bool present;
+            // 9 bit lookahead, (code length << 8) | symbol, 0 when the code is longer than 9 bits
+            uint16_t fast[512];
+            int32_t maxcode[18];
+            int32_t valptr[17];
+            uint16_t mincode[17];
+            uint8_t values[256];
+        };
+
+        HuffTable m_dc[4];
+        HuffTable m_ac[4];
+        uint16_t m_qt[4][64];
+        bool m_qtPresent[4];
+        Component m_comp[MAX_COMPS];
+        int m_numComp = 0;
+        uint16_t m_width = 0;
+        uint16_t m_height = 0;
+        uint16_t m_restartInterval = 0;
+        int m_hmax = 1;
+        int m_vmax = 1;
+        size_t m_scanStart = 0;
+
+        // DC maps, luminance at one value per 8x8 block and chroma at one value per MCU
+        uint8_t *m_maps[MAX_COMPS] = {nullptr, nullptr, nullptr};
+        size_t m_mapCapacity[MAX_COMPS] = {0, 0, 0};
+        uint16_t m_mapWidth[MAX_COMPS];
+        uint16_t m_mapHeight[MAX_COMPS];
+
+        // entropy coded segment reader with byte unstuffing
+        const uint8_t *m_pos;
+        const uint8_t *m_end;
+        uint32_t m_bits;
+        int m_bitCount;
+        bool m_marker;
+
+        static uint16_t be16(const uint8_t *p)
+        {
+            return (p[0] << 8) | p[1];
+        }
+
+        void buildTable(HuffTable &t, const uint8_t *counts, const uint8_t *values, int total)
+        {
+            memset(t.fast, 0, sizeof(t.fast));
+            memcpy(t.values, values, total);
+
+            uint16_t code = 0;
+            int k = 0;
+            for (int len = 1; len <= 16; len++)
+            {
+                t.valptr[len] = k;
+                t.mincode[len] = code;
+                for (int i = 0; i < counts[len - 1]; i++)
+                {
+                    if (len <= 9)
+                    {
+                        int shift = 9 - len;
+                        for (int j = 0; j < (1 << shift); j++)
+                        {
+                            t.fast[(code << shift) | j] = (len << 8) | values[k];
+                        }
+                    }
+                    code++;
+                    k++;
+                }
+                t.maxcode[len] = counts[len - 1] ? code - 1 : -1;
+                code <<= 1;
+            }
+            t.maxcode[17] = 0x7FFFFFFF;
+            t.present = true;
+        }
+
+        void resetBits()
+        {
+            m_bits = 0;
+            m_bitCount = 0;
+            m_marker = false;
+        }
+
+        void fill()
+        {
+            while (m_bitCount <= 24)
+            {
+                uint32_t byte = 0;
+                if (!m_marker && m_pos < m_end)
+                {
+                    byte = *m_pos;
+                    if (byte == 0xFF)
+                    {
+                        uint8_t next = m_pos + 1 < m_end ? m_pos[1] : 0xD9;
+                        if (next == 0x00)
+                        {
+                            m_pos += 2;
+                        }
+                        else
+                        {
+                            // a marker ends the segment, feed zeros until the caller deals with it
+                            m_marker = true;
+                            byte = 0;
+                        }
+                    }
+                    else
+                    {
+                        m_pos++;
+                    }
+                }
+                m_bits |= byte << (24 - m_bitCount);
+                m_bitCount += 8;
+            }
+        }
+
+        inline int getBits(int n)
+        {
+            if (n == 0)
+                return 0;
+            if (m_bitCount < n)
+                fill();
+            int v = m_bits >> (32 - n);
+            m_bits <<= n;
+            m_bitCount -= n;
+            return v;
+        }
+
+        static inline int extend(int v, int s)
+        {
+            return v < (1 << (s - 1)) ? v - (1 << s) + 1 : v;
+        }
+
+        int decodeSymbol(const HuffTable &t)
+        {
+            if (m_bitCount < 16)
+                fill();
+
+            uint16_t fast = t.fast[m_bits >> 23];
+            if (fast)
+            {
+                int len = fast >> 8;
+                m_bits <<= len;
+                m_bitCount -= len;
+                return fast & 0xFF;
+            }
+
+            int len = 10;
+            int32_t code = m_bits >> 22;
+            while (code > t.maxcode[len])
+            {
+                len++;
+                if (len > 16)
+                    return -1;
+                code = m_bits >> (32 - len);
+            }
+            m_bits <<= len;
+            m_bitCount -= len;
+            return t.values[t.valptr[len] + code - t.mincode[len]];
+        }
+
+        // decodes one block and returns its dequantized DC value
+        bool decodeBlock(Component &c, int &dc)
+        {
+            int s = decodeSymbol(m_dc[c.td]);
+            if (s < 0)
+                return false;
+            c.pred += s ? extend(getBits(s), s) : 0;
+            dc = c.pred * m_qt[c.tq][0];
+
+            const HuffTable &ac = m_ac[c.ta];
+            for (int k = 1; k < 64;)
+            {
+                int rs = decodeSymbol(ac);
+                if (rs < 0)
+                    return false;
+                int r = rs >> 4;
+                s = rs & 15;
+                if (s)
+                {
+                    getBits(s);
+                    k += r + 1;
+                }
+                else if (r == 15)
+                {
+                    k += 16;
+                }
+                else
+                {
+                    break;
+                }
+            }
+            return true;
+        }
+
+        // skips to just past the RSTn marker that ends a restart interval
+        bool restart()
+        {
+            const uint8_t *p = m_pos;
+            while (p + 1 < m_end && !(p[0] == 0xFF && p[1] >= 0xD0 && p[1] <= 0xD7))
+            {
+                p++;
+            }
+            if (p + 1 >= m_end)
+                return false;
+
+            m_pos = p + 2;
+            resetBits();
+            for (int i = 0; i < m_numComp; i++)
+            {
+                m_comp[i].pred = 0;
+            }
+            return true;
+        }
+
+        bool reserveMaps()
+        {
+            int mcusX = (m_width + 8 * m_hmax - 1) / (8 * m_hmax);
+            int mcusY = (m_height + 8 * m_vmax - 1) / (8 * m_vmax);
+
+            for (int i = 0; i < m_numComp; i++)
+            {
+                m_mapWidth[i] = mcusX * m_comp[i].h;
+                m_mapHeight[i] = mcusY * m_comp[i].v;
+                size_t size = (size_t)m_mapWidth[i] * m_mapHeight[i];
+                if (size > m_mapCapacity[i])
+                {
+                    uint8_t *map = (uint8_t *)realloc(m_maps[i], size);
+                    if (!map)
+                        return false;
+                    m_maps[i] = map;
+                    m_mapCapacity[i] = size;
+                }
+            }
+            return true;
+        }
+
+    public:
+        ~JpegDcDecoder()
+        {
+            for (int i = 0; i < MAX_COMPS; i++)
+            {
+                free(m_maps[i]);
+            }
+        }
+
+        // reads every marker segment up to the start of scan, tables and frame geometry become available
+        bool parseHeaders(const uint8_t *data, size_t len)
+        {
+            memset(m_qtPresent, 0, sizeof(m_qtPresent));
+            for (int i = 0; i < 4; i++)
+            {
+                m_dc[i].present = false;
+                m_ac[i].present = false;
+            }
+            m_numComp = 0;
+            m_restartInterval = 0;
+
+            if (len < 4 || data[0] != 0xFF || data[1] != 0xD8)
+                return false;
+
+            size_t pos = 2;
+            while (pos + 4 <= len)
+            {
+                if (data[pos] != 0xFF)
+                    return false;
+                uint8_t marker = data[pos + 1];
+                if (marker == 0xFF)
+                {
+                    pos++;
+                    continue;
+                }
+
+                size_t segLen = be16(data + pos + 2);
+                const uint8_t *seg = data + pos + 4;
+                if (pos + 2 + segLen > len)
+                    return false;
+
+                switch (marker)
+                {
+                case 0xDB:
+                {
+                    const uint8_t *p = seg;
+                    while (p < seg + segLen - 2)
+                    {
+                        int precision = p[0] >> 4;
+                        int id = p[0] & 3;
+                        p++;
+                        for (int i = 0; i < 64; i++)
+                        {
+                            m_qt[id][i] = precision ? be16(p + 2 * i) : p[i];
+                        }
+                        p += precision ? 128 : 64;
+                        m_qtPresent[id] = true;
+                    }
+                    break;
+                }
+                case 0xC4:
+                {
+                    const uint8_t *p = seg;
+                    while (p < seg + segLen - 2)
+                    {
+                        int tc = p[0] >> 4;
+                        int th = p[0] & 3;
+                        int total = 0;
+                        for (int i = 0; i < 16; i++)
+                        {
+                            total += p[1 + i];
+                        }
+                        buildTable(tc ? m_ac[th] : m_dc[th], p + 1, p + 17, total);
+                        p += 17 + total;
+                    }
+                    break;
+                }
+                case 0xC0:
+                case 0xC1:
+                {
+                    m_height = be16(seg + 1);
+                    m_width = be16(seg + 3);
+                    m_numComp = seg[5];
+                    if (m_numComp > MAX_COMPS || m_numComp < 1)
+                        return false;
+                    m_hmax = 1;
+                    m_vmax = 1;
+                    for (int i = 0; i < m_numComp; i++)
+                    {
+                        const uint8_t *c = seg + 6 + 3 * i;
+                        m_comp[i].id = c[0];
+                        m_comp[i].h = c[1] >> 4;
+                        m_comp[i].v = c[1] & 15;
+                        m_comp[i].tq = c[2] & 3;
+                        if (m_comp[i].h > m_hmax)
+                            m_hmax = m_comp[i].h;
+                        if (m_comp[i].v > m_vmax)
+                            m_vmax = m_comp[i].v;
+                    }
+                    break;
+                }
+                case 0xC2:
+                    // progressive is never produced by the camera
+                    return false;
+                case 0xDD:
+                    m_restartInterval = be16(seg);
+                    break;
+                case 0xDA:
+                {
+                    int n = seg[0];
+                    for (int i = 0; i < n; i++)
+                    {
+                        uint8_t id = seg[1 + 2 * i];
+                        uint8_t tables = seg[2 + 2 * i];
+                        for (int j = 0; j < m_numComp; j++)
+                        {
+                            if (m_comp[j].id == id)
+                            {
+                                m_comp[j].td = tables >> 4;
+                                m_comp[j].ta = tables & 3;
+                            }
+                        }
+                    }
+                    m_scanStart = pos + 2 + segLen;
+                    return m_numComp > 0;
+                }
+                default:
+                    break;
+                }
+                pos += 2 + segLen;
+            }
+            return false;
+        }
+
+        // decodes the DC coefficients of every block into the component maps
+        bool decode(const uint8_t *data, size_t len)
+        {
+            if (!parseHeaders(data, len))
+                return false;
+
+            for (int i = 0; i < m_numComp; i++)
+            {
+                Component &c = m_comp[i];
+                if (!m_qtPresent[c.tq] || !m_dc[c.td].present || !m_ac[c.ta].present)
+                    return false;
+                c.pred = 0;
+            }
+
+            if (!reserveMaps())
+                return false;
+
+            m_pos = data + m_scanStart;
+            m_end = data + len;
+            resetBits();
+
+            int mcusX = (m_width + 8 * m_hmax - 1) / (8 * m_hmax);
+            int mcusY = (m_height + 8 * m_vmax - 1) / (8 * m_vmax);
+            int mcu = 0;
+
+            for (int my = 0; my < mcusY; my++)
+            {
+                for (int mx = 0; mx < mcusX; mx++)
+                {
+                    if (m_restartInterval && mcu && mcu % m_restartInterval == 0 && !restart())
+                        return false;
+                    mcu++;
+
+                    for (int i = 0; i < m_numComp; i++)
+                    {
+                        Component &c = m_comp[i];
+                        uint8_t *map = m_maps[i];
+                        for (int by = 0; by < c.v; by++)
+                        {
+                            for (int bx = 0; bx < c.h; bx++)
+                            {
+                                int dc;
+                                if (!decodeBlock(c, dc))
+                                    return false;
+                                // DC is 8x the block mean around zero, back to a 0..255 sample
+                                int value = (dc >> 3) + 128;
+                                value = value < 0 ? 0 : (value > 255 ? 255 : value);
+                                map[(my * c.v + by) * m_mapWidth[i] + mx * c.h + bx] = value;
+                            }
+                        }
+                    }
+                }
+            }
+            return true;
+        }
+
+        uint16_t getWidth()
+        {
+            return m_width;
+        }
+
+        uint16_t getHeight()
+        {
+            return m_height;
+        }
+
+        int getComponentCount()
+        {
+            return m_numComp;
+        }
+
+        const Component &getComponent(int index)
+        {
+            return m_comp[index];
+        }
+
+        // offset of the entropy coded data right after the SOS segment
+        size_t getScanStart()
+        {
+            return m_scanStart;
+        }
+
+        uint16_t getRestartInterval()
+        {
+            return m_restartInterval;
+        }
+
+        // quantization table in zigzag order, or nullptr if it was not defined
+        const uint16_t *getQuantTable(int id)
+        {
+            return m_qtPresent[id & 3] ? m_qt[id & 3] : nullptr;
+        }
+
+        const uint8_t *getMap(int component)
+        {
+            return m_maps[component];
+        }
+
+        uint16_t getMapWidth(int component)
+        {
+            return m_mapWidth[component];
+        }
+
+        uint16_t getMapHeight(int component)
+        {
+            return m_mapHeight[component];
+        }
+    };
+}
+#endif
@@ -0,0 +1,655 @@
+#ifndef ESPCAMLIB_JPEGENCODER_H
+#define ESPCAMLIB_JPEGENCODER_H
+#include <Arduino.h>
+#include "esp_camera.h"
+
+#include "StripExecutor.h"
+
+// baseline JPEG encoder for the raw sensor formats. Pixels are converted one MCU at a time straight from
+// the frame buffer, so there is no RGB888 or YCbCr copy of the frame, and the DCT and quantization are
+// integer only. Tables are built by setQuality(), after that encode() is reentrant. Given a StripExecutor
+// the MCU rows are coded in two bands at once, with a restart marker after every row so the bands join
+namespace EspCam
+{
+    class JpegEncoder
+    {
+    private:
+        struct HuffCode
+        {
+            uint16_t code;
+            uint8_t size;
+        };
+
+        struct BitWriter
+        {
+            uint8_t *out;
+            size_t pos;
+            uint32_t acc;
+            int count;
+
+            inline void put(uint32_t bits, int n)
+            {
+                acc = (acc << n) | bits;
+                count += n;
+                while (count >= 8)
+                {
+                    uint8_t byte = acc >> (count - 8);
+                    out[pos++] = byte;
+                    if (byte == 0xFF)
+                        out[pos++] = 0;
+                    count -= 8;
+                }
+            }
+
+            void flush()
+            {
+                // pad the last byte with ones
+                if (count > 0)
+                    put((1 << (8 - count)) - 1, 8 - count);
+            }
+        };
+
+        // worst case for one MCU of four blocks, including stuffed bytes
+        static const size_t MCU_MAX = 4 * 64 * 4 + 64;
+
+        int m_quality = 0;
+        uint8_t m_qt[2][64];
+        // 2^20 / (8 * q), the DCT output is 8 times the true coefficient
+        uint32_t m_recip[2][64];
+        HuffCode m_dc[2][12];
+        HuffCode m_ac[2][256];
+
+        static const uint8_t *zigzag()
+        {
+            static const uint8_t table[64] = {
+                0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+                12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+                35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+                58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63};
+            return table;
+        }
+
+        // ITU T.81 Annex K tables: luma and chroma quantization, then DC/AC code counts and symbols
+        static const uint8_t *baseQuant(int table)
+        {
+            static const uint8_t quant[2][64] = {
+                {16, 11, 10, 16, 24, 40, 51, 61, 12, 12, 14, 19, 26, 58, 60, 55,
+                 14, 13, 16, 24, 40, 57, 69, 56, 14, 17, 22, 29, 51, 87, 80, 62,
+                 18, 22, 37, 56, 68, 109, 103, 77, 24, 35, 55, 64, 81, 104, 113, 92,
+                 49, 64, 78, 87, 103, 121, 120, 101, 72, 92, 95, 98, 112, 100, 103, 99},
+                {17, 18, 24, 47, 99, 99, 99, 99, 18, 21, 26, 66, 99, 99, 99, 99,
+                 24, 26, 56, 99, 99, 99, 99, 99, 47, 66, 99, 99, 99, 99, 99, 99,
+                 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+                 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99}};
+            return quant[table];
+        }
+
+        static const uint8_t *dcCounts(int table)
+        {
+            static const uint8_t counts[2][16] = {
+                {0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0},
+                {0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0}};
+            return counts[table];
+        }
+
+        static const uint8_t *dcValues()
+        {
+            static const uint8_t values[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+            return values;
+        }
+
+        static const uint8_t *acCounts(int table)
+        {
+            static const uint8_t counts[2][16] = {
+                {0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d},
+                {0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77}};
+            return counts[table];
+        }
+
+        static const uint8_t *acValues(int table)
+        {
+            static const uint8_t values[2][162] = {
+                {0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+                 0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+                 0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+                 0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+                 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+                 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+                 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+                 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+                 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+                 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+                 0xf9, 0xfa},
+                {0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+                 0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+                 0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+                 0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+                 0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+                 0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+                 0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+                 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+                 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+                 0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+                 0xf9, 0xfa}};
+            return values[table];
+        }
+
+        static void buildCodes(HuffCode *codes, const uint8_t *counts, const uint8_t *values)
+        {
+            uint16_t code = 0;
+            int k = 0;
+            for (int len = 1; len <= 16; len++)
+            {
+                for (int i = 0; i < counts[len - 1]; i++)
+                {
+                    codes[values[k++]] = {code++, (uint8_t)len};
+                }
+                code <<= 1;
+            }
+        }
+
+        // integer forward DCT (the LLM "islow" algorithm), outputs are 8 times the true coefficients
+        static void fdct(int32_t *d)
+        {
+            const int CONST_BITS = 13;
+            const int PASS1_BITS = 2;
+#define ESPCAM_DESCALE(x, n) (((x) + (1 << ((n)-1))) >> (n))
+
+            for (int row = 0; row < 8; row++)
+            {
+                int32_t *p = d + row * 8;
+                int32_t tmp0 = p[0] + p[7], tmp7 = p[0] - p[7];
+                int32_t tmp1 = p[1] + p[6], tmp6 = p[1] - p[6];
+                int32_t tmp2 = p[2] + p[5], tmp5 = p[2] - p[5];
+                int32_t tmp3 = p[3] + p[4], tmp4 = p[3] - p[4];
+
+                int32_t tmp10 = tmp0 + tmp3, tmp13 = tmp0 - tmp3;
+                int32_t tmp11 = tmp1 + tmp2, tmp12 = tmp1 - tmp2;
+                p[0] = (tmp10 + tmp11) << PASS1_BITS;
+                p[4] = (tmp10 - tmp11) << PASS1_BITS;
+                int32_t z1 = (tmp12 + tmp13) * 4433;
+                p[2] = ESPCAM_DESCALE(z1 + tmp13 * 6270, CONST_BITS - PASS1_BITS);
+                p[6] = ESPCAM_DESCALE(z1 - tmp12 * 15137, CONST_BITS - PASS1_BITS);
+
+                z1 = tmp4 + tmp7;
+                int32_t z2 = tmp5 + tmp6, z3 = tmp4 + tmp6, z4 = tmp5 + tmp7;
+                int32_t z5 = (z3 + z4) * 9633;
+                tmp4 *= 2446;
+                tmp5 *= 16819;
+                tmp6 *= 25172;
+                tmp7 *= 12299;
+                z1 *= -7373;
+                z2 *= -20995;
+                z3 = z3 * -16069 + z5;
+                z4 = z4 * -3196 + z5;
+                p[7] = ESPCAM_DESCALE(tmp4 + z1 + z3, CONST_BITS - PASS1_BITS);
+                p[5] = ESPCAM_DESCALE(tmp5 + z2 + z4, CONST_BITS - PASS1_BITS);
+                p[3] = ESPCAM_DESCALE(tmp6 + z2 + z3, CONST_BITS - PASS1_BITS);
+                p[1] = ESPCAM_DESCALE(tmp7 + z1 + z4, CONST_BITS - PASS1_BITS);
+            }
+
+            for (int col = 0; col < 8; col++)
+            {
+                int32_t *p = d + col;
+                int32_t tmp0 = p[0] + p[56], tmp7 = p[0] - p[56];
+                int32_t tmp1 = p[8] + p[48], tmp6 = p[8] - p[48];
+                int32_t tmp2 = p[16] + p[40], tmp5 = p[16] - p[40];
+                int32_t tmp3 = p[24] + p[32], tmp4 = p[24] - p[32];
+
+                int32_t tmp10 = tmp0 + tmp3, tmp13 = tmp0 - tmp3;
+                int32_t tmp11 = tmp1 + tmp2, tmp12 = tmp1 - tmp2;
+                p[0] = ESPCAM_DESCALE(tmp10 + tmp11, PASS1_BITS);
+                p[32] = ESPCAM_DESCALE(tmp10 - tmp11, PASS1_BITS);
+                int32_t z1 = (tmp12 + tmp13) * 4433;
+                p[16] = ESPCAM_DESCALE(z1 + tmp13 * 6270, CONST_BITS + PASS1_BITS);
+                p[48] = ESPCAM_DESCALE(z1 - tmp12 * 15137, CONST_BITS + PASS1_BITS);
+
+                z1 = tmp4 + tmp7;
+                int32_t z2 = tmp5 + tmp6, z3 = tmp4 + tmp6, z4 = tmp5 + tmp7;
+                int32_t z5 = (z3 + z4) * 9633;
+                tmp4 *= 2446;
+                tmp5 *= 16819;
+                tmp6 *= 25172;
+                tmp7 *= 12299;
+                z1 *= -7373;
+                z2 *= -20995;
+                z3 = z3 * -16069 + z5;
+                z4 = z4 * -3196 + z5;
+                p[56] = ESPCAM_DESCALE(tmp4 + z1 + z3, CONST_BITS + PASS1_BITS);
+                p[40] = ESPCAM_DESCALE(tmp5 + z2 + z4, CONST_BITS + PASS1_BITS);
+                p[24] = ESPCAM_DESCALE(tmp6 + z2 + z3, CONST_BITS + PASS1_BITS);
+                p[8] = ESPCAM_DESCALE(tmp7 + z1 + z4, CONST_BITS + PASS1_BITS);
+            }
+#undef ESPCAM_DESCALE
+        }
+
+        void encodeBlock(BitWriter &bits, int32_t *block, int table, int &pred) const
+        {
+            fdct(block);
+
+            const uint32_t *recip = m_recip[table];
+            const uint8_t *zz = zigzag();
+            int16_t q[64];
+            for (int i = 0; i < 64; i++)
+            {
+                int32_t c = block[zz[i]];
+                uint32_t half = 4 * m_qt[table][i];
+                if (c < 0)
+                    q[i] = -(int16_t)(((uint32_t)-c + half) * recip[i] >> 20);
+                else
+                    q[i] = (int16_t)(((uint32_t)c + half) * recip[i] >> 20);
+            }
+
+            int diff = q[0] - pred;
+            pred = q[0];
+            putValue(bits, m_dc[table], diff, 0);
+
+            const HuffCode *ac = m_ac[table];
+            int run = 0;
+            for (int i = 1; i < 64; i++)
+            {
+                if (q[i] == 0)
+                {
+                    run++;
+                    continue;
+                }
+                while (run > 15)
+                {
+                    bits.put(ac[0xF0].code, ac[0xF0].size);
+                    run -= 16;
+                }
+                putValue(bits, ac, q[i], run << 4);
+                run = 0;
+            }
+            if (run)
+                bits.put(ac[0].code, ac[0].size);
+        }
+
+        // huffman code of (`prefix` | magnitude category) followed by the value bits
+        static inline void putValue(BitWriter &bits, const HuffCode *codes, int v, int prefix)
+        {
+            int magnitude = v < 0 ? -v : v;
+            int size = magnitude ? 32 - __builtin_clz(magnitude) : 0;
+            const HuffCode &code = codes[prefix | size];
+            bits.put(code.code, code.size);
+            if (size)
+                bits.put((v < 0 ? v - 1 : v) & ((1 << size) - 1), size);
+        }
+
+        static inline void toYCbCr(int r, int g, int b, int32_t &y, int &cb, int &cr)
+        {
+            // JFIF in 8.8 fixed point, luma level shifted for the DCT
+            y = ((77 * r + 150 * g + 29 * b + 128) >> 8) - 128;
+            cb = (-43 * r - 85 * g + 128 * b + 128) >> 8;
+            cr = (128 * r - 107 * g - 21 * b + 128) >> 8;
+        }
+
+        // one 16x8 MCU of 4:2:2: two luma blocks and one Cb and Cr block, edge pixels are repeated
+        static void loadColorMcu(const uint8_t *src, uint16_t width, uint16_t height, pixformat_t format,
+                                 int x0, int y0, int32_t *y, int32_t *cb, int32_t *cr)
+        {
+            for (int row = 0; row < 8; row++)
+            {
+                int sy = y0 + row < height ? y0 + row : height - 1;
+                for (int col = 0; col < 16; col += 2)
+                {
+                    int sx = x0 + col < width ? x0 + col : width - 1;
+                    int sx1 = sx + 1 < width ? sx + 1 : sx;
+                    int32_t *yOut = y + (col >> 3) * 64 + row * 8 + (col & 7);
+                    int c = row * 8 + (col >> 1);
+
+                    if (format == PIXFORMAT_YUV422)
+                    {
+                        // YUYV, chroma is shared by the pixel pair
+                        const uint8_t *p = src + ((size_t)sy * width + (sx & ~1)) * 2;
+                        yOut[0] = p[sx & 1 ? 2 : 0] - 128;
+                        yOut[1] = (sx1 != sx ? p[2] : yOut[0] + 128) - 128;
+                        cb[c] = p[1] - 128;
+                        cr[c] = p[3] - 128;
+                        continue;
+                    }
+
+                    int r0, g0, b0, r1, g1, b1;
+                    if (format == PIXFORMAT_RGB565)
+                    {
+                        // the sensor sends RGB565 big endian
+                        const uint8_t *p = src + (size_t)sy * width * 2;
+                        uint16_t a = (p[sx * 2] << 8) | p[sx * 2 + 1];
+                        uint16_t b = (p[sx1 * 2] << 8) | p[sx1 * 2 + 1];
+                        r0 = (a >> 8) & 0xF8;
+                        g0 = (a >> 3) & 0xFC;
+                        b0 = (a << 3) & 0xF8;
+                        r1 = (b >> 8) & 0xF8;
+                        g1 = (b >> 3) & 0xFC;
+                        b1 = (b << 3) & 0xF8;
+                    }
+                    else
+                    {
+                        // RGB888 frames are stored BGR
+                        const uint8_t *p = src + (size_t)sy * width * 3;
+                        b0 = p[sx * 3];
+                        g0 = p[sx * 3 + 1];
+                        r0 = p[sx * 3 + 2];
+                        b1 = p[sx1 * 3];
+                        g1 = p[sx1 * 3 + 1];
+                        r1 = p[sx1 * 3 + 2];
+                    }
+
+                    int cb0, cr0, cb1, cr1;
+                    toYCbCr(r0, g0, b0, yOut[0], cb0, cr0);
+                    toYCbCr(r1, g1, b1, yOut[1], cb1, cr1);
+                    cb[c] = (cb0 + cb1) >> 1;
+                    cr[c] = (cr0 + cr1) >> 1;
+                }
+            }
+        }
+
+        static void loadGrayBlock(const uint8_t *src, uint16_t width, uint16_t height, int x0, int y0, int32_t *y)
+        {
+            for (int row = 0; row < 8; row++)
+            {
+                int sy = y0 + row < height ? y0 + row : height - 1;
+                const uint8_t *p = src + (size_t)sy * width;
+                for (int col = 0; col < 8; col++)
+                {
+                    int sx = x0 + col < width ? x0 + col : width - 1;
+                    y[row * 8 + col] = p[sx] - 128;
+                }
+            }
+        }
+
+        size_t writeHeaders(uint8_t *out, uint16_t width, uint16_t height, bool gray, uint16_t restartInterval) const
+        {
+            uint8_t *p = out;
+            static const uint8_t soiApp0[] = {0xFF, 0xD8, 0xFF, 0xE0, 0, 16, 'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0};
+            memcpy(p, soiApp0, sizeof(soiApp0));
+            p += sizeof(soiApp0);
+
+            if (restartInterval)
+            {
+                *p++ = 0xFF;
+                *p++ = 0xDD;
+                *p++ = 0;
+                *p++ = 4;
+                *p++ = restartInterval >> 8;
+                *p++ = restartInterval;
+            }
+
+            int tables = gray ? 1 : 2;
+            for (int t = 0; t < tables; t++)
+            {
+                *p++ = 0xFF;
+                *p++ = 0xDB;
+                *p++ = 0;
+                *p++ = 67;
+                *p++ = t;
+                memcpy(p, m_qt[t], 64);
+                p += 64;
+            }
+
+            int comps = gray ? 1 : 3;
+            *p++ = 0xFF;
+            *p++ = 0xC0;
+            *p++ = 0;
+            *p++ = 8 + 3 * comps;
+            *p++ = 8;
+            *p++ = height >> 8;
+            *p++ = height;
+            *p++ = width >> 8;
+            *p++ = width;
+            *p++ = comps;
+            for (int c = 0; c < comps; c++)
+            {
+                *p++ = c + 1;
+                *p++ = c == 0 && !gray ? 0x21 : 0x11;
+                *p++ = c == 0 ? 0 : 1;
+            }
+
+            for (int t = 0; t < tables; t++)
+            {
+                for (int ac = 0; ac < 2; ac++)
+                {
+                    const uint8_t *counts = ac ? acCounts(t) : dcCounts(t);
+                    const uint8_t *values = ac ? acValues(t) : dcValues();
+                    int total = 0;
+                    for (int i = 0; i < 16; i++)
+                    {
+                        total += counts[i];
+                    }
+                    *p++ = 0xFF;
+                    *p++ = 0xC4;
+                    *p++ = (19 + total) >> 8;
+                    *p++ = 19 + total;
+                    *p++ = (ac << 4) | t;
+                    memcpy(p, counts, 16);
+                    p += 16;
+                    memcpy(p, values, total);
+                    p += total;
+                }
+            }
+
+            *p++ = 0xFF;
+            *p++ = 0xDA;
+            *p++ = 0;
+            *p++ = 6 + 2 * comps;
+            *p++ = comps;
+            for (int c = 0; c < comps; c++)
+            {
+                *p++ = c + 1;
+                *p++ = c == 0 ? 0x00 : 0x11;
+            }
+            *p++ = 0;
+            *p++ = 63;
+            *p++ = 0;
+            return p - out;
+        }
+
+        static bool reserve(uint8_t *&out, size_t &capacity, size_t needed)
+        {
+            if (needed <= capacity)
+                return true;
+            size_t grown = capacity ? capacity : 16 * 1024;
+            while (grown < needed)
+            {
+                grown *= 2;
+            }
+            void *buf = psramFound() ? ps_realloc(out, grown) : realloc(out, grown);
+            if (!buf)
+                return false;
+            out = (uint8_t *)buf;
+            capacity = grown;
+            return true;
+        }
+
+        static bool accepts(pixformat_t format, uint16_t width, uint16_t height)
+        {
+            // YUYV shares chroma between pixel pairs, an odd width would read the pair past the row
+            return supports(format) && width && height && !(format == PIXFORMAT_YUV422 && (width & 1));
+        }
+
+        // entropy codes MCU rows [rowStart, rowEnd) from `pos` on. With `restart` every row starts from fresh
+        // DC predictors and ends byte aligned with an RSTn marker, except the last row of the frame
+        bool encodeRows(const uint8_t *src, uint16_t width, uint16_t height, pixformat_t format, int rowStart, int rowEnd,
+                        bool restart, uint8_t *&out, size_t &capacity, size_t &pos) const
+        {
+            bool gray = format == PIXFORMAT_GRAYSCALE;
+            int mcuWidth = gray ? 8 : 16;
+            int rows = (height + 7) / 8;
+            size_t mcus = (size_t)((width + mcuWidth - 1) / mcuWidth) * (rowEnd - rowStart);
+
+            BitWriter bits = {out, pos, 0, 0};
+            int32_t y[2 * 64];
+            int32_t cb[64];
+            int32_t cr[64];
+            int predY = 0, predCb = 0, predCr = 0;
+            size_t done = 0;
+
+            for (int row = rowStart; row < rowEnd; row++)
+            {
+                int y0 = row * 8;
+                for (int x0 = 0; x0 < width; x0 += mcuWidth)
+                {
+                    // room for the MCU and a restart marker behind it
+                    if (bits.pos + MCU_MAX + 4 > capacity)
+                    {
+                        size_t remaining = mcus - done;
+                        if (!reserve(out, capacity, bits.pos + remaining * MCU_MAX / 4 + MCU_MAX + 4))
+                            return false;
+                        bits.out = out;
+                    }
+
+                    if (gray)
+                    {
+                        loadGrayBlock(src, width, height, x0, y0, y);
+                        encodeBlock(bits, y, 0, predY);
+                    }
+                    else
+                    {
+                        loadColorMcu(src, width, height, format, x0, y0, y, cb, cr);
+                        encodeBlock(bits, y, 0, predY);
+                        encodeBlock(bits, y + 64, 0, predY);
+                        encodeBlock(bits, cb, 1, predCb);
+                        encodeBlock(bits, cr, 1, predCr);
+                    }
+                    done++;
+                }
+
+                if (restart && row < rows - 1)
+                {
+                    bits.flush();
+                    bits.out[bits.pos++] = 0xFF;
+                    bits.out[bits.pos++] = 0xD0 + (row & 7);
+                    predY = predCb = predCr = 0;
+                }
+            }
+
+            bits.flush();
+            pos = bits.pos;
+            return true;
+        }
+
+        // a two band encode, the band starting at row 0 goes to `out[0]` behind the headers, the other to `out[1]`
+        struct BandJob
+        {
+            const JpegEncoder *encoder;
+            const uint8_t *src;
+            uint16_t width;
+            uint16_t height;
+            pixformat_t format;
+            int rows;
+            uint8_t **out[2];
+            size_t *capacity[2];
+            size_t length[2];
+            bool ok[2];
+        };
+
+        static void encodeBand(void *ctx, int rowStart, int rowEnd, uint8_t *scratch, size_t scratchSize)
+        {
+            static_assert(StripExecutor::MAX_WORKERS == 2, "one output buffer per band");
+            BandJob *job = static_cast<BandJob *>(ctx);
+            int band = rowStart == 0 ? 0 : 1;
+            job->ok[band] = job->encoder->encodeRows(job->src, job->width, job->height, job->format, rowStart, rowEnd, true,
+                                                     *job->out[band], *job->capacity[band], job->length[band]);
+        }
+
+    public:
+        static const size_t HEADER_MAX = 700;
+
+        JpegEncoder(int quality = 80)
+        {
+            for (int t = 0; t < 2; t++)
+            {
+                buildCodes(m_dc[t], dcCounts(t), dcValues());
+                buildCodes(m_ac[t], acCounts(t), acValues(t));
+            }
+            setQuality(quality);
+        }
+
+        static bool supports(pixformat_t format)
+        {
+            return format == PIXFORMAT_GRAYSCALE || format == PIXFORMAT_RGB565 || format == PIXFORMAT_YUV422 || format == PIXFORMAT_RGB888;
+        }
+
+        // 1..100 like libjpeg, not the 0..63 scale of the sensor. Not safe while encode() runs
+        void setQuality(int quality)
+        {
+            quality = quality < 1 ? 1 : (quality > 100 ? 100 : quality);
+            if (quality == m_quality)
+                return;
+            m_quality = quality;
+
+            int scale = quality < 50 ? 5000 / quality : 200 - 2 * quality;
+            const uint8_t *zz = zigzag();
+            for (int t = 0; t < 2; t++)
+            {
+                for (int i = 0; i < 64; i++)
+                {
+                    // stored in zigzag order, as DQT wants them
+                    int q = (baseQuant(t)[zz[i]] * scale + 50) / 100;
+                    q = q < 1 ? 1 : (q > 255 ? 255 : q);
+                    m_qt[t][i] = q;
+                    m_recip[t][i] = (1u << 20) / (8 * q);
+                }
+            }
+        }
+
+        int getQuality()
+        {
+            return m_quality;
+        }
+
+        // encodes a frame into `out`, which is grown as needed and can be reused for the next frame
+        bool encode(const uint8_t *src, uint16_t width, uint16_t height, pixformat_t format,
+                    uint8_t *&out, size_t &capacity, size_t &length) const
+        {
+            if (!accepts(format, width, height))
+                return false;
+
+            // typical output is far below this, it only grows when a frame needs it
+            if (!reserve(out, capacity, HEADER_MAX + (size_t)width * height / 2 + 4 * MCU_MAX))
+                return false;
+
+            size_t pos = writeHeaders(out, width, height, format == PIXFORMAT_GRAYSCALE, 0);
+            if (!encodeRows(src, width, height, format, 0, (height + 7) / 8, false, out, capacity, pos))
+                return false;
+            out[pos++] = 0xFF;
+            out[pos++] = 0xD9;
+            length = pos;
+            return true;
+        }
+
+        // the same split into two bands on `executor`, the later band is coded into `spill` and copied behind
+        // the first. `spill` is grown and reused like `out`. Without a second worker this is encode()
+        bool encode(const uint8_t *src, uint16_t width, uint16_t height, pixformat_t format,
+                    uint8_t *&out, size_t &capacity, size_t &length,
+                    StripExecutor &executor, uint8_t *&spill, size_t &spillCapacity) const
+        {
+            int rows = (height + 7) / 8;
+            if (executor.getWorkerCount() < 2 || rows < 2)
+                return encode(src, width, height, format, out, capacity, length);
+            if (!accepts(format, width, height))
+                return false;
+
+            if (!reserve(out, capacity, HEADER_MAX + (size_t)width * height / 4 + 4 * MCU_MAX) ||
+                !reserve(spill, spillCapacity, (size_t)width * height / 4 + 4 * MCU_MAX))
+                return false;
+
+            bool gray = format == PIXFORMAT_GRAYSCALE;
+            int mcusPerRow = (width + (gray ? 7 : 15)) / (gray ? 8 : 16);
+            BandJob job = {this, src, width, height, format, rows, {&out, &spill}, {&capacity, &spillCapacity}, {0, 0}, {false, false}};
+            job.length[0] = writeHeaders(out, width, height, gray, mcusPerRow);
+            if (!executor.run(encodeBand, &job, rows) || !job.ok[0] || !job.ok[1])
+                return false;
+
+            if (!reserve(out, capacity, job.length[0] + job.length[1] + 2))
+                return false;
+            memcpy(out + job.length[0], spill, job.length[1]);
+            size_t pos = job.length[0] + job.length[1];
+            out[pos++] = 0xFF;
+            out[pos++] = 0xD9;
+            length = pos;
+            return true;
+        }
+    };
+}
+#endif
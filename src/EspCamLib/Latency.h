@@ -0,0 +1,164 @@
+#ifndef ESPCAMLIB_LATENCY_H
+#define ESPCAMLIB_LATENCY_H
+#include <Arduino.h>
+#include <atomic>
+
+// fixed bucket latency histograms, recording is one bit scan and one relaxed atomic add
+// so it can sit on every frame of every consumer
+namespace EspCam
+{
+    struct LatencySummary
+    {
+        uint32_t count;
+        uint32_t p50;
+        uint32_t p95;
+        uint32_t p99;
+        uint32_t max;
+    };
+
+    // microsecond values, exact below 16 and four buckets per power of two above, so within 25%
+    class LatencyHistogram
+    {
+    public:
+        static const int BUCKETS = 128;
+
+    private:
+        std::atomic<uint32_t> m_buckets[BUCKETS];
+        std::atomic<uint32_t> m_max;
+
+        static int bucketOf(uint32_t us)
+        {
+            if (us < 16)
+                return us;
+            int msb = 31 - __builtin_clz(us);
+            return 16 + (msb - 4) * 4 + ((us >> (msb - 2)) & 3);
+        }
+
+        // largest value that falls into `bucket`
+        static uint32_t upperBound(int bucket)
+        {
+            if (bucket < 16)
+                return bucket;
+            int msb = (bucket - 16) / 4 + 4;
+            int sub = (bucket - 16) % 4;
+            uint64_t low = ((uint64_t)(4 + sub)) << (msb - 2);
+            return (uint32_t)(low + (1ULL << (msb - 2)) - 1);
+        }
+
+    public:
+        LatencyHistogram()
+        {
+            reset();
+        }
+
+        void record(uint32_t us)
+        {
+            m_buckets[bucketOf(us)].fetch_add(1, std::memory_order_relaxed);
+            uint32_t max = m_max.load(std::memory_order_relaxed);
+            while (us > max && !m_max.compare_exchange_weak(max, us, std::memory_order_relaxed))
+            {
+            }
+        }
+
+        void reset()
+        {
+            for (int i = 0; i < BUCKETS; i++)
+            {
+                m_buckets[i].store(0, std::memory_order_relaxed);
+            }
+            m_max.store(0, std::memory_order_relaxed);
+        }
+
+        // percentiles are reported as the upper bound of their bucket, capped at the largest value seen
+        LatencySummary summarize()
+        {
+            uint32_t counts[BUCKETS];
+            uint32_t total = 0;
+            for (int i = 0; i < BUCKETS; i++)
+            {
+                counts[i] = m_buckets[i].load(std::memory_order_relaxed);
+                total += counts[i];
+            }
+
+            LatencySummary summary = {total, 0, 0, 0, m_max.load(std::memory_order_relaxed)};
+            if (!total)
+                return summary;
+
+            uint32_t ranks[3] = {(total * 50 + 99) / 100, (total * 95 + 99) / 100, (total * 99 + 99) / 100};
+            uint32_t *outs[3] = {&summary.p50, &summary.p95, &summary.p99};
+            uint32_t seen = 0;
+            int next = 0;
+            for (int i = 0; i < BUCKETS && next < 3; i++)
+            {
+                seen += counts[i];
+                while (next < 3 && seen >= ranks[next])
+                {
+                    uint32_t bound = upperBound(i);
+                    *outs[next++] = bound < summary.max ? bound : summary.max;
+                }
+            }
+            return summary;
+        }
+    };
+
+    // per stage timings of the capture-to-wire and capture-to-card paths, all relative to the frame
+    // being published by the FrameBroker except the first two
+    class PipelineLatency
+    {
+    public:
+        enum Stage
+        {
+            // time the broker waited on the driver for a frame
+            FRAME_WAIT,
+            // driver capture to broker publish, the time a frame sat in the fb_count buffers
+            BUFFERED,
+            // software JPEG encoding of a raw frame
+            ENCODE,
+            // publish to a consumer taking the frame
+            DEQUEUE,
+            FIRST_BYTE,
+            LAST_BYTE,
+            RECORD_QUEUED,
+            RECORD_WRITTEN,
+            STAGE_COUNT
+        };
+
+    private:
+        LatencyHistogram m_stages[STAGE_COUNT];
+
+    public:
+        static const char *stageName(int stage)
+        {
+            static const char *names[STAGE_COUNT] = {"frame_wait", "buffered", "encode", "dequeue", "first_byte", "last_byte", "record_queued", "record_written"};
+            return stage >= 0 && stage < STAGE_COUNT ? names[stage] : "";
+        }
+
+        void record(Stage stage, uint32_t us)
+        {
+            m_stages[stage].record(us);
+        }
+
+        // records the time elapsed since `sinceUs`, ignoring timestamps from the future
+        void recordSince(Stage stage, int64_t sinceUs, int64_t nowUs)
+        {
+            if (sinceUs > 0 && nowUs >= sinceUs)
+            {
+                m_stages[stage].record((uint32_t)(nowUs - sinceUs));
+            }
+        }
+
+        LatencySummary summarize(Stage stage)
+        {
+            return m_stages[stage].summarize();
+        }
+
+        void reset()
+        {
+            for (int i = 0; i < STAGE_COUNT; i++)
+            {
+                m_stages[i].reset();
+            }
+        }
+    };
+}
+#endif
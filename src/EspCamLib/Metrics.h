@@ -0,0 +1,196 @@
+#ifndef ESPCAMLIB_METRICS_H
+#define ESPCAMLIB_METRICS_H
+#include <Arduino.h>
+#include <atomic>
+#include "esp_timer.h"
+
+// monotonic counters and gauges updated with relaxed atomics from any task. Nothing is ever reset,
+// readers compute rates from the difference between two snapshots
+namespace EspCam
+{
+    // a 64-bit byte total kept in 32-bit atomics, 64-bit atomics are not lock-free on the ESP32 and take
+    // a global lock on every add. The writer that wraps the low word counts the wrap, a reader can still see
+    // the wrapped low word before the count and come out exactly 4 GiB short, Metrics::snapshot() corrects that
+    // against the total it handed out last
+    class WideCounter
+    {
+    private:
+        std::atomic<uint32_t> m_low;
+        std::atomic<uint32_t> m_wraps;
+
+    public:
+        WideCounter()
+        {
+            m_low.store(0);
+            m_wraps.store(0);
+        }
+
+        void add(uint32_t n)
+        {
+            uint32_t old = m_low.fetch_add(n, std::memory_order_relaxed);
+            if ((uint32_t)(old + n) < old)
+                m_wraps.fetch_add(1, std::memory_order_release);
+        }
+
+        // never more than the true total, at most 4 GiB less
+        uint64_t load()
+        {
+            uint32_t wraps = m_wraps.load(std::memory_order_acquire);
+            return ((uint64_t)wraps << 32) | m_low.load(std::memory_order_relaxed);
+        }
+    };
+
+    struct MetricsSnapshot
+    {
+        int64_t timestamp;
+        uint32_t framesCaptured;
+        uint32_t framesSent;
+        uint32_t streamFramesDropped;
+        uint32_t recorderFrames;
+        uint32_t recorderFramesDropped;
+        uint64_t bytesSent;
+        uint64_t sdBytesWritten;
+        int32_t streamClients;
+    };
+
+    class Metrics
+    {
+    private:
+        std::atomic<uint32_t> m_framesCaptured;
+        std::atomic<uint32_t> m_framesSent;
+        std::atomic<uint32_t> m_streamFramesDropped;
+        std::atomic<uint32_t> m_recorderFrames;
+        std::atomic<uint32_t> m_recorderFramesDropped;
+        WideCounter m_bytesSent;
+        WideCounter m_sdBytesWritten;
+        std::atomic<int32_t> m_streamClients;
+        // the last totals handed out, snapshot() never goes below them
+        portMUX_TYPE m_mux = portMUX_INITIALIZER_UNLOCKED;
+        uint64_t m_lastBytesSent = 0;
+        uint64_t m_lastSdBytesWritten = 0;
+
+        static uint64_t monotonic(uint64_t value, uint64_t &last)
+        {
+            if (value < last)
+                value += 1ULL << 32;
+            last = value;
+            return value;
+        }
+
+    public:
+        Metrics()
+        {
+            m_framesCaptured.store(0);
+            m_framesSent.store(0);
+            m_streamFramesDropped.store(0);
+            m_recorderFrames.store(0);
+            m_recorderFramesDropped.store(0);
+            m_streamClients.store(0);
+        }
+
+        void addFrameCaptured()
+        {
+            m_framesCaptured.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // one stream part fully written to a client
+        void addFrameSent()
+        {
+            m_framesSent.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void addStreamDropped(uint32_t frames = 1)
+        {
+            m_streamFramesDropped.fetch_add(frames, std::memory_order_relaxed);
+        }
+
+        void addRecorderFrame()
+        {
+            m_recorderFrames.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void addRecorderDropped(uint32_t frames = 1)
+        {
+            m_recorderFramesDropped.fetch_add(frames, std::memory_order_relaxed);
+        }
+
+        void addBytesSent(size_t bytes)
+        {
+            m_bytesSent.add(bytes);
+        }
+
+        void addSdBytesWritten(size_t bytes)
+        {
+            m_sdBytesWritten.add(bytes);
+        }
+
+        void streamClientOpened()
+        {
+            m_streamClients.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void streamClientClosed()
+        {
+            m_streamClients.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        MetricsSnapshot snapshot()
+        {
+            MetricsSnapshot s;
+            s.timestamp = esp_timer_get_time();
+            s.framesCaptured = m_framesCaptured.load(std::memory_order_relaxed);
+            s.framesSent = m_framesSent.load(std::memory_order_relaxed);
+            s.streamFramesDropped = m_streamFramesDropped.load(std::memory_order_relaxed);
+            s.recorderFrames = m_recorderFrames.load(std::memory_order_relaxed);
+            s.recorderFramesDropped = m_recorderFramesDropped.load(std::memory_order_relaxed);
+            // loaded under the lock so a reader that lost the race cannot push an older total past a newer one
+            portENTER_CRITICAL(&m_mux);
+            s.bytesSent = monotonic(m_bytesSent.load(), m_lastBytesSent);
+            s.sdBytesWritten = monotonic(m_sdBytesWritten.load(), m_lastSdBytesWritten);
+            portEXIT_CRITICAL(&m_mux);
+            s.streamClients = m_streamClients.load(std::memory_order_relaxed);
+            return s;
+        }
+    };
+
+    // turns snapshots taken by one reader into rates, the window only moves once `minWindowMs` has passed
+    // so frequent polling does not make the rate noisy
+    class MetricsRate
+    {
+    private:
+        MetricsSnapshot m_previous = {};
+        uint32_t m_minWindowUs;
+        float m_bytesPerSec = 0;
+        float m_framesPerSec = 0;
+
+    public:
+        MetricsRate(uint32_t minWindowMs = 1000) : m_minWindowUs(minWindowMs * 1000) {}
+
+        void update(const MetricsSnapshot &now)
+        {
+            if (!m_previous.timestamp)
+            {
+                m_previous = now;
+                return;
+            }
+            int64_t elapsed = now.timestamp - m_previous.timestamp;
+            if (elapsed < m_minWindowUs)
+                return;
+
+            m_bytesPerSec = (now.bytesSent - m_previous.bytesSent) * 1000000.0f / elapsed;
+            m_framesPerSec = (now.framesSent - m_previous.framesSent) * 1000000.0f / elapsed;
+            m_previous = now;
+        }
+
+        float getBytesPerSec()
+        {
+            return m_bytesPerSec;
+        }
+
+        float getFramesPerSec()
+        {
+            return m_framesPerSec;
+        }
+    };
+}
+#endif
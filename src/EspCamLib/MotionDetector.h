@@ -0,0 +1,425 @@
+#ifndef ESPCAMLIB_MOTIONDETECTOR_H
+#define ESPCAMLIB_MOTIONDETECTOR_H
+#include <Arduino.h>
+#include "esp_camera.h"
+#include "esp_timer.h"
+
+#include "Camera.h"
+#include "FrameBroker.h"
+#include "JpegDc.h"
+
+// block-wise frame differencing on a 1/8 scale luminance map taken from the JPEG DC coefficients,
+// compared against a slowly adapting background
+namespace EspCam
+{
+    struct MotionZone
+    {
+        // rectangle in percent of the frame
+        uint8_t x;
+        uint8_t y;
+        uint8_t width;
+        uint8_t height;
+        // luminance change a cell needs to count as changed, 0..255
+        uint8_t threshold;
+        // percent of changed cells in the zone that reports motion
+        uint8_t trigger;
+    };
+
+    struct MotionResult
+    {
+        static const int MAX_ZONES = 8;
+
+        uint32_t sequence;
+        int64_t timestamp;
+        // highest zone score, percent of changed cells
+        float score;
+        float zoneScores[MAX_ZONES];
+        int zoneCount;
+        bool motion;
+        uint32_t analysisUs;
+        uint16_t cellsX;
+        uint16_t cellsY;
+    };
+
+    class MotionDetector
+    {
+    public:
+        static const int MAX_ZONES = MotionResult::MAX_ZONES;
+        typedef void (*MotionCallback)(const MotionResult &result, void *ctx);
+
+    private:
+        Camera *m_camera;
+        JpegDcDecoder m_decoder;
+        MotionZone m_zones[MAX_ZONES];
+        int m_zoneCount = 0;
+        MotionZone m_defaultZone = {0, 0, 100, 100, 24, 2};
+        uint8_t m_cellSize = 2;
+        uint8_t m_learnShift = 3;
+        uint32_t m_intervalMs = 200;
+
+        uint8_t *m_blocks = nullptr;
+        size_t m_blocksCapacity = 0;
+        uint8_t *m_cells = nullptr;
+        // background in 8.4 fixed point
+        uint16_t *m_background = nullptr;
+        size_t m_cellCapacity = 0;
+        uint16_t m_cellsX = 0;
+        uint16_t m_cellsY = 0;
+        bool m_hasBackground = false;
+
+        MotionResult m_result;
+        SemaphoreHandle_t m_lock = NULL;
+        MotionCallback m_callback = nullptr;
+        void *m_callbackCtx = nullptr;
+        TaskHandle_t m_taskHandle = NULL;
+        volatile bool m_running = false;
+
+        bool reserve(uint8_t *&buf, size_t &capacity, size_t size)
+        {
+            if (size <= capacity)
+                return true;
+            uint8_t *grown = (uint8_t *)realloc(buf, size);
+            if (!grown)
+                return false;
+            buf = grown;
+            capacity = size;
+            return true;
+        }
+
+        // 8x8 block means of a raw frame, for the formats that do not come with DC coefficients
+        bool rawBlockMeans(camera_fb_t *fb, uint16_t &blocksX, uint16_t &blocksY)
+        {
+            blocksX = fb->width / 8;
+            blocksY = fb->height / 8;
+            if (!reserve(m_blocks, m_blocksCapacity, (size_t)blocksX * blocksY))
+                return false;
+
+            for (int by = 0; by < blocksY; by++)
+            {
+                for (int bx = 0; bx < blocksX; bx++)
+                {
+                    uint32_t sum = 0;
+                    for (int y = 0; y < 8; y++)
+                    {
+                        size_t row = (size_t)(by * 8 + y) * fb->width + bx * 8;
+                        for (int x = 0; x < 8; x++)
+                        {
+                            if (fb->format == PIXFORMAT_GRAYSCALE)
+                            {
+                                sum += fb->buf[row + x];
+                            }
+                            else
+                            {
+                                // big endian RGB565, luma approximated from the 6 bit green channel
+                                const uint8_t *p = fb->buf + (row + x) * 2;
+                                sum += ((p[0] & 0x07) << 5) | ((p[1] & 0xE0) >> 3);
+                            }
+                        }
+                    }
+                    m_blocks[by * blocksX + bx] = sum >> 6;
+                }
+            }
+            return true;
+        }
+
+        bool buildCells(const uint8_t *map, uint16_t stride, uint16_t blocksX, uint16_t blocksY)
+        {
+            uint16_t cellsX = blocksX / m_cellSize;
+            uint16_t cellsY = blocksY / m_cellSize;
+            size_t count = (size_t)cellsX * cellsY;
+            if (!count)
+                return false;
+
+            if (count > m_cellCapacity)
+            {
+                uint8_t *cells = (uint8_t *)realloc(m_cells, count);
+                if (!cells)
+                    return false;
+                m_cells = cells;
+                uint16_t *background = (uint16_t *)realloc(m_background, count * sizeof(uint16_t));
+                if (!background)
+                    return false;
+                m_background = background;
+                m_cellCapacity = count;
+            }
+
+            if (cellsX != m_cellsX || cellsY != m_cellsY)
+            {
+                // frame size changed, start learning again
+                m_cellsX = cellsX;
+                m_cellsY = cellsY;
+                m_hasBackground = false;
+            }
+
+            int area = m_cellSize * m_cellSize;
+            for (int cy = 0; cy < cellsY; cy++)
+            {
+                for (int cx = 0; cx < cellsX; cx++)
+                {
+                    uint32_t sum = 0;
+                    for (int y = 0; y < m_cellSize; y++)
+                    {
+                        const uint8_t *row = map + (size_t)(cy * m_cellSize + y) * stride + cx * m_cellSize;
+                        for (int x = 0; x < m_cellSize; x++)
+                        {
+                            sum += row[x];
+                        }
+                    }
+                    m_cells[cy * cellsX + cx] = sum / area;
+                }
+            }
+            return true;
+        }
+
+        float zoneScore(const MotionZone &zone)
+        {
+            int x0 = zone.x * m_cellsX / 100;
+            int y0 = zone.y * m_cellsY / 100;
+            int x1 = (zone.x + zone.width) * m_cellsX / 100;
+            int y1 = (zone.y + zone.height) * m_cellsY / 100;
+            if (x1 > m_cellsX)
+                x1 = m_cellsX;
+            if (y1 > m_cellsY)
+                y1 = m_cellsY;
+            if (x1 <= x0 || y1 <= y0)
+                return 0;
+
+            int changed = 0;
+            for (int y = y0; y < y1; y++)
+            {
+                for (int x = x0; x < x1; x++)
+                {
+                    int i = y * m_cellsX + x;
+                    int diff = (int)m_cells[i] - (m_background[i] >> 4);
+                    if (diff < 0)
+                        diff = -diff;
+                    if (diff > zone.threshold)
+                        changed++;
+                }
+            }
+            return changed * 100.0f / ((x1 - x0) * (y1 - y0));
+        }
+
+        void learn()
+        {
+            size_t count = (size_t)m_cellsX * m_cellsY;
+            for (size_t i = 0; i < count; i++)
+            {
+                int target = m_cells[i] << 4;
+                if (!m_hasBackground)
+                    m_background[i] = target;
+                else
+                    m_background[i] += (target - (int)m_background[i]) >> m_learnShift;
+            }
+            m_hasBackground = true;
+        }
+
+        static void detectTask(void *param)
+        {
+            MotionDetector *self = static_cast<MotionDetector *>(param);
+            FrameBroker *broker = self->m_camera->getBroker();
+            uint32_t lastSeq = 0;
+            TickType_t lastRun = xTaskGetTickCount();
+
+            while (self->m_running)
+            {
+                FrameRef frame = broker->acquire(lastSeq, pdMS_TO_TICKS(1000));
+                if (!frame)
+                    continue;
+                lastSeq = frame.sequence();
+
+                MotionResult result;
+                bool analyzed = self->analyze(frame, result);
+                frame.reset();
+
+                if (analyzed && result.motion && self->m_callback)
+                {
+                    self->m_callback(result, self->m_callbackCtx);
+                }
+
+                vTaskDelayUntil(&lastRun, pdMS_TO_TICKS(self->m_intervalMs));
+            }
+
+            self->m_taskHandle = NULL;
+            vTaskDelete(NULL);
+        }
+
+    public:
+        MotionDetector(Camera *camera) : m_camera(camera)
+        {
+            memset(&m_result, 0, sizeof(m_result));
+        }
+
+        ~MotionDetector()
+        {
+            stop();
+            free(m_blocks);
+            free(m_cells);
+            free(m_background);
+            if (m_lock)
+            {
+                vSemaphoreDelete(m_lock);
+            }
+        }
+
+        // zones replace the default full frame zone, returns false when all slots are taken
+        bool addZone(const MotionZone &zone)
+        {
+            if (m_zoneCount >= MAX_ZONES)
+                return false;
+            m_zones[m_zoneCount++] = zone;
+            return true;
+        }
+
+        void clearZones()
+        {
+            m_zoneCount = 0;
+        }
+
+        // threshold and trigger of the full frame zone used while no zones are set
+        void setSensitivity(uint8_t threshold, uint8_t trigger)
+        {
+            m_defaultZone.threshold = threshold;
+            m_defaultZone.trigger = trigger;
+        }
+
+        // side of a cell in 8x8 blocks, larger cells ignore more noise
+        void setCellSize(uint8_t blocks)
+        {
+            m_cellSize = blocks ? blocks : 1;
+        }
+
+        // background adapts by 1/2^shift of the difference on every analyzed frame
+        void setLearningRate(uint8_t shift)
+        {
+            m_learnShift = shift;
+        }
+
+        // minimum time between analyzed frames
+        void setInterval(uint32_t ms)
+        {
+            m_intervalMs = ms ? ms : 1;
+        }
+
+        void onMotion(MotionCallback callback, void *ctx = nullptr)
+        {
+            m_callback = callback;
+            m_callbackCtx = ctx;
+        }
+
+        // runs the detector on its own task, by default on core 0 away from capture
+        bool begin(int core = 0)
+        {
+            if (m_running)
+                return true;
+
+            if (!m_lock)
+            {
+                m_lock = xSemaphoreCreateMutex();
+                if (!m_lock)
+                    return false;
+            }
+
+            if (!m_camera->getBroker()->begin())
+                return false;
+
+            m_running = true;
+            if (xTaskCreatePinnedToCore(detectTask, "Motion", 4096, this, 4, &m_taskHandle, core) != pdPASS)
+            {
+                m_running = false;
+                return false;
+            }
+            return true;
+        }
+
+        void stop()
+        {
+            if (!m_running)
+                return;
+
+            m_running = false;
+            unsigned long startWait = millis();
+            while (m_taskHandle != NULL && millis() - startWait < 2000)
+            {
+                vTaskDelay(10);
+            }
+        }
+
+        // analyzes one frame and updates the background, can also be called directly without begin()
+        bool analyze(const FrameRef &frame, MotionResult &result)
+        {
+            int64_t start = esp_timer_get_time();
+            camera_fb_t *fb = frame.fb();
+            if (!fb)
+                return false;
+
+            const uint8_t *map;
+            uint16_t stride, blocksX, blocksY;
+            if (fb->format == PIXFORMAT_JPEG)
+            {
+                if (!m_decoder.decode(fb->buf, fb->len))
+                    return false;
+                map = m_decoder.getMap(0);
+                stride = m_decoder.getMapWidth(0);
+                blocksX = (m_decoder.getWidth() + 7) / 8;
+                blocksY = (m_decoder.getHeight() + 7) / 8;
+            }
+            else if (fb->format == PIXFORMAT_GRAYSCALE || fb->format == PIXFORMAT_RGB565)
+            {
+                if (!rawBlockMeans(fb, blocksX, blocksY))
+                    return false;
+                map = m_blocks;
+                stride = blocksX;
+            }
+            else
+            {
+                return false;
+            }
+
+            if (!buildCells(map, stride, blocksX, blocksY))
+                return false;
+
+            memset(&result, 0, sizeof(result));
+            result.sequence = frame.sequence();
+            result.timestamp = frame.timestamp();
+            result.cellsX = m_cellsX;
+            result.cellsY = m_cellsY;
+
+            if (m_hasBackground)
+            {
+                const MotionZone *zones = m_zoneCount ? m_zones : &m_defaultZone;
+                result.zoneCount = m_zoneCount ? m_zoneCount : 1;
+                for (int i = 0; i < result.zoneCount; i++)
+                {
+                    float score = zoneScore(zones[i]);
+                    result.zoneScores[i] = score;
+                    if (score > result.score)
+                        result.score = score;
+                    if (score >= zones[i].trigger)
+                        result.motion = true;
+                }
+            }
+            learn();
+
+            result.analysisUs = esp_timer_get_time() - start;
+            if (m_lock)
+                xSemaphoreTake(m_lock, portMAX_DELAY);
+            m_result = result;
+            if (m_lock)
+                xSemaphoreGive(m_lock);
+            return true;
+        }
+
+        MotionResult getResult()
+        {
+            MotionResult result;
+            if (m_lock)
+                xSemaphoreTake(m_lock, portMAX_DELAY);
+            result = m_result;
+            if (m_lock)
+                xSemaphoreGive(m_lock);
+            return result;
+        }
+    };
+}
+#endif
@@ -0,0 +1,117 @@
+#ifndef ESPCAMLIB_MULTIPART_H
+#define ESPCAMLIB_MULTIPART_H
+#include <Arduino.h>
+#include "esp_http_server.h"
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+
+// allocation free multipart/x-mixed-replace framing, each part goes out as one gathered socket write
+namespace EspCam
+{
+    class MultipartWriter
+    {
+    public:
+        static const size_t HEADER_MAX = 80;
+
+    private:
+        int m_fd;
+        char m_header[HEADER_MAX];
+
+    public:
+        MultipartWriter(int fd) : m_fd(fd) {}
+
+        MultipartWriter(httpd_req_t *req) : m_fd(httpd_req_to_sockfd(req)) {}
+
+        int getSocket()
+        {
+            return m_fd;
+        }
+
+        // formats the part header for a payload of `len` bytes into `out`, returns its length
+        static size_t formatPartHeader(char *out, size_t len)
+        {
+            static const char prefix[] = "--frame\r\nContent-Type: image/jpeg\r\nContent-Length: ";
+            memcpy(out, prefix, sizeof(prefix) - 1);
+            size_t pos = sizeof(prefix) - 1;
+
+            char digits[12];
+            int n = 0;
+            do
+            {
+                digits[n++] = '0' + (len % 10);
+                len /= 10;
+            } while (len);
+            while (n)
+            {
+                out[pos++] = digits[--n];
+            }
+
+            memcpy(out + pos, "\r\n\r\n", 4);
+            return pos + 4;
+        }
+
+        // fills `iov` with header, payload and trailer, skipping the first `offset` bytes already sent.
+        // `trailerLen` is 0 for framings without a part trailer
+        static int fillParts(struct iovec iov[3], const char *header, size_t headerLen, const uint8_t *data, size_t len, size_t offset, size_t trailerLen = 2)
+        {
+            const void *bases[3] = {header, data, "\r\n"};
+            size_t lens[3] = {headerLen, len, trailerLen};
+            int count = 0;
+
+            for (int i = 0; i < 3; i++)
+            {
+                if (offset >= lens[i])
+                {
+                    offset -= lens[i];
+                    continue;
+                }
+                iov[count].iov_base = (void *)((const uint8_t *)bases[i] + offset);
+                iov[count].iov_len = lens[i] - offset;
+                offset = 0;
+                count++;
+            }
+            return count;
+        }
+
+        // the stream is close delimited, so the handler must return ESP_FAIL when done to drop the connection
+        esp_err_t begin(httpd_req_t *req)
+        {
+            static const char response[] =
+                "HTTP/1.1 200 OK\r\n"
+                "Content-Type: multipart/x-mixed-replace; boundary=frame\r\n"
+                "Access-Control-Allow-Origin: *\r\n"
+                "Cache-Control: no-cache, no-store\r\n"
+                "Connection: close\r\n\r\n";
+
+            return httpd_send(req, response, sizeof(response) - 1) == sizeof(response) - 1 ? ESP_OK : ESP_FAIL;
+        }
+
+        // `firstByteUs`, when given, gets the time the first write the socket accepted returned
+        esp_err_t writeFrame(const uint8_t *data, size_t len, int64_t *firstByteUs = nullptr)
+        {
+            size_t headerLen = formatPartHeader(m_header, len);
+            size_t total = headerLen + len + 2;
+            size_t sent = 0;
+
+            while (sent < total)
+            {
+                struct iovec iov[3];
+                int count = fillParts(iov, m_header, headerLen, data, len, sent);
+                ssize_t res = lwip_writev(m_fd, iov, count);
+                if (res < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    return ESP_FAIL;
+                }
+                if (firstByteUs && sent == 0 && res > 0)
+                {
+                    *firstByteUs = esp_timer_get_time();
+                }
+                sent += res;
+            }
+            return ESP_OK;
+        }
+    };
+}
+#endif
@@ -0,0 +1,170 @@
+#ifndef ESPCAMLIB_PREROLLBUFFER_H
+#define ESPCAMLIB_PREROLLBUFFER_H
+#include <Arduino.h>
+
+// ring of copied JPEG frames in PSRAM, keeps the last seconds of video around without holding camera buffers
+namespace EspCam
+{
+    class PreRollBuffer
+    {
+    public:
+        struct Entry
+        {
+            size_t offset;
+            uint32_t len;
+            uint16_t width;
+            uint16_t height;
+            int64_t timestamp;
+        };
+
+    private:
+        uint8_t *m_buf = nullptr;
+        size_t m_capacity = 0;
+        Entry *m_entries = nullptr;
+        int m_maxEntries = 0;
+        int m_first = 0;
+        int m_count = 0;
+        size_t m_writePos = 0;
+        uint32_t m_evicted = 0;
+
+        // frames are stored contiguously, wrapping to the start of the buffer when the tail is too short
+        bool fits(size_t len)
+        {
+            if (m_count == 0)
+            {
+                m_writePos = 0;
+                return len <= m_capacity;
+            }
+
+            size_t oldest = m_entries[m_first].offset;
+            if (m_writePos > oldest)
+            {
+                if (m_capacity - m_writePos >= len)
+                    return true;
+                if (oldest >= len)
+                {
+                    m_writePos = 0;
+                    return true;
+                }
+                return false;
+            }
+            return oldest - m_writePos >= len;
+        }
+
+    public:
+        ~PreRollBuffer()
+        {
+            end();
+        }
+
+        bool begin(size_t bytes, int maxFrames)
+        {
+            end();
+            m_buf = (uint8_t *)(psramFound() ? ps_malloc(bytes) : malloc(bytes));
+            m_entries = (Entry *)(psramFound() ? ps_malloc(maxFrames * sizeof(Entry)) : malloc(maxFrames * sizeof(Entry)));
+            if (!m_buf || !m_entries)
+            {
+                end();
+                return false;
+            }
+            m_capacity = bytes;
+            m_maxEntries = maxFrames;
+            clear();
+            return true;
+        }
+
+        void end()
+        {
+            free(m_buf);
+            free(m_entries);
+            m_buf = nullptr;
+            m_entries = nullptr;
+            m_capacity = 0;
+            m_maxEntries = 0;
+            m_count = 0;
+        }
+
+        void clear()
+        {
+            m_first = 0;
+            m_count = 0;
+            m_writePos = 0;
+        }
+
+        // memory held by the ring and its frame table
+        size_t getFootprint()
+        {
+            return m_capacity + m_maxEntries * sizeof(Entry);
+        }
+
+        int count()
+        {
+            return m_count;
+        }
+
+        // frames pushed out to make room since the counter was last read
+        uint32_t takeEvicted()
+        {
+            uint32_t evicted = m_evicted;
+            m_evicted = 0;
+            return evicted;
+        }
+
+        // time covered by the buffered frames in microseconds
+        int64_t duration()
+        {
+            if (m_count < 2)
+                return 0;
+            return m_entries[(m_first + m_count - 1) % m_maxEntries].timestamp - m_entries[m_first].timestamp;
+        }
+
+        const Entry &front()
+        {
+            return m_entries[m_first];
+        }
+
+        const uint8_t *data(const Entry &entry)
+        {
+            return m_buf + entry.offset;
+        }
+
+        void pop()
+        {
+            if (m_count == 0)
+                return;
+            m_first = (m_first + 1) % m_maxEntries;
+            m_count--;
+        }
+
+        // copies a frame in, evicting the oldest ones that are out of room or older than `maxAgeUs` (0 keeps any age)
+        bool push(const uint8_t *data, size_t len, uint16_t width, uint16_t height, int64_t timestamp, int64_t maxAgeUs = 0)
+        {
+            if (!m_buf || len > m_capacity)
+                return false;
+
+            while (m_count > 0 && maxAgeUs > 0 && timestamp - m_entries[m_first].timestamp > maxAgeUs)
+            {
+                pop();
+                m_evicted++;
+            }
+
+            while (m_count == m_maxEntries || !fits(len))
+            {
+                pop();
+                m_evicted++;
+            }
+
+            Entry &entry = m_entries[(m_first + m_count) % m_maxEntries];
+            entry.offset = m_writePos;
+            entry.len = len;
+            entry.width = width;
+            entry.height = height;
+            entry.timestamp = timestamp;
+            memcpy(m_buf + m_writePos, data, len);
+            m_writePos += len;
+            m_count++;
+            return true;
+        }
+    };
+}
+#endif
@@ -0,0 +1,360 @@
+#ifndef ESPCAMLIB_RATECONTROLLER_H
+#define ESPCAMLIB_RATECONTROLLER_H
+#include <stdint.h>
+#include <stddef.h>
+
+// closed-loop stream rate control, walks a ladder of jpeg quality and then frame size steps
+// so the slowest viewer can keep up with the target fps. Only plain integer inputs and no
+// ESP-IDF calls, the caller supplies the clock and applies the chosen settings to the camera.
+// Frame sizes are framesize_t values, the size steps keep the aspect ratio of the base size
+namespace EspCam
+{
+    struct RateControlState
+    {
+        bool enabled;
+        int level;
+        int maxLevel;
+        int quality;
+        int frameSize;
+        // slowest client over the last window
+        float fps;
+        // frames per second the slowest client could take at the current frame size
+        float capacityFps;
+        uint32_t avgFrameBytes;
+        uint32_t avgSendUs;
+        int clients;
+        uint32_t stepsDown;
+        uint32_t stepsUp;
+    };
+
+    class RateController
+    {
+    public:
+        static const int MAX_CLIENTS = 8;
+        static const int MAX_SIZES = 8;
+
+    private:
+        struct Client
+        {
+            int id = -1;
+            uint32_t frames = 0;
+            uint64_t bytes = 0;
+            uint64_t sendUs = 0;
+        };
+
+        Client m_clients[MAX_CLIENTS];
+        bool m_enabled = false;
+        float m_targetFps = 15;
+        int m_baseQuality = 12;
+        int m_worstQuality = 40;
+        int m_qualityStep = 4;
+        int m_baseFrameSize = 0;
+        int m_minFrameSize = 0;
+        // the base and the smaller sizes of the same aspect ratio down to the minimum, largest first
+        int m_sizes[MAX_SIZES] = {0};
+        int m_sizeCount = 1;
+        // a step needs this many consecutive windows below / above the band
+        int m_downWindows = 2;
+        int m_upWindows = 4;
+        // degrade below target * (1 - low), recover above target * (1 + high)
+        float m_lowBand = 0.15f;
+        float m_highBand = 0.6f;
+        uint32_t m_windowUs = 1000000;
+        int m_holdWindows = 1;
+
+        int m_level = 0;
+        int m_below = 0;
+        int m_above = 0;
+        int m_hold = 0;
+        int64_t m_windowStart = -1;
+        RateControlState m_state = {};
+
+        int qualityLevels()
+        {
+            if (m_worstQuality <= m_baseQuality || m_qualityStep <= 0)
+                return 0;
+            return (m_worstQuality - m_baseQuality + m_qualityStep - 1) / m_qualityStep;
+        }
+
+        int sizeLevels()
+        {
+            return m_sizeCount - 1;
+        }
+
+        // width and height of a framesize_t of the esp32-camera driver, nullptr for one it does not know
+        static const uint16_t *dimensions(int frameSize)
+        {
+            static const uint16_t table[][2] = {
+                {96, 96}, {160, 120}, {176, 144}, {240, 176}, {240, 240}, {320, 240}, {400, 296}, {480, 320},
+                {640, 480}, {800, 600}, {1024, 768}, {1280, 720}, {1280, 1024}, {1600, 1200}, {1920, 1080},
+                {720, 1280}, {864, 1536}, {2048, 1536}, {2560, 1440}, {2560, 1600}, {1080, 1920}, {2560, 1920}};
+            if (frameSize < 0 || frameSize >= (int)(sizeof(table) / sizeof(table[0])))
+                return nullptr;
+            return table[frameSize];
+        }
+
+        // the enum mixes aspect ratios (HVGA is 3:2, 240X240 square, CIF not quite 4:3), so stepping
+        // through it would stretch the picture. Only exact matches of the base ratio are kept
+        void buildSizes()
+        {
+            m_sizes[0] = m_baseFrameSize;
+            m_sizeCount = 1;
+            const uint16_t *base = dimensions(m_baseFrameSize);
+            const uint16_t *min = dimensions(m_minFrameSize);
+            if (!base || !min)
+                return;
+
+            uint32_t minArea = (uint32_t)min[0] * min[1];
+            uint16_t width = base[0];
+            for (int size = m_baseFrameSize - 1; size >= 0 && m_sizeCount < MAX_SIZES; size--)
+            {
+                const uint16_t *d = dimensions(size);
+                if ((uint32_t)d[0] * base[1] != (uint32_t)d[1] * base[0] || d[0] >= width || (uint32_t)d[0] * d[1] < minArea)
+                    continue;
+                m_sizes[m_sizeCount++] = size;
+                width = d[0];
+            }
+        }
+
+        void resetWindow()
+        {
+            for (int i = 0; i < MAX_CLIENTS; i++)
+            {
+                m_clients[i].frames = 0;
+                m_clients[i].bytes = 0;
+                m_clients[i].sendUs = 0;
+            }
+        }
+
+        Client *find(int id, bool create)
+        {
+            Client *freeSlot = nullptr;
+            for (int i = 0; i < MAX_CLIENTS; i++)
+            {
+                if (m_clients[i].id == id)
+                    return &m_clients[i];
+                if (!freeSlot && m_clients[i].id < 0)
+                    freeSlot = &m_clients[i];
+            }
+            if (create && freeSlot)
+            {
+                *freeSlot = Client();
+                freeSlot->id = id;
+                return freeSlot;
+            }
+            return nullptr;
+        }
+
+        void setLevel(int level)
+        {
+            int max = getMaxLevel();
+            if (level < 0)
+                level = 0;
+            if (level > max)
+                level = max;
+            if (level > m_level)
+                m_state.stepsDown++;
+            else if (level < m_level)
+                m_state.stepsUp++;
+            m_level = level;
+            m_below = 0;
+            m_above = 0;
+            m_hold = m_holdWindows;
+        }
+
+    public:
+        // jpeg quality and frame size the ladder starts from, also the best it will ever go back to
+        void setBase(int quality, int frameSize)
+        {
+            m_baseQuality = quality;
+            m_baseFrameSize = frameSize;
+            buildSizes();
+            if (m_level > getMaxLevel())
+                m_level = getMaxLevel();
+        }
+
+        void setTargetFps(float fps)
+        {
+            m_targetFps = fps;
+        }
+
+        // worst jpeg quality (higher number) to degrade to and the step between levels
+        void setQualityRange(int worst, int step = 4)
+        {
+            m_worstQuality = worst;
+            m_qualityStep = step;
+        }
+
+        // smallest framesize_t to fall back to once quality is exhausted, sizes with fewer pixels are
+        // left out. Equal to the base, or no smaller size with the base's aspect ratio, disables resizing
+        void setMinFrameSize(int frameSize)
+        {
+            m_minFrameSize = frameSize;
+            buildSizes();
+            if (m_level > getMaxLevel())
+                m_level = getMaxLevel();
+        }
+
+        void setHysteresis(float lowBand, float highBand, int downWindows = 2, int upWindows = 4)
+        {
+            m_lowBand = lowBand;
+            m_highBand = highBand;
+            m_downWindows = downWindows;
+            m_upWindows = upWindows;
+        }
+
+        void setWindow(uint32_t windowMs)
+        {
+            m_windowUs = windowMs * 1000;
+        }
+
+        void setEnabled(bool enable)
+        {
+            m_enabled = enable;
+            if (!enable)
+            {
+                reset();
+            }
+        }
+
+        // back to the base settings, e.g. after they were changed by hand
+        void reset()
+        {
+            m_level = 0;
+            m_below = 0;
+            m_above = 0;
+            m_hold = m_holdWindows;
+        }
+
+        bool isEnabled()
+        {
+            return m_enabled;
+        }
+
+        int getMaxLevel()
+        {
+            return qualityLevels() + sizeLevels();
+        }
+
+        int getLevel()
+        {
+            return m_level;
+        }
+
+        int getQuality()
+        {
+            int q = m_baseQuality + (m_level < qualityLevels() ? m_level : qualityLevels()) * m_qualityStep;
+            return q > m_worstQuality && qualityLevels() ? m_worstQuality : q;
+        }
+
+        int getFrameSize()
+        {
+            int steps = m_level - qualityLevels();
+            return m_sizes[steps > 0 ? steps : 0];
+        }
+
+        // one finished frame for client `id`, `sendUs` is the time from the first to the last byte
+        void onFrameSent(int id, size_t bytes, uint32_t sendUs)
+        {
+            Client *client = find(id, true);
+            if (!client)
+                return;
+            client->frames++;
+            client->bytes += bytes;
+            client->sendUs += sendUs;
+        }
+
+        void removeClient(int id)
+        {
+            Client *client = find(id, false);
+            if (client)
+                client->id = -1;
+        }
+
+        // closes the measurement window once `nowUs` passes its end, returns true when the level changed
+        bool update(int64_t nowUs)
+        {
+            if (m_windowStart < 0)
+            {
+                m_windowStart = nowUs;
+                return false;
+            }
+            int64_t elapsed = nowUs - m_windowStart;
+            if (elapsed < m_windowUs)
+                return false;
+
+            // the slowest client is the one with the least headroom
+            int clients = 0;
+            float worstCapacity = 0;
+            float worstFps = 0;
+            uint32_t worstBytes = 0;
+            uint32_t worstSendUs = 0;
+            for (int i = 0; i < MAX_CLIENTS; i++)
+            {
+                Client &c = m_clients[i];
+                if (c.id < 0)
+                    continue;
+
+                float fps = c.frames * 1000000.0f / elapsed;
+                // a client that did not finish a frame in the whole window is stalled on its socket
+                float capacity = c.frames ? c.frames * 1000000.0f / (c.sendUs ? c.sendUs : 1) : 0;
+                if (!clients || capacity < worstCapacity)
+                {
+                    worstCapacity = capacity;
+                    worstFps = fps;
+                    worstBytes = c.frames ? c.bytes / c.frames : 0;
+                    worstSendUs = c.frames ? c.sendUs / c.frames : (uint32_t)elapsed;
+                }
+                clients++;
+            }
+            resetWindow();
+            m_windowStart = nowUs;
+
+            m_state.fps = worstFps;
+            m_state.capacityFps = worstCapacity;
+            m_state.avgFrameBytes = worstBytes;
+            m_state.avgSendUs = worstSendUs;
+            m_state.clients = clients;
+
+            if (!m_enabled || !clients)
+                return false;
+            if (m_hold > 0)
+            {
+                m_hold--;
+                return false;
+            }
+
+            int previous = m_level;
+            if (worstCapacity < m_targetFps * (1 - m_lowBand))
+            {
+                m_above = 0;
+                if (++m_below >= m_downWindows && m_level < getMaxLevel())
+                    setLevel(m_level + 1);
+            }
+            else if (worstCapacity > m_targetFps * (1 + m_highBand))
+            {
+                m_below = 0;
+                if (++m_above >= m_upWindows && m_level > 0)
+                    setLevel(m_level - 1);
+            }
+            else
+            {
+                m_below = 0;
+                m_above = 0;
+            }
+            return m_level != previous;
+        }
+
+        RateControlState getState()
+        {
+            RateControlState state = m_state;
+            state.enabled = m_enabled;
+            state.level = m_level;
+            state.maxLevel = getMaxLevel();
+            state.quality = getQuality();
+            state.frameSize = getFrameSize();
+            return state;
+        }
+    };
+}
+#endif
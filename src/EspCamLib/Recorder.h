@@ -2,143 +2,803 @@
 #define ESPCAMLIB_RECORDER_H
 
 #include <Arduino.h>
+#include <atomic>
 #include "Camera.h"
+#include "FrameBroker.h"
+#include "AviWriter.h"
+#include "FramePacer.h"
+#include "WriteBuffer.h"
+#include "PreRollBuffer.h"
 #include <SPI.h>
 #include <SD.h>
 #include "FS.h"
+#include <unistd.h>
 
 namespace EspCam
 {
+    struct RecorderStats
+    {
+        uint32_t framesWritten;
+        uint32_t framesDropped;
+        size_t bufferHighWater;
+        uint32_t flushRate;
+        uint32_t segments;
+        uint32_t lastRotationUs;
+        uint32_t maxRotationUs;
+        uint32_t framesLostAtRotation;
+        size_t preRollFootprint;
+        int preRollFrames;
+        uint32_t preRollMs;
+        uint32_t triggerLatencyUs;
+        // output timing, see FramePacer
+        float captureFps;
+        uint32_t pacerDropped;
+        uint32_t framesDuplicated;
+        uint32_t jitterAvgUs;
+        uint32_t jitterMaxUs;
+    };
+
     class Recorder
     {
+    public:
+        static const int MAX_SEGMENTS = 256;
+
     private:
+        static const int TIMING_SLOTS = 64;
+
+        struct Segment
+        {
+            uint32_t index;
+            uint32_t size;
+        };
+
+        // where a frame ends in the write buffer, to time it when the card write gets past it
+        struct PendingWrite
+        {
+            uint32_t end;
+            int64_t timestamp;
+        };
+
         Camera *m_camera;
-        const char *m_filename;
+        const char *m_mountPoint = "/sd";
         int m_frameRate = 30;
         TaskHandle_t m_recordHandle;
         TaskHandle_t m_writeHandle;
-        QueueHandle_t m_fbQueue;
         volatile bool m_isRecording;
+        // the record task fills one while the write task may still be finishing the other
+        AviWriter m_avi[2];
+        int m_recordAvi = 0;
+        int m_writeAvi = 0;
+        WriteBuffer m_buffer;
+        size_t m_bufferSize = 512 * 1024;
+        size_t m_blockSize = 32 * 1024;
+        size_t m_preallocate = 0;
+        uint32_t m_maxFileSize = AviWriter::MAX_FILE_SIZE;
+        volatile uint32_t m_framesWritten = 0;
+        volatile uint32_t m_droppedFrames = 0;
+
+        bool m_loop = false;
+        char m_directory[48];
+        uint32_t m_segmentSeconds = 0;
+        size_t m_segmentBytes = 0;
+        uint64_t m_budget = 0;
+        Segment m_segments[MAX_SEGMENTS];
+        int m_segmentHead = 0;
+        int m_segmentCount = 0;
+        uint64_t m_usedBytes = 0;
+        uint32_t m_nextIndex = 0;
+        uint32_t m_lastSegmentSize = 0;
+        char m_currentPath[80];
+        char m_nextPath[80];
+        uint32_t m_currentIndex = 0;
+        uint32_t m_nextSegmentIndex = 0;
+        File m_nextFile;
+        int64_t m_segmentStart = 0;
+        uint32_t m_segmentsWritten = 0;
+        uint32_t m_lastRotationUs = 0;
+        uint32_t m_maxRotationUs = 0;
+        volatile uint32_t m_rotationDrops = 0;
+
+        // the record task paces the file, the hold pacer thins pre-roll frames to the same rate
+        FramePacer m_pacer;
+        FramePacer m_holdPacer;
+
+        PreRollBuffer m_preRoll;
+        uint32_t m_preRollSeconds = 0;
+        size_t m_preRollBytes = 0;
+        volatile bool m_armed = false;
+        int64_t m_triggerTime = 0;
+        volatile uint32_t m_triggerLatencyUs = 0;
+
+        PipelineLatency *m_latency;
+        Metrics *m_metrics;
+        PendingWrite m_pending[TIMING_SLOTS];
+        std::atomic<uint32_t> m_pendingHead;
+        std::atomic<uint32_t> m_pendingTail;
+
+        bool segmentFull(AviWriter &avi, int64_t timestamp)
+        {
+            if (m_segmentBytes && avi.getFileSize() >= m_segmentBytes)
+                return true;
+            return m_segmentSeconds && timestamp - m_segmentStart >= (int64_t)m_segmentSeconds * 1000000;
+        }
+
+        // copies one frame into the write buffer, false when there is no room for it right now. Frames the
+        // pacer drops count as handled, a frame lost to a full buffer is made up by a repeat in front of the next
+        bool muxData(const uint8_t *data, size_t len, uint16_t width, uint16_t height, int64_t timestamp, bool live)
+        {
+            AviWriter &avi = m_avi[m_recordAvi];
+            if (!avi.isStarted())
+            {
+                if (!avi.begin(&m_buffer, width, height, m_frameRate))
+                    return false;
+                m_segmentStart = timestamp;
+                m_pacer.restart();
+            }
+
+            uint32_t slots = m_pacer.slotsFor(timestamp);
+            if (slots == 0)
+            {
+                m_pacer.place(timestamp);
+                return true;
+            }
+            if (m_buffer.freeSpace() < len + 16 + (slots - 1) * 8)
+                return false;
+
+            // a file at its size limit rotates early in loop mode and ends a single recording
+            if (!avi.hasRoomFor(len, slots - 1))
+            {
+                if (!m_loop)
+                {
+                    m_isRecording = false;
+                    return true;
+                }
+                if (avi.getFrameCount() == 0 || !m_buffer.markSegment())
+                    return false;
+                m_recordAvi ^= 1;
+                return muxData(data, len, width, height, timestamp, live);
+            }
+
+            m_pacer.place(timestamp);
+            bool added = true;
+            for (uint32_t i = 1; i < slots && added; i++)
+            {
+                added = avi.addRepeat();
+            }
+            if (!added || !avi.addFrame(data, len))
+            {
+                // the index could not grow, the file is finished with the frames it has
+                m_isRecording = false;
+                return false;
+            }
+            m_framesWritten++;
+            m_metrics->addRecorderFrame();
+
+            // frames coming out of the pre-roll ring are late on purpose, only live ones are timed
+            if (live)
+            {
+                m_latency->recordSince(PipelineLatency::RECORD_QUEUED, timestamp, esp_timer_get_time());
+                uint32_t head = m_pendingHead.load(std::memory_order_relaxed);
+                if (head - m_pendingTail.load(std::memory_order_acquire) < TIMING_SLOTS)
+                {
+                    m_pending[head % TIMING_SLOTS] = {m_buffer.getWritePosition(), timestamp};
+                    m_pendingHead.store(head + 1, std::memory_order_release);
+                }
+            }
+
+            // the next frame opens the next segment, while the write task finishes this one
+            if (m_loop && segmentFull(avi, timestamp) && m_buffer.markSegment())
+            {
+                m_recordAvi ^= 1;
+            }
+            return true;
+        }
+
+        void countDrop()
+        {
+            m_droppedFrames++;
+            m_metrics->addRecorderDropped();
+            if (m_buffer.segmentPending())
+                m_rotationDrops++;
+        }
+
+        // copies the frame out so the camera buffer goes back right away. While pre-roll frames are
+        // still queued, live frames queue up behind them so the file has no gap
+        void muxFrame(FrameRef &frame)
+        {
+            camera_fb_t *fb = frame.fb();
+            if (!frame.length())
+            {
+                countDrop();
+                return;
+            }
+            if (m_preRoll.count() == 0)
+            {
+                if (!muxData(frame.data(), frame.length(), fb->width, fb->height, frame.timestamp(), true))
+                    countDrop();
+                return;
+            }
+
+            m_preRoll.push(frame.data(), frame.length(), fb->width, fb->height, frame.timestamp());
+            uint32_t evicted = m_preRoll.takeEvicted();
+            m_droppedFrames += evicted;
+            if (evicted)
+                m_metrics->addRecorderDropped(evicted);
+
+            while (m_preRoll.count() > 0)
+            {
+                const PreRollBuffer::Entry &entry = m_preRoll.front();
+                if (!muxData(m_preRoll.data(entry), entry.len, entry.width, entry.height, entry.timestamp, false))
+                    break;
+                m_preRoll.pop();
+            }
+        }
+
+        void holdFrame(FrameRef &frame)
+        {
+            if (!m_holdPacer.place(frame.timestamp()) || !frame.length())
+                return;
+            camera_fb_t *fb = frame.fb();
+            m_preRoll.push(frame.data(), frame.length(), fb->width, fb->height, frame.timestamp(), (int64_t)m_preRollSeconds * 1000000);
+            m_preRoll.takeEvicted();
+        }
 
+        // takes every frame the broker publishes, the pacers decide which ones end up in the file.
+        // While armed and not recording the task only feeds the pre-roll ring
         static void recordTask(void *param)
         {
             Recorder *self = static_cast<Recorder *>(param);
-            const TickType_t frameDelay = pdMS_TO_TICKS(1000 / self->m_frameRate);
-            TickType_t lastFrameTime = xTaskGetTickCount();
+            FrameBroker *broker = self->m_camera->getBroker();
+            uint32_t lastSeq = 0;
+            bool wasRecording = false;
 
-            while (self->m_isRecording)
+            while (self->m_isRecording || self->m_armed)
             {
-                camera_fb_t *fb = self->m_camera->getFrame();
+                FrameRef frame = broker->acquire(lastSeq, pdMS_TO_TICKS(1000));
 
-                if (!fb)
+                if (!frame)
                 {
                     vTaskDelay(1);
                     continue;
                 }
+                lastSeq = frame.sequence();
 
-                if (xQueueSend(self->m_fbQueue, &fb, 0) != pdTRUE)
+                if (self->m_isRecording)
                 {
-                    self->m_camera->releaseFrame(fb);
+                    self->m_latency->recordSince(PipelineLatency::DEQUEUE, frame.timestamp(), esp_timer_get_time());
+                    wasRecording = true;
+                    self->muxFrame(frame);
+                }
+                else
+                {
+                    if (wasRecording)
+                    {
+                        wasRecording = false;
+                        self->m_buffer.close();
+                    }
+                    self->holdFrame(frame);
                 }
-
-                vTaskDelayUntil(&lastFrameTime, frameDelay);
             }
 
+            if (wasRecording || !self->m_buffer.isClosed())
+            {
+                self->m_buffer.close();
+            }
+            self->m_recordHandle = NULL;
             vTaskDelete(NULL);
         }
 
+        // write task side, times every frame whose last byte has reached the card
+        void timeWrites()
+        {
+            uint32_t tail = m_pendingTail.load(std::memory_order_relaxed);
+            uint32_t head = m_pendingHead.load(std::memory_order_acquire);
+            int64_t now = esp_timer_get_time();
+            while (tail != head && m_buffer.isFlushed(m_pending[tail % TIMING_SLOTS].end))
+            {
+                m_latency->recordSince(PipelineLatency::RECORD_WRITTEN, m_pending[tail % TIMING_SLOTS].timestamp, now);
+                tail++;
+            }
+            m_pendingTail.store(tail, std::memory_order_release);
+        }
+
+        File openSegmentFile(const char *path)
+        {
+            File file = SD.open(path, FILE_WRITE);
+            if (file && m_preallocate)
+            {
+                // reserving the clusters up front keeps FAT updates out of the steady state writes
+                file.seek(m_preallocate - 1);
+                file.write((uint8_t)0);
+                file.seek(0);
+            }
+            return file;
+        }
+
+        void formatSegmentPath(char *out, size_t len, uint32_t index)
+        {
+            snprintf(out, len, "%s/seg%05u.avi", m_directory, (unsigned)index);
+        }
+
+        // stops tracking the oldest segment, the file stays on the card
+        void forgetOldestSegment()
+        {
+            m_usedBytes -= m_segments[m_segmentHead].size;
+            m_segmentHead = (m_segmentHead + 1) % MAX_SEGMENTS;
+            m_segmentCount--;
+        }
+
+        void deleteOldestSegment()
+        {
+            char path[80];
+            formatSegmentPath(path, sizeof(path), m_segments[m_segmentHead].index);
+            SD.remove(path);
+            forgetOldestSegment();
+        }
+
+        // only a storage budget deletes files, without one the list just keeps the newest segments
+        void makeRoomForSegment()
+        {
+            if (m_segmentCount < MAX_SEGMENTS)
+                return;
+            if (m_budget)
+                deleteOldestSegment();
+            else
+                forgetOldestSegment();
+        }
+
+        void addSegment(uint32_t index, uint32_t size)
+        {
+            makeRoomForSegment();
+
+            Segment &segment = m_segments[(m_segmentHead + m_segmentCount) % MAX_SEGMENTS];
+            segment.index = index;
+            segment.size = size;
+            m_segmentCount++;
+            m_usedBytes += size;
+        }
+
+        // frees space for the segment being written and the one prepared after it
+        void enforceBudget()
+        {
+            if (!m_budget)
+                return;
+
+            uint64_t expected = m_segmentBytes ? m_segmentBytes : (m_preallocate ? m_preallocate : m_lastSegmentSize);
+            while (m_segmentCount > 0 && m_usedBytes + 2 * expected > m_budget)
+            {
+                deleteOldestSegment();
+            }
+        }
+
+        // opens the following segment ahead of time so rotating is just a file handle swap
+        void prepareNextSegment()
+        {
+            enforceBudget();
+            m_nextSegmentIndex = m_nextIndex++;
+            formatSegmentPath(m_nextPath, sizeof(m_nextPath), m_nextSegmentIndex);
+            m_nextFile = openSegmentFile(m_nextPath);
+        }
+
+        void closeSegment(File &file, AviWriter &avi, const char *path, uint32_t index)
+        {
+            if (!avi.isStarted())
+            {
+                file.close();
+                SD.remove(path);
+                return;
+            }
+
+            avi.finish(&file);
+            avi.writeHeader(file);
+            uint32_t size = avi.getFileSize();
+            file.close();
+
+            if (m_preallocate)
+            {
+                char vfsPath[128];
+                snprintf(vfsPath, sizeof(vfsPath), "%s%s", m_mountPoint, path);
+                truncate(vfsPath, size);
+            }
+
+            m_lastSegmentSize = size;
+            m_segmentsWritten++;
+            if (m_loop)
+            {
+                addSegment(index, size);
+            }
+        }
+
         static void writeTask(void *param)
         {
             Recorder *self = static_cast<Recorder *>(param);
+            self->m_buffer.setConsumer(xTaskGetCurrentTaskHandle());
 
-            File videoFile = SD.open(self->m_filename, FILE_WRITE);
+            File videoFile = self->openSegmentFile(self->m_currentPath);
 
             if (!videoFile)
             {
                 self->m_isRecording = false;
+                self->m_buffer.abort();
+                self->m_writeHandle = NULL;
                 vTaskDelete(NULL);
                 return;
             }
 
-            camera_fb_t *fb = NULL;
+            if (self->m_loop)
+            {
+                self->prepareNextSegment();
+            }
 
-            while (self->m_isRecording || uxQueueMessagesWaiting(self->m_fbQueue) > 0)
+            while (!self->m_buffer.isDrained())
             {
-                if (xQueueReceive(self->m_fbQueue, &fb, pdMS_TO_TICKS(1000)) == pdTRUE)
+                self->m_buffer.waitForData(pdMS_TO_TICKS(100));
+                uint64_t flushed = self->m_buffer.getBytesFlushed();
+                bool ok = self->m_buffer.flushTo(videoFile);
+                self->m_metrics->addSdBytesWritten(self->m_buffer.getBytesFlushed() - flushed);
+                if (!ok)
+                {
+                    self->m_isRecording = false;
+                    self->m_buffer.abort();
+                    break;
+                }
+                self->timeWrites();
+
+                if (!self->m_triggerLatencyUs && self->m_buffer.getBytesFlushed() > 0)
                 {
-                    if (fb)
+                    self->m_triggerLatencyUs = esp_timer_get_time() - self->m_triggerTime;
+                }
+
+                if (self->m_buffer.atSegmentEnd())
+                {
+                    int64_t rotationStart = esp_timer_get_time();
+                    self->closeSegment(videoFile, self->m_avi[self->m_writeAvi], self->m_currentPath, self->m_currentIndex);
+                    self->m_writeAvi ^= 1;
+
+                    videoFile = self->m_nextFile ? self->m_nextFile : self->openSegmentFile(self->m_nextPath);
+                    self->m_nextFile = File();
+                    memcpy(self->m_currentPath, self->m_nextPath, sizeof(self->m_currentPath));
+                    self->m_currentIndex = self->m_nextSegmentIndex;
+                    self->m_buffer.nextSegment();
+
+                    uint32_t rotationUs = esp_timer_get_time() - rotationStart;
+                    self->m_lastRotationUs = rotationUs;
+                    if (rotationUs > self->m_maxRotationUs)
+                        self->m_maxRotationUs = rotationUs;
+
+                    if (!videoFile)
                     {
-                        size_t written = videoFile.write(fb->buf, fb->len);
-                        self->m_camera->releaseFrame(fb);
+                        // the record side may already have started the segment that had nowhere to go
+                        self->m_isRecording = false;
+                        self->m_buffer.abort();
+                        self->m_avi[self->m_writeAvi].reset();
+                        break;
                     }
+                    self->prepareNextSegment();
                 }
             }
 
-            videoFile.close();
+            if (videoFile)
+            {
+                self->closeSegment(videoFile, self->m_avi[self->m_writeAvi], self->m_currentPath, self->m_currentIndex);
+            }
+            if (self->m_nextFile)
+            {
+                self->m_nextFile.close();
+                SD.remove(self->m_nextPath);
+            }
+
             self->m_writeHandle = NULL;
             vTaskDelete(NULL);
         }
 
+        // picks up the segments of a previous loop recording so they count against the budget
+        void scanSegments()
+        {
+            m_segmentHead = 0;
+            m_segmentCount = 0;
+            m_usedBytes = 0;
+            m_nextIndex = 0;
+
+            File dir = SD.open(m_directory);
+            if (!dir || !dir.isDirectory())
+                return;
+
+            File entry = dir.openNextFile();
+            while (entry)
+            {
+                const char *name = strrchr(entry.name(), '/');
+                name = name ? name + 1 : entry.name();
+
+                unsigned index;
+                if (!entry.isDirectory() && sscanf(name, "seg%u.avi", &index) == 1)
+                {
+                    makeRoomForSegment();
+
+                    // keep the list sorted oldest first
+                    int pos = m_segmentCount;
+                    while (pos > 0 && m_segments[(m_segmentHead + pos - 1) % MAX_SEGMENTS].index > index)
+                    {
+                        m_segments[(m_segmentHead + pos) % MAX_SEGMENTS] = m_segments[(m_segmentHead + pos - 1) % MAX_SEGMENTS];
+                        pos--;
+                    }
+                    m_segments[(m_segmentHead + pos) % MAX_SEGMENTS] = {index, (uint32_t)entry.size()};
+                    m_segmentCount++;
+                    m_usedBytes += entry.size();
+                    if (index >= m_nextIndex)
+                        m_nextIndex = index + 1;
+                }
+                entry = dir.openNextFile();
+            }
+        }
+
+        bool startTasks()
+        {
+            m_triggerTime = esp_timer_get_time();
+            m_triggerLatencyUs = 0;
+
+            if (SD.cardType() == CARD_NONE)
+            {
+                return false;
+            }
+
+            if (!m_camera->getBroker()->begin())
+            {
+                return false;
+            }
+
+            if (!m_buffer.begin(m_bufferSize, m_blockSize))
+            {
+                return false;
+            }
+
+            // a write task that gave up may have left a segment unfinished, start both from a new header
+            m_avi[0].reset();
+            m_avi[1].reset();
+            m_avi[0].setMaxFileSize(m_maxFileSize);
+            m_avi[1].setMaxFileSize(m_maxFileSize);
+            m_recordAvi = 0;
+            m_writeAvi = 0;
+            m_framesWritten = 0;
+            m_droppedFrames = 0;
+            m_segmentsWritten = 0;
+            m_lastRotationUs = 0;
+            m_maxRotationUs = 0;
+            m_rotationDrops = 0;
+            m_pendingHead.store(0);
+            m_pendingTail.store(0);
+            m_pacer.setRate(m_frameRate);
+            m_pacer.resetStats();
+
+            // set before the write task runs, it clears the flag again when the file does not open
+            m_isRecording = true;
+            if (xTaskCreatePinnedToCore(writeTask, "WriteTask", 4096, this, 15, &m_writeHandle, 0) != pdPASS)
+            {
+                m_writeHandle = NULL;
+                m_isRecording = false;
+                return false;
+            }
+
+            // when armed the record task is already running and switches over on its next frame
+            if (m_recordHandle == NULL && xTaskCreatePinnedToCore(recordTask, "RecTask", 3072, this, 10, &m_recordHandle, 1) != pdPASS)
+            {
+                m_recordHandle = NULL;
+                m_isRecording = false;
+                m_buffer.close();
+                waitForTasks();
+                return false;
+            }
+
+            return true;
+        }
+
+        // waits for the write task, and for the record task unless it stays on for pre-roll
+        void waitForTasks()
+        {
+            unsigned long startWait = millis();
+            while ((m_writeHandle != NULL || (!m_armed && m_recordHandle != NULL)) && millis() - startWait < 6000)
+            {
+                vTaskDelay(10);
+            }
+        }
+
     public:
-        Recorder(Camera *camera, int fps = 30) : m_camera(camera), m_recordHandle(NULL), m_writeHandle(NULL), m_fbQueue(NULL), m_isRecording(false), m_frameRate(fps) {}
+        Recorder(Camera *camera, int fps = 30) : m_camera(camera), m_frameRate(fps), m_recordHandle(NULL), m_writeHandle(NULL), m_isRecording(false)
+        {
+            m_latency = camera->getBroker()->getLatency();
+            m_metrics = camera->getBroker()->getMetrics();
+            m_pendingHead.store(0);
+            m_pendingTail.store(0);
+        }
 
         ~Recorder()
         {
             stop();
+            disarm();
         }
 
+        // frame rate of the recorded file, frames are dropped or repeated against it. Call before start()
         void setTargetFPS(int fps)
         {
             m_frameRate = fps;
         }
 
-        bool start(const char *filename)
+        // size of the PSRAM write-behind buffer and of the blocks written to the card, call before start()
+        void setWriteBuffer(size_t bufferSize, size_t blockSize = 32 * 1024)
         {
-            if (m_isRecording)
-                return false;
+            m_bufferSize = bufferSize;
+            m_blockSize = blockSize;
+        }
 
-            if (SD.cardType() == CARD_NONE)
-            {
+        // grows the file to `bytes` when it is opened and trims it back on stop(), 0 disables it
+        void setPreallocation(size_t bytes)
+        {
+            m_preallocate = bytes;
+        }
+
+        // VFS mount point the SD card was mounted at, needed to trim preallocated files
+        void setMountPoint(const char *mountPoint)
+        {
+            m_mountPoint = mountPoint;
+        }
+
+        // loop recording rotates when either limit is reached, 0 disables that limit
+        void setSegmentLimits(uint32_t seconds, size_t bytes = 0)
+        {
+            m_segmentSeconds = seconds;
+            m_segmentBytes = bytes;
+        }
+
+        // no file grows past `bytes`: a loop segment rotates early, a start() recording ends there. Defaults
+        // to the 4 GiB the 32 bit AVI sizes can describe
+        void setMaxFileSize(uint32_t bytes)
+        {
+            m_maxFileSize = bytes;
+        }
+
+        // oldest loop segments are deleted to keep the directory under `bytes`, 0 means unlimited
+        void setStorageBudget(uint64_t bytes)
+        {
+            m_budget = bytes;
+        }
+
+        RecorderStats getStats()
+        {
+            RecorderStats stats;
+            stats.framesWritten = m_framesWritten;
+            stats.framesDropped = m_droppedFrames;
+            stats.bufferHighWater = m_buffer.getHighWater();
+            stats.flushRate = m_buffer.getFlushRate();
+            stats.segments = m_segmentsWritten;
+            stats.lastRotationUs = m_lastRotationUs;
+            stats.maxRotationUs = m_maxRotationUs;
+            stats.framesLostAtRotation = m_rotationDrops;
+            stats.preRollFootprint = m_preRoll.getFootprint();
+            stats.preRollFrames = m_preRoll.count();
+            stats.preRollMs = m_preRoll.duration() / 1000;
+            stats.triggerLatencyUs = m_triggerLatencyUs;
+
+            FramePacerStats pacing = m_pacer.getStats();
+            stats.captureFps = pacing.inputFps;
+            stats.pacerDropped = pacing.dropped;
+            stats.framesDuplicated = pacing.duplicated;
+            stats.jitterAvgUs = pacing.jitterAvgUs;
+            stats.jitterMaxUs = pacing.jitterMaxUs;
+            return stats;
+        }
+
+        // how much video arm() keeps before a trigger, limited by time and by PSRAM bytes
+        void setPreRoll(uint32_t seconds, size_t bytes = 1024 * 1024)
+        {
+            m_preRollSeconds = seconds;
+            m_preRollBytes = bytes;
+        }
+
+        // starts buffering frames in PSRAM so a later start() includes the seconds before it
+        bool arm()
+        {
+            if (m_armed)
+                return true;
+
+            if (!m_preRollSeconds || !m_preRollBytes)
                 return false;
-            }
 
-            m_filename = filename;
-            m_isRecording = true;
+            if (!m_camera->getBroker()->begin())
+                return false;
 
-            m_fbQueue = xQueueCreate(2, sizeof(camera_fb_t *));
+            m_holdPacer.setRate(m_frameRate);
+            m_holdPacer.restart();
+            int maxFrames = m_preRollSeconds * m_frameRate + 2;
+            if (!m_preRoll.begin(m_preRollBytes, maxFrames))
+                return false;
 
-            xTaskCreatePinnedToCore(recordTask, "RecTask", 3072, this, 10, &m_recordHandle, 1);
-            xTaskCreatePinnedToCore(writeTask, "WriteTask", 4096, this, 15, &m_writeHandle, 0);
+            // allocating the write buffer now keeps it off the trigger path
+            if (!m_buffer.begin(m_bufferSize, m_blockSize))
+                return false;
+            m_buffer.close();
 
+            m_armed = true;
+            if (m_recordHandle == NULL && xTaskCreatePinnedToCore(recordTask, "RecTask", 3072, this, 10, &m_recordHandle, 1) != pdPASS)
+            {
+                m_recordHandle = NULL;
+                m_armed = false;
+                m_preRoll.end();
+                return false;
+            }
             return true;
         }
 
-        void stop()
+        // stops pre-roll buffering, an ongoing recording keeps going until stop()
+        void disarm()
         {
-            if (!m_isRecording)
+            m_armed = false;
+            if (m_isRecording)
                 return;
 
-            m_isRecording = false;
-
             unsigned long startWait = millis();
-            while (m_writeHandle != NULL && millis() - startWait < 6000)
+            while (m_recordHandle != NULL && millis() - startWait < 2000)
             {
                 vTaskDelay(10);
             }
+            m_preRoll.end();
+        }
+
+        bool isArmed()
+        {
+            return m_armed;
+        }
+
+        // false again once a recording reached its size limit or could not go on
+        bool isRecording()
+        {
+            return m_isRecording;
+        }
+
+        bool start(const char *filename)
+        {
+            if (m_isRecording || m_writeHandle != NULL)
+                return false;
+
+            m_loop = false;
+            snprintf(m_currentPath, sizeof(m_currentPath), "%s", filename);
+            return startTasks();
+        }
+
+        // records continuously into `directory`/segNNNNN.avi, rotating at the segment limits
+        bool startLoop(const char *directory)
+        {
+            if (m_isRecording || m_writeHandle != NULL)
+                return false;
+
+            if (!m_segmentSeconds && !m_segmentBytes)
+                return false;
+
+            if (SD.cardType() == CARD_NONE)
+                return false;
 
-            if (m_fbQueue)
+            snprintf(m_directory, sizeof(m_directory), "%s", directory);
+            if (!SD.exists(m_directory))
             {
-                camera_fb_t *fb = NULL;
-                while (xQueueReceive(m_fbQueue, &fb, 0) == pdTRUE)
-                {
-                    if (fb)
-                        m_camera->releaseFrame(fb);
-                }
-                vQueueDelete(m_fbQueue);
-                m_fbQueue = NULL;
+                SD.mkdir(m_directory);
             }
 
-            m_recordHandle = NULL;
+            m_loop = true;
+            scanSegments();
+            enforceBudget();
+            m_currentIndex = m_nextIndex++;
+            formatSegmentPath(m_currentPath, sizeof(m_currentPath), m_currentIndex);
+            return startTasks();
+        }
+
+        void stop()
+        {
+            if (!m_isRecording && m_writeHandle == NULL)
+                return;
+
+            m_isRecording = false;
+
+            // an armed recorder goes back to filling the pre-roll ring
+            waitForTasks();
         }
     };
 };
@@ -0,0 +1,253 @@
+#ifndef ESPCAMLIB_RTPJPEG_H
+#define ESPCAMLIB_RTPJPEG_H
+#include <Arduino.h>
+
+// RTP/JPEG (RFC 2435) packetizer. The JPEG headers are parsed once per frame and every packet is a small
+// header built here plus a slice of the entropy coded data that still points into the frame buffer,
+// so the payload is never copied. Quantization tables go in-band (Q=255) with the first packet
+namespace EspCam
+{
+    class RtpJpegPacketizer
+    {
+    public:
+        static const uint8_t PAYLOAD_TYPE = 26;
+        static const size_t RTP_HEADER_LEN = 12;
+        // rtp, main jpeg header, restart marker header, quantization table header with two tables
+        static const size_t HEADER_MAX = RTP_HEADER_LEN + 8 + 4 + 4 + 128;
+        static const size_t DEFAULT_MAX_PAYLOAD = 1400;
+
+        struct Packet
+        {
+            uint8_t header[HEADER_MAX];
+            size_t headerLen;
+            const uint8_t *payload;
+            size_t payloadLen;
+            bool last;
+        };
+
+    private:
+        const uint8_t *m_qt[2] = {nullptr, nullptr};
+        int m_qtCount = 0;
+        const uint8_t *m_scan = nullptr;
+        size_t m_scanLen = 0;
+        uint8_t m_type = 0;
+        uint8_t m_width8 = 0;
+        uint8_t m_height8 = 0;
+        uint16_t m_restartInterval = 0;
+        uint32_t m_timestamp = 0;
+        size_t m_offset = 0;
+        size_t m_maxPayload = DEFAULT_MAX_PAYLOAD;
+
+        static uint16_t be16(const uint8_t *p)
+        {
+            return (p[0] << 8) | p[1];
+        }
+
+        static void put16(uint8_t *p, uint16_t v)
+        {
+            p[0] = v >> 8;
+            p[1] = v;
+        }
+
+        static void put32(uint8_t *p, uint32_t v)
+        {
+            p[0] = v >> 24;
+            p[1] = v >> 16;
+            p[2] = v >> 8;
+            p[3] = v;
+        }
+
+    public:
+        // payload bytes per packet, the headers come on top of this
+        void setMaxPayload(size_t bytes)
+        {
+            m_maxPayload = bytes < 256 ? 256 : bytes;
+        }
+
+        // reads the headers of a baseline YCbCr JPEG, only 4:2:2 and 4:2:0 have an RFC 2435 type.
+        // `timestamp` is the 90kHz RTP clock of this frame
+        bool begin(const uint8_t *jpeg, size_t len, uint32_t timestamp)
+        {
+            m_scan = nullptr;
+            m_qtCount = 0;
+            m_restartInterval = 0;
+            m_offset = 0;
+            m_timestamp = timestamp;
+            if (len < 4 || jpeg[0] != 0xFF || jpeg[1] != 0xD8)
+                return false;
+
+            const uint8_t *tables[4] = {nullptr, nullptr, nullptr, nullptr};
+            uint8_t tq[3] = {0, 0, 0};
+            bool frame = false;
+            size_t pos = 2;
+            while (pos + 4 <= len)
+            {
+                if (jpeg[pos] != 0xFF)
+                    return false;
+                uint8_t marker = jpeg[pos + 1];
+                if (marker == 0xFF)
+                {
+                    pos++;
+                    continue;
+                }
+                size_t segLen = be16(jpeg + pos + 2);
+                const uint8_t *seg = jpeg + pos + 4;
+                if (segLen < 2 || pos + 2 + segLen > len)
+                    return false;
+                size_t bodyLen = segLen - 2;
+
+                switch (marker)
+                {
+                case 0xDB:
+                    for (size_t i = 0; i + 65 <= bodyLen; i += 65)
+                    {
+                        // 16 bit tables cannot be sent in-band with Q=255
+                        if (seg[i] >> 4)
+                            return false;
+                        tables[seg[i] & 3] = seg + i + 1;
+                    }
+                    break;
+                case 0xC0:
+                {
+                    if (bodyLen < 6 + 3 * 3 || seg[5] != 3)
+                        return false;
+                    uint16_t height = be16(seg + 1);
+                    uint16_t width = be16(seg + 3);
+                    if (width > 2040 || height > 2040)
+                        return false;
+                    m_width8 = (width + 7) / 8;
+                    m_height8 = (height + 7) / 8;
+
+                    uint8_t luma = seg[7];
+                    if (seg[10] != 0x11 || seg[13] != 0x11)
+                        return false;
+                    if (luma == 0x21)
+                        m_type = 0;
+                    else if (luma == 0x22)
+                        m_type = 1;
+                    else
+                        return false;
+                    for (int c = 0; c < 3; c++)
+                    {
+                        tq[c] = seg[8 + c * 3] & 3;
+                    }
+                    frame = true;
+                    break;
+                }
+                case 0xC1:
+                case 0xC2:
+                case 0xC3:
+                    return false;
+                case 0xDD:
+                    if (bodyLen < 2)
+                        return false;
+                    m_restartInterval = be16(seg);
+                    break;
+                case 0xDA:
+                {
+                    if (!frame || tq[1] != tq[2] || !tables[tq[0]] || !tables[tq[1]])
+                        return false;
+                    m_qt[0] = tables[tq[0]];
+                    m_qt[1] = tables[tq[1]];
+                    m_qtCount = 2;
+
+                    // entropy coded data up to, not including, the EOI marker
+                    m_scan = jpeg + pos + 2 + segLen;
+                    const uint8_t *end = jpeg + len;
+                    while (end - m_scan >= 2 && !(end[-2] == 0xFF && end[-1] == 0xD9))
+                    {
+                        end--;
+                    }
+                    m_scanLen = end - m_scan >= 2 ? end - m_scan - 2 : end - m_scan;
+                    if (m_restartInterval)
+                        m_type += 64;
+                    return m_scanLen > 0;
+                }
+                default:
+                    break;
+                }
+                pos += 2 + segLen;
+            }
+            return false;
+        }
+
+        bool done()
+        {
+            return !m_scan || m_offset >= m_scanLen;
+        }
+
+        size_t getScanLength()
+        {
+            return m_scanLen;
+        }
+
+        // builds the next packet, `sequence` and `ssrc` can be patched per receiver with setSequence()
+        bool next(Packet &packet, uint16_t sequence, uint32_t ssrc)
+        {
+            if (done())
+                return false;
+
+            size_t chunk = m_scanLen - m_offset;
+            if (chunk > m_maxPayload)
+                chunk = m_maxPayload;
+            bool last = m_offset + chunk >= m_scanLen;
+
+            uint8_t *p = packet.header;
+            p[0] = 0x80;
+            p[1] = PAYLOAD_TYPE | (last ? 0x80 : 0);
+            put16(p + 2, sequence);
+            put32(p + 4, m_timestamp);
+            put32(p + 8, ssrc);
+            size_t pos = RTP_HEADER_LEN;
+
+            p[pos++] = 0;
+            p[pos++] = m_offset >> 16;
+            p[pos++] = m_offset >> 8;
+            p[pos++] = m_offset;
+            p[pos++] = m_type;
+            p[pos++] = 255;
+            p[pos++] = m_width8;
+            p[pos++] = m_height8;
+
+            if (m_restartInterval)
+            {
+                put16(p + pos, m_restartInterval);
+                // first and last bits set with a count of 0x3FFF, the packet is not split on restart boundaries
+                put16(p + pos + 2, 0xFFFF);
+                pos += 4;
+            }
+
+            if (m_offset == 0)
+            {
+                p[pos++] = 0;
+                p[pos++] = 0;
+                put16(p + pos, 64 * m_qtCount);
+                pos += 2;
+                for (int i = 0; i < m_qtCount; i++)
+                {
+                    memcpy(p + pos, m_qt[i], 64);
+                    pos += 64;
+                }
+            }
+
+            packet.headerLen = pos;
+            packet.payload = m_scan + m_offset;
+            packet.payloadLen = chunk;
+            packet.last = last;
+            m_offset += chunk;
+            return true;
+        }
+
+        static void setSequence(Packet &packet, uint16_t sequence)
+        {
+            put16(packet.header + 2, sequence);
+        }
+
+        // 90kHz RTP clock from an esp_timer timestamp
+        static uint32_t rtpTime(int64_t us)
+        {
+            return (uint32_t)(us * 9 / 100);
+        }
+    };
+}
+#endif
@@ -0,0 +1,795 @@
+#ifndef ESPCAMLIB_RTSPSERVER_H
+#define ESPCAMLIB_RTSPSERVER_H
+#include <Arduino.h>
+#include "esp_camera.h"
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+
+#include "Camera.h"
+#include "FrameBroker.h"
+#include "Latency.h"
+#include "RtpJpeg.h"
+
+// RTSP server for NVRs and players, serves the brokered frames as RTP/JPEG over UDP or interleaved in the
+// RTSP connection. One task answers RTSP requests, another packetizes each frame once and fans the packets
+// out to every playing session, so the frame is shared by all of them and never copied
+namespace EspCam
+{
+    struct RtspStats
+    {
+        int sessions;
+        int playing;
+        uint32_t framesSent;
+        uint32_t packetsSent;
+        uint32_t packetsDropped;
+        uint32_t badFrames;
+        float packetsPerSec;
+        // per frame time spent parsing the jpeg and building packet headers, without the socket writes
+        LatencySummary packetize;
+    };
+
+    class RtspServer
+    {
+    public:
+        static const int MAX_SESSIONS = 4;
+        static const size_t RX_MAX = 1024;
+        static const uint32_t SESSION_TIMEOUT_S = 60;
+        static const uint32_t SEND_TIMEOUT_MS = 2000;
+
+    private:
+        struct Session
+        {
+            int fd = -1;
+            bool ready = false;
+            bool playing = false;
+            bool failed = false;
+            bool tcp = false;
+            uint8_t channel = 0;
+            struct sockaddr_in peer;
+            uint32_t id = 0;
+            uint16_t sequence = 0;
+            int64_t lastActivity = 0;
+            char rx[RX_MAX + 1];
+            size_t rxLen = 0;
+        };
+
+        Camera *m_camera;
+        int m_port;
+        uint16_t m_rtpPort = 6970;
+        int m_listenFd = -1;
+        int m_udpFd = -1;
+        uint32_t m_ssrc = 0;
+        Session m_sessions[MAX_SESSIONS];
+        volatile int m_playing = 0;
+        SemaphoreHandle_t m_lock = NULL;
+        // one per session slot, held while writing to its socket so RTSP replies and interleaved packets
+        // do not mix and the socket is not closed under a write. Taken before m_lock when both are needed
+        SemaphoreHandle_t m_writeLocks[MAX_SESSIONS] = {};
+        TaskHandle_t m_controlHandle = NULL;
+        TaskHandle_t m_streamHandle = NULL;
+        volatile bool m_running = false;
+
+        RtpJpegPacketizer m_packetizer;
+        RtpJpegPacketizer::Packet m_packet;
+        LatencyHistogram m_packetizeUs;
+        uint32_t m_framesSent = 0;
+        uint32_t m_packetsSent = 0;
+        uint32_t m_packetsDropped = 0;
+        uint32_t m_badFrames = 0;
+        uint32_t m_windowPackets = 0;
+        int64_t m_windowStart = 0;
+        float m_packetsPerSec = 0;
+
+        // blocking gathered write that survives partial writes. The socket send timeout applies per call and a
+        // peer that takes a few bytes at a time would restart it, so the whole write gets the timeout once
+        static bool writeAll(int fd, struct iovec *iov, int count)
+        {
+            int64_t deadline = esp_timer_get_time() + SEND_TIMEOUT_MS * 1000LL;
+            while (count > 0)
+            {
+                ssize_t res = lwip_writev(fd, iov, count);
+                if (res < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    return false;
+                }
+                while (count > 0 && (size_t)res >= iov->iov_len)
+                {
+                    res -= iov->iov_len;
+                    iov++;
+                    count--;
+                }
+                if (count > 0)
+                {
+                    if (esp_timer_get_time() > deadline)
+                        return false;
+                    iov->iov_base = (uint8_t *)iov->iov_base + res;
+                    iov->iov_len -= res;
+                }
+            }
+            return true;
+        }
+
+        // where a frame goes, copied from a playing session when the frame starts so the packets go out
+        // without holding m_lock
+        struct Target
+        {
+            int index;
+            uint32_t id;
+            int fd;
+            bool tcp;
+            uint8_t channel;
+            struct sockaddr_in peer;
+            uint16_t sequence;
+            bool failed;
+        };
+
+        bool sendPacket(Target &target)
+        {
+            if (target.tcp)
+            {
+                size_t len = m_packet.headerLen + m_packet.payloadLen;
+                uint8_t prefix[4] = {'$', target.channel, (uint8_t)(len >> 8), (uint8_t)len};
+                struct iovec iov[3] = {
+                    {prefix, 4},
+                    {m_packet.header, m_packet.headerLen},
+                    {(void *)m_packet.payload, m_packet.payloadLen}};
+                return writeAll(target.fd, iov, 3);
+            }
+
+            struct iovec iov[2] = {
+                {m_packet.header, m_packet.headerLen},
+                {(void *)m_packet.payload, m_packet.payloadLen}};
+            struct msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_name = &target.peer;
+            msg.msg_namelen = sizeof(target.peer);
+            msg.msg_iov = iov;
+            msg.msg_iovlen = 2;
+
+            // a frame is a burst of packets, give lwip one tick to free buffers before giving up on one
+            for (int attempt = 0; attempt < 2; attempt++)
+            {
+                if (lwip_sendmsg(m_udpFd, &msg, 0) >= 0)
+                    return true;
+                if (errno != ENOMEM && errno != EAGAIN)
+                    break;
+                vTaskDelay(1);
+            }
+            m_packetsDropped++;
+            return true;
+        }
+
+        // writes one interleaved packet unless the slot was closed or reused since the snapshot
+        bool sendInterleaved(Target &target)
+        {
+            xSemaphoreTake(m_writeLocks[target.index], portMAX_DELAY);
+            const Session &current = m_sessions[target.index];
+            bool ok = current.fd == target.fd && current.id == target.id && sendPacket(target);
+            xSemaphoreGive(m_writeLocks[target.index]);
+            return ok;
+        }
+
+        void sendFrame(FrameRef &frame)
+        {
+            // a raw frame is encoded here, outside the packetize timing
+            const uint8_t *jpeg = frame.data();
+            size_t len = frame.length();
+            int64_t start = esp_timer_get_time();
+            if (!m_packetizer.begin(jpeg, len, RtpJpegPacketizer::rtpTime(frame.timestamp())))
+            {
+                m_badFrames++;
+                return;
+            }
+            int64_t packetizeUs = esp_timer_get_time() - start;
+
+            Target targets[MAX_SESSIONS];
+            int count = 0;
+            xSemaphoreTake(m_lock, portMAX_DELAY);
+            for (int i = 0; i < MAX_SESSIONS; i++)
+            {
+                Session &session = m_sessions[i];
+                if (session.playing && !session.failed)
+                {
+                    targets[count++] = {i, session.id, session.fd, session.tcp, session.channel, session.peer, session.sequence, false};
+                }
+            }
+            xSemaphoreGive(m_lock);
+
+            uint32_t sent = 0;
+            while (true)
+            {
+                int64_t t = esp_timer_get_time();
+                if (!m_packetizer.next(m_packet, 0, m_ssrc))
+                    break;
+                packetizeUs += esp_timer_get_time() - t;
+
+                for (int i = 0; i < count; i++)
+                {
+                    Target &target = targets[i];
+                    if (target.failed)
+                        continue;
+
+                    RtpJpegPacketizer::setSequence(m_packet, target.sequence++);
+                    if (target.tcp ? !sendInterleaved(target) : !sendPacket(target))
+                    {
+                        target.failed = true;
+                        continue;
+                    }
+                    sent++;
+                }
+            }
+
+            Metrics *metrics = m_camera->getBroker()->getMetrics();
+            xSemaphoreTake(m_lock, portMAX_DELAY);
+            m_packetsSent += sent;
+            m_windowPackets += sent;
+            for (int i = 0; i < count; i++)
+            {
+                Session &session = m_sessions[targets[i].index];
+                // the slot may have been closed or reused while the frame went out
+                if (session.fd != targets[i].fd || session.id != targets[i].id)
+                    continue;
+                session.sequence = targets[i].sequence;
+                if (targets[i].failed)
+                {
+                    // the control task sees the shut down socket and closes the session
+                    session.failed = true;
+                    shutdown(session.fd, SHUT_RDWR);
+                    continue;
+                }
+                m_framesSent++;
+                metrics->addFrameSent();
+                metrics->addBytesSent(frame.length());
+            }
+            xSemaphoreGive(m_lock);
+
+            m_packetizeUs.record((uint32_t)packetizeUs);
+            m_camera->getBroker()->getLatency()->recordSince(PipelineLatency::LAST_BYTE, frame.timestamp(), esp_timer_get_time());
+        }
+
+        static void streamTask(void *param)
+        {
+            RtspServer *self = static_cast<RtspServer *>(param);
+            FrameBroker *broker = self->m_camera->getBroker();
+            uint32_t lastSeq = 0;
+
+            while (self->m_running)
+            {
+                if (self->m_playing == 0)
+                {
+                    self->m_packetsPerSec = 0;
+                    self->m_windowPackets = 0;
+                    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+                    self->m_windowStart = esp_timer_get_time();
+                    continue;
+                }
+
+                FrameRef frame = broker->acquire(lastSeq, pdMS_TO_TICKS(100));
+                if (frame)
+                {
+                    lastSeq = frame.sequence();
+                    broker->getLatency()->recordSince(PipelineLatency::DEQUEUE, frame.timestamp(), esp_timer_get_time());
+                    self->sendFrame(frame);
+                }
+
+                int64_t now = esp_timer_get_time();
+                int64_t elapsed = now - self->m_windowStart;
+                if (elapsed >= 1000000)
+                {
+                    self->m_packetsPerSec = self->m_windowPackets * 1000000.0f / elapsed;
+                    self->m_windowPackets = 0;
+                    self->m_windowStart = now;
+                }
+            }
+
+            self->m_streamHandle = NULL;
+            vTaskDelete(NULL);
+        }
+
+        // value of header `name` in the request, trimmed and copied into `out`
+        static bool getHeader(const char *request, const char *name, char *out, size_t max)
+        {
+            size_t nameLen = strlen(name);
+            const char *line = strstr(request, "\r\n");
+            while (line && line[2] != '\r')
+            {
+                line += 2;
+                if (strncasecmp(line, name, nameLen) == 0 && line[nameLen] == ':')
+                {
+                    const char *value = line + nameLen + 1;
+                    while (*value == ' ')
+                        value++;
+                    size_t len = strcspn(value, "\r\n");
+                    if (len >= max)
+                        len = max - 1;
+                    memcpy(out, value, len);
+                    out[len] = '\0';
+                    return true;
+                }
+                line = strstr(line, "\r\n");
+            }
+            return false;
+        }
+
+        bool respond(Session &session, const char *status, const char *cseq, const char *headers, const char *body = "")
+        {
+            char buf[640];
+            size_t bodyLen = strlen(body);
+            int len = snprintf(buf, sizeof(buf), "RTSP/1.0 %s\r\nCSeq: %s\r\n%s", status, cseq, headers);
+            if (bodyLen)
+                len += snprintf(buf + len, sizeof(buf) - len, "Content-Length: %u\r\n", (unsigned)bodyLen);
+            len += snprintf(buf + len, sizeof(buf) - len, "\r\n%s", body);
+            if (len >= (int)sizeof(buf))
+                return false;
+
+            struct iovec iov = {buf, (size_t)len};
+            // interleaved sessions share the socket with the stream task
+            SemaphoreHandle_t writeLock = m_writeLocks[&session - m_sessions];
+            xSemaphoreTake(writeLock, portMAX_DELAY);
+            bool ok = writeAll(session.fd, &iov, 1);
+            xSemaphoreGive(writeLock);
+            return ok;
+        }
+
+        bool setup(Session &session, const char *cseq, const char *transport)
+        {
+            char headers[192];
+            const char *interleaved = strstr(transport, "interleaved=");
+            if (strstr(transport, "RTP/AVP/TCP"))
+            {
+                session.tcp = true;
+                session.channel = interleaved ? atoi(interleaved + 12) : 0;
+                snprintf(headers, sizeof(headers), "Transport: RTP/AVP/TCP;unicast;interleaved=%u-%u\r\nSession: %08X;timeout=%u\r\n",
+                         session.channel, session.channel + 1, (unsigned)session.id, (unsigned)SESSION_TIMEOUT_S);
+            }
+            else
+            {
+                const char *clientPort = strstr(transport, "client_port=");
+                socklen_t peerLen = sizeof(session.peer);
+                if (!clientPort || getpeername(session.fd, (struct sockaddr *)&session.peer, &peerLen) != 0)
+                    return respond(session, "461 Unsupported Transport", cseq, "");
+
+                int port = atoi(clientPort + 12);
+                session.tcp = false;
+                session.peer.sin_port = htons(port);
+                snprintf(headers, sizeof(headers), "Transport: RTP/AVP;unicast;client_port=%d-%d;server_port=%u-%u;ssrc=%08X\r\nSession: %08X;timeout=%u\r\n",
+                         port, port + 1, m_rtpPort, m_rtpPort + 1, (unsigned)m_ssrc, (unsigned)session.id, (unsigned)SESSION_TIMEOUT_S);
+            }
+            session.ready = true;
+            return respond(session, "200 OK", cseq, headers);
+        }
+
+        bool describe(Session &session, const char *cseq, const char *url)
+        {
+            struct sockaddr_in local;
+            socklen_t localLen = sizeof(local);
+            getsockname(session.fd, (struct sockaddr *)&local, &localLen);
+            char ip[16];
+            inet_ntoa_r(local.sin_addr, ip, sizeof(ip));
+
+            char sdp[192];
+            snprintf(sdp, sizeof(sdp),
+                     "v=0\r\n"
+                     "o=- %u 1 IN IP4 %s\r\n"
+                     "s=EspCam\r\n"
+                     "c=IN IP4 0.0.0.0\r\n"
+                     "t=0 0\r\n"
+                     "m=video 0 RTP/AVP %u\r\n"
+                     "a=control:track1\r\n",
+                     (unsigned)m_ssrc, ip, RtpJpegPacketizer::PAYLOAD_TYPE);
+
+            char headers[256];
+            const char *slash = url[strlen(url) - 1] == '/' ? "" : "/";
+            snprintf(headers, sizeof(headers), "Content-Base: %s%s\r\nContent-Type: application/sdp\r\n", url, slash);
+            return respond(session, "200 OK", cseq, headers, sdp);
+        }
+
+        void setPlaying(Session &session, bool playing)
+        {
+            if (session.playing == playing)
+                return;
+
+            xSemaphoreTake(m_lock, portMAX_DELAY);
+            session.playing = playing;
+            m_playing += playing ? 1 : -1;
+            xSemaphoreGive(m_lock);
+
+            Metrics *metrics = m_camera->getBroker()->getMetrics();
+            if (playing)
+            {
+                metrics->streamClientOpened();
+                xTaskNotifyGive(m_streamHandle);
+            }
+            else
+            {
+                metrics->streamClientClosed();
+            }
+        }
+
+        // returns false when the connection should be closed
+        bool handleRequest(Session &session, char *request)
+        {
+            char method[16];
+            char url[128];
+            char cseq[12];
+            if (sscanf(request, "%15s %127s", method, url) != 2)
+                return false;
+            if (!getHeader(request, "CSeq", cseq, sizeof(cseq)))
+                strcpy(cseq, "0");
+
+            char sessionHeader[40];
+            snprintf(sessionHeader, sizeof(sessionHeader), "Session: %08X\r\n", (unsigned)session.id);
+
+            if (strcmp(method, "OPTIONS") == 0)
+                return respond(session, "200 OK", cseq, "Public: OPTIONS, DESCRIBE, SETUP, PLAY, PAUSE, TEARDOWN, GET_PARAMETER\r\n");
+
+            if (strcmp(method, "DESCRIBE") == 0)
+                return describe(session, cseq, url);
+
+            if (strcmp(method, "SETUP") == 0)
+            {
+                char transport[128];
+                if (session.playing || !getHeader(request, "Transport", transport, sizeof(transport)))
+                    return respond(session, "455 Method Not Valid in This State", cseq, "");
+                return setup(session, cseq, transport);
+            }
+
+            if (strcmp(method, "PLAY") == 0)
+            {
+                if (!session.ready)
+                    return respond(session, "455 Method Not Valid in This State", cseq, "");
+                bool ok = respond(session, "200 OK", cseq, sessionHeader);
+                setPlaying(session, true);
+                return ok;
+            }
+
+            if (strcmp(method, "PAUSE") == 0)
+            {
+                setPlaying(session, false);
+                return respond(session, "200 OK", cseq, sessionHeader);
+            }
+
+            if (strcmp(method, "TEARDOWN") == 0)
+            {
+                setPlaying(session, false);
+                respond(session, "200 OK", cseq, sessionHeader);
+                return false;
+            }
+
+            // keepalives
+            if (strcmp(method, "GET_PARAMETER") == 0 || strcmp(method, "SET_PARAMETER") == 0)
+                return respond(session, "200 OK", cseq, sessionHeader);
+
+            return respond(session, "501 Not Implemented", cseq, "");
+        }
+
+        // consumes complete requests and interleaved RTCP packets from the receive buffer
+        bool processInput(Session &session)
+        {
+            while (session.rxLen > 0)
+            {
+                size_t used;
+                if (session.rx[0] == '$')
+                {
+                    if (session.rxLen < 4)
+                        return true;
+                    used = 4 + ((uint8_t)session.rx[2] << 8 | (uint8_t)session.rx[3]);
+                    if (used > RX_MAX)
+                        return false;
+                    if (session.rxLen < used)
+                        return true;
+                }
+                else
+                {
+                    session.rx[session.rxLen] = '\0';
+                    char *end = strstr(session.rx, "\r\n\r\n");
+                    if (!end)
+                        return session.rxLen < RX_MAX;
+
+                    char length[12];
+                    end[2] = '\0';
+                    used = end + 4 - session.rx + (getHeader(session.rx, "Content-Length", length, sizeof(length)) ? atoi(length) : 0);
+                    end[2] = '\r';
+                    if (used > RX_MAX)
+                        return false;
+                    if (session.rxLen < used)
+                        return true;
+
+                    end[2] = '\0';
+                    if (!handleRequest(session, session.rx))
+                        return false;
+                }
+
+                memmove(session.rx, session.rx + used, session.rxLen - used);
+                session.rxLen -= used;
+            }
+            return true;
+        }
+
+        void closeSession(Session &session)
+        {
+            setPlaying(session, false);
+            // waits out a packet the stream task is writing to this socket
+            SemaphoreHandle_t writeLock = m_writeLocks[&session - m_sessions];
+            xSemaphoreTake(writeLock, portMAX_DELAY);
+            xSemaphoreTake(m_lock, portMAX_DELAY);
+            close(session.fd);
+            session.fd = -1;
+            xSemaphoreGive(m_lock);
+            xSemaphoreGive(writeLock);
+        }
+
+        void acceptSession()
+        {
+            int fd = lwip_accept(m_listenFd, NULL, NULL);
+            if (fd < 0)
+                return;
+
+            for (int i = 0; i < MAX_SESSIONS; i++)
+            {
+                Session &session = m_sessions[i];
+                if (session.fd < 0)
+                {
+                    struct timeval timeout = {SEND_TIMEOUT_MS / 1000, (SEND_TIMEOUT_MS % 1000) * 1000};
+                    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+                    int one = 1;
+                    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+                    xSemaphoreTake(m_writeLocks[i], portMAX_DELAY);
+                    xSemaphoreTake(m_lock, portMAX_DELAY);
+                    session = Session();
+                    session.fd = fd;
+                    session.id = esp_random();
+                    session.sequence = esp_random();
+                    session.lastActivity = esp_timer_get_time();
+                    xSemaphoreGive(m_lock);
+                    xSemaphoreGive(m_writeLocks[i]);
+                    return;
+                }
+            }
+            close(fd);
+        }
+
+        static void controlTask(void *param)
+        {
+            RtspServer *self = static_cast<RtspServer *>(param);
+
+            while (self->m_running)
+            {
+                fd_set readable;
+                FD_ZERO(&readable);
+                FD_SET(self->m_listenFd, &readable);
+                int maxFd = self->m_listenFd;
+                for (int i = 0; i < MAX_SESSIONS; i++)
+                {
+                    int fd = self->m_sessions[i].fd;
+                    if (fd >= 0)
+                    {
+                        FD_SET(fd, &readable);
+                        if (fd > maxFd)
+                            maxFd = fd;
+                    }
+                }
+
+                struct timeval tv = {0, 100000};
+                int ready = select(maxFd + 1, &readable, NULL, NULL, &tv);
+                if (!self->m_running)
+                    break;
+
+                int64_t now = esp_timer_get_time();
+                for (int i = 0; i < MAX_SESSIONS; i++)
+                {
+                    Session &session = self->m_sessions[i];
+                    if (session.fd < 0)
+                        continue;
+
+                    bool keep = !session.failed;
+                    if (keep && ready > 0 && FD_ISSET(session.fd, &readable))
+                    {
+                        ssize_t res = recv(session.fd, session.rx + session.rxLen, RX_MAX - session.rxLen, MSG_DONTWAIT);
+                        if (res > 0)
+                        {
+                            session.rxLen += res;
+                            session.lastActivity = now;
+                            keep = self->processInput(session);
+                        }
+                        else if (res == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+                        {
+                            keep = false;
+                        }
+                    }
+                    // UDP viewers only show they are alive through RTSP keepalives
+                    if (keep && !session.tcp && now - session.lastActivity > SESSION_TIMEOUT_S * 1000000LL)
+                        keep = false;
+                    if (!keep)
+                        self->closeSession(session);
+                }
+
+                if (ready > 0 && FD_ISSET(self->m_listenFd, &readable))
+                    self->acceptSession();
+            }
+
+            self->m_controlHandle = NULL;
+            vTaskDelete(NULL);
+        }
+
+        bool openSockets()
+        {
+            m_listenFd = socket(AF_INET, SOCK_STREAM, 0);
+            m_udpFd = socket(AF_INET, SOCK_DGRAM, 0);
+            if (m_listenFd < 0 || m_udpFd < 0)
+                return false;
+
+            int one = 1;
+            setsockopt(m_listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+            struct sockaddr_in addr;
+            memset(&addr, 0, sizeof(addr));
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_ANY);
+            addr.sin_port = htons(m_port);
+            if (bind(m_listenFd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(m_listenFd, 2) != 0)
+                return false;
+
+            addr.sin_port = htons(m_rtpPort);
+            return bind(m_udpFd, (struct sockaddr *)&addr, sizeof(addr)) == 0;
+        }
+
+        void closeSockets()
+        {
+            if (m_listenFd >= 0)
+            {
+                close(m_listenFd);
+                m_listenFd = -1;
+            }
+            if (m_udpFd >= 0)
+            {
+                close(m_udpFd);
+                m_udpFd = -1;
+            }
+        }
+
+    public:
+        RtspServer(Camera *camera, int port = 554) : m_camera(camera), m_port(port) {}
+
+        ~RtspServer()
+        {
+            stop();
+            if (m_lock)
+            {
+                vSemaphoreDelete(m_lock);
+            }
+            for (int i = 0; i < MAX_SESSIONS; i++)
+            {
+                if (m_writeLocks[i])
+                    vSemaphoreDelete(m_writeLocks[i]);
+            }
+        }
+
+        // local port the RTP packets leave from, the next one is announced for RTCP. Call before begin()
+        void setRtpPort(uint16_t port)
+        {
+            m_rtpPort = port;
+        }
+
+        // RTP payload bytes per packet, keep it under the path MTU
+        void setMaxPayload(size_t bytes)
+        {
+            m_packetizer.setMaxPayload(bytes);
+        }
+
+        bool begin(int port = 554)
+        {
+            if (m_running)
+                return true;
+
+            m_port = port;
+            pixformat_t format = m_camera->getPixelFormat();
+            if (format != PIXFORMAT_JPEG && !JpegEncoder::supports(format))
+            {
+                Serial.println("RtspServer ERROR: Camera pixel format can not be encoded to JPEG.");
+                return false;
+            }
+            // RFC 2435 only carries 3 component JPEG, a grayscale frame encodes to one component
+            if (format == PIXFORMAT_GRAYSCALE)
+            {
+                Serial.println("RtspServer ERROR: RTP/JPEG can not carry grayscale frames.");
+                return false;
+            }
+            if (!m_camera->getBroker()->begin())
+                return false;
+
+            if (!m_lock)
+            {
+                m_lock = xSemaphoreCreateMutex();
+                if (!m_lock)
+                    return false;
+            }
+            for (int i = 0; i < MAX_SESSIONS; i++)
+            {
+                if (!m_writeLocks[i])
+                    m_writeLocks[i] = xSemaphoreCreateMutex();
+                if (!m_writeLocks[i])
+                    return false;
+            }
+            if (!openSockets())
+            {
+                closeSockets();
+                return false;
+            }
+
+            m_ssrc = esp_random();
+            m_windowStart = esp_timer_get_time();
+            m_running = true;
+            if (xTaskCreatePinnedToCore(streamTask, "RtspStream", 4096, this, 5, &m_streamHandle, 0) != pdPASS)
+            {
+                m_running = false;
+                closeSockets();
+                return false;
+            }
+            if (xTaskCreatePinnedToCore(controlTask, "Rtsp", 4096, this, 3, &m_controlHandle, 0) != pdPASS)
+            {
+                stop();
+                return false;
+            }
+            return true;
+        }
+
+        void stop()
+        {
+            if (!m_running)
+                return;
+
+            m_running = false;
+            if (m_streamHandle)
+            {
+                xTaskNotifyGive(m_streamHandle);
+            }
+
+            unsigned long startWait = millis();
+            while ((m_streamHandle != NULL || m_controlHandle != NULL) && millis() - startWait < 2000)
+            {
+                vTaskDelay(10);
+            }
+
+            for (int i = 0; i < MAX_SESSIONS; i++)
+            {
+                if (m_sessions[i].fd >= 0)
+                    closeSession(m_sessions[i]);
+            }
+            closeSockets();
+        }
+
+        RtspStats getStats()
+        {
+            RtspStats stats;
+            memset(&stats, 0, sizeof(stats));
+            if (!m_lock)
+                return stats;
+
+            xSemaphoreTake(m_lock, portMAX_DELAY);
+            for (int i = 0; i < MAX_SESSIONS; i++)
+            {
+                if (m_sessions[i].fd >= 0)
+                    stats.sessions++;
+            }
+            stats.playing = m_playing;
+            stats.framesSent = m_framesSent;
+            stats.packetsSent = m_packetsSent;
+            stats.packetsDropped = m_packetsDropped;
+            stats.badFrames = m_badFrames;
+            stats.packetsPerSec = m_packetsPerSec;
+            xSemaphoreGive(m_lock);
+            stats.packetize = m_packetizeUs.summarize();
+            return stats;
+        }
+
+        void resetPacketizeStats()
+        {
+            m_packetizeUs.reset();
+        }
+    };
+}
+#endif
@@ -0,0 +1,187 @@
+#ifndef ESPCAMLIB_SENSORPROFILE_H
+#define ESPCAMLIB_SENSORPROFILE_H
+#include <Arduino.h>
+#include <stdio.h>
+#include "esp_camera.h"
+#include "nvs.h"
+
+#include "SensorQueue.h"
+
+// everything Camera::begin() needs to bring the sensor back to where it was, stored as one blob so a
+// wake-snap-sleep cycle restores it with one read instead of a chain of setter calls
+namespace EspCam
+{
+    struct SensorProfile
+    {
+        static const uint32_t MAGIC = 0x50534345; // "ECSP"
+        static const uint16_t VERSION = 2;
+
+        uint32_t magic;
+        uint16_t version;
+        uint16_t size;
+        uint16_t sensorPid;
+        int16_t flash;
+        // camera_config_t fields, the pins stay with the board definition
+        int32_t pixelFormat;
+        int32_t frameSize;
+        int32_t jpegQuality;
+        int32_t fbCount;
+        int32_t fbLocation;
+        int32_t grabMode;
+        int32_t xclkFreqHz;
+        int16_t settings[SENSOR_SETTING_COUNT];
+        // last exposure and gain the sensor converged to, so auto exposure starts from there
+        uint8_t hasExposure;
+        uint8_t gain;
+        uint32_t exposure;
+        uint32_t checksum;
+
+        uint32_t computeChecksum() const
+        {
+            const uint8_t *p = (const uint8_t *)this;
+            uint32_t hash = 2166136261u;
+            for (size_t i = 0; i < offsetof(SensorProfile, checksum); i++)
+            {
+                hash = (hash ^ p[i]) * 16777619u;
+            }
+            return hash;
+        }
+
+        void seal()
+        {
+            magic = MAGIC;
+            version = VERSION;
+            size = sizeof(SensorProfile);
+            checksum = computeChecksum();
+        }
+
+        bool isValid() const
+        {
+            return magic == MAGIC && version == VERSION && size == sizeof(SensorProfile) && checksum == computeChecksum();
+        }
+
+        // live exposure and gain registers, only known for the OV2640
+        static bool readExposure(sensor_t *s, uint32_t &exposure, uint8_t &gain)
+        {
+            if (s->id.PID != OV2640_PID || !s->get_reg)
+                return false;
+
+            // sensor bank: AEC[15:10] in 0x45, AEC[9:2] in 0x10, AEC[1:0] in 0x04, gain in 0x00
+            int high = s->get_reg(s, 0x145, 0x3F);
+            int mid = s->get_reg(s, 0x110, 0xFF);
+            int low = s->get_reg(s, 0x104, 0x03);
+            int g = s->get_reg(s, 0x100, 0xFF);
+            if (high < 0 || mid < 0 || low < 0 || g < 0)
+                return false;
+            exposure = (high << 10) | (mid << 2) | low;
+            gain = g;
+            return true;
+        }
+
+        // with AEC and AGC enabled the sensor keeps adjusting from these values instead of from its defaults
+        static void writeExposure(sensor_t *s, uint32_t exposure, uint8_t gain)
+        {
+            if (s->id.PID != OV2640_PID || !s->set_reg)
+                return;
+
+            s->set_reg(s, 0x145, 0x3F, (exposure >> 10) & 0x3F);
+            s->set_reg(s, 0x110, 0xFF, (exposure >> 2) & 0xFF);
+            s->set_reg(s, 0x104, 0x03, exposure & 0x03);
+            s->set_reg(s, 0x100, 0xFF, gain);
+        }
+    };
+
+    // where Camera keeps its profile
+    class ProfileStore
+    {
+    public:
+        virtual ~ProfileStore() {}
+        // true only when exactly `len` bytes were read
+        virtual bool load(void *data, size_t len) = 0;
+        virtual bool save(const void *data, size_t len) = 0;
+        virtual bool erase() = 0;
+    };
+
+    // one NVS blob, the Arduino core has initialized the default NVS partition by the time setup() runs
+    class NvsProfileStore : public ProfileStore
+    {
+    private:
+        const char *m_namespace;
+        const char *m_key;
+
+    public:
+        NvsProfileStore(const char *nvsNamespace = "espcam", const char *key = "profile") : m_namespace(nvsNamespace), m_key(key) {}
+
+        bool load(void *data, size_t len) override
+        {
+            nvs_handle_t handle;
+            if (nvs_open(m_namespace, NVS_READONLY, &handle) != ESP_OK)
+                return false;
+            size_t size = len;
+            esp_err_t err = nvs_get_blob(handle, m_key, data, &size);
+            nvs_close(handle);
+            return err == ESP_OK && size == len;
+        }
+
+        bool save(const void *data, size_t len) override
+        {
+            nvs_handle_t handle;
+            if (nvs_open(m_namespace, NVS_READWRITE, &handle) != ESP_OK)
+                return false;
+            esp_err_t err = nvs_set_blob(handle, m_key, data, len);
+            if (err == ESP_OK)
+                err = nvs_commit(handle);
+            nvs_close(handle);
+            return err == ESP_OK;
+        }
+
+        bool erase() override
+        {
+            nvs_handle_t handle;
+            if (nvs_open(m_namespace, NVS_READWRITE, &handle) != ESP_OK)
+                return false;
+            esp_err_t err = nvs_erase_key(handle, m_key);
+            if (err == ESP_OK)
+                err = nvs_commit(handle);
+            nvs_close(handle);
+            return err == ESP_OK || err == ESP_ERR_NVS_NOT_FOUND;
+        }
+    };
+
+    // plain file, for a VFS path on the device or for host side tests
+    class FileProfileStore : public ProfileStore
+    {
+    private:
+        const char *m_path;
+
+    public:
+        FileProfileStore(const char *path) : m_path(path) {}
+
+        bool load(void *data, size_t len) override
+        {
+            FILE *file = fopen(m_path, "rb");
+            if (!file)
+                return false;
+            size_t read = fread(data, 1, len, file);
+            // a longer file is from another layout
+            bool exact = read == len && fgetc(file) == EOF;
+            fclose(file);
+            return exact;
+        }
+
+        bool save(const void *data, size_t len) override
+        {
+            FILE *file = fopen(m_path, "wb");
+            if (!file)
+                return false;
+            bool ok = fwrite(data, 1, len, file) == len;
+            return fclose(file) == 0 && ok;
+        }
+
+        bool erase() override
+        {
+            return remove(m_path) == 0 || errno == ENOENT;
+        }
+    };
+}
+#endif
@@ -0,0 +1,271 @@
+#ifndef ESPCAMLIB_SENSORQUEUE_H
+#define ESPCAMLIB_SENSORQUEUE_H
+#include <Arduino.h>
+#include <atomic>
+#include "esp_camera.h"
+
+// sensor settings posted from any task and applied by the capture task between two frames. Each
+// setting has one mailbox slot, so a newer value replaces a pending one instead of queueing behind it
+namespace EspCam
+{
+    // in the order they are applied, geometry and format first
+    enum SensorSetting
+    {
+        SENSOR_PIXFORMAT,
+        SENSOR_FRAMESIZE,
+        // region of interest, programmed by Camera after the frame size
+        SENSOR_WINDOW,
+        SENSOR_QUALITY,
+        SENSOR_CONTRAST,
+        SENSOR_BRIGHTNESS,
+        SENSOR_SATURATION,
+        SENSOR_SHARPNESS,
+        SENSOR_DENOISE,
+        SENSOR_GAINCEILING,
+        SENSOR_COLORBAR,
+        SENSOR_AWB,
+        SENSOR_AGC,
+        SENSOR_AEC,
+        SENSOR_AEC2,
+        SENSOR_AWB_GAIN,
+        SENSOR_AGC_GAIN,
+        SENSOR_AEC_VALUE,
+        SENSOR_SPECIAL_EFFECT,
+        SENSOR_WB_MODE,
+        SENSOR_AE_LEVEL,
+        SENSOR_DCW,
+        SENSOR_BPC,
+        SENSOR_WPC,
+        SENSOR_RAW_GMA,
+        SENSOR_LENC,
+        SENSOR_VFLIP,
+        SENSOR_HMIRROR,
+        SENSOR_SETTING_COUNT
+    };
+
+    class SensorQueue
+    {
+    public:
+        // bits of the settings that change the frame size or format
+        static const uint32_t GEOMETRY_MASK = (1u << SENSOR_PIXFORMAT) | (1u << SENSOR_FRAMESIZE) | (1u << SENSOR_WINDOW);
+
+    private:
+        std::atomic<int> m_values[SENSOR_SETTING_COUNT];
+        std::atomic<uint32_t> m_dirty;
+        std::atomic<uint32_t> m_posted;
+        std::atomic<uint32_t> m_applied;
+
+    public:
+        SensorQueue()
+        {
+            for (int i = 0; i < SENSOR_SETTING_COUNT; i++)
+            {
+                m_values[i].store(0);
+            }
+            m_dirty.store(0);
+            m_posted.store(0);
+            m_applied.store(0);
+        }
+
+        // returns a ticket for waitApplied(), any number of tasks may post
+        uint32_t post(SensorSetting setting, int value)
+        {
+            m_values[setting].store(value, std::memory_order_relaxed);
+            // the dirty bit goes up before the ticket is counted, so a ticket a drain reads is always covered
+            // by the bits it takes or took before. A drain in between takes the value under an older ticket
+            m_dirty.fetch_or(1u << setting, std::memory_order_release);
+            return m_posted.fetch_add(1, std::memory_order_acq_rel) + 1;
+        }
+
+        // also true with no bit left when a setting was taken before its ticket was counted, the next
+        // take() then hands out that ticket with an empty mask
+        bool pending()
+        {
+            return m_dirty.load(std::memory_order_acquire) != 0 ||
+                   m_posted.load(std::memory_order_acquire) != m_applied.load(std::memory_order_acquire);
+        }
+
+        // consumer side: takes every pending setting into `values`, returns their bits and the
+        // ticket that is covered once they are applied. The ticket is read first, reading it after the
+        // bits could cover a post whose bit is still to be taken
+        uint32_t take(int values[SENSOR_SETTING_COUNT], uint32_t &ticket)
+        {
+            ticket = m_posted.load(std::memory_order_acquire);
+            uint32_t mask = m_dirty.exchange(0, std::memory_order_acq_rel);
+            for (int i = 0; i < SENSOR_SETTING_COUNT; i++)
+            {
+                if (mask & (1u << i))
+                    values[i] = m_values[i].load(std::memory_order_relaxed);
+            }
+            return mask;
+        }
+
+        // consumer side: everything up to `ticket` is visible in the frames from now on
+        void complete(uint32_t ticket)
+        {
+            if ((int32_t)(ticket - m_applied.load(std::memory_order_relaxed)) > 0)
+                m_applied.store(ticket, std::memory_order_release);
+        }
+
+        bool isApplied(uint32_t ticket)
+        {
+            return (int32_t)(m_applied.load(std::memory_order_acquire) - ticket) >= 0;
+        }
+
+        bool waitApplied(uint32_t ticket, TickType_t timeout)
+        {
+            TickType_t start = xTaskGetTickCount();
+            while (!isApplied(ticket))
+            {
+                if (xTaskGetTickCount() - start >= timeout)
+                    return false;
+                vTaskDelay(1);
+            }
+            return true;
+        }
+
+        // the value the sensor driver last stored for `setting`
+        static int read(sensor_t *s, int setting)
+        {
+            const camera_status_t &st = s->status;
+            switch (setting)
+            {
+            case SENSOR_PIXFORMAT:
+                return s->pixformat;
+            case SENSOR_FRAMESIZE:
+                return st.framesize;
+            case SENSOR_QUALITY:
+                return st.quality;
+            case SENSOR_CONTRAST:
+                return st.contrast;
+            case SENSOR_BRIGHTNESS:
+                return st.brightness;
+            case SENSOR_SATURATION:
+                return st.saturation;
+            case SENSOR_SHARPNESS:
+                return st.sharpness;
+            case SENSOR_DENOISE:
+                return st.denoise;
+            case SENSOR_GAINCEILING:
+                return st.gainceiling;
+            case SENSOR_COLORBAR:
+                return st.colorbar;
+            case SENSOR_AWB:
+                return st.awb;
+            case SENSOR_AGC:
+                return st.agc;
+            case SENSOR_AEC:
+                return st.aec;
+            case SENSOR_AEC2:
+                return st.aec2;
+            case SENSOR_AWB_GAIN:
+                return st.awb_gain;
+            case SENSOR_AGC_GAIN:
+                return st.agc_gain;
+            case SENSOR_AEC_VALUE:
+                return st.aec_value;
+            case SENSOR_SPECIAL_EFFECT:
+                return st.special_effect;
+            case SENSOR_WB_MODE:
+                return st.wb_mode;
+            case SENSOR_AE_LEVEL:
+                return st.ae_level;
+            case SENSOR_DCW:
+                return st.dcw;
+            case SENSOR_BPC:
+                return st.bpc;
+            case SENSOR_WPC:
+                return st.wpc;
+            case SENSOR_RAW_GMA:
+                return st.raw_gma;
+            case SENSOR_LENC:
+                return st.lenc;
+            case SENSOR_VFLIP:
+                return st.vflip;
+            case SENSOR_HMIRROR:
+                return st.hmirror;
+            default:
+                return 0;
+            }
+        }
+
+        // false for the settings the sensor driver leaves without a setter, e.g. sharpness on the OV2640
+        static bool supported(sensor_t *s, int setting)
+        {
+            switch (setting)
+            {
+            case SENSOR_SHARPNESS:
+                return s->set_sharpness != nullptr;
+            case SENSOR_DENOISE:
+                return s->set_denoise != nullptr;
+            default:
+                return true;
+            }
+        }
+
+        // one setter call, a negative value for the flips toggles the current state
+        static int apply(sensor_t *s, int setting, int value)
+        {
+            switch (setting)
+            {
+            case SENSOR_PIXFORMAT:
+                return s->set_pixformat(s, (pixformat_t)value);
+            case SENSOR_FRAMESIZE:
+                return s->set_framesize(s, (framesize_t)value);
+            case SENSOR_QUALITY:
+                return s->set_quality(s, value);
+            case SENSOR_CONTRAST:
+                return s->set_contrast(s, value);
+            case SENSOR_BRIGHTNESS:
+                return s->set_brightness(s, value);
+            case SENSOR_SATURATION:
+                return s->set_saturation(s, value);
+            case SENSOR_SHARPNESS:
+                return s->set_sharpness ? s->set_sharpness(s, value) : -1;
+            case SENSOR_DENOISE:
+                return s->set_denoise ? s->set_denoise(s, value) : -1;
+            case SENSOR_GAINCEILING:
+                return s->set_gainceiling(s, (gainceiling_t)value);
+            case SENSOR_COLORBAR:
+                return s->set_colorbar(s, value);
+            case SENSOR_AWB:
+                return s->set_whitebal(s, value);
+            case SENSOR_AGC:
+                return s->set_gain_ctrl(s, value);
+            case SENSOR_AEC:
+                return s->set_exposure_ctrl(s, value);
+            case SENSOR_AEC2:
+                return s->set_aec2(s, value);
+            case SENSOR_AWB_GAIN:
+                return s->set_awb_gain(s, value);
+            case SENSOR_AGC_GAIN:
+                return s->set_agc_gain(s, value);
+            case SENSOR_AEC_VALUE:
+                return s->set_aec_value(s, value);
+            case SENSOR_SPECIAL_EFFECT:
+                return s->set_special_effect(s, value);
+            case SENSOR_WB_MODE:
+                return s->set_wb_mode(s, value);
+            case SENSOR_AE_LEVEL:
+                return s->set_ae_level(s, value);
+            case SENSOR_DCW:
+                return s->set_dcw(s, value);
+            case SENSOR_BPC:
+                return s->set_bpc(s, value);
+            case SENSOR_WPC:
+                return s->set_wpc(s, value);
+            case SENSOR_RAW_GMA:
+                return s->set_raw_gma(s, value);
+            case SENSOR_LENC:
+                return s->set_lenc(s, value);
+            case SENSOR_VFLIP:
+                return s->set_vflip(s, value < 0 ? !s->status.vflip : value != 0);
+            case SENSOR_HMIRROR:
+                return s->set_hmirror(s, value < 0 ? !s->status.hmirror : value != 0);
+            default:
+                return -1;
+            }
+        }
+    };
+}
+#endif
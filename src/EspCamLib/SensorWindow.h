@@ -0,0 +1,132 @@
+#ifndef ESPCAMLIB_SENSORWINDOW_H
+#define ESPCAMLIB_SENSORWINDOW_H
+#include <Arduino.h>
+#include "esp_camera.h"
+
+// maps a region of interest onto the OV2640 readout. The sensor reads the full field at 1600x1200 (UXGA),
+// binned at 800x600 (SVGA) or at 400x296 (CIF); a window of that readout goes to the DSP, which scales it
+// down to the output size. The fastest readout that still has as many pixels as the output is used, so a
+// small region costs fewer bytes per frame and can also come at a higher frame rate
+namespace EspCam
+{
+    // in full field pixels, 0,0 being the top left of the 1600x1200 array
+    struct CameraRegion
+    {
+        bool active;
+        uint16_t x;
+        uint16_t y;
+        uint16_t width;
+        uint16_t height;
+        framesize_t output;
+    };
+
+    // the arguments for the OV2640 set_res_raw(), `mode` goes in as startX
+    struct SensorWindow
+    {
+        int mode;
+        uint16_t offsetX;
+        uint16_t offsetY;
+        uint16_t width;
+        uint16_t height;
+        uint16_t outputWidth;
+        uint16_t outputHeight;
+    };
+
+    class SensorWindowMapper
+    {
+    public:
+        static const uint16_t FIELD_WIDTH = 1600;
+        static const uint16_t FIELD_HEIGHT = 1200;
+
+    private:
+        struct Mode
+        {
+            int mode;
+            int binning;
+            uint16_t width;
+            uint16_t height;
+        };
+
+        // fastest first, OV2640_MODE_CIF, OV2640_MODE_SVGA and OV2640_MODE_UXGA of the driver
+        static const Mode *modes()
+        {
+            static const Mode table[3] = {{2, 4, 400, 296}, {1, 2, 800, 600}, {0, 1, 1600, 1200}};
+            return table;
+        }
+
+        // moves [start, start + size) back inside [0, limit)
+        static uint16_t clampStart(int start, int size, int limit)
+        {
+            if (start + size > limit)
+                start = limit - size;
+            return start < 0 ? 0 : start;
+        }
+
+    public:
+        // adjusts `region` to what the sensor can deliver and fills in the window for it. The window is widened
+        // to the aspect of the output and to at least the output size, the DSP does not stretch or scale up
+        static bool map(CameraRegion &region, SensorWindow &window)
+        {
+            if (region.output >= FRAMESIZE_INVALID)
+                return false;
+            uint32_t outW = resolution[region.output].width;
+            uint32_t outH = resolution[region.output].height;
+            if (outW > FIELD_WIDTH || outH > FIELD_HEIGHT)
+                return false;
+
+            int centerX = region.x + region.width / 2;
+            int centerY = region.y + region.height / 2;
+            uint32_t w = region.width;
+            uint32_t h = region.height;
+            if (w * outH < h * outW)
+                w = h * outW / outH;
+            else
+                h = w * outH / outW;
+            if (w < outW)
+            {
+                w = outW;
+                h = outH;
+            }
+            if (w > FIELD_WIDTH)
+            {
+                w = FIELD_WIDTH;
+                h = w * outH / outW;
+            }
+            if (h > FIELD_HEIGHT)
+            {
+                h = FIELD_HEIGHT;
+                w = h * outW / outH;
+            }
+            // the window registers count in steps of 4 readout pixels
+            w &= ~3;
+            h &= ~3;
+
+            region.width = w;
+            region.height = h;
+            region.x = clampStart(centerX - (int)w / 2, w, FIELD_WIDTH);
+            region.y = clampStart(centerY - (int)h / 2, h, FIELD_HEIGHT);
+
+            for (int i = 0; i < 3; i++)
+            {
+                const Mode &mode = modes()[i];
+                uint16_t modeW = (w / mode.binning) & ~3;
+                uint16_t modeH = (h / mode.binning) & ~3;
+                if (modeW < outW || modeH < outH)
+                    continue;
+                if (modeW > mode.width || modeH > mode.height)
+                    continue;
+
+                window.mode = mode.mode;
+                window.width = modeW;
+                window.height = modeH;
+                window.offsetX = clampStart(region.x / mode.binning, modeW, mode.width);
+                window.offsetY = clampStart(region.y / mode.binning, modeH, mode.height);
+                window.outputWidth = outW;
+                window.outputHeight = outH;
+                return true;
+            }
+            return false;
+        }
+    };
+}
+#endif
@@ -0,0 +1,513 @@
+#ifndef ESPCAMLIB_STREAMBROADCASTER_H
+#define ESPCAMLIB_STREAMBROADCASTER_H
+#include <Arduino.h>
+#include "esp_http_server.h"
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+
+#include "FrameBroker.h"
+#include "Multipart.h"
+#include "WebSocket.h"
+
+// one task pushes every frame to all stream sockets with non-blocking writes,
+// a slow client keeps only its newest pending frame and skips the ones in between.
+// WebSocket clients that ack frames are also held to a window of unacknowledged frames
+namespace EspCam
+{
+    struct StreamClientStats
+    {
+        int fd;
+        float fps;
+        uint32_t framesSent;
+        uint32_t framesDropped;
+        uint64_t bytesSent;
+    };
+
+    // notified from the streaming task, e.g. to drive a RateController
+    class StreamObserver
+    {
+    public:
+        virtual ~StreamObserver() {}
+        // `sendUs` is the time from queueing the first byte of the part to writing its last one
+        virtual void onFrameSent(int fd, size_t bytes, uint32_t sendUs) = 0;
+        // called on every pass of the streaming loop, also while sockets are stalled
+        virtual void onStreamTick(int64_t nowUs) {}
+        virtual void onClientRemoved(int fd) {}
+    };
+
+    class StreamBroadcaster
+    {
+    public:
+        static const int MAX_CLIENTS = 8;
+        static const uint32_t MAX_ACK_WINDOW = 8;
+        static const size_t HEADER_MAX = MultipartWriter::HEADER_MAX > WebSocketFraming::HEADER_MAX ? MultipartWriter::HEADER_MAX : WebSocketFraming::HEADER_MAX;
+
+    private:
+        struct Client
+        {
+            int fd = -1;
+            bool closing = false;
+            bool websocket = false;
+            FrameRef current;
+            FrameRef pending;
+            char header[HEADER_MAX];
+            size_t headerLen = 0;
+            // sequence of the last frame started, and the last one the client acked, 0 until it acks
+            uint32_t lastStarted = 0;
+            uint32_t lastAcked = 0;
+            // sequences of the frames started since the last ack, oldest first. Frames skipped in between
+            // leave gaps in the numbers, so the window counts these instead of subtracting sequences
+            uint32_t unacked[MAX_ACK_WINDOW];
+            uint32_t unackedCount = 0;
+            size_t offset = 0;
+            int64_t frameStart = 0;
+            uint32_t framesSent = 0;
+            uint32_t framesDropped = 0;
+            uint64_t bytesSent = 0;
+            uint32_t windowFrames = 0;
+            int64_t windowStart = 0;
+            float fps = 0;
+        };
+
+        FrameBroker *m_broker;
+        PipelineLatency *m_latency;
+        Metrics *m_metrics;
+        httpd_handle_t m_server = NULL;
+        Client m_clients[MAX_CLIENTS];
+        int m_clientCount = 0;
+        SemaphoreHandle_t m_lock = NULL;
+        TaskHandle_t m_taskHandle = NULL;
+        volatile bool m_running = false;
+        StreamObserver *m_observer = nullptr;
+        uint32_t m_ackWindow = 2;
+
+        // clients that never ack are only limited by the socket, like multipart clients
+        bool ackWindowFull(Client &client)
+        {
+            return client.lastAcked && client.unackedCount >= m_ackWindow;
+        }
+
+        void startFrame(Client &client, FrameRef &frame)
+        {
+            client.current = frame;
+            if (client.websocket)
+                client.headerLen = WebSocketFraming::formatHeader(client.header, frame.sequence(), frame.timestamp(), frame.length());
+            else
+                client.headerLen = MultipartWriter::formatPartHeader(client.header, frame.length());
+            client.offset = 0;
+            client.frameStart = esp_timer_get_time();
+            client.lastStarted = frame.sequence();
+            // before the first ack nothing limits the count, keep the newest ones
+            if (client.unackedCount == MAX_ACK_WINDOW)
+            {
+                memmove(client.unacked, client.unacked + 1, (MAX_ACK_WINDOW - 1) * sizeof(uint32_t));
+                client.unackedCount--;
+            }
+            client.unacked[client.unackedCount++] = frame.sequence();
+        }
+
+        void startPending(Client &client)
+        {
+            if (client.current || !client.pending || ackWindowFull(client))
+                return;
+            startFrame(client, client.pending);
+            client.pending.reset();
+        }
+
+        void distribute(FrameRef &frame)
+        {
+            for (int i = 0; i < MAX_CLIENTS; i++)
+            {
+                Client &client = m_clients[i];
+                if (client.fd < 0 || client.closing)
+                    continue;
+
+                if (!client.current && !ackWindowFull(client))
+                {
+                    startFrame(client, frame);
+                }
+                else
+                {
+                    if (client.pending)
+                    {
+                        client.framesDropped++;
+                        m_metrics->addStreamDropped();
+                    }
+                    client.pending = frame;
+                }
+            }
+        }
+
+        void dropClient(Client &client)
+        {
+            // httpd closes the socket and calls removeClient() from its own task
+            client.closing = true;
+            httpd_sess_trigger_close(m_server, client.fd);
+            client.current.reset();
+            client.pending.reset();
+        }
+
+        void sendTo(Client &client)
+        {
+            size_t len = client.current.length();
+            size_t trailerLen = client.websocket ? 0 : 2;
+            size_t total = client.headerLen + len + trailerLen;
+
+            struct iovec iov[3];
+            struct msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = iov;
+            msg.msg_iovlen = MultipartWriter::fillParts(iov, client.header, client.headerLen, client.current.data(), len, client.offset, trailerLen);
+
+            ssize_t res = lwip_sendmsg(client.fd, &msg, MSG_DONTWAIT);
+            if (res < 0)
+            {
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                    dropClient(client);
+                return;
+            }
+
+            int64_t now = esp_timer_get_time();
+            if (client.offset == 0 && res > 0)
+            {
+                m_latency->recordSince(PipelineLatency::FIRST_BYTE, client.current.timestamp(), now);
+            }
+            client.offset += res;
+            client.bytesSent += res;
+            m_metrics->addBytesSent(res);
+            if (client.offset < total)
+                return;
+
+            client.framesSent++;
+            client.windowFrames++;
+            m_metrics->addFrameSent();
+            m_latency->recordSince(PipelineLatency::LAST_BYTE, client.current.timestamp(), now);
+            if (m_observer)
+            {
+                m_observer->onFrameSent(client.fd, len, (uint32_t)(now - client.frameStart));
+            }
+            client.current.reset();
+            startPending(client);
+        }
+
+        // waits up to `timeoutMs` for sockets with queued data to become writable and writes what they accept
+        bool service(int timeoutMs)
+        {
+            fd_set writable;
+            FD_ZERO(&writable);
+            int maxFd = -1;
+
+            for (int i = 0; i < MAX_CLIENTS; i++)
+            {
+                Client &client = m_clients[i];
+                if (client.fd >= 0 && client.current)
+                {
+                    FD_SET(client.fd, &writable);
+                    if (client.fd > maxFd)
+                        maxFd = client.fd;
+                }
+            }
+
+            if (maxFd < 0)
+                return false;
+
+            struct timeval tv = {0, timeoutMs * 1000};
+            if (select(maxFd + 1, NULL, &writable, NULL, &tv) <= 0)
+                return true;
+
+            for (int i = 0; i < MAX_CLIENTS; i++)
+            {
+                Client &client = m_clients[i];
+                if (client.fd >= 0 && client.current && FD_ISSET(client.fd, &writable))
+                    sendTo(client);
+            }
+            return true;
+        }
+
+        void updateRates()
+        {
+            int64_t now = esp_timer_get_time();
+            for (int i = 0; i < MAX_CLIENTS; i++)
+            {
+                Client &client = m_clients[i];
+                if (client.fd < 0)
+                    continue;
+
+                int64_t elapsed = now - client.windowStart;
+                if (elapsed >= 1000000)
+                {
+                    client.fps = client.windowFrames * 1000000.0f / elapsed;
+                    client.windowFrames = 0;
+                    client.windowStart = now;
+                }
+            }
+        }
+
+        static void broadcastTask(void *param)
+        {
+            StreamBroadcaster *self = static_cast<StreamBroadcaster *>(param);
+            uint32_t lastSeq = 0;
+            bool busy = false;
+            // while clients are connected the broker keeps capturing, also when this task is busy
+            // writing and only polls for a frame without waiting
+            bool demand = false;
+
+            while (self->m_running)
+            {
+                if (self->m_clientCount == 0)
+                {
+                    if (demand)
+                    {
+                        self->m_broker->removeDemand();
+                        demand = false;
+                    }
+                    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+                    continue;
+                }
+                if (!demand)
+                {
+                    self->m_broker->addDemand();
+                    demand = true;
+                }
+
+                FrameRef frame = self->m_broker->acquire(lastSeq, busy ? 0 : pdMS_TO_TICKS(100));
+                if (frame)
+                {
+                    lastSeq = frame.sequence();
+                    // a raw frame is encoded now, not under the lock
+                    if (!frame.length())
+                        frame.reset();
+                }
+
+                xSemaphoreTake(self->m_lock, portMAX_DELAY);
+                if (frame)
+                {
+                    self->m_latency->recordSince(PipelineLatency::DEQUEUE, frame.timestamp(), esp_timer_get_time());
+                    self->distribute(frame);
+                }
+                busy = self->service(5);
+                self->updateRates();
+                if (self->m_observer)
+                {
+                    self->m_observer->onStreamTick(esp_timer_get_time());
+                }
+                xSemaphoreGive(self->m_lock);
+            }
+
+            if (demand)
+            {
+                self->m_broker->removeDemand();
+            }
+            self->m_taskHandle = NULL;
+            vTaskDelete(NULL);
+        }
+
+    public:
+        StreamBroadcaster(FrameBroker *broker) : m_broker(broker), m_latency(broker->getLatency()), m_metrics(broker->getMetrics()) {}
+
+        ~StreamBroadcaster()
+        {
+            stop();
+            if (m_lock)
+            {
+                vSemaphoreDelete(m_lock);
+            }
+        }
+
+        bool begin(httpd_handle_t server, int core = 0)
+        {
+            if (m_running)
+                return true;
+
+            m_server = server;
+            if (!m_lock)
+            {
+                m_lock = xSemaphoreCreateMutex();
+                if (!m_lock)
+                    return false;
+            }
+
+            m_running = true;
+            if (xTaskCreatePinnedToCore(broadcastTask, "Broadcast", 4096, this, 5, &m_taskHandle, core) != pdPASS)
+            {
+                m_running = false;
+                return false;
+            }
+            return true;
+        }
+
+        void stop()
+        {
+            if (!m_running)
+                return;
+
+            m_running = false;
+            xTaskNotifyGive(m_taskHandle);
+
+            unsigned long startWait = millis();
+            while (m_taskHandle != NULL && millis() - startWait < 2000)
+            {
+                vTaskDelay(10);
+            }
+
+            // nothing writes to the sockets anymore, have httpd close them. Its close handler calls removeClient()
+            xSemaphoreTake(m_lock, portMAX_DELAY);
+            for (int i = 0; i < MAX_CLIENTS; i++)
+            {
+                Client &client = m_clients[i];
+                if (client.fd >= 0 && !client.closing)
+                {
+                    dropClient(client);
+                }
+            }
+            xSemaphoreGive(m_lock);
+
+            startWait = millis();
+            while (m_clientCount > 0 && millis() - startWait < 2000)
+            {
+                vTaskDelay(10);
+            }
+
+            xSemaphoreTake(m_lock, portMAX_DELAY);
+            for (int i = 0; i < MAX_CLIENTS; i++)
+            {
+                m_clients[i].current.reset();
+                m_clients[i].pending.reset();
+            }
+            xSemaphoreGive(m_lock);
+        }
+
+        // must be called before begin()
+        void setObserver(StreamObserver *observer)
+        {
+            m_observer = observer;
+        }
+
+        // frames a WebSocket client may have unacknowledged before newer ones are skipped, 1..MAX_ACK_WINDOW.
+        // Must be called before begin()
+        void setAckWindow(uint32_t frames)
+        {
+            m_ackWindow = frames < 1 ? 1 : (frames > MAX_ACK_WINDOW ? MAX_ACK_WINDOW : frames);
+        }
+
+        // takes over a socket whose multipart response headers, or WebSocket handshake, were already sent
+        bool addClient(int fd, bool websocket = false)
+        {
+            if (!m_running)
+                return false;
+
+            bool added = false;
+            xSemaphoreTake(m_lock, portMAX_DELAY);
+            for (int i = 0; i < MAX_CLIENTS; i++)
+            {
+                Client &client = m_clients[i];
+                if (client.fd < 0)
+                {
+                    client = Client();
+                    client.fd = fd;
+                    client.websocket = websocket;
+                    client.windowStart = esp_timer_get_time();
+                    m_clientCount++;
+                    m_metrics->streamClientOpened();
+                    added = true;
+                    break;
+                }
+            }
+            xSemaphoreGive(m_lock);
+
+            if (added)
+            {
+                xTaskNotifyGive(m_taskHandle);
+            }
+            return added;
+        }
+
+        // the client has received frame `sequence`, acks for frames it was never sent are ignored
+        void ack(int fd, uint32_t sequence)
+        {
+            if (!m_lock || !sequence)
+                return;
+
+            xSemaphoreTake(m_lock, portMAX_DELAY);
+            for (int i = 0; i < MAX_CLIENTS; i++)
+            {
+                Client &client = m_clients[i];
+                if (client.fd != fd)
+                    continue;
+
+                if ((int32_t)(client.lastStarted - sequence) >= 0 && (int32_t)(sequence - client.lastAcked) > 0)
+                {
+                    client.lastAcked = sequence;
+                    uint32_t acked = 0;
+                    while (acked < client.unackedCount && (int32_t)(client.unacked[acked] - sequence) <= 0)
+                    {
+                        acked++;
+                    }
+                    client.unackedCount -= acked;
+                    memmove(client.unacked, client.unacked + acked, client.unackedCount * sizeof(uint32_t));
+                    // a frame held back by the window goes out on the next pass of the streaming loop
+                    startPending(client);
+                }
+                break;
+            }
+            xSemaphoreGive(m_lock);
+        }
+
+        // must be called before the socket is closed, returns false if it was not a stream client
+        bool removeClient(int fd)
+        {
+            if (!m_lock)
+                return false;
+
+            bool removed = false;
+            xSemaphoreTake(m_lock, portMAX_DELAY);
+            for (int i = 0; i < MAX_CLIENTS; i++)
+            {
+                Client &client = m_clients[i];
+                if (client.fd == fd)
+                {
+                    client.current.reset();
+                    client.pending.reset();
+                    client.fd = -1;
+                    m_clientCount--;
+                    m_metrics->streamClientClosed();
+                    removed = true;
+                    if (m_observer)
+                    {
+                        m_observer->onClientRemoved(fd);
+                    }
+                    break;
+                }
+            }
+            xSemaphoreGive(m_lock);
+            return removed;
+        }
+
+        int getClientCount()
+        {
+            return m_clientCount;
+        }
+
+        int getClientStats(StreamClientStats *out, int max)
+        {
+            int count = 0;
+            xSemaphoreTake(m_lock, portMAX_DELAY);
+            for (int i = 0; i < MAX_CLIENTS && count < max; i++)
+            {
+                Client &client = m_clients[i];
+                if (client.fd < 0)
+                    continue;
+
+                out[count].fd = client.fd;
+                out[count].fps = client.fps;
+                out[count].framesSent = client.framesSent;
+                out[count].framesDropped = client.framesDropped;
+                out[count].bytesSent = client.bytesSent;
+                count++;
+            }
+            xSemaphoreGive(m_lock);
+            return count;
+        }
+    };
+}
+#endif
@@ -0,0 +1,312 @@
+#ifndef ESPCAMLIB_STRIPEXECUTOR_H
+#define ESPCAMLIB_STRIPEXECUTOR_H
+#include <Arduino.h>
+#include "esp_timer.h"
+
+// splits per-frame pixel work into horizontal bands and runs them on both cores. The calling task takes
+// the last band itself while a helper task pinned to the other core takes the first, then run() joins
+namespace EspCam
+{
+    // processes rows [rowStart, rowEnd). `scratch` belongs to the worker running the band, so kernels can
+    // use it without locking, e.g. to pull a row out of PSRAM into internal RAM first
+    typedef void (*StripKernel)(void *ctx, int rowStart, int rowEnd, uint8_t *scratch, size_t scratchSize);
+
+    class StripExecutor
+    {
+    public:
+        static const int MAX_WORKERS = 2;
+
+    private:
+        struct Worker
+        {
+            StripExecutor *owner;
+            TaskHandle_t handle;
+            SemaphoreHandle_t start;
+            uint8_t *scratch;
+            int rowStart;
+            int rowEnd;
+        };
+
+        // worker 0 is whichever task calls run()
+        Worker m_workers[MAX_WORKERS];
+        int m_workerCount = 1;
+        size_t m_scratchSize = 0;
+        int m_core = 0;
+        int m_priority = 5;
+        StripKernel m_kernel = nullptr;
+        void *m_ctx = nullptr;
+        SemaphoreHandle_t m_lock = NULL;
+        SemaphoreHandle_t m_done = NULL;
+        volatile bool m_running = false;
+        uint32_t m_runs = 0;
+        uint32_t m_lastRunUs = 0;
+        uint32_t m_lastJoinUs = 0;
+
+        static void workerTask(void *param)
+        {
+            Worker *worker = static_cast<Worker *>(param);
+            StripExecutor *self = worker->owner;
+
+            while (true)
+            {
+                xSemaphoreTake(worker->start, portMAX_DELAY);
+                if (!self->m_running)
+                    break;
+                self->m_kernel(self->m_ctx, worker->rowStart, worker->rowEnd, worker->scratch, self->m_scratchSize);
+                xSemaphoreGive(self->m_done);
+            }
+
+            worker->handle = NULL;
+            vTaskDelete(NULL);
+        }
+
+        void freeScratch()
+        {
+            for (int i = 0; i < MAX_WORKERS; i++)
+            {
+                free(m_workers[i].scratch);
+                m_workers[i].scratch = nullptr;
+            }
+        }
+
+    public:
+        StripExecutor()
+        {
+            for (int i = 0; i < MAX_WORKERS; i++)
+            {
+                m_workers[i] = {this, NULL, NULL, nullptr, 0, 0};
+            }
+        }
+
+        ~StripExecutor()
+        {
+            stop();
+            for (int i = 0; i < MAX_WORKERS; i++)
+            {
+                if (m_workers[i].start)
+                    vSemaphoreDelete(m_workers[i].start);
+            }
+            if (m_done)
+                vSemaphoreDelete(m_done);
+            if (m_lock)
+                vSemaphoreDelete(m_lock);
+        }
+
+        // core and priority of the helper task, set before begin(). The caller of run() should be on the other core
+        void setCore(int core)
+        {
+            m_core = core;
+        }
+
+        void setPriority(int priority)
+        {
+            m_priority = priority;
+        }
+
+        // `workers` 1 runs everything on the calling task. Each worker gets `scratchSize` bytes of internal RAM
+        bool begin(int workers = MAX_WORKERS, size_t scratchSize = 0)
+        {
+            if (m_running)
+                return true;
+
+            if (!m_lock)
+            {
+                m_lock = xSemaphoreCreateMutex();
+                m_done = xSemaphoreCreateCounting(MAX_WORKERS, 0);
+                if (!m_lock || !m_done)
+                    return false;
+            }
+
+            m_workerCount = workers < 1 ? 1 : (workers > MAX_WORKERS ? MAX_WORKERS : workers);
+            m_scratchSize = scratchSize;
+            for (int i = 0; i < m_workerCount && scratchSize; i++)
+            {
+                m_workers[i].scratch = (uint8_t *)heap_caps_malloc(scratchSize, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+                if (!m_workers[i].scratch)
+                {
+                    freeScratch();
+                    return false;
+                }
+            }
+
+            m_running = true;
+            for (int i = 1; i < m_workerCount; i++)
+            {
+                Worker &worker = m_workers[i];
+                if (!worker.start)
+                    worker.start = xSemaphoreCreateBinary();
+                if (!worker.start || xTaskCreatePinnedToCore(workerTask, "Strip", 3072, &worker, m_priority, &worker.handle, m_core) != pdPASS)
+                {
+                    stop();
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        void stop()
+        {
+            if (!m_running)
+                return;
+
+            xSemaphoreTake(m_lock, portMAX_DELAY);
+            m_running = false;
+            for (int i = 1; i < m_workerCount; i++)
+            {
+                if (m_workers[i].handle)
+                    xSemaphoreGive(m_workers[i].start);
+            }
+
+            unsigned long startWait = millis();
+            for (int i = 1; i < m_workerCount; i++)
+            {
+                while (m_workers[i].handle != NULL && millis() - startWait < 2000)
+                {
+                    vTaskDelay(10);
+                }
+            }
+            freeScratch();
+            m_workerCount = 1;
+            xSemaphoreGive(m_lock);
+        }
+
+        bool isRunning()
+        {
+            return m_running;
+        }
+
+        int getWorkerCount()
+        {
+            return m_workerCount;
+        }
+
+        // runs `kernel` over `rows` rows and returns once every band is done. Band edges fall on multiples of
+        // `align` rows, e.g. 8 or 16 for JPEG MCU rows. Calls from several tasks are serialized
+        bool run(StripKernel kernel, void *ctx, int rows, int align = 1)
+        {
+            if (!m_running || rows <= 0)
+                return false;
+
+            xSemaphoreTake(m_lock, portMAX_DELAY);
+            int64_t start = esp_timer_get_time();
+            m_kernel = kernel;
+            m_ctx = ctx;
+
+            align = align < 1 ? 1 : align;
+            int units = (rows + align - 1) / align;
+            int workers = units < m_workerCount ? units : m_workerCount;
+            int row = 0;
+            for (int i = workers - 1; i >= 0; i--)
+            {
+                // the caller's band is last, it also absorbs the remainder
+                int share = units / workers + (i == 0 ? units % workers : 0);
+                m_workers[i].rowStart = row;
+                row += share * align;
+                m_workers[i].rowEnd = row < rows ? row : rows;
+            }
+            for (int i = 1; i < workers; i++)
+            {
+                xSemaphoreGive(m_workers[i].start);
+            }
+
+            kernel(ctx, m_workers[0].rowStart, m_workers[0].rowEnd, m_workers[0].scratch, m_scratchSize);
+
+            int64_t joinStart = esp_timer_get_time();
+            for (int i = 1; i < workers; i++)
+            {
+                xSemaphoreTake(m_done, portMAX_DELAY);
+            }
+            int64_t now = esp_timer_get_time();
+            m_lastJoinUs = (uint32_t)(now - joinStart);
+            m_lastRunUs = (uint32_t)(now - start);
+            m_runs++;
+            xSemaphoreGive(m_lock);
+            return true;
+        }
+
+        uint32_t getRuns()
+        {
+            return m_runs;
+        }
+
+        uint32_t getLastRunUs()
+        {
+            return m_lastRunUs;
+        }
+
+        // time the caller spent waiting for the helper after its own band, high when the split is uneven
+        uint32_t getLastJoinUs()
+        {
+            return m_lastJoinUs;
+        }
+    };
+
+    // conversions of big endian RGB565 frames, as the sensor sends them. `ctx` is a PixelJob
+    struct PixelJob
+    {
+        const uint8_t *src;
+        uint8_t *dst;
+        uint16_t width;
+    };
+
+    class PixelKernels
+    {
+    private:
+        // the source row, copied to the worker's scratch when it fits
+        static const uint8_t *sourceRow(const PixelJob *job, int row, uint8_t *scratch, size_t scratchSize)
+        {
+            const uint8_t *src = job->src + (size_t)row * job->width * 2;
+            if (scratchSize < (size_t)job->width * 2)
+                return src;
+            memcpy(scratch, src, (size_t)job->width * 2);
+            return scratch;
+        }
+
+    public:
+        // one byte per pixel, JFIF luma weights
+        static void rgb565ToGray(void *ctx, int rowStart, int rowEnd, uint8_t *scratch, size_t scratchSize)
+        {
+            const PixelJob *job = static_cast<const PixelJob *>(ctx);
+            for (int row = rowStart; row < rowEnd; row++)
+            {
+                const uint8_t *src = sourceRow(job, row, scratch, scratchSize);
+                uint8_t *dst = job->dst + (size_t)row * job->width;
+                for (int x = 0; x < job->width; x++)
+                {
+                    uint16_t p = (src[x * 2] << 8) | src[x * 2 + 1];
+                    int r = (p >> 8) & 0xF8;
+                    int g = (p >> 3) & 0xFC;
+                    int b = (p << 3) & 0xF8;
+                    // widened like rgb565ToRgb888, so white is 255 and not 249
+                    r |= r >> 5;
+                    g |= g >> 6;
+                    b |= b >> 5;
+                    dst[x] = (77 * r + 150 * g + 29 * b + 128) >> 8;
+                }
+            }
+        }
+
+        // three bytes per pixel in the BGR order fmt2jpg and JpegEncoder expect for RGB888
+        static void rgb565ToRgb888(void *ctx, int rowStart, int rowEnd, uint8_t *scratch, size_t scratchSize)
+        {
+            const PixelJob *job = static_cast<const PixelJob *>(ctx);
+            for (int row = rowStart; row < rowEnd; row++)
+            {
+                const uint8_t *src = sourceRow(job, row, scratch, scratchSize);
+                uint8_t *dst = job->dst + (size_t)row * job->width * 3;
+                for (int x = 0; x < job->width; x++)
+                {
+                    uint16_t p = (src[x * 2] << 8) | src[x * 2 + 1];
+                    uint8_t r = (p >> 8) & 0xF8;
+                    uint8_t g = (p >> 3) & 0xFC;
+                    uint8_t b = (p << 3) & 0xF8;
+                    // replicate the top bits so full scale stays 255
+                    *dst++ = b | (b >> 5);
+                    *dst++ = g | (g >> 6);
+                    *dst++ = r | (r >> 5);
+                }
+            }
+        }
+    };
+}
+#endif
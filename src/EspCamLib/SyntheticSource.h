@@ -0,0 +1,252 @@
+#ifndef ESPCAMLIB_SYNTHETICSOURCE_H
+#define ESPCAMLIB_SYNTHETICSOURCE_H
+#include <Arduino.h>
+#include <sys/time.h>
+#include "esp_camera.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+
+#include "Camera.h"
+
+// fake sensor that produces frames at a fixed rate with a configurable JPEG size distribution,
+// used to load test streaming and recording without a camera module attached
+namespace EspCam
+{
+    class SyntheticSource : public FrameSource
+    {
+    public:
+        static const int MAX_BUFFERS = 4;
+
+    private:
+        const camera_config_t *m_config = nullptr;
+        camera_fb_t m_fbs[MAX_BUFFERS];
+        size_t m_capacity[MAX_BUFFERS];
+        bool m_inUse[MAX_BUFFERS];
+        int m_bufferCount = 2;
+        SemaphoreHandle_t m_free = NULL;
+        portMUX_TYPE m_mux = portMUX_INITIALIZER_UNLOCKED;
+        int m_frameRate = 25;
+        size_t m_meanSize = 0;
+        int m_spread = 20;
+        int64_t m_nextFrame = 0;
+        uint32_t m_frameCount = 0;
+
+        // rough JPEG size for the configured resolution and quality when no explicit size is set
+        size_t estimateSize(size_t width, size_t height)
+        {
+            if (m_meanSize)
+                return m_meanSize;
+            int quality = m_config->jpeg_quality > 0 ? m_config->jpeg_quality : 1;
+            return (width * height * 6) / (5 * quality);
+        }
+
+        size_t pickSize(size_t mean)
+        {
+            // sum of three uniforms approximates a normal distribution centered on the mean
+            int32_t r = (int32_t)(esp_random() % 2001) + (int32_t)(esp_random() % 2001) + (int32_t)(esp_random() % 2001) - 3000;
+            int64_t size = (int64_t)mean + ((int64_t)mean * m_spread * r) / (100 * 3000);
+            if (size < 64)
+                size = 64;
+            return (size_t)size;
+        }
+
+        bool reserve(int index, size_t len)
+        {
+            if (m_capacity[index] >= len)
+                return true;
+
+            uint8_t *buf = (uint8_t *)(psramFound() ? ps_realloc(m_fbs[index].buf, len) : realloc(m_fbs[index].buf, len));
+            if (!buf)
+                return false;
+
+            m_fbs[index].buf = buf;
+            m_capacity[index] = len;
+            return true;
+        }
+
+        // SOI, COM segments as filler and EOI, so the payload has the exact requested size and still parses as JPEG markers
+        void fillJpeg(uint8_t *buf, size_t len)
+        {
+            size_t pos = 0;
+            buf[pos++] = 0xFF;
+            buf[pos++] = 0xD8;
+
+            size_t remaining = len - 4;
+            while (remaining > 0)
+            {
+                size_t segment = remaining > 65537 ? 65537 : remaining;
+                if (remaining - segment > 0 && remaining - segment < 4)
+                    segment -= 4;
+
+                size_t segLen = segment - 2;
+                buf[pos++] = 0xFF;
+                buf[pos++] = 0xFE;
+                buf[pos++] = segLen >> 8;
+                buf[pos++] = segLen & 0xFF;
+                memset(buf + pos, (uint8_t)m_frameCount, segLen - 2);
+                pos += segLen - 2;
+                remaining -= segment;
+            }
+
+            buf[pos++] = 0xFF;
+            buf[pos++] = 0xD9;
+        }
+
+        void fillRaw(uint8_t *buf, size_t len)
+        {
+            for (size_t i = 0; i < len; i++)
+            {
+                buf[i] = (uint8_t)(i + m_frameCount);
+            }
+        }
+
+        void waitForFrameTime()
+        {
+            int64_t now = esp_timer_get_time();
+            if (m_nextFrame > now)
+            {
+                vTaskDelay(pdMS_TO_TICKS((m_nextFrame - now) / 1000) + 1);
+                now = esp_timer_get_time();
+            }
+
+            int64_t interval = 1000000 / (m_frameRate > 0 ? m_frameRate : 1);
+            // a late consumer gets the next frame right away instead of a burst of catch-up frames
+            m_nextFrame = m_nextFrame + interval < now ? now + interval : m_nextFrame + interval;
+        }
+
+    public:
+        SyntheticSource(int fps = 25) : m_frameRate(fps)
+        {
+            memset(m_fbs, 0, sizeof(m_fbs));
+            memset(m_capacity, 0, sizeof(m_capacity));
+            memset(m_inUse, 0, sizeof(m_inUse));
+        }
+
+        ~SyntheticSource()
+        {
+            for (int i = 0; i < MAX_BUFFERS; i++)
+            {
+                free(m_fbs[i].buf);
+            }
+            if (m_free)
+            {
+                vSemaphoreDelete(m_free);
+            }
+        }
+
+        void setFrameRate(int fps)
+        {
+            m_frameRate = fps;
+        }
+
+        // mean JPEG size in bytes (0 derives it from frame size and quality) and spread in percent of the mean
+        void setJpegSize(size_t meanBytes, int spreadPercent = 20)
+        {
+            m_meanSize = meanBytes;
+            m_spread = spreadPercent;
+        }
+
+        uint32_t getFrameCount()
+        {
+            return m_frameCount;
+        }
+
+        bool begin(const camera_config_t *config) override
+        {
+            m_config = config;
+            m_bufferCount = config->fb_count;
+            if (m_bufferCount < 1)
+                m_bufferCount = 1;
+            if (m_bufferCount > MAX_BUFFERS)
+                m_bufferCount = MAX_BUFFERS;
+
+            if (!m_free)
+            {
+                m_free = xSemaphoreCreateCounting(m_bufferCount, m_bufferCount);
+            }
+            m_nextFrame = esp_timer_get_time();
+            return m_free != NULL;
+        }
+
+        camera_fb_t *get() override
+        {
+            if (!m_free || xSemaphoreTake(m_free, pdMS_TO_TICKS(4000)) != pdTRUE)
+                return nullptr;
+
+            int index = -1;
+            portENTER_CRITICAL(&m_mux);
+            for (int i = 0; i < m_bufferCount; i++)
+            {
+                if (!m_inUse[i])
+                {
+                    m_inUse[i] = true;
+                    index = i;
+                    break;
+                }
+            }
+            portEXIT_CRITICAL(&m_mux);
+
+            waitForFrameTime();
+
+            camera_fb_t *fb = &m_fbs[index];
+            framesize_t frameSize = m_config->frame_size;
+            pixformat_t format = m_config->pixel_format;
+            fb->width = resolution[frameSize].width;
+            fb->height = resolution[frameSize].height;
+            fb->format = format;
+
+            size_t len;
+            switch (format)
+            {
+            case PIXFORMAT_JPEG:
+                len = pickSize(estimateSize(fb->width, fb->height));
+                break;
+            case PIXFORMAT_GRAYSCALE:
+                len = fb->width * fb->height;
+                break;
+            case PIXFORMAT_RGB888:
+                len = fb->width * fb->height * 3;
+                break;
+            default:
+                len = fb->width * fb->height * 2;
+                break;
+            }
+
+            if (!reserve(index, len))
+            {
+                release(fb);
+                return nullptr;
+            }
+
+            fb->len = len;
+            m_frameCount++;
+            if (format == PIXFORMAT_JPEG)
+                fillJpeg(fb->buf, len);
+            else
+                fillRaw(fb->buf, len);
+            // same clock as the esp_camera driver, esp_timer time split into a timeval
+            int64_t now = esp_timer_get_time();
+            fb->timestamp.tv_sec = now / 1000000;
+            fb->timestamp.tv_usec = now % 1000000;
+            return fb;
+        }
+
+        void release(camera_fb_t *fb) override
+        {
+            int index = fb - m_fbs;
+            if (index < 0 || index >= MAX_BUFFERS)
+                return;
+
+            portENTER_CRITICAL(&m_mux);
+            bool wasInUse = m_inUse[index];
+            m_inUse[index] = false;
+            portEXIT_CRITICAL(&m_mux);
+
+            if (wasInUse)
+            {
+                xSemaphoreGive(m_free);
+            }
+        }
+    };
+}
+#endif
@@ -0,0 +1,218 @@
+#ifndef ESPCAMLIB_THUMBNAILER_H
+#define ESPCAMLIB_THUMBNAILER_H
+#include <Arduino.h>
+#include "esp_camera.h"
+#include "esp_timer.h"
+#include "img_converters.h"
+
+#include "FrameBroker.h"
+#include "JpegDc.h"
+
+// 1/8 scale preview built from the JPEG DC coefficients and re-encoded at low quality,
+// the result is kept until a newer frame shows up so any number of pollers cost one conversion
+namespace EspCam
+{
+    class Thumbnailer
+    {
+    private:
+        FrameBroker *m_broker;
+        JpegDcDecoder m_decoder;
+        SemaphoreHandle_t m_lock = NULL;
+        uint8_t m_quality = 60;
+        uint32_t m_maxAgeMs = 500;
+
+        uint8_t *m_pixels = nullptr;
+        size_t m_pixelsCapacity = 0;
+        uint8_t *m_jpeg = nullptr;
+        size_t m_jpegLen = 0;
+        uint32_t m_sequence = 0;
+        uint16_t m_width = 0;
+        uint16_t m_height = 0;
+        uint32_t m_conversions = 0;
+        uint32_t m_lastConversionUs = 0;
+
+        static uint8_t clamp(int v)
+        {
+            return v < 0 ? 0 : (v > 255 ? 255 : v);
+        }
+
+        // DC maps to packed pixels, chroma is sampled once per MCU so it is spread over the luma blocks it covers
+        bool buildPixels(uint16_t width, uint16_t height)
+        {
+            int comps = m_decoder.getComponentCount();
+            size_t size = (size_t)width * height * (comps == 1 ? 1 : 3);
+            if (size > m_pixelsCapacity)
+            {
+                uint8_t *pixels = (uint8_t *)realloc(m_pixels, size);
+                if (!pixels)
+                    return false;
+                m_pixels = pixels;
+                m_pixelsCapacity = size;
+            }
+
+            const uint8_t *luma = m_decoder.getMap(0);
+            uint16_t lumaStride = m_decoder.getMapWidth(0);
+            if (comps == 1)
+            {
+                for (int y = 0; y < height; y++)
+                {
+                    memcpy(m_pixels + (size_t)y * width, luma + (size_t)y * lumaStride, width);
+                }
+                return true;
+            }
+
+            const JpegDcDecoder::Component &yc = m_decoder.getComponent(0);
+            const JpegDcDecoder::Component &cbc = m_decoder.getComponent(1);
+            const JpegDcDecoder::Component &crc = m_decoder.getComponent(2);
+            const uint8_t *cbMap = m_decoder.getMap(1);
+            const uint8_t *crMap = m_decoder.getMap(2);
+            uint16_t cbStride = m_decoder.getMapWidth(1);
+            uint16_t crStride = m_decoder.getMapWidth(2);
+
+            uint8_t *out = m_pixels;
+            for (int y = 0; y < height; y++)
+            {
+                const uint8_t *lumaRow = luma + (size_t)y * lumaStride;
+                const uint8_t *cbRow = cbMap + (size_t)(y * cbc.v / yc.v) * cbStride;
+                const uint8_t *crRow = crMap + (size_t)(y * crc.v / yc.v) * crStride;
+                for (int x = 0; x < width; x++)
+                {
+                    int l = lumaRow[x];
+                    int cb = cbRow[x * cbc.h / yc.h] - 128;
+                    int cr = crRow[x * crc.h / yc.h] - 128;
+                    // JFIF YCbCr to RGB in 8.8 fixed point, stored in the BGR order fmt2jpg expects for RGB888
+                    *out++ = clamp(l + ((454 * cb) >> 8));
+                    *out++ = clamp(l - ((88 * cb + 183 * cr) >> 8));
+                    *out++ = clamp(l + ((359 * cr) >> 8));
+                }
+            }
+            return true;
+        }
+
+        bool convert(const FrameRef &frame)
+        {
+            int64_t start = esp_timer_get_time();
+            // raw frames come out of the broker's encoder
+            if (!frame.length() || !m_decoder.decode(frame.data(), frame.length()))
+                return false;
+
+            // blocks past the image edge are padding, only keep the ones with real pixels in them
+            uint16_t width = (m_decoder.getWidth() + 7) / 8;
+            uint16_t height = (m_decoder.getHeight() + 7) / 8;
+            if (width > m_decoder.getMapWidth(0))
+                width = m_decoder.getMapWidth(0);
+            if (height > m_decoder.getMapHeight(0))
+                height = m_decoder.getMapHeight(0);
+            if (!buildPixels(width, height))
+                return false;
+
+            bool gray = m_decoder.getComponentCount() == 1;
+            uint8_t *jpeg = nullptr;
+            size_t jpegLen = 0;
+            if (!fmt2jpg(m_pixels, (size_t)width * height * (gray ? 1 : 3), width, height,
+                         gray ? PIXFORMAT_GRAYSCALE : PIXFORMAT_RGB888, m_quality, &jpeg, &jpegLen))
+                return false;
+
+            free(m_jpeg);
+            m_jpeg = jpeg;
+            m_jpegLen = jpegLen;
+            m_width = width;
+            m_height = height;
+            m_sequence = frame.sequence();
+            m_conversions++;
+            m_lastConversionUs = esp_timer_get_time() - start;
+            return true;
+        }
+
+    public:
+        Thumbnailer(FrameBroker *broker) : m_broker(broker) {}
+
+        ~Thumbnailer()
+        {
+            free(m_pixels);
+            free(m_jpeg);
+            if (m_lock)
+            {
+                vSemaphoreDelete(m_lock);
+            }
+        }
+
+        bool begin()
+        {
+            if (!m_lock)
+            {
+                m_lock = xSemaphoreCreateMutex();
+            }
+            return m_lock != NULL;
+        }
+
+        // jpeg quality of the preview, 1..100
+        void setQuality(uint8_t quality)
+        {
+            m_quality = quality;
+        }
+
+        // a cached frame older than this is replaced by a fresh capture, the broker only captures while someone waits
+        void setMaxAge(uint32_t ms)
+        {
+            m_maxAgeMs = ms;
+        }
+
+        // holds the lock until release() so the cached jpeg can be sent without copying it
+        bool acquire(const uint8_t *&data, size_t &len, TickType_t timeout = pdMS_TO_TICKS(2000))
+        {
+            if (!m_lock)
+                return false;
+
+            FrameRef frame = m_broker->recent(m_maxAgeMs, timeout);
+
+            xSemaphoreTake(m_lock, portMAX_DELAY);
+            bool ok = m_jpeg != nullptr;
+            if (frame && frame.sequence() != m_sequence)
+            {
+                ok = convert(frame) || ok;
+            }
+            frame.reset();
+
+            if (!ok)
+            {
+                xSemaphoreGive(m_lock);
+                return false;
+            }
+            data = m_jpeg;
+            len = m_jpegLen;
+            return true;
+        }
+
+        void release()
+        {
+            xSemaphoreGive(m_lock);
+        }
+
+        uint32_t getSequence()
+        {
+            return m_sequence;
+        }
+
+        uint16_t getWidth()
+        {
+            return m_width;
+        }
+
+        uint16_t getHeight()
+        {
+            return m_height;
+        }
+
+        uint32_t getConversions()
+        {
+            return m_conversions;
+        }
+
+        uint32_t getLastConversionUs()
+        {
+            return m_lastConversionUs;
+        }
+    };
+}
+#endif
@@ -2,146 +2,747 @@
 #define ESPCAMLIB_WEBSERVER_H
 #include <Arduino.h>
 #include <WiFi.h>
+#include <stdarg.h>
+#include <time.h>
 #include "esp_camera.h"
 #include "esp_http_server.h"
+#include "esp_timer.h"
+#include "esp32/rom/miniz.h"
 
 #include "Camera.h"
+#include "Control.h"
+#include "FrameBroker.h"
+#include "Multipart.h"
+#include "RateController.h"
+#include "StreamBroadcaster.h"
+#include "Thumbnailer.h"
 #include "WebServer/Index.h"
 
 // http server with user interactivity and a separate stream endpoint
 namespace EspCam
 {   
-    class WebServer
+    class WebServer : public StreamObserver
     {
     private:
         int m_port;
         Camera* m_camera;
         httpd_handle_t camera_httpd = NULL;
         httpd_handle_t stream_httpd = NULL;
-        volatile size_t m_bytes_per_sec = 0;
+        static const size_t STATUS_MAX = 1024;
+
+        // double buffered /status payload, only touched by the sampler task outside of m_statusLock.
+        // Handlers send from the front buffer without the lock, the readers count keeps it from being reused
+        char m_status[2][STATUS_MAX];
+        size_t m_statusLen[2] = {2, 2};
+        int m_statusReaders[2] = {0, 0};
+        volatile int m_statusFront = 0;
+        SemaphoreHandle_t m_statusLock = NULL;
+        TaskHandle_t m_statusHandle = NULL;
+        volatile bool m_statusRunning = false;
+        uint32_t m_statusIntervalMs = 1000;
+        MetricsRate m_statusRate;
+        bool m_broadcast = false;
+        bool m_websocket = false;
+        uint8_t m_thumbQuality = 60;
+        uint32_t m_snapshotMaxAgeMs = 500;
+        StreamBroadcaster* m_broadcaster = NULL;
+        Thumbnailer* m_thumbnailer = NULL;
+        RateController m_rate;
+        SemaphoreHandle_t m_rateLock = NULL;
+
+        static void noopFree(void *ctx) { }
+
+        // runs on the stream httpd task right before a socket is closed
+        static void closeHandler(httpd_handle_t hd, int sockfd) {
+            WebServer* instance = static_cast<WebServer*>(httpd_get_global_user_ctx(hd));
+            // removeClient() notifies the observer, which is this server, for its own clients
+            bool removed = instance && instance->m_broadcaster && instance->m_broadcaster->removeClient(sockfd);
+            if (instance && !removed) {
+                instance->onClientRemoved(sockfd);
+            }
+            close(sockfd);
+        }
+
+        // true when header `name` is present and contains `token`
+        static bool headerContains(httpd_req_t *req, const char *name, const char *token) {
+            char value[96];
+            if (httpd_req_get_hdr_value_str(req, name, value, sizeof(value)) != ESP_OK) {
+                return false;
+            }
+            return strstr(value, token) != NULL;
+        }
+
+        // inflates the embedded page for the rare client without gzip support, the decompressor
+        // state is too big for the httpd stack so it goes on the heap together with the page
+        static esp_err_t sendIdentityIndex(httpd_req_t *req) {
+            tinfl_decompressor* inflator = (tinfl_decompressor*)malloc(sizeof(tinfl_decompressor));
+            uint8_t* html = (uint8_t*)malloc(INDEX_HTML_LENGTH);
+            esp_err_t res = ESP_FAIL;
+            if (inflator && html) {
+                tinfl_init(inflator);
+                // skip the 10 byte gzip header and the 8 byte crc/size trailer around the deflate stream
+                size_t inLen = INDEX_HTML_GZ_LENGTH - 18;
+                size_t outLen = INDEX_HTML_LENGTH;
+                tinfl_status status = tinfl_decompress(inflator, INDEX_HTML_GZ + 10, &inLen, html, html, &outLen,
+                                                       TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF);
+                if (status == TINFL_STATUS_DONE && outLen == INDEX_HTML_LENGTH) {
+                    res = httpd_resp_send(req, (const char*)html, outLen);
+                }
+            }
+            free(inflator);
+            free(html);
+            if (res != ESP_OK) {
+                httpd_resp_send_500(req);
+            }
+            return res;
+        }
 
         static esp_err_t indexHandler(httpd_req_t *req) {
+            httpd_resp_set_hdr(req, "ETag", INDEX_HTML_ETAG);
+            httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+            httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+
+            if (headerContains(req, "If-None-Match", INDEX_HTML_ETAG)) {
+                httpd_resp_set_status(req, "304 Not Modified");
+                return httpd_resp_send(req, NULL, 0);
+            }
+
             httpd_resp_set_type(req, "text/html");
-            return httpd_resp_send(req, INDEX_HTML, INDEX_HTML_LENGTH);
+            if (!headerContains(req, "Accept-Encoding", "gzip")) {
+                return sendIdentityIndex(req);
+            }
+            httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+            return httpd_resp_send(req, (const char*)INDEX_HTML_GZ, INDEX_HTML_GZ_LENGTH);
         }
 
-        static esp_err_t statusHandler(httpd_req_t *req) {
-            WebServer* instance = static_cast<WebServer*>(req->user_ctx);
-            if (!instance) return ESP_FAIL;
+        // appends to a fixed buffer, a payload that does not fit is cut short and the sample is dropped
+        static void appendf(char* out, size_t cap, size_t& pos, const char* fmt, ...) {
+            if (pos >= cap) {
+                return;
+            }
+            va_list args;
+            va_start(args, fmt);
+            int n = vsnprintf(out + pos, cap - pos, fmt, args);
+            va_end(args);
+            pos = n < 0 ? cap : pos + n;
+        }
+
+        // `key` as a JSON string of at most 31 characters, it comes straight from the query so quotes,
+        // backslashes and control characters are escaped
+        static void appendKey(char* out, size_t cap, size_t& pos, const char* key) {
+            appendf(out, cap, pos, "\"");
+            for (int i = 0; i < 31 && key[i]; i++) {
+                uint8_t c = key[i];
+                if (c == '"' || c == '\\') {
+                    appendf(out, cap, pos, "\\%c", c);
+                }
+                else if (c < 0x20) {
+                    appendf(out, cap, pos, "\\u%04x", c);
+                }
+                else {
+                    appendf(out, cap, pos, "%c", c);
+                }
+            }
+            appendf(out, cap, pos, "\"");
+        }
+
+        size_t formatStatus(char* out, size_t cap) {
+            m_statusRate.update(m_camera->getBroker()->getMetrics()->snapshot());
+            float kbps = (m_statusRate.getBytesPerSec() * 8.0f) / 1024.0f;
+            IPAddress ip = WiFi.localIP();
+
+            size_t pos = 0;
+            appendf(out, cap, pos, "{\"heap\":%u,\"rssi\":%d,\"kbps\":%.1f,\"ip\":\"%u.%u.%u.%u\"",
+                    (unsigned)(ESP.getFreeHeap() + ESP.getFreePsram()), (int)WiFi.RSSI(), kbps,
+                    ip[0], ip[1], ip[2], ip[3]);
+            if (m_broadcaster) {
+                StreamClientStats clients[StreamBroadcaster::MAX_CLIENTS];
+                int count = m_broadcaster->getClientStats(clients, StreamBroadcaster::MAX_CLIENTS);
+                appendf(out, cap, pos, ",\"clients\":[");
+                for (int i = 0; i < count; i++) {
+                    appendf(out, cap, pos, "%s{\"fps\":%.1f,\"sent\":%u,\"dropped\":%u}", i > 0 ? "," : "",
+                            clients[i].fps, (unsigned)clients[i].framesSent, (unsigned)clients[i].framesDropped);
+                }
+                appendf(out, cap, pos, "]");
+            }
+            CameraRegion roi = m_camera->getRegionOfInterest();
+            if (roi.active) {
+                appendf(out, cap, pos, ",\"roi\":{\"x\":%u,\"y\":%u,\"w\":%u,\"h\":%u,\"size\":%d}",
+                        roi.x, roi.y, roi.width, roi.height, (int)roi.output);
+            }
+            if (m_rateLock) {
+                RateControlState rate = getRateState();
+                appendf(out, cap, pos, ",\"abr\":{\"enabled\":%s,\"level\":%d,\"maxLevel\":%d,\"quality\":%d,"
+                        "\"framesize\":%d,\"fps\":%.1f,\"capacity\":%.1f,\"sendUs\":%u}",
+                        rate.enabled ? "true" : "false", rate.level, rate.maxLevel, rate.quality,
+                        rate.frameSize, rate.fps, rate.capacityFps, (unsigned)rate.avgSendUs);
+            }
+            appendf(out, cap, pos, "}");
+            return pos < cap ? pos : 0;
+        }
 
-            float kbps = (instance->m_bytes_per_sec * 8.0f) / 1024.0f;
-            instance->m_bytes_per_sec = 0; 
+        // builds the next payload off to the side and only takes the lock to swap it in
+        static void statusTask(void *param) {
+            WebServer* self = static_cast<WebServer*>(param);
+            while (self->m_statusRunning) {
+                int back = self->m_statusFront ^ 1;
+                // a slow client may still be sending the previous sample, nobody starts on the back buffer
+                xSemaphoreTake(self->m_statusLock, portMAX_DELAY);
+                bool busy = self->m_statusReaders[back] > 0;
+                xSemaphoreGive(self->m_statusLock);
+                if (busy) {
+                    vTaskDelay(pdMS_TO_TICKS(10));
+                    continue;
+                }
+                size_t len = self->formatStatus(self->m_status[back], STATUS_MAX);
+                if (len) {
+                    xSemaphoreTake(self->m_statusLock, portMAX_DELAY);
+                    self->m_statusLen[back] = len;
+                    self->m_statusFront = back;
+                    xSemaphoreGive(self->m_statusLock);
+                }
+                ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(self->m_statusIntervalMs));
+            }
+            self->m_statusHandle = NULL;
+            vTaskDelete(NULL);
+        }
 
-            String json = "{";
-            json += "\"heap\":" + String(ESP.getFreeHeap()+ESP.getFreePsram()) + ",";
-            json += "\"rssi\":" + String(WiFi.RSSI()) + ",";
-            json += "\"kbps\":" + String(kbps, 1) + ",";
-            json += "\"ip\":\"" + WiFi.localIP().toString() + "\""; 
-            json += "}";
+        // serves the last sample, every poller shares the work of one sampling pass
+        static esp_err_t statusHandler(httpd_req_t *req) {
+            WebServer* instance = static_cast<WebServer*>(req->user_ctx);
+            if (!instance || !instance->m_statusLock) return ESP_FAIL;
 
             httpd_resp_set_type(req, "application/json");
             httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
-            return httpd_resp_send(req, json.c_str(), json.length());
+            httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+
+            // the lock only covers picking the buffer, so a client slow to take the response holds up neither
+            // the sampler's swap nor the other pollers
+            xSemaphoreTake(instance->m_statusLock, portMAX_DELAY);
+            int front = instance->m_statusFront;
+            const char* data = instance->m_status[front];
+            size_t len = instance->m_statusLen[front];
+            instance->m_statusReaders[front]++;
+            xSemaphoreGive(instance->m_statusLock);
+
+            esp_err_t res = httpd_resp_send(req, data, len);
+
+            xSemaphoreTake(instance->m_statusLock, portMAX_DELAY);
+            instance->m_statusReaders[front]--;
+            xSemaphoreGive(instance->m_statusLock);
+            return res;
+        }
+
+        // applies every key=value pair of `params` in order and writes a per-key result object to `out`
+        size_t applyControls(char* params, char* out, size_t cap, bool& reboot) {
+            size_t pos = 0;
+            bool rebase = false;
+            uint32_t ticket = 0;
+            // the old single setting form, ?var=<key>&val=<value>
+            char var[32];
+            char val[16];
+            bool legacy = httpd_query_key_value(params, "var", var, sizeof(var)) == ESP_OK &&
+                          httpd_query_key_value(params, "val", val, sizeof(val)) == ESP_OK;
+
+            appendf(out, cap, pos, "{");
+            char* next = params;
+            while (next && *next) {
+                char* pair = next;
+                next = strchr(pair, '&');
+                if (next) {
+                    *next++ = 0;
+                }
+                char* value = strchr(pair, '=');
+                if (value) {
+                    *value++ = 0;
+                }
+
+                const char* key = pair;
+                if (legacy) {
+                    key = var;
+                    value = val;
+                    next = NULL;
+                }
+                if (!*key) {
+                    continue;
+                }
+
+                ControlResult result;
+                if (strcmp(key, "reboot") == 0) {
+                    reboot = true;
+                    result = CONTROL_OK;
+                }
+                else {
+                    result = CameraControl::apply(m_camera, key, value ? atoi(value) : 1, ticket);
+                    if (result == CONTROL_OK && (strcmp(key, "framesize") == 0 || strcmp(key, "quality") == 0 ||
+                                                 strncmp(key, "roi", 3) == 0 || strcmp(key, "zoom") == 0)) {
+                        rebase = true;
+                    }
+                }
+                appendf(out, cap, pos, "%s", pos > 1 ? "," : "");
+                appendKey(out, cap, pos, key);
+                appendf(out, cap, pos, ":\"%s\"", CameraControl::resultName(result));
+            }
+            appendf(out, cap, pos, "}");
+
+            if (rebase) {
+                rebaseRate();
+            }
+            // answer once the frames show the new settings, so a snapshot right after is not stale
+            m_camera->waitForSensor(ticket);
+            return pos < cap ? pos : 0;
         }
 
+        // GET /control?brightness=1&contrast=-1&... or the same pairs as a form encoded POST body
         static esp_err_t controlHandler(httpd_req_t *req) {
             WebServer* instance = static_cast<WebServer*>(req->user_ctx);
-            
-            char buf[128];
-            size_t buf_len = httpd_req_get_url_query_len(req) + 1;
-            
-            if (buf_len > 1 && buf_len < 128) {
-                if (httpd_req_get_url_query_str(req, buf, buf_len) == ESP_OK) {
-                    char var[32] = {0,};
-                    char val[32] = {0,};
-
-                    if (httpd_query_key_value(buf, "var", var, sizeof(var)) == ESP_OK &&
-                        httpd_query_key_value(buf, "val", val, sizeof(val)) == ESP_OK) {
-                        
-                        String cmd = String(var);
-                        int value = atoi(val);
-                    
-                        if (cmd == "flash") {
-                            instance->m_camera->setFlash(value);
-                        }
-                        else if (cmd == "vflip") {
-                            bool isFlipped = instance->m_camera->getVFlip();
-                            instance->m_camera->setVFlip(!isFlipped);
-                        }
-                        else if (cmd == "hmirror") {
-                            bool isMirrored = instance->m_camera->getHFlip();
-                            instance->m_camera->setHFlip(!isMirrored);
-                        }
-                        else if (cmd == "framesize") {
-                            instance->m_camera->setFrameSize((framesize_t)value);
-                        }
-                        else if (cmd == "quality") {
-                            instance->m_camera->setJPEGQuality(value);
-                        }
-                        else if (cmd == "reboot") {
-                            ESP.restart();
-                        }
+            if (!instance) return ESP_FAIL;
+
+            char params[512];
+            size_t len = 0;
+            if (req->method == HTTP_POST) {
+                if (req->content_len >= sizeof(params)) {
+                    httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Body too long");
+                    return ESP_FAIL;
+                }
+                while (len < req->content_len) {
+                    int received = httpd_req_recv(req, params + len, req->content_len - len);
+                    if (received <= 0) {
+                        return ESP_FAIL;
                     }
+                    len += received;
                 }
+                params[len] = 0;
+            }
+            else if (httpd_req_get_url_query_str(req, params, sizeof(params)) != ESP_OK) {
+                params[0] = 0;
+            }
+
+            char result[512];
+            bool reboot = false;
+            size_t resultLen = instance->applyControls(params, result, sizeof(result), reboot);
+            if (!resultLen) {
+                memcpy(result, "{}", 2);
+                resultLen = 2;
+            }
+
+            httpd_resp_set_type(req, "application/json");
+            httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+            esp_err_t res = httpd_resp_send(req, result, resultLen);
+            if (reboot) {
+                // let the response leave before restarting
+                vTaskDelay(pdMS_TO_TICKS(100));
+                ESP.restart();
+            }
+            return res;
+        }
+
+        static esp_err_t latencyHandler(httpd_req_t *req) {
+            WebServer* instance = static_cast<WebServer*>(req->user_ctx);
+            if (!instance) return ESP_FAIL;
+
+            PipelineLatency* latency = instance->m_camera->getBroker()->getLatency();
+            char query[32];
+            char reset[8];
+            bool clear = httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+                         httpd_query_key_value(query, "reset", reset, sizeof(reset)) == ESP_OK && atoi(reset);
+
+            // fixed size output, 7 stages of at most ~110 bytes each
+            char json[1024];
+            int pos = snprintf(json, sizeof(json), "{\"unit\":\"us\"");
+            for (int i = 0; i < PipelineLatency::STAGE_COUNT; i++) {
+                LatencySummary stage = latency->summarize((PipelineLatency::Stage)i);
+                pos += snprintf(json + pos, sizeof(json) - pos,
+                                ",\"%s\":{\"count\":%u,\"p50\":%u,\"p95\":%u,\"p99\":%u,\"max\":%u}",
+                                PipelineLatency::stageName(i), (unsigned)stage.count, (unsigned)stage.p50,
+                                (unsigned)stage.p95, (unsigned)stage.p99, (unsigned)stage.max);
+            }
+            pos += snprintf(json + pos, sizeof(json) - pos, "}");
+            if (clear) {
+                latency->reset();
             }
-            
+
+            httpd_resp_set_type(req, "application/json");
             httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
-            return httpd_resp_send(req, "OK", 2);
+            return httpd_resp_send(req, json, pos);
         }
 
-        static esp_err_t streamHandler(httpd_req_t *req) {
+        static esp_err_t metricsHandler(httpd_req_t *req) {
             WebServer* instance = static_cast<WebServer*>(req->user_ctx);
-            if (!instance) {
+            if (!instance) return ESP_FAIL;
+
+            MetricsSnapshot m = instance->m_camera->getBroker()->getMetrics()->snapshot();
+            char text[1536];
+            int len = snprintf(text, sizeof(text),
+                "# TYPE espcam_frames_captured_total counter\n"
+                "espcam_frames_captured_total %u\n"
+                "# TYPE espcam_frames_sent_total counter\n"
+                "espcam_frames_sent_total %u\n"
+                "# TYPE espcam_frames_dropped_total counter\n"
+                "espcam_frames_dropped_total{consumer=\"stream\"} %u\n"
+                "espcam_frames_dropped_total{consumer=\"recorder\"} %u\n"
+                "# TYPE espcam_recorder_frames_total counter\n"
+                "espcam_recorder_frames_total %u\n"
+                "# TYPE espcam_bytes_sent_total counter\n"
+                "espcam_bytes_sent_total %llu\n"
+                "# TYPE espcam_sd_bytes_written_total counter\n"
+                "espcam_sd_bytes_written_total %llu\n"
+                "# TYPE espcam_stream_clients gauge\n"
+                "espcam_stream_clients %d\n"
+                "# TYPE espcam_heap_free_bytes gauge\n"
+                "espcam_heap_free_bytes %u\n"
+                "# TYPE espcam_psram_free_bytes gauge\n"
+                "espcam_psram_free_bytes %u\n"
+                "# TYPE espcam_wifi_rssi_dbm gauge\n"
+                "espcam_wifi_rssi_dbm %d\n"
+                "# TYPE espcam_uptime_seconds counter\n"
+                "espcam_uptime_seconds %llu\n",
+                (unsigned)m.framesCaptured, (unsigned)m.framesSent,
+                (unsigned)m.streamFramesDropped, (unsigned)m.recorderFramesDropped,
+                (unsigned)m.recorderFrames,
+                (unsigned long long)m.bytesSent, (unsigned long long)m.sdBytesWritten,
+                (int)m.streamClients,
+                (unsigned)ESP.getFreeHeap(), (unsigned)ESP.getFreePsram(),
+                (int)WiFi.RSSI(),
+                (unsigned long long)(m.timestamp / 1000000));
+
+            httpd_resp_set_type(req, "text/plain; version=0.0.4");
+            return httpd_resp_send(req, text, len);
+        }
+
+        // serves the newest brokered frame while holding a reference on it, so snapshots taken while
+        // anything else is capturing never trigger a capture of their own. ?fresh=1 waits for the next frame
+        static esp_err_t captureHandler(httpd_req_t *req) {
+            WebServer* instance = static_cast<WebServer*>(req->user_ctx);
+            if (!instance) return ESP_FAIL;
+
+            FrameBroker* broker = instance->m_camera->getBroker();
+            char query[32];
+            char fresh[8];
+            bool waitNext = httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+                            httpd_query_key_value(query, "fresh", fresh, sizeof(fresh)) == ESP_OK && atoi(fresh);
+
+            FrameRef frame = waitNext ? broker->acquire(broker->sequence(), pdMS_TO_TICKS(2000))
+                                      : broker->recent(instance->m_snapshotMaxAgeMs);
+            if (!frame || !frame.length()) {
+                httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "No frame");
                 return ESP_FAIL;
             }
 
-            httpd_resp_set_type(req, "multipart/x-mixed-replace; boundary=frame");
+            char seq[12];
+            char timestamp[24];
+            snprintf(seq, sizeof(seq), "%u", (unsigned)frame.sequence());
+            snprintf(timestamp, sizeof(timestamp), "%lld", (long long)frame.timestamp());
+            httpd_resp_set_type(req, "image/jpeg");
+            httpd_resp_set_hdr(req, "Content-Disposition", "inline; filename=capture.jpg");
+            httpd_resp_set_hdr(req, "Cache-Control", "no-store");
             httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+            httpd_resp_set_hdr(req, "X-Frame-Sequence", seq);
+            httpd_resp_set_hdr(req, "X-Timestamp", timestamp);
 
-            while (true) {
-                camera_fb_t *pic = instance->m_camera->getFrame();
-                if (!pic) {
+            // wall clock time of the capture, only once the clock was set (e.g. by SNTP)
+            char lastModified[32];
+            time_t now = time(NULL);
+            if (now > 1577836800) {
+                time_t captured = now - (esp_timer_get_time() - frame.timestamp()) / 1000000;
+                struct tm tm;
+                gmtime_r(&captured, &tm);
+                strftime(lastModified, sizeof(lastModified), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+                httpd_resp_set_hdr(req, "Last-Modified", lastModified);
+            }
+
+            esp_err_t res = httpd_resp_send(req, (const char*)frame.data(), frame.length());
+            broker->getMetrics()->addBytesSent(frame.length());
+            return res;
+        }
+
+        static esp_err_t thumbHandler(httpd_req_t *req) {
+            WebServer* instance = static_cast<WebServer*>(req->user_ctx);
+            if (!instance || !instance->m_thumbnailer) {
+                return ESP_FAIL;
+            }
+
+            const uint8_t* jpeg;
+            size_t len;
+            if (!instance->m_thumbnailer->acquire(jpeg, len)) {
+                httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "No frame");
+                return ESP_FAIL;
+            }
+
+            char seq[12];
+            snprintf(seq, sizeof(seq), "%u", (unsigned)instance->m_thumbnailer->getSequence());
+            httpd_resp_set_type(req, "image/jpeg");
+            httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+            httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+            httpd_resp_set_hdr(req, "X-Frame-Sequence", seq);
+            esp_err_t res = httpd_resp_send(req, (const char*)jpeg, len);
+            instance->m_thumbnailer->release();
+            instance->m_camera->getBroker()->getMetrics()->addBytesSent(len);
+            return res;
+        }
+
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+        // frames go out as binary messages from the broadcaster, this only handles the handshake and acks.
+        // httpd answers pings and close frames itself
+        static esp_err_t wsHandler(httpd_req_t *req) {
+            WebServer* instance = static_cast<WebServer*>(req->user_ctx);
+            if (!instance || !instance->m_broadcaster) {
+                return ESP_FAIL;
+            }
+
+            int fd = httpd_req_to_sockfd(req);
+            if (req->method == HTTP_GET) {
+                return instance->m_broadcaster->addClient(fd, true) ? ESP_OK : ESP_FAIL;
+            }
+
+            uint8_t payload[16];
+            httpd_ws_frame_t frame;
+            memset(&frame, 0, sizeof(frame));
+            if (httpd_ws_recv_frame(req, &frame, 0) != ESP_OK) {
+                return ESP_FAIL;
+            }
+            if (frame.len > sizeof(payload)) {
+                // not an ack, read it anyway so the next frame starts at a frame boundary
+                uint8_t* discard = (uint8_t*)malloc(frame.len);
+                if (!discard) {
                     return ESP_FAIL;
                 }
+                frame.payload = discard;
+                esp_err_t res = httpd_ws_recv_frame(req, &frame, frame.len);
+                free(discard);
+                return res;
+            }
+
+            frame.payload = payload;
+            if (frame.len && httpd_ws_recv_frame(req, &frame, frame.len) != ESP_OK) {
+                return ESP_FAIL;
+            }
+            if (frame.type == HTTPD_WS_TYPE_BINARY || frame.type == HTTPD_WS_TYPE_TEXT) {
+                uint32_t seq = WebSocketFraming::parseAck(payload, frame.len, frame.type == HTTPD_WS_TYPE_BINARY);
+                instance->m_broadcaster->ack(fd, seq);
+            }
+            return ESP_OK;
+        }
+#endif
+
+        static esp_err_t streamHandler(httpd_req_t *req) {
+            WebServer* instance = static_cast<WebServer*>(req->user_ctx);
+            if (!instance) {
+                return ESP_FAIL;
+            }
+
+            MultipartWriter writer(req);
+            if (writer.begin(req) != ESP_OK) {
+                return ESP_FAIL;
+            }
+
+            // hand the socket to the broadcaster and free this httpd worker right away
+            if (instance->m_broadcast && instance->m_broadcaster) {
+                return instance->m_broadcaster->addClient(writer.getSocket()) ? ESP_OK : ESP_FAIL;
+            }
+
+            FrameBroker* broker = instance->m_camera->getBroker();
+            PipelineLatency* latency = broker->getLatency();
+            Metrics* metrics = broker->getMetrics();
+            uint32_t lastSeq = 0;
+            metrics->streamClientOpened();
 
-                String partHeader = "--frame\r\nContent-Type: image/jpeg\r\nContent-Length: " + String(pic->len) + "\r\n\r\n";
-                esp_err_t res = httpd_resp_send_chunk(req, partHeader.c_str(), partHeader.length());
-                
-                if (res == ESP_OK) {
-                    res = httpd_resp_send_chunk(req, (const char *)pic->buf, pic->len);
+            while (true) {
+                FrameRef pic = broker->acquire(lastSeq, pdMS_TO_TICKS(5000));
+                if (!pic) {
+                    break;
                 }
-                
-                if (res == ESP_OK) {
-                    httpd_resp_send_chunk(req, "\r\n", 2);
+                // frames published while this client was still writing never reach it
+                if (lastSeq && pic.sequence() > lastSeq + 1) {
+                    metrics->addStreamDropped(pic.sequence() - lastSeq - 1);
                 }
-
-                if (res == ESP_OK) {
-                    instance->m_bytes_per_sec += pic->len;
+                lastSeq = pic.sequence();
+                if (!pic.length()) {
+                    continue;
                 }
 
-                instance->m_camera->releaseFrame(pic);
-                
-                if (res != ESP_OK) {
+                int64_t start = esp_timer_get_time();
+                int64_t firstByte = 0;
+                latency->recordSince(PipelineLatency::DEQUEUE, pic.timestamp(), start);
+                if (writer.writeFrame(pic.data(), pic.length(), &firstByte) != ESP_OK) {
                     break;
                 }
+                // blocking writes, the first byte has left once the socket took the first chunk
+                int64_t now = esp_timer_get_time();
+                latency->recordSince(PipelineLatency::FIRST_BYTE, pic.timestamp(), firstByte);
+                latency->recordSince(PipelineLatency::LAST_BYTE, pic.timestamp(), now);
+                metrics->addFrameSent();
+                metrics->addBytesSent(pic.length());
+                instance->onFrameSent(writer.getSocket(), pic.length(), (uint32_t)(now - start));
+                instance->onStreamTick(now);
             }
+            metrics->streamClientClosed();
 
-            return ESP_OK;
+            // the response is close delimited, failing makes httpd drop the socket
+            return ESP_FAIL;
+        }
+
+        // the camera settings at the time become the best the controller goes back to
+        void rebaseRate() {
+            if (!m_rateLock) {
+                return;
+            }
+            xSemaphoreTake(m_rateLock, portMAX_DELAY);
+            m_rate.setBase(m_camera->getJpegQuality(), m_camera->getFrameSize());
+            if (m_rate.isEnabled()) {
+                m_rate.reset();
+                applyRate();
+            }
+            xSemaphoreGive(m_rateLock);
+        }
+
+        void applyRate() {
+            int quality = m_rate.getQuality();
+            framesize_t frameSize = (framesize_t)m_rate.getFrameSize();
+            sensor_t *s = esp_camera_sensor_get();
+            if (!s) {
+                return;
+            }
+            // sensor only, so the camera config keeps the user's settings as the base
+            if (s->status.framesize != frameSize) {
+                m_camera->setSensor(SENSOR_FRAMESIZE, frameSize);
+            }
+            if (s->status.quality != quality) {
+                m_camera->setSensor(SENSOR_QUALITY, quality);
+            }
         }
 
     public:
-        WebServer(Camera* camera, int port = 80) : m_camera(camera), m_port(port) { }
+        WebServer(Camera* camera, int port = 80) : m_camera(camera), m_port(port) {
+            memcpy(m_status[0], "{}", 2);
+            memcpy(m_status[1], "{}", 2);
+        }
+
+        void onFrameSent(int fd, size_t bytes, uint32_t sendUs) override {
+            if (!m_rateLock) {
+                return;
+            }
+            xSemaphoreTake(m_rateLock, portMAX_DELAY);
+            m_rate.onFrameSent(fd, bytes, sendUs);
+            xSemaphoreGive(m_rateLock);
+        }
+
+        void onStreamTick(int64_t nowUs) override {
+            if (!m_rateLock) {
+                return;
+            }
+            xSemaphoreTake(m_rateLock, portMAX_DELAY);
+            if (m_rate.update(nowUs)) {
+                applyRate();
+            }
+            xSemaphoreGive(m_rateLock);
+        }
+
+        void onClientRemoved(int fd) override {
+            if (!m_rateLock) {
+                return;
+            }
+            xSemaphoreTake(m_rateLock, portMAX_DELAY);
+            m_rate.removeClient(fd);
+            xSemaphoreGive(m_rateLock);
+        }
+
+        // steps jpeg quality (and frame size down to `minFrameSize`) so the slowest viewer keeps `targetFps`
+        void setAdaptiveRate(bool enable, float targetFps = 15, framesize_t minFrameSize = FRAMESIZE_QVGA) {
+            if (m_rateLock) {
+                xSemaphoreTake(m_rateLock, portMAX_DELAY);
+            }
+            m_rate.setTargetFps(targetFps);
+            m_rate.setMinFrameSize(minFrameSize);
+            m_rate.setBase(m_camera->getJpegQuality(), m_camera->getFrameSize());
+            bool wasEnabled = m_rate.isEnabled();
+            m_rate.setEnabled(enable);
+            if (wasEnabled && !enable) {
+                applyRate();
+            }
+            if (m_rateLock) {
+                xSemaphoreGive(m_rateLock);
+            }
+        }
+
+        // for tuning the ladder and hysteresis, lock-free so only change it before begin()
+        RateController* getRateController() {
+            return &m_rate;
+        }
+
+        RateControlState getRateState() {
+            if (!m_rateLock) {
+                return m_rate.getState();
+            }
+            xSemaphoreTake(m_rateLock, portMAX_DELAY);
+            RateControlState state = m_rate.getState();
+            xSemaphoreGive(m_rateLock);
+            return state;
+        }
+
+        // how often the /status payload is sampled, polls in between get the cached copy
+        void setStatusInterval(uint32_t ms) {
+            m_statusIntervalMs = ms;
+        }
+
+        // one task pushes frames to every viewer instead of one httpd worker per viewer, call before begin()
+        void setBroadcast(bool enable) {
+            m_broadcast = enable;
+        }
+
+        // binary WebSocket stream on /ws of the stream port, see WebSocketFraming for the message layout.
+        // Shares the broadcaster task with setBroadcast(), call before begin()
+        void setWebSocket(bool enable) {
+            m_websocket = enable;
+        }
+
+        // /capture serves a cached frame up to this old before capturing a new one
+        void setSnapshotMaxAge(uint32_t ms) {
+            m_snapshotMaxAgeMs = ms;
+        }
+
+        // jpeg quality of the 1/8 scale /thumb preview
+        void setThumbnailQuality(uint8_t quality) {
+            m_thumbQuality = quality;
+            if (m_thumbnailer) {
+                m_thumbnailer->setQuality(quality);
+            }
+        }
+
+        int getStreamClientStats(StreamClientStats* out, int max) {
+            return m_broadcaster ? m_broadcaster->getClientStats(out, max) : 0;
+        }
 
         bool begin(int port = 80) {
             m_port = port;
+            // raw formats are encoded by the broker
             pixformat_t format = m_camera->getPixelFormat();
-            if (format != PIXFORMAT_JPEG) {
+            if (format != PIXFORMAT_JPEG && !JpegEncoder::supports(format)) {
+                return false;
+            }
+
+            if (!m_camera->getBroker()->begin()) {
                 return false;
             }
 
+            if (!m_rateLock) {
+                m_rateLock = xSemaphoreCreateMutex();
+                if (!m_rateLock) {
+                    return false;
+                }
+                m_rate.setBase(m_camera->getJpegQuality(), m_camera->getFrameSize());
+            }
+
+            if (!m_thumbnailer) {
+                m_thumbnailer = new Thumbnailer(m_camera->getBroker());
+                m_thumbnailer->setQuality(m_thumbQuality);
+                m_thumbnailer->begin();
+            }
+
             httpd_config_t config = HTTPD_DEFAULT_CONFIG();
             config.server_port = m_port;
             config.ctrl_port = m_port;
+            config.max_uri_handlers = 16;
 
             httpd_uri_t indexUri = {
                 .uri       = "/",
@@ -164,14 +765,57 @@ namespace EspCam
                 .user_ctx  = this
             };
 
+            httpd_uri_t controlPostUri = {
+                .uri       = "/control",
+                .method    = HTTP_POST,
+                .handler   = controlHandler,
+                .user_ctx  = this
+            };
+
+            httpd_uri_t latencyUri = {
+                .uri       = "/latency",
+                .method    = HTTP_GET,
+                .handler   = latencyHandler,
+                .user_ctx  = this
+            };
+
+            httpd_uri_t metricsUri = {
+                .uri       = "/metrics",
+                .method    = HTTP_GET,
+                .handler   = metricsHandler,
+                .user_ctx  = this
+            };
+
+            httpd_uri_t captureUri = {
+                .uri       = "/capture",
+                .method    = HTTP_GET,
+                .handler   = captureHandler,
+                .user_ctx  = this
+            };
+
+            httpd_uri_t thumbUri = {
+                .uri       = "/thumb",
+                .method    = HTTP_GET,
+                .handler   = thumbHandler,
+                .user_ctx  = this
+            };
+
             if (httpd_start(&camera_httpd, &config) == ESP_OK) {
                 httpd_register_uri_handler(camera_httpd, &indexUri);
                 httpd_register_uri_handler(camera_httpd, &statusUri);
                 httpd_register_uri_handler(camera_httpd, &controlUri);
+                httpd_register_uri_handler(camera_httpd, &controlPostUri);
+                httpd_register_uri_handler(camera_httpd, &thumbUri);
+                httpd_register_uri_handler(camera_httpd, &captureUri);
+                httpd_register_uri_handler(camera_httpd, &latencyUri);
+                httpd_register_uri_handler(camera_httpd, &metricsUri);
             }
 
             config.server_port = m_port + 1;
             config.ctrl_port = m_port + 1;
+            config.global_user_ctx = this;
+            config.global_user_ctx_free_fn = noopFree;
+            config.close_fn = closeHandler;
 
             httpd_uri_t streamUri = {
                 .uri       = "/stream",
@@ -182,18 +826,65 @@ namespace EspCam
 
             if (httpd_start(&stream_httpd, &config) == ESP_OK) {
                 httpd_register_uri_handler(stream_httpd, &streamUri);
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+                if (m_websocket) {
+                    httpd_uri_t wsUri = {
+                        .uri       = "/ws",
+                        .method    = HTTP_GET,
+                        .handler   = wsHandler,
+                        .user_ctx  = this,
+                        .is_websocket = true
+                    };
+                    httpd_register_uri_handler(stream_httpd, &wsUri);
+                }
+#endif
+                if (m_broadcast || m_websocket) {
+                    m_broadcaster = new StreamBroadcaster(m_camera->getBroker());
+                    m_broadcaster->setObserver(this);
+                    m_broadcaster->begin(stream_httpd);
+                }
+            }
+
+            if (!m_statusLock) {
+                m_statusLock = xSemaphoreCreateMutex();
+            }
+            if (m_statusLock && !m_statusRunning) {
+                m_statusRunning = true;
+                if (xTaskCreatePinnedToCore(statusTask, "Status", 4096, this, 2, &m_statusHandle, 0) != pdPASS) {
+                    m_statusRunning = false;
+                }
             }
 
             return (camera_httpd != NULL && stream_httpd != NULL);
         }
 
         ~WebServer() {
+            if (m_statusRunning) {
+                m_statusRunning = false;
+                xTaskNotifyGive(m_statusHandle);
+                unsigned long startWait = millis();
+                while (m_statusHandle != NULL && millis() - startWait < 2000) {
+                    vTaskDelay(10);
+                }
+            }
             if (camera_httpd) {
                 httpd_stop(camera_httpd);
             }
             if (stream_httpd) {
                 httpd_stop(stream_httpd);
             }
+            if (m_broadcaster) {
+                delete m_broadcaster;
+            }
+            if (m_thumbnailer) {
+                delete m_thumbnailer;
+            }
+            if (m_rateLock) {
+                vSemaphoreDelete(m_rateLock);
+            }
+            if (m_statusLock) {
+                vSemaphoreDelete(m_statusLock);
+            }
         }
     };
 };
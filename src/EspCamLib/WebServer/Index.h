@@ -1,388 +1,231 @@
 #ifndef WEB_INDEX_H
 #define WEB_INDEX_H
 
-const char INDEX_HTML[] PROGMEM = R"rawliteral(
-<!DOCTYPE html>
-<html lang="en">
-<head>
-    <meta charset="UTF-8">
-    <title>EspCamLib WebServer</title>
-    <style>
-        :root {
-            --bg: #000000;
-            --panel: #1a1a1a;
-            --border: #333;
-            --text-main: #e0e0e0;
-            --text-dim: #888;
-            --accent: #0f0;
-            --alert: #f00;
-            --warn: #fa0;
-        }
-
-        body {
-            background: var(--bg);
-            color: var(--text-main);
-            font-family: Consolas, Monaco, monospace;
-            font-size: 13px;
-            margin: 0;
-            height: 100vh;
-            display: grid;
-            grid-template-rows: 40px 1fr 150px;
-            overflow: hidden;
-        }
-
-        header {
-            background: var(--panel);
-            border-bottom: 1px solid var(--border);
-            display: flex;
-            align-items: center;
-            padding: 0 15px;
-            justify-content: space-between;
-        }
-
-        .brand { font-size: 16px; font-weight: 600; color: #fff; letter-spacing: 1px; }
-        
-        .status-badge { 
-            background: #333; color: #aaa; padding: 4px 8px; 
-            border-radius: 2px; font-size: 11px; font-weight: bold; 
-        }
-        .status-badge.online { background: var(--accent); color: #000; }
-
-        .workspace {
-            display: grid;
-            grid-template-columns: 1fr 320px;
-            overflow: hidden;
-        }
-
-        .viewport {
-            background: #050505;
-            display: flex;
-            justify-content: center;
-            align-items: center;
-            padding: 20px;
-            overflow: hidden;
-        }
-
-        .stream-box {
-            width: 100%;
-            max-width: 1280px;
-            aspect-ratio: 16 / 9;
-            background: #080808;
-            border: 1px solid var(--border);
-            position: relative;
-            display: flex;
-            justify-content: center;
-            align-items: center;
-            box-shadow: 0 0 20px rgba(0,0,0,0.5);
-        }
-        
-        #cam-stream {
-            width: 100%;
-            height: 100%;
-            object-fit: contain;
-            display: block;
-        }
-
-        .overlay-data {
-            position: absolute;
-            top: 15px;
-            left: 15px;
-            display: flex;
-            flex-direction: column;
-            gap: 5px;
-            pointer-events: none;
-        }
-        
-        .overlay-tag {
-            background: rgba(0, 0, 0, 0.7);
-            padding: 4px 8px;
-            border-left: 2px solid var(--accent);
-            font-size: 11px;
-            backdrop-filter: blur(4px);
-        }
-
-        aside {
-            background: var(--bg);
-            border-left: 1px solid var(--border);
-            padding: 15px;
-            display: flex;
-            flex-direction: column;
-            gap: 20px;
-            overflow-y: auto;
-        }
-
-        .panel-box { border: 1px solid var(--border); padding: 10px; }
-        .panel-header { 
-            color: var(--text-dim); text-transform: uppercase; font-size: 11px; 
-            margin-bottom: 10px; border-bottom: 1px solid #222; padding-bottom: 5px; 
-            display: flex; justify-content: space-between;
-        }
-
-        .data-row { display: flex; justify-content: space-between; margin-bottom: 6px; }
-        .data-val { color: var(--accent); font-weight: bold; }
-
-        .control-group { margin-bottom: 15px; }
-        .control-label { display: block; margin-bottom: 8px; color: var(--text-dim); }
-        
-        input[type="range"] {
-            width: 100%;
-            height: 4px;
-            background: #333;
-            outline: none;
-            -webkit-appearance: none;
-        }
-        input[type="range"]::-webkit-slider-thumb {
-            -webkit-appearance: none;
-            width: 14px; height: 14px; background: var(--text-main);
-            border-radius: 50%; cursor: pointer; border: 2px solid #000;
-        }
-
-        select {
-            width: 100%;
-            background: #222;
-            color: #e0e0e0;
-            border: 1px solid #444;
-            padding: 5px;
-            font-family: inherit;
-        }
-
-        button {
-            background: #222; border: 1px solid #444; color: #fff;
-            width: 100%; padding: 10px; cursor: pointer;
-            font-family: inherit; margin-bottom: 5px;
-            transition: all 0.2s;
-        }
-        button:hover { background: #333; border-color: #666; }
-        button:active { background: var(--accent); color: #000; }
-        button.danger { border-color: #500; color: #f55; }
-        button.danger:hover { background: #500; color: #fff; }
-
-        #log-panel {
-            background: #000;
-            border-top: 1px solid var(--border);
-            padding: 10px;
-            font-family: 'Courier New', Courier, monospace;
-            overflow-y: auto;
-            display: flex;
-            flex-direction: column-reverse;
-        }
-        .log-line { margin: 2px 0; border-bottom: 1px solid #111; padding-bottom: 2px;}
-        .log-time { color: var(--text-dim); margin-right: 10px; }
-        .log-msg.err { color: var(--alert); }
-        .log-msg.ok { color: var(--accent); }
-    </style>
-</head>
-<body>
-
-<header>
-    <div class="brand">EspCamLib</div>
-    <div id="status-badge" class="status-badge">DISCONNECTED</div>
-</header>
-
-<div class="workspace">
-    <div class="viewport">
-        <div class="stream-box">
-            <img id="cam-stream" src="">
-            <div class="overlay-data">
-                <div class="overlay-tag" id="osd-res">RES: --</div>
-                <div class="overlay-tag" id="osd-fps">FPS: --</div>
-            </div>
-        </div>
-    </div>
-
-    <aside>
-        <div class="panel-box">
-            <div class="panel-header">Performance Metrics</div>
-            <div class="data-row"><span>RAM Usage</span> <span class="data-val" id="val-ram">--</span></div>
-            <div class="data-row"><span>Latency</span> <span class="data-val" id="val-ping">--</span></div>
-            <div class="data-row"><span>Bitrate</span> <span class="data-val" id="val-bitrate">--</span></div>
-            <div class="data-row"><span>WiFi Signal</span> <span class="data-val" id="val-rssi">--</span></div>
-        </div>
-
-        <div class="panel-box">
-            <div class="panel-header">Image Settings</div>
-            
-            <div class="control-group">
-                <span class="control-label">Resolution</span>
-                <select id="res-select" onchange="updateResolution(this.value)">
-                    <option value="0">96x96</option>
-                    <option value="1">QQVGA (160x120)</option>
-                    <option value="3">HQVGA (240x176)</option>
-                    <option value="5">QVGA (320x240)</option>
-                    <option value="6">CIF (400x296)</option>
-                    <option value="7">HVGA (480x320)</option>
-                    <option value="8" selected>VGA (640x480)</option>
-                    <option value="9">SVGA (800x600)</option>
-                    <option value="10">XGA (1024x768)</option>
-                    <option value="11">HD (1280x720)</option>
-                    <option value="12">SXGA (1280x1024)</option>
-                    <option value="13">UXGA (1600x1200)</option>
-                </select>
-            </div>
-
-            <div class="control-group">
-                <span class="control-label">JPEG Quality (Lower is better)</span>
-                <input type="range" min="10" max="63" value="12" id="quality-slider" oninput="updateQualityDebounced(this.value)">
-                <div style="text-align: right; color: #888; font-size: 10px;" id="quality-val-disp">12</div>
-            </div>
-        </div>
-
-        <div class="panel-box">
-            <div class="panel-header">Hardware Controls</div>
-            
-            <div class="control-group">
-                <span class="control-label">Flash Intensity</span>
-                <input type="range" min="0" max="255" value="0" id="flash-slider" oninput="updateFlashDebounced(this.value)">
-            </div>
-
-            <button onclick="sendCommand('hmirror')">Flip X</button>
-            <button onclick="sendCommand('vflip')">Flip Y</button>
-            <button class="danger" onclick="sendCommand('reboot')">Reboot</button>
-        </div>
-    </aside>
-</div>
-
-<div id="log-panel">
-    <div class="log-line"><span class="log-time">System</span> <span class="log-msg">Interface ready.</span></div>
-</div>
-
-<script>
-    const CONFIG = {
-        streamPort: 81,
-        apiPort: 80,
-        interval: 1000
-    };
-
-    const ui = {
-        badge: document.getElementById('status-badge'),
-        stream: document.getElementById('cam-stream'),
-        ram: document.getElementById('val-ram'),
-        ping: document.getElementById('val-ping'),
-        rssi: document.getElementById('val-rssi'),
-        bitrate: document.getElementById('val-bitrate'),
-        osdRes: document.getElementById('osd-res'),
-        osdFps: document.getElementById('osd-fps'),
-        logs: document.getElementById('log-panel'),
-        qualDisp: document.getElementById('quality-val-disp')
-    };
-
-    let baseUrl = window.location.hostname;
-    if (!baseUrl) baseUrl = "192.168.1.100"; 
-    
-    ui.stream.src = `http://${baseUrl}:${CONFIG.streamPort}/stream`;
-
-    let frameCount = 0;
-    let lastFrameTime = Date.now();
-    let currentFps = 0;
-    let flashTimeout = null;
-    let qualityTimeout = null;
-
-    ui.stream.onload = () => {
-        frameCount++;
-        const now = Date.now();
-        if (now - lastFrameTime >= 1000) {
-            currentFps = frameCount;
-            frameCount = 0;
-            lastFrameTime = now;
-            updateStreamStats();
-        }
-    };
-
-    function updateStreamStats() {
-        ui.osdFps.innerText = `FPS: ${currentFps}`;
-        if (ui.stream.naturalWidth) {
-            ui.osdRes.innerText = `RES: ${ui.stream.naturalWidth}x${ui.stream.naturalHeight}`;
-        }
-    }
-
-    function addLog(msg, type = 'info') {
-        const time = new Date().toLocaleTimeString();
-        const line = document.createElement('div');
-        line.className = 'log-line';
-        line.innerHTML = `<span class="log-time">${time}</span> <span class="log-msg ${type}">${msg}</span>`;
-        ui.logs.prepend(line);
-        if (ui.logs.children.length > 50) ui.logs.lastElementChild.remove();
-    }
-
-    function updateFlashDebounced(val) {
-        if (flashTimeout) clearTimeout(flashTimeout);
-        flashTimeout = setTimeout(() => {
-            updateControl('flash', val);
-        }, 150);
-    }
-
-    function updateQualityDebounced(val) {
-        ui.qualDisp.innerText = val;
-        if (qualityTimeout) clearTimeout(qualityTimeout);
-        qualityTimeout = setTimeout(() => {
-            updateControl('quality', val);
-        }, 300);
-    }
-
-    function updateResolution(val) {
-        updateControl('framesize', val);
-    }
-
-    async function updateControl(variable, val) {
-        try {
-            val = parseInt(val);
-            await fetch(`http://${baseUrl}:${CONFIG.apiPort}/control?var=${variable}&val=${val}`);
-            addLog(`Set ${variable} to ${val}`, 'info');
-        } catch (e) {
-            console.error(e);
-            addLog(`Failed to set ${variable}`, 'err');
-        }
-    }
-
-    async function sendCommand(cmd) {
-        addLog(`Sending command: ${cmd}...`);
-        try {
-            await fetch(`http://${baseUrl}:${CONFIG.apiPort}/control?var=${cmd}&val=1`);
-            addLog(`Command ${cmd} executed`, 'ok');
-        } catch (e) {
-            addLog(`Command ${cmd} failed`, 'err');
-        }
-    }
-
-    async function fetchTelemetry() {
-        const start = performance.now();
-        try {
-            const controller = new AbortController();
-            setTimeout(() => controller.abort(), 2000);
-
-            const res = await fetch(`http://${baseUrl}:${CONFIG.apiPort}/status`, { signal: controller.signal });
-            const latency = Math.round(performance.now() - start);
-            
-            if (res.ok) {
-                const data = await res.json();
-                
-                ui.badge.innerText = "ONLINE";
-                ui.badge.className = "status-badge online";
-                
-                ui.ping.innerText = latency + " ms";
-                ui.ram.innerText = data.heap ? Math.round(data.heap / 1024) + " KB" : "N/A";
-                ui.rssi.innerText = data.rssi ? data.rssi + " dBm" : "N/A";
-                
-                if (data.kbps) ui.bitrate.innerText = data.kbps + " kbps";
-                else ui.bitrate.innerText = "N/A"; 
-
-            } else {
-                throw new Error("API Error");
-            }
-        } catch (e) {
-            ui.badge.innerText = "OFFLINE";
-            ui.badge.className = "status-badge";
-            ui.ping.innerText = "--";
-        }
-    }
-
-    setInterval(fetchTelemetry, CONFIG.interval);
-    addLog("Dashboard initialized");
-</script>
-</body>
-</html>
-)rawliteral";
-
-const size_t INDEX_HTML_LENGTH = sizeof(INDEX_HTML) - 1;
-
-#endif
\ No newline at end of file
+// generated from Index.html by tools/embed_index.py, do not edit by hand
+
+const uint8_t INDEX_HTML_GZ[] PROGMEM = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xbd, 0x1b, 0x6b, 0x73, 0xdb, 0x36,
+    0xf2, 0x7b, 0x7e, 0x05, 0x4a, 0xe7, 0x46, 0xd2, 0xd4, 0xa2, 0x1e, 0xb6, 0x15, 0x47, 0xb6, 0x74,
+    0x93, 0xf8, 0xd1, 0xf8, 0x2e, 0x49, 0xd3, 0x3a, 0xbd, 0xb6, 0x73, 0x73, 0x33, 0x81, 0x48, 0x48,
+    0x42, 0x4d, 0x11, 0x3c, 0x10, 0xb2, 0xec, 0x7a, 0xf4, 0xdf, 0x6f, 0x17, 0x24, 0x45, 0x10, 0x24,
+    0x65, 0x29, 0xd7, 0x56, 0xca, 0x24, 0x14, 0x81, 0x7d, 0x2f, 0xf6, 0x45, 0xe6, 0xfc, 0x9b, 0xcb,
+    0xef, 0x2f, 0x3e, 0xff, 0xfa, 0xe9, 0x8a, 0xcc, 0xd5, 0x22, 0x18, 0xbf, 0x38, 0xc7, 0x7f, 0x48,
+    0x40, 0xc3, 0xd9, 0xc8, 0x61, 0xa1, 0x83, 0x37, 0x18, 0xf5, 0xc7, 0x2f, 0x08, 0x7c, 0xce, 0x17,
+    0x4c, 0x51, 0xe2, 0xcd, 0xa9, 0x8c, 0x99, 0x1a, 0x39, 0x3f, 0x7d, 0xbe, 0x6e, 0x9f, 0x3a, 0xe9,
+    0x92, 0xe2, 0x2a, 0x60, 0xe3, 0xab, 0x38, 0xba, 0xa0, 0x8b, 0xf7, 0x7c, 0x42, 0x7e, 0x66, 0x93,
+    0x5b, 0x26, 0xef, 0x99, 0x3c, 0xef, 0x24, 0x4b, 0xc9, 0xb6, 0x58, 0x3d, 0x66, 0xd7, 0xf8, 0x19,
+    0x4a, 0x21, 0x14, 0x79, 0xda, 0xfc, 0xc6, 0x4f, 0xbb, 0x3d, 0x99, 0x0d, 0xc9, 0x41, 0x57, 0x7f,
+    0xce, 0xac, 0xa5, 0x88, 0x86, 0x2c, 0x80, 0xd5, 0x1e, 0xc5, 0xaf, 0xbd, 0x3a, 0x11, 0xd2, 0x67,
+    0x12, 0x96, 0x8f, 0x8e, 0x8e, 0xec, 0x35, 0xc5, 0x1e, 0x54, 0x7b, 0x41, 0x79, 0x08, 0xcb, 0xac,
+    0x8b, 0xdf, 0xca, 0x1d, 0x3e, 0x5f, 0xc0, 0x86, 0xd3, 0xd3, 0x53, 0x7b, 0x95, 0x7a, 0x1e, 0x0b,
+    0x15, 0x32, 0x36, 0x2d, 0x41, 0xd2, 0x80, 0x49, 0x5c, 0x9a, 0x96, 0x19, 0x5e, 0x51, 0x89, 0x14,
+    0xa7, 0xd4, 0x58, 0x59, 0xbf, 0xd8, 0x5c, 0x4e, 0x84, 0xff, 0x68, 0xc9, 0x3f, 0xa1, 0xde, 0xdd,
+    0x4c, 0x8a, 0x65, 0xe8, 0x0f, 0xc9, 0x3d, 0x95, 0x4d, 0xd4, 0x47, 0xab, 0x88, 0xd6, 0x13, 0x81,
+    0x90, 0xd9, 0xea, 0x46, 0x30, 0x6b, 0xd3, 0x54, 0x84, 0xaa, 0x3d, 0xa5, 0x0b, 0x1e, 0x3c, 0x0e,
+    0xc9, 0x85, 0x08, 0x63, 0x11, 0xd0, 0xf8, 0x90, 0x7c, 0x10, 0x21, 0xf5, 0xc4, 0x21, 0x59, 0x88,
+    0x50, 0xc4, 0x11, 0xf5, 0x58, 0x05, 0x54, 0xcc, 0x7f, 0x67, 0x43, 0xd2, 0x3b, 0x8a, 0x1e, 0x8a,
+    0x8b, 0x0b, 0x2a, 0x67, 0xa8, 0x40, 0x4b, 0xca, 0x39, 0xe3, 0xb3, 0x39, 0xc8, 0xdf, 0xeb, 0x76,
+    0xef, 0xe7, 0xc5, 0x25, 0x9f, 0xc7, 0x51, 0x40, 0x81, 0x81, 0x99, 0xe4, 0x7e, 0x71, 0x09, 0xef,
+    0x00, 0xf3, 0x0b, 0x58, 0x57, 0xac, 0x2d, 0xc5, 0x2a, 0x1e, 0x92, 0xe3, 0x6e, 0xf4, 0x40, 0x7a,
+    0x53, 0x49, 0x7a, 0x27, 0x5d, 0x9b, 0xb8, 0x00, 0x67, 0x9a, 0x06, 0x62, 0x35, 0x24, 0x73, 0xee,
+    0xfb, 0x2c, 0xac, 0xd4, 0x27, 0x3a, 0x2b, 0x93, 0xcf, 0x6a, 0x54, 0xbb, 0x91, 0xa5, 0xaf, 0xc4,
+    0x79, 0xc0, 0x87, 0x94, 0x12, 0xe0, 0x03, 0x3d, 0xe0, 0x04, 0x54, 0xc6, 0xfd, 0xcc, 0x08, 0x7a,
+    0xb9, 0x55, 0x23, 0xde, 0x34, 0x60, 0x16, 0xbb, 0x34, 0xe0, 0xb3, 0xb0, 0xcd, 0x41, 0x40, 0x90,
+    0x0b, 0x5d, 0x87, 0xc9, 0xe2, 0x86, 0x88, 0xfa, 0x3e, 0x0f, 0xc1, 0xd5, 0xbb, 0x20, 0xad, 0x2d,
+    0xec, 0x6f, 0xcb, 0x58, 0xf1, 0xe9, 0x63, 0xdb, 0x03, 0x73, 0x68, 0xb7, 0xd3, 0xa6, 0x6a, 0x4f,
+    0x98, 0x5a, 0xb1, 0x1a, 0xd1, 0xdd, 0x89, 0xa4, 0xa1, 0x4f, 0x9e, 0x0a, 0x26, 0x1c, 0x00, 0xe2,
+    0xe4, 0xc6, 0x2a, 0x35, 0xd2, 0x00, 0x7c, 0x34, 0x73, 0xa0, 0x83, 0xe9, 0x74, 0x7a, 0x46, 0x02,
+    0xa6, 0x80, 0xb9, 0x36, 0x52, 0xd0, 0xfc, 0xf4, 0x10, 0x66, 0xbd, 0xc1, 0x9b, 0x13, 0x88, 0x15,
+    0x55, 0xcb, 0xb8, 0x3d, 0xa1, 0xfe, 0x8c, 0x01, 0x9d, 0x5a, 0x1d, 0xeb, 0xe3, 0xb7, 0xa1, 0x41,
+    0x29, 0x3d, 0xcb, 0x85, 0x3d, 0x06, 0xb5, 0x9e, 0x22, 0x81, 0x2a, 0xdd, 0x4b, 0xea, 0xf3, 0x25,
+    0xa8, 0xab, 0xbf, 0xe1, 0x3a, 0x15, 0xa3, 0x57, 0x12, 0x63, 0x22, 0x02, 0xdf, 0x40, 0xb2, 0xae,
+    0xe6, 0xd2, 0x15, 0x61, 0xc0, 0x43, 0x64, 0xb6, 0xec, 0x03, 0xc9, 0x81, 0x6e, 0xe5, 0x8c, 0x62,
+    0xb8, 0x29, 0x28, 0x74, 0x25, 0xe4, 0x9d, 0xd6, 0xbb, 0xe5, 0x4f, 0x3b, 0x3b, 0x35, 0x60, 0x5e,
+    0x2e, 0x42, 0x10, 0x08, 0x5d, 0xfa, 0xa8, 0xff, 0x75, 0x2e, 0xed, 0xde, 0x73, 0xb6, 0x8a, 0x84,
+    0x54, 0x5b, 0xbc, 0xfa, 0xa0, 0x7b, 0x82, 0xdf, 0x9d, 0x9d, 0xb3, 0xe4, 0x5e, 0x55, 0x0e, 0xba,
+    0xbb, 0x07, 0x7f, 0xad, 0x64, 0xb1, 0x92, 0x8c, 0x2e, 0xe0, 0x68, 0x3d, 0x58, 0xb2, 0xad, 0xb8,
+    0xaf, 0xe6, 0x3a, 0xa0, 0xfc, 0xcd, 0x8e, 0x40, 0x0f, 0xed, 0x6c, 0xb1, 0x7f, 0x5a, 0x22, 0x4b,
+    0xe3, 0x88, 0x79, 0x0a, 0xfc, 0x48, 0x71, 0x81, 0xde, 0x4f, 0x3a, 0xe4, 0xf5, 0xd9, 0x16, 0xad,
+    0x9d, 0xe2, 0xb7, 0x2a, 0x0c, 0xec, 0x78, 0xfe, 0x23, 0x11, 0x73, 0x20, 0x05, 0x21, 0x51, 0x32,
+    0xb0, 0x38, 0xbf, 0x67, 0x7f, 0xb1, 0x09, 0x40, 0x75, 0xed, 0x78, 0x4e, 0x7d, 0xd4, 0x74, 0x17,
+    0xbe, 0x68, 0x09, 0x22, 0x67, 0x13, 0xda, 0xec, 0x1e, 0xea, 0xaf, 0x7b, 0xd2, 0x3a, 0xab, 0x38,
+    0x25, 0x9b, 0x8b, 0x03, 0x0f, 0x0c, 0x90, 0xd8, 0x61, 0x57, 0x1b, 0x18, 0xe1, 0xde, 0x5a, 0x11,
+    0x93, 0xdf, 0x50, 0xfd, 0x53, 0x8e, 0xe2, 0x80, 0x5c, 0x90, 0x94, 0x6a, 0xf4, 0x31, 0x09, 0x84,
+    0x77, 0x57, 0xed, 0x14, 0xe8, 0x3a, 0xb0, 0xa7, 0xed, 0x53, 0x28, 0x36, 0x9e, 0x6a, 0xd4, 0x4d,
+    0x27, 0x60, 0x9b, 0xa5, 0xb2, 0xd4, 0xad, 0x44, 0x34, 0xac, 0x08, 0xa6, 0x01, 0x9b, 0xaa, 0xaa,
+    0xfb, 0x5b, 0xac, 0x83, 0x77, 0xa0, 0x16, 0x90, 0x20, 0x8e, 0xa6, 0x97, 0x9c, 0x64, 0xeb, 0xac,
+    0x53, 0xa0, 0x56, 0x42, 0x1a, 0x09, 0x8e, 0x66, 0x6a, 0xb3, 0x7b, 0x30, 0x17, 0x58, 0x2d, 0x14,
+    0x21, 0xdb, 0x6a, 0x81, 0x8d, 0xc0, 0x8a, 0xce, 0xb6, 0x1c, 0xf1, 0xd4, 0xa8, 0x24, 0xfd, 0xe3,
+    0xbe, 0x6a, 0xd5, 0x1c, 0xc6, 0x2c, 0xc2, 0x56, 0x05, 0xd8, 0x44, 0x13, 0x7d, 0xcb, 0xb5, 0xb3,
+    0x48, 0x58, 0x5b, 0x08, 0xf4, 0x4a, 0xe8, 0x80, 0x31, 0x5f, 0x8a, 0x08, 0x4c, 0x1d, 0x28, 0x3c,
+    0x2d, 0x93, 0x60, 0x29, 0x9b, 0x40, 0xb9, 0x55, 0x69, 0x53, 0x1a, 0x73, 0x9f, 0xed, 0x5f, 0xe6,
+    0x14, 0x98, 0xde, 0xed, 0x3c, 0x66, 0x4a, 0xf8, 0x73, 0x8c, 0x5d, 0x1f, 0xe7, 0xda, 0x80, 0x98,
+    0x2e, 0x95, 0xa8, 0x76, 0x69, 0x5d, 0x6e, 0x24, 0x61, 0xee, 0xd9, 0xf8, 0x62, 0xc8, 0xd0, 0x2d,
+    0x26, 0xe2, 0x14, 0x4d, 0x56, 0xe2, 0x90, 0x67, 0x4a, 0x42, 0xa8, 0x64, 0x01, 0x9b, 0xbe, 0x54,
+    0x50, 0x19, 0xc4, 0x53, 0x21, 0xa1, 0xac, 0x59, 0x46, 0x11, 0x93, 0x1e, 0x8d, 0x59, 0x45, 0x82,
+    0xad, 0xa8, 0xf5, 0xf2, 0x72, 0x48, 0x33, 0x53, 0x5b, 0x23, 0x1d, 0xf4, 0xfb, 0xfd, 0x0d, 0xeb,
+    0x9b, 0xf5, 0x93, 0x12, 0xd6, 0xa2, 0x15, 0xbe, 0xaa, 0xcc, 0xc1, 0xb8, 0x80, 0xe5, 0x22, 0x68,
+    0x60, 0x3f, 0x6c, 0xb6, 0x48, 0x03, 0x4b, 0xbd, 0x1a, 0xf1, 0x3d, 0x0d, 0x00, 0x71, 0x41, 0x9b,
+    0x9b, 0x42, 0xa1, 0xa2, 0x00, 0x31, 0x19, 0x43, 0xb2, 0x52, 0x04, 0x6d, 0xf4, 0xea, 0x08, 0x90,
+    0xd8, 0x1a, 0x3c, 0xb1, 0xe8, 0x65, 0xfb, 0x03, 0x3a, 0x61, 0x81, 0x29, 0x4d, 0x12, 0x1c, 0x6d,
+    0x78, 0x5d, 0x35, 0xd5, 0x99, 0xb9, 0x22, 0xae, 0xf0, 0x30, 0x5a, 0xaa, 0x7f, 0xab, 0xc7, 0x88,
+    0x8d, 0x1c, 0xb0, 0xff, 0x8c, 0x39, 0xff, 0xd9, 0x37, 0xc2, 0x1f, 0x57, 0x9d, 0xfb, 0x42, 0x95,
+    0x57, 0x3c, 0x0c, 0x4b, 0x85, 0xd5, 0x96, 0x1d, 0xf3, 0x74, 0x23, 0xb4, 0x62, 0x93, 0x3b, 0xae,
+    0xda, 0x14, 0xdc, 0x8f, 0x02, 0x37, 0x1e, 0xab, 0x8f, 0x8c, 0x15, 0x8c, 0x0f, 0x87, 0x19, 0x82,
+    0x18, 0xbc, 0x0d, 0x3c, 0x50, 0xcd, 0x97, 0x8b, 0x89, 0xdd, 0x38, 0x3e, 0x4b, 0xc3, 0x14, 0x1a,
+    0x65, 0xcb, 0x53, 0x99, 0xfe, 0x55, 0x0e, 0x49, 0x75, 0xbd, 0x95, 0x55, 0xaf, 0x9e, 0x80, 0x02,
+    0x89, 0xb7, 0x94, 0x31, 0xda, 0x26, 0x4d, 0x00, 0x67, 0x9b, 0x93, 0x9e, 0x87, 0xdb, 0x83, 0x42,
+    0x47, 0x6b, 0xf8, 0x4e, 0xcc, 0x02, 0x08, 0x3e, 0xbb, 0x9a, 0xa7, 0x60, 0x05, 0x3c, 0x78, 0x55,
+    0x91, 0xa0, 0xb2, 0xc9, 0x2d, 0x07, 0x9f, 0x83, 0xe3, 0xe3, 0xe3, 0x9a, 0x18, 0x5a, 0x0a, 0xa1,
+    0x85, 0x8e, 0x92, 0x87, 0x73, 0x26, 0xb9, 0xaa, 0xee, 0x6a, 0x97, 0xe0, 0xb2, 0xe1, 0xb6, 0x7a,
+    0x55, 0x87, 0x8b, 0x1a, 0x6e, 0x0a, 0xdd, 0x49, 0xad, 0x46, 0xec, 0x38, 0x69, 0xab, 0xff, 0x79,
+    0xce, 0xed, 0x03, 0x56, 0x92, 0x57, 0x87, 0xcd, 0xac, 0xe0, 0x08, 0x02, 0x48, 0xba, 0xfd, 0xb8,
+    0xca, 0x61, 0x13, 0x71, 0x87, 0x73, 0x4c, 0x06, 0x56, 0xab, 0x91, 0xb4, 0x42, 0xa9, 0xbb, 0x64,
+    0x72, 0x0d, 0x06, 0x83, 0xb3, 0x32, 0x38, 0xf5, 0xb0, 0x7e, 0xdc, 0xab, 0x55, 0x29, 0x62, 0x80,
+    0x00, 0x06, 0x87, 0x45, 0x6e, 0x72, 0xcc, 0x86, 0xde, 0x49, 0xa1, 0xe5, 0x3b, 0x39, 0xa9, 0x05,
+    0xad, 0x16, 0xe1, 0xa4, 0xd4, 0x31, 0x1a, 0xa6, 0x3e, 0x08, 0xc4, 0x2c, 0x69, 0xa7, 0xb7, 0xb6,
+    0x27, 0xdd, 0x4a, 0x47, 0x6c, 0x27, 0x05, 0xdb, 0x7e, 0x99, 0xbd, 0xbb, 0xd5, 0x2d, 0x1b, 0x17,
+    0x62, 0x29, 0x39, 0x08, 0xf1, 0x91, 0xad, 0x1a, 0x87, 0x24, 0xfd, 0x55, 0x3b, 0xee, 0xa8, 0xcf,
+    0xdf, 0x5f, 0x55, 0x33, 0xb4, 0x25, 0x94, 0x7d, 0x32, 0xae, 0x0c, 0x6b, 0x2e, 0x6a, 0x2a, 0xed,
+    0x46, 0xb3, 0x41, 0x0a, 0x86, 0x86, 0xee, 0xb6, 0xb4, 0xda, 0xeb, 0xf5, 0xca, 0x69, 0x15, 0xdb,
+    0x63, 0x0b, 0xaf, 0xe2, 0x0b, 0x66, 0xe7, 0x2d, 0x23, 0x3d, 0xa4, 0x9e, 0x2e, 0xb3, 0xc2, 0xdd,
+    0xca, 0x44, 0x88, 0x61, 0x11, 0xcf, 0x5c, 0x26, 0x65, 0x29, 0xf9, 0xe1, 0x68, 0xab, 0x55, 0xb9,
+    0x5b, 0xdc, 0xd5, 0x66, 0xca, 0x64, 0xf7, 0x79, 0x27, 0x1d, 0xf7, 0x9d, 0x77, 0x92, 0x21, 0xe2,
+    0x39, 0x8e, 0xbb, 0xc6, 0x2f, 0x92, 0x99, 0x22, 0x93, 0xe9, 0x4c, 0xd0, 0xe7, 0xf7, 0xc4, 0x0b,
+    0x68, 0x1c, 0x8f, 0x1c, 0x3d, 0xc2, 0x70, 0xf2, 0x31, 0xe2, 0x79, 0x07, 0x16, 0x8d, 0x6d, 0xdc,
+    0x1f, 0x39, 0x66, 0x7f, 0xef, 0x64, 0x80, 0x85, 0x9b, 0xe3, 0xcb, 0x9b, 0xdb, 0x8b, 0xef, 0x3f,
+    0x7e, 0xbc, 0xba, 0xf8, 0x7c, 0x75, 0x99, 0xa2, 0x48, 0x58, 0x40, 0x9a, 0x2f, 0x4c, 0x82, 0x9b,
+    0x16, 0xdf, 0x29, 0x33, 0x93, 0xf5, 0xdd, 0x4e, 0x3e, 0xaf, 0x34, 0x97, 0xf3, 0xe6, 0xd5, 0xd8,
+    0xa0, 0x37, 0xf1, 0xc5, 0x4c, 0x73, 0x9a, 0xb7, 0x56, 0x0e, 0x89, 0xa5, 0x37, 0x72, 0xec, 0x8d,
+    0x06, 0x36, 0xb3, 0xeb, 0xb1, 0xb6, 0xd5, 0x6d, 0x85, 0x7e, 0xc1, 0xd1, 0x74, 0x44, 0xec, 0x83,
+    0xe3, 0xc5, 0xce, 0xf8, 0xc7, 0xab, 0xdb, 0x21, 0x69, 0xb7, 0x0d, 0xad, 0xed, 0x85, 0x63, 0x1a,
+    0x01, 0x8e, 0xeb, 0x4f, 0x75, 0x38, 0xac, 0x5b, 0xa6, 0x6d, 0x92, 0xcb, 0xe4, 0x5a, 0x17, 0xfb,
+    0xd5, 0x2a, 0xdb, 0xd4, 0xc1, 0x5b, 0x14, 0x61, 0x16, 0xb9, 0xce, 0xf8, 0x13, 0x1c, 0x4f, 0xa8,
+    0x5b, 0x31, 0x99, 0x93, 0x0f, 0x4c, 0x49, 0xee, 0xc5, 0x55, 0x9c, 0x19, 0xf0, 0x59, 0x79, 0xe8,
+    0x8c, 0xcf, 0xc1, 0xb0, 0xe1, 0xf8, 0xc7, 0x37, 0x1f, 0xc8, 0x4f, 0x31, 0x9d, 0x31, 0xf0, 0x46,
+    0xfc, 0x4d, 0xf4, 0xed, 0xc2, 0x6e, 0xa8, 0xf9, 0x12, 0x25, 0xc0, 0x05, 0xe4, 0xf4, 0x85, 0x33,
+    0x46, 0xf9, 0xf5, 0xee, 0x3d, 0x89, 0xbd, 0xa7, 0x50, 0x78, 0x7a, 0x8f, 0x3b, 0x92, 0x8a, 0xe0,
+    0x50, 0x7f, 0x3d, 0xad, 0xb7, 0x1c, 0xf2, 0x93, 0xda, 0x55, 0xac, 0x49, 0xb2, 0xfb, 0xeb, 0xc9,
+    0xfd, 0xcc, 0xaf, 0x39, 0xb9, 0xe5, 0xb3, 0x90, 0x06, 0xbb, 0x6a, 0x32, 0x8e, 0x79, 0x3d, 0x3d,
+    0xd3, 0x67, 0xfe, 0x7f, 0x3f, 0xb9, 0x59, 0x80, 0x85, 0xc9, 0x2d, 0x53, 0x0a, 0x74, 0x5a, 0xe5,
+    0x22, 0xb5, 0x78, 0x0a, 0x55, 0x7b, 0xd5, 0xc9, 0x33, 0x85, 0x2c, 0x94, 0xec, 0x70, 0xde, 0x98,
+    0x9e, 0x42, 0x40, 0x02, 0x48, 0x65, 0xac, 0x80, 0x4e, 0x2a, 0x3b, 0xd4, 0x09, 0x1c, 0xd1, 0x76,
+    0xf2, 0xd3, 0x21, 0x22, 0xf4, 0xe6, 0x98, 0x72, 0x47, 0xce, 0x32, 0x02, 0xcd, 0xb1, 0x1c, 0x53,
+    0x53, 0xcd, 0x79, 0xec, 0x82, 0xfe, 0x96, 0xac, 0x55, 0xc1, 0x8e, 0x46, 0x2a, 0x22, 0xdc, 0x49,
+    0xf4, 0xa6, 0x91, 0xd3, 0x75, 0xc6, 0xaf, 0x07, 0x0f, 0xaf, 0x07, 0xe7, 0x9d, 0xe4, 0xfe, 0x4e,
+    0x40, 0x3d, 0x67, 0xfc, 0xc3, 0x0f, 0xff, 0xfa, 0xee, 0x0d, 0x69, 0xf6, 0x06, 0xdd, 0x87, 0x5e,
+    0xbf, 0xdb, 0xda, 0x0b, 0xfc, 0xc8, 0x19, 0xbf, 0x4b, 0xc0, 0xfb, 0xc7, 0x00, 0xfe, 0x6a, 0xb0,
+    0x1f, 0xf8, 0x09, 0x50, 0xd7, 0xd0, 0x47, 0xfd, 0xee, 0x03, 0x60, 0xd8, 0x0f, 0x7a, 0xe0, 0x8c,
+    0x2f, 0x6e, 0xae, 0x49, 0xf3, 0xb8, 0x0b, 0xc0, 0xaf, 0xf7, 0x24, 0xfd, 0x0a, 0x38, 0xd7, 0xa4,
+    0x8f, 0x4f, 0xbb, 0x0f, 0x47, 0xfb, 0xca, 0x7d, 0xea, 0xa4, 0xb5, 0x3a, 0xf3, 0xc7, 0x1a, 0xcb,
+    0x00, 0xc4, 0x07, 0x4c, 0xfb, 0x61, 0x79, 0xed, 0x8c, 0x6f, 0x35, 0xf4, 0x29, 0x48, 0x30, 0xe8,
+    0xee, 0x09, 0xdd, 0x03, 0x83, 0xff, 0xa2, 0x2d, 0xd7, 0xed, 0x1f, 0x3f, 0xbc, 0x1a, 0x9c, 0xee,
+    0x09, 0x0e, 0xa6, 0x7f, 0x77, 0x09, 0xd0, 0x7d, 0x50, 0xc0, 0xab, 0x7d, 0x15, 0xd0, 0xeb, 0x03,
+    0xef, 0x09, 0x75, 0x84, 0x47, 0x16, 0xf6, 0x44, 0x00, 0xae, 0xf3, 0xd3, 0x2f, 0xa9, 0xe3, 0x69,
+    0xcf, 0xdb, 0xc6, 0x01, 0x9c, 0x2b, 0xad, 0xee, 0xca, 0x4c, 0xf4, 0xa7, 0x9c, 0xe9, 0x7f, 0x7c,
+    0xba, 0xfa, 0x8e, 0xfc, 0xb0, 0xa4, 0x01, 0x57, 0x8f, 0xa4, 0xf9, 0x5e, 0xac, 0xa0, 0x96, 0xe4,
+    0x31, 0x99, 0xe8, 0x87, 0x24, 0xad, 0xda, 0x73, 0xae, 0x9b, 0x56, 0x62, 0x36, 0xad, 0x64, 0xc1,
+    0x43, 0x6d, 0x2c, 0x1c, 0x5a, 0x83, 0xd3, 0x1e, 0x39, 0x86, 0x0e, 0x75, 0x40, 0xf8, 0x6f, 0x42,
+    0x25, 0xed, 0x69, 0x31, 0x28, 0x68, 0x2c, 0x59, 0x4c, 0x48, 0x99, 0xb8, 0x64, 0x13, 0xa8, 0xa2,
+    0x3d, 0xe6, 0x3f, 0x13, 0x19, 0xb4, 0x02, 0x74, 0xc1, 0x35, 0x72, 0x74, 0xe9, 0xa7, 0x87, 0xc7,
+    0x43, 0xa2, 0x8b, 0xbe, 0xbc, 0x80, 0xc7, 0x47, 0x9b, 0x85, 0xd1, 0x0f, 0x16, 0x83, 0x45, 0x7e,
+    0x30, 0x78, 0x63, 0xe9, 0xeb, 0x8c, 0x7b, 0xfd, 0x9d, 0xeb, 0x80, 0x3f, 0x28, 0x90, 0xbf, 0xa3,
+    0xd2, 0x5f, 0x51, 0xc9, 0xf0, 0x89, 0x25, 0x9a, 0xe5, 0x2f, 0x8b, 0xe5, 0xd7, 0x70, 0x77, 0x4e,
+    0x6e, 0x70, 0x72, 0x04, 0x3d, 0xdf, 0xe3, 0xde, 0x86, 0xce, 0xec, 0xdc, 0x3f, 0x39, 0x71, 0xf2,
+    0xc8, 0xac, 0xf5, 0x3a, 0x45, 0xd4, 0x75, 0x56, 0xd6, 0x74, 0x77, 0xb1, 0x71, 0xa5, 0xd3, 0xa7,
+    0x9d, 0x36, 0xa4, 0x93, 0x80, 0x7b, 0x77, 0x50, 0x94, 0xb2, 0xd0, 0xbf, 0x10, 0x0b, 0x28, 0x98,
+    0xfc, 0x66, 0x63, 0xbe, 0xe0, 0x52, 0x0a, 0xd9, 0x68, 0xa1, 0x74, 0x3c, 0x22, 0xbf, 0x9c, 0x77,
+    0x92, 0xfd, 0xe3, 0x3d, 0x90, 0xdc, 0x4f, 0x01, 0x74, 0x83, 0xe2, 0xd7, 0xed, 0x28, 0x36, 0xb5,
+    0x00, 0x76, 0x93, 0x4e, 0x0d, 0x46, 0x09, 0xc2, 0x0a, 0x85, 0x28, 0x7f, 0xd4, 0x57, 0x65, 0x94,
+    0x85, 0xd2, 0x32, 0xad, 0x27, 0x33, 0xf1, 0x37, 0x7d, 0xc0, 0xa6, 0xf1, 0xac, 0x28, 0xdd, 0xb3,
+    0x56, 0x2b, 0x2d, 0x5e, 0xcc, 0xdb, 0xd8, 0x29, 0x41, 0x08, 0x7b, 0x8c, 0x15, 0x5b, 0x54, 0x16,
+    0x32, 0x69, 0x7b, 0x03, 0x35, 0x05, 0xce, 0x11, 0xa6, 0xf8, 0xf8, 0x0f, 0x4a, 0x78, 0xff, 0xd1,
+    0x2d, 0xd6, 0x31, 0x1b, 0x7e, 0x62, 0x4f, 0xf2, 0x28, 0x0d, 0x50, 0xe0, 0x53, 0xb1, 0x22, 0xd0,
+    0x7b, 0x5c, 0xdf, 0x7c, 0x47, 0x46, 0x46, 0x47, 0x9c, 0xb4, 0x01, 0x9f, 0x04, 0xbe, 0x26, 0x70,
+    0xda, 0x3b, 0xcc, 0x27, 0xe3, 0x11, 0x4f, 0x6f, 0x76, 0x0f, 0x8d, 0x01, 0x18, 0x10, 0x06, 0x1f,
+    0xd0, 0x93, 0x8e, 0xae, 0xbe, 0xbd, 0x3e, 0x7b, 0x61, 0x10, 0x58, 0xf2, 0x02, 0x72, 0xdd, 0xf5,
+    0x0c, 0x89, 0x2f, 0xbc, 0xe5, 0x02, 0xfa, 0x2f, 0x77, 0xc6, 0xd4, 0x55, 0xc0, 0xf0, 0xf2, 0xed,
+    0xe3, 0x0d, 0x28, 0xdc, 0x6c, 0x8e, 0x1a, 0xad, 0x43, 0x8b, 0xa9, 0x2d, 0x80, 0x79, 0x03, 0x63,
+    0x82, 0xc9, 0xad, 0x30, 0x69, 0x0d, 0x6d, 0x02, 0x44, 0xba, 0x71, 0xdf, 0x0a, 0x81, 0x5b, 0x0a,
+    0x34, 0xa0, 0x76, 0x7c, 0x8e, 0x08, 0x6c, 0x31, 0x41, 0xd2, 0x0a, 0xf7, 0x19, 0xa8, 0x74, 0x97,
+    0x09, 0x08, 0xad, 0x0f, 0x94, 0x5f, 0x5b, 0xe0, 0xd2, 0xfe, 0xca, 0x82, 0xb9, 0x8e, 0x9e, 0x83,
+    0x81, 0x7e, 0xca, 0x84, 0x01, 0xc7, 0xda, 0x06, 0xb1, 0xf1, 0x67, 0x13, 0x06, 0x43, 0xf2, 0x25,
+    0x84, 0xe2, 0x2d, 0x70, 0x76, 0xd4, 0x6e, 0xb4, 0x0a, 0x1e, 0x13, 0x30, 0x05, 0x0e, 0x12, 0xb3,
+    0x9f, 0x64, 0x00, 0x4e, 0xb3, 0xe2, 0xa1, 0x2f, 0x56, 0xd0, 0xc2, 0x7b, 0xf8, 0x88, 0x34, 0x74,
+    0xe7, 0x22, 0x56, 0x21, 0x5d, 0xa4, 0x03, 0x0b, 0x3e, 0x25, 0xcd, 0x6f, 0xd2, 0xcd, 0x2d, 0x03,
+    0xca, 0xe9, 0xbd, 0xee, 0xbb, 0xbd, 0xc1, 0xa9, 0xdb, 0x73, 0xc1, 0x23, 0x9d, 0x74, 0xa6, 0xaf,
+    0xff, 0x5a, 0xf2, 0xf4, 0x29, 0xae, 0x0b, 0x1d, 0x2e, 0x6c, 0xfd, 0x32, 0x57, 0x2a, 0x1a, 0x76,
+    0x3a, 0x2f, 0x9f, 0x52, 0xf0, 0xf5, 0xf0, 0xe5, 0x53, 0x72, 0x20, 0xdc, 0xfc, 0x10, 0xac, 0x3b,
+    0xc9, 0xf5, 0x17, 0x83, 0xc9, 0x29, 0x78, 0x0d, 0xbb, 0x80, 0x30, 0xa8, 0x00, 0x4d, 0x3a, 0x2e,
+    0xc2, 0xfb, 0x70, 0x2a, 0xd5, 0x35, 0xae, 0x7d, 0xc6, 0x19, 0xc7, 0x88, 0x5c, 0x82, 0xf9, 0xdc,
+    0x50, 0xac, 0x9a, 0xad, 0x7c, 0x8f, 0xb7, 0x94, 0x12, 0x14, 0x02, 0x26, 0x29, 0xc2, 0xea, 0xc8,
+    0x8b, 0x70, 0x62, 0x89, 0x58, 0xc3, 0x65, 0x10, 0xe4, 0x8b, 0xa9, 0xe2, 0xec, 0x65, 0x4b, 0x2c,
+    0x11, 0x06, 0x82, 0xfa, 0xb0, 0xda, 0x6c, 0x91, 0xd1, 0xd8, 0x38, 0x75, 0x39, 0xbf, 0xdf, 0x7e,
+    0x9b, 0xcf, 0x7b, 0x92, 0x03, 0x0a, 0xec, 0x55, 0x70, 0x9a, 0xa9, 0x18, 0x57, 0xdb, 0x96, 0x5c,
+    0xe3, 0x91, 0x3e, 0xec, 0x2d, 0x6b, 0x8a, 0x56, 0x10, 0x2c, 0xa7, 0x68, 0xcd, 0xa2, 0x2a, 0x34,
+    0xb7, 0x71, 0x3a, 0x4b, 0x7b, 0x40, 0xbb, 0xb8, 0x21, 0xc9, 0x42, 0xb7, 0x5a, 0xd8, 0x5b, 0x08,
+    0x14, 0x71, 0xb3, 0xf4, 0xc0, 0x38, 0x73, 0xa5, 0x29, 0xa4, 0x28, 0x5d, 0xca, 0x55, 0xc0, 0x18,
+    0x7c, 0x83, 0xee, 0x92, 0xe3, 0xe1, 0xf2, 0x30, 0x64, 0xf2, 0x33, 0xd4, 0x22, 0xe8, 0x18, 0x7a,
+    0xb0, 0xf0, 0xf2, 0x29, 0x97, 0x68, 0xfd, 0xa5, 0xa8, 0x96, 0x5c, 0xe7, 0x21, 0xc4, 0x2b, 0x49,
+    0x83, 0x9f, 0x71, 0xdc, 0x6b, 0x6b, 0x24, 0xc1, 0x0e, 0x07, 0xb6, 0x88, 0x5d, 0x8f, 0x3e, 0x5e,
+    0x3e, 0x55, 0xe3, 0x58, 0x3f, 0x54, 0xac, 0xbc, 0xd3, 0xb3, 0x7f, 0x93, 0x89, 0x54, 0x5a, 0x4b,
+    0x58, 0xea, 0xfb, 0xef, 0xc5, 0xac, 0x09, 0x29, 0xe1, 0x50, 0xa7, 0x7d, 0xa0, 0xd6, 0xe0, 0xe1,
+    0x54, 0x34, 0x4c, 0xce, 0x12, 0xb3, 0xab, 0x54, 0xc7, 0x6c, 0xa5, 0x6d, 0xdf, 0x6c, 0xb9, 0x4a,
+    0xbc, 0x87, 0xa3, 0x16, 0x68, 0xed, 0x83, 0xbe, 0x20, 0xca, 0x99, 0xea, 0x4d, 0xa0, 0xf4, 0x4c,
+    0x70, 0x94, 0x1f, 0x70, 0x0f, 0xb8, 0x54, 0x2c, 0x3d, 0xe3, 0xcd, 0x06, 0xa4, 0x99, 0x86, 0x01,
+    0x83, 0xbb, 0x5d, 0x9d, 0xaa, 0x3e, 0x52, 0x4d, 0xad, 0x91, 0x25, 0xbb, 0x86, 0xb5, 0x49, 0xeb,
+    0xe7, 0xdd, 0xe7, 0x0f, 0xef, 0x51, 0x3f, 0x35, 0x79, 0xf0, 0xe5, 0x13, 0xfe, 0xbb, 0xde, 0x96,
+    0x08, 0x41, 0xab, 0x28, 0xf6, 0x1a, 0x37, 0xc3, 0xcf, 0x6c, 0xaf, 0xa1, 0x37, 0x50, 0x2d, 0xc6,
+    0x36, 0x37, 0x92, 0x2c, 0x82, 0x44, 0xdf, 0x44, 0xea, 0xad, 0x92, 0x6d, 0xf5, 0x16, 0x6f, 0xce,
+    0x03, 0x1f, 0xec, 0xef, 0x06, 0x2c, 0x9c, 0xa9, 0x39, 0x19, 0x93, 0x13, 0xf0, 0xf9, 0x6c, 0x15,
+    0x9d, 0x35, 0x95, 0xfb, 0x02, 0x37, 0xba, 0x92, 0x2d, 0xc4, 0x3d, 0xcb, 0x54, 0xb6, 0xae, 0x74,
+    0x43, 0xab, 0x80, 0x82, 0x30, 0x68, 0x1a, 0x06, 0x89, 0x9b, 0x51, 0xa0, 0x05, 0xd2, 0x31, 0x2a,
+    0xd3, 0x5f, 0xc5, 0xa5, 0x9c, 0x65, 0x2b, 0x6e, 0xc4, 0x4c, 0x65, 0x00, 0x76, 0x14, 0xc8, 0x8f,
+    0x50, 0x5a, 0xb0, 0x36, 0x1b, 0x1a, 0xb8, 0x71, 0x88, 0x45, 0xa0, 0x79, 0x94, 0x0e, 0xf1, 0xa5,
+    0xb6, 0xad, 0x92, 0x94, 0x0a, 0x7e, 0x4b, 0x16, 0x50, 0x53, 0x96, 0x0f, 0x0a, 0xce, 0x0f, 0xdb,
+    0x8a, 0xda, 0x2e, 0x46, 0x36, 0x4b, 0x64, 0x6b, 0xf1, 0xac, 0x90, 0x6b, 0x0a, 0xf1, 0x70, 0x3f,
+    0xb1, 0x53, 0xf0, 0x2a, 0xc1, 0x8f, 0xba, 0xdb, 0x05, 0x37, 0xa6, 0x1f, 0xb6, 0xc8, 0x96, 0x6a,
+    0x31, 0x92, 0x61, 0xdf, 0x52, 0xa0, 0x92, 0x22, 0xa5, 0xf1, 0x63, 0xe8, 0xd9, 0xa8, 0x33, 0xd0,
+    0x7b, 0x2a, 0x39, 0x9d, 0x04, 0x2c, 0x81, 0x33, 0x28, 0x28, 0x69, 0xbf, 0x80, 0x89, 0x8f, 0x80,
+    0x47, 0x24, 0xc2, 0xb7, 0x5c, 0xa1, 0x04, 0x6c, 0x16, 0xa5, 0xd1, 0x84, 0x56, 0x94, 0x43, 0x6e,
+    0x61, 0xca, 0x9b, 0x37, 0xb7, 0xe5, 0xbb, 0xb4, 0xb8, 0x5b, 0x77, 0xd2, 0x56, 0xe3, 0xef, 0x2f,
+    0x9f, 0x32, 0x36, 0xd6, 0x23, 0xbc, 0x0e, 0xd6, 0x5f, 0x6c, 0xd4, 0x49, 0xb0, 0xf9, 0x72, 0x0b,
+    0xf9, 0xc9, 0xd8, 0x4d, 0x94, 0x20, 0x29, 0xc0, 0x61, 0x16, 0x7d, 0x0c, 0x0d, 0x13, 0xc8, 0xe6,
+    0xde, 0x9c, 0x34, 0x59, 0x29, 0x7d, 0xe8, 0xd7, 0x3e, 0x19, 0x0e, 0xf6, 0x85, 0x6c, 0xb2, 0x1a,
+    0x62, 0xd7, 0x94, 0x07, 0xcc, 0x47, 0x1a, 0x71, 0x91, 0x2c, 0x12, 0x03, 0xd0, 0x46, 0xab, 0x26,
+    0x46, 0x5a, 0x1a, 0x37, 0xab, 0x7c, 0x6f, 0xe1, 0x9b, 0xcc, 0xe4, 0x72, 0x85, 0xf8, 0x28, 0x03,
+    0x18, 0xd3, 0xdb, 0x74, 0x42, 0x58, 0xf8, 0x6b, 0xd7, 0x75, 0x4d, 0x4d, 0x94, 0x6d, 0xd2, 0xe9,
+    0x90, 0x76, 0x0f, 0x38, 0x9c, 0xcd, 0x02, 0x16, 0x13, 0x35, 0x67, 0x04, 0xdb, 0x92, 0xf8, 0x8f,
+    0x32, 0x0b, 0xf2, 0x30, 0x6a, 0xf7, 0xea, 0xac, 0x91, 0x0a, 0x95, 0x32, 0x4b, 0xd8, 0x03, 0xf3,
+    0x96, 0x8a, 0xf9, 0xa8, 0x1e, 0x71, 0xb7, 0x9b, 0x25, 0x6a, 0x50, 0x4d, 0xb5, 0xea, 0xf7, 0xd4,
+    0xb3, 0x16, 0xf1, 0x33, 0xc3, 0x40, 0x09, 0x9a, 0x6a, 0x96, 0xf3, 0x10, 0x14, 0xfc, 0x12, 0x0f,
+    0x70, 0x94, 0x4f, 0xcf, 0xed, 0x3a, 0xa4, 0xac, 0xe2, 0x04, 0x34, 0xd5, 0x49, 0xc0, 0x64, 0x9a,
+    0xc8, 0xde, 0x4c, 0x40, 0x57, 0x17, 0x9b, 0xbb, 0x4d, 0x4b, 0x45, 0xa5, 0x18, 0x91, 0x23, 0x70,
+    0x29, 0x82, 0x36, 0x5b, 0x87, 0xa4, 0xdf, 0xd5, 0x01, 0xa0, 0x82, 0x1c, 0x94, 0xd5, 0x40, 0x67,
+    0x6f, 0xcb, 0x25, 0x1d, 0x0d, 0xa8, 0xed, 0x89, 0xc4, 0x7a, 0x24, 0x3d, 0x34, 0xe9, 0x26, 0xb7,
+    0xc8, 0xba, 0xf4, 0xd6, 0xb4, 0xce, 0xb6, 0xc9, 0x88, 0x1e, 0xa8, 0x7e, 0xa0, 0x6a, 0xee, 0xea,
+    0x27, 0x94, 0xcd, 0x92, 0xa2, 0xa0, 0x3e, 0xd3, 0x4a, 0xb4, 0x50, 0x14, 0x7e, 0x60, 0xa4, 0x05,
+    0xfe, 0x5d, 0x71, 0x67, 0x1b, 0x3b, 0xa7, 0xa6, 0x5f, 0x62, 0xcb, 0x04, 0xc4, 0xcd, 0xbf, 0xc5,
+    0x10, 0xe4, 0x2c, 0xac, 0x25, 0xcc, 0x69, 0xb0, 0x4f, 0x5e, 0x61, 0x35, 0x23, 0xbd, 0xf3, 0xfd,
+    0xc7, 0xf7, 0x37, 0x1f, 0xaf, 0x9c, 0xb3, 0xfa, 0xed, 0x66, 0x69, 0x50, 0x78, 0x2c, 0x46, 0x92,
+    0x77, 0x61, 0x9d, 0xdd, 0x68, 0x63, 0x43, 0x56, 0x20, 0x9d, 0xe9, 0xed, 0x5b, 0xe2, 0x90, 0x45,
+    0x5c, 0xcd, 0x01, 0x44, 0xe7, 0x02, 0x0c, 0x4a, 0xef, 0xce, 0x19, 0x8d, 0xc8, 0xdf, 0x4d, 0x6d,
+    0xe7, 0xb7, 0x3b, 0x44, 0x0f, 0x10, 0x35, 0xd2, 0x7f, 0xbe, 0x75, 0xc8, 0x90, 0x38, 0x1f, 0x3b,
+    0x6f, 0x6a, 0x90, 0x43, 0xbf, 0x57, 0xc6, 0x8e, 0x77, 0x01, 0x7b, 0x7e, 0x8d, 0xa8, 0xfc, 0xb7,
+    0x8b, 0x2d, 0xb8, 0x4a, 0x37, 0xd0, 0x90, 0x1a, 0xc1, 0xdd, 0x24, 0x8a, 0x75, 0x35, 0x92, 0x76,
+    0x89, 0x65, 0x72, 0xb8, 0x43, 0x93, 0xc0, 0x8b, 0x0a, 0xdc, 0x2c, 0x88, 0x59, 0x1d, 0x82, 0x84,
+    0x1d, 0x52, 0x3c, 0x06, 0xeb, 0x04, 0xa4, 0xec, 0x3f, 0x6a, 0x8e, 0xef, 0x38, 0xe1, 0x09, 0xbc,
+    0xd2, 0xc1, 0xdb, 0x79, 0xf3, 0xe9, 0x26, 0xb9, 0x74, 0x2c, 0xf7, 0x59, 0xef, 0x10, 0x7e, 0x6a,
+    0xbc, 0xe9, 0xfa, 0xba, 0xc2, 0x9d, 0x9e, 0x77, 0xa5, 0x32, 0x40, 0xc9, 0x5d, 0x9c, 0x76, 0xdb,
+    0xa9, 0x89, 0x66, 0x10, 0x32, 0x6e, 0xd2, 0x09, 0x47, 0xb3, 0x18, 0xca, 0x0e, 0xd3, 0xd1, 0x89,
+    0x9b, 0x4d, 0x40, 0x52, 0x49, 0xd3, 0xe0, 0xe9, 0x5c, 0x42, 0x61, 0x35, 0x11, 0x54, 0xfa, 0x84,
+    0x87, 0x5c, 0x71, 0xa8, 0x37, 0x7e, 0x67, 0x3e, 0xaa, 0x03, 0x6a, 0xd2, 0x74, 0x0a, 0x73, 0xde,
+    0x49, 0x9e, 0x31, 0x9f, 0x77, 0xf4, 0xff, 0x67, 0xf9, 0x1f, 0xdf, 0x2a, 0x6a, 0x62, 0xdf, 0x32,
+    0x00, 0x00,
+};
+
+const size_t INDEX_HTML_GZ_LENGTH = sizeof(INDEX_HTML_GZ);
+const size_t INDEX_HTML_LENGTH = 13023;
+const char INDEX_HTML_ETAG[] = "\"fc515bf9ddaeb48a\"";
+
+#endif
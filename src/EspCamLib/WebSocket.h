@@ -0,0 +1,81 @@
+#ifndef ESPCAMLIB_WEBSOCKET_H
+#define ESPCAMLIB_WEBSOCKET_H
+#include <Arduino.h>
+
+// binary WebSocket framing for stream frames. Each frame is one unmasked binary message whose payload
+// starts with a 16 byte little endian header: sequence (u32), capture timestamp in microseconds (u64)
+// and jpeg length (u32). Clients acknowledge a frame by sending its sequence back, as a 4 byte
+// little endian binary message or as decimal text
+namespace EspCam
+{
+    class WebSocketFraming
+    {
+    public:
+        static const size_t FRAME_HEADER_LEN = 16;
+        // 10 bytes of WebSocket header at most plus the frame header
+        static const size_t HEADER_MAX = 10 + FRAME_HEADER_LEN;
+
+        static size_t formatHeader(char *out, uint32_t sequence, int64_t timestamp, size_t len)
+        {
+            uint8_t *p = (uint8_t *)out;
+            uint64_t payload = FRAME_HEADER_LEN + len;
+            size_t pos = 0;
+
+            // FIN and the binary opcode, server frames are never masked
+            p[pos++] = 0x82;
+            if (payload < 126)
+            {
+                p[pos++] = payload;
+            }
+            else if (payload < 65536)
+            {
+                p[pos++] = 126;
+                p[pos++] = payload >> 8;
+                p[pos++] = payload;
+            }
+            else
+            {
+                p[pos++] = 127;
+                for (int i = 7; i >= 0; i--)
+                {
+                    p[pos++] = payload >> (8 * i);
+                }
+            }
+
+            for (int i = 0; i < 4; i++)
+            {
+                p[pos++] = sequence >> (8 * i);
+            }
+            for (int i = 0; i < 8; i++)
+            {
+                p[pos++] = (uint64_t)timestamp >> (8 * i);
+            }
+            for (int i = 0; i < 4; i++)
+            {
+                p[pos++] = (uint32_t)len >> (8 * i);
+            }
+            return pos;
+        }
+
+        // sequence number carried by an ack message, 0 if it is not one
+        static uint32_t parseAck(const uint8_t *payload, size_t len, bool binary)
+        {
+            if (binary)
+            {
+                if (len != 4)
+                    return 0;
+                return payload[0] | (payload[1] << 8) | (payload[2] << 16) | ((uint32_t)payload[3] << 24);
+            }
+
+            uint32_t sequence = 0;
+            for (size_t i = 0; i < len; i++)
+            {
+                if (payload[i] < '0' || payload[i] > '9')
+                    return 0;
+                sequence = sequence * 10 + (payload[i] - '0');
+            }
+            return sequence;
+        }
+    };
+}
+#endif
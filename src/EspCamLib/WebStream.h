@@ -4,8 +4,11 @@
 #include <WiFi.h>
 #include "esp_camera.h"
 #include "esp_http_server.h"
+#include "esp_timer.h"
 
 #include "Camera.h"
+#include "FrameBroker.h"
+#include "Multipart.h"
 
 // stream only HTTP server
 namespace EspCam
@@ -23,25 +26,43 @@ namespace EspCam
                 return ESP_FAIL;
             }
 
-            httpd_resp_set_type(req, "multipart/x-mixed-replace; boundary=frame");
-            httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+            MultipartWriter writer(req);
+            if (writer.begin(req) != ESP_OK) {
+                return ESP_FAIL;
+            }
+
+            FrameBroker* broker = instance->m_camera->getBroker();
+            PipelineLatency* latency = broker->getLatency();
+            Metrics* metrics = broker->getMetrics();
+            uint32_t lastSeq = 0;
+            metrics->streamClientOpened();
 
             while (true) {
-                camera_fb_t* pic = instance->m_camera->getFrame();
+                FrameRef pic = broker->acquire(lastSeq, pdMS_TO_TICKS(5000));
                 if (!pic) {
-                    return ESP_FAIL;
+                    break;
+                }
+                if (lastSeq && pic.sequence() > lastSeq + 1) {
+                    metrics->addStreamDropped(pic.sequence() - lastSeq - 1);
+                }
+                lastSeq = pic.sequence();
+                if (!pic.length()) {
+                    continue;
                 }
 
-                String partHeader = "--frame\r\nContent-Type: image/jpeg\r\nContent-Length: " + String(pic->len) + "\r\n\r\n";
-                httpd_resp_send_chunk(req, partHeader.c_str(), partHeader.length());
-
-                httpd_resp_send_chunk(req, (const char *)pic->buf, pic->len);
-                httpd_resp_send_chunk(req, "\r\n", 2);
-
-                instance->m_camera->releaseFrame(pic);
+                int64_t firstByte = 0;
+                latency->recordSince(PipelineLatency::DEQUEUE, pic.timestamp(), esp_timer_get_time());
+                if (writer.writeFrame(pic.data(), pic.length(), &firstByte) != ESP_OK) {
+                    break;
+                }
+                latency->recordSince(PipelineLatency::FIRST_BYTE, pic.timestamp(), firstByte);
+                latency->recordSince(PipelineLatency::LAST_BYTE, pic.timestamp(), esp_timer_get_time());
+                metrics->addFrameSent();
+                metrics->addBytesSent(pic.length());
             }
+            metrics->streamClientClosed();
 
-            return ESP_OK;
+            return ESP_FAIL;
         }
     public:
         WebStream(Camera* camera, int port = 80) : m_camera(camera), m_port(port) { }
@@ -49,8 +70,12 @@ namespace EspCam
         bool begin(int port = 80) {
             m_port = port;
             pixformat_t format = m_camera->getPixelFormat();
-            if (format != PIXFORMAT_JPEG) {
-                Serial.println("BasicWebServer ERROR: Camera pixel format must be set to JPEG.");
+            if (format != PIXFORMAT_JPEG && !JpegEncoder::supports(format)) {
+                Serial.println("BasicWebServer ERROR: Camera pixel format can not be encoded to JPEG.");
+                return false;
+            }
+
+            if (!m_camera->getBroker()->begin()) {
                 return false;
             }
 
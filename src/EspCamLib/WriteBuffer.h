@@ -0,0 +1,330 @@
+#ifndef ESPCAMLIB_WRITEBUFFER_H
+#define ESPCAMLIB_WRITEBUFFER_H
+#include <Arduino.h>
+#include <atomic>
+#include "esp_timer.h"
+#include "FS.h"
+
+// write-behind ring in PSRAM, one task writes into it and another drains it to a file in whole blocks,
+// so the card only ever sees large block aligned writes. The stream can be split into segments that
+// each start on a block boundary, for writing consecutive files without stopping the producer.
+// Producer and consumer positions are running byte offsets that start over at a multiple of the
+// capacity, a free running 32-bit offset would only map onto the ring across its wrap for power of
+// two sizes
+namespace EspCam
+{
+    class WriteBuffer : public Print
+    {
+    private:
+        uint8_t *m_buf = nullptr;
+        size_t m_capacity = 0;
+        size_t m_blockSize = 32768;
+        // positions run from 0 to m_wrap - 1
+        uint32_t m_wrap = 0;
+        std::atomic<uint32_t> m_head;
+        std::atomic<uint32_t> m_tail;
+        std::atomic<uint32_t> m_boundary;
+        uint32_t m_nextStart = 0;
+        TaskHandle_t m_consumer = NULL;
+        volatile bool m_closed = false;
+        volatile bool m_aborted = false;
+        size_t m_highWater = 0;
+        uint64_t m_flushed = 0;
+        uint64_t m_flushUs = 0;
+
+        void notifyConsumer()
+        {
+            if (m_consumer)
+            {
+                xTaskNotifyGive(m_consumer);
+            }
+        }
+
+        uint32_t advance(uint32_t position, size_t n)
+        {
+            uint32_t next = position + n;
+            return next >= m_wrap ? next - m_wrap : next;
+        }
+
+        uint32_t distance(uint32_t from, uint32_t to)
+        {
+            return to >= from ? to - from : to + m_wrap - from;
+        }
+
+    public:
+        static const uint32_t NO_BOUNDARY = UINT32_MAX;
+
+        WriteBuffer()
+        {
+            m_head.store(0);
+            m_tail.store(0);
+            m_boundary.store(NO_BOUNDARY);
+        }
+
+        ~WriteBuffer()
+        {
+            end();
+        }
+
+        // capacity is rounded up to a multiple of the block size so a block never wraps around the ring
+        bool begin(size_t capacity, size_t blockSize)
+        {
+            if (blockSize < 512)
+                blockSize = 512;
+            capacity = ((capacity + blockSize - 1) / blockSize) * blockSize;
+            if (capacity < 2 * blockSize)
+                capacity = 2 * blockSize;
+
+            if (!m_buf || m_capacity != capacity)
+            {
+                end();
+                m_buf = (uint8_t *)(psramFound() ? ps_malloc(capacity) : malloc(capacity));
+                if (!m_buf)
+                    return false;
+                m_capacity = capacity;
+            }
+
+            m_blockSize = blockSize;
+            // the largest multiple of the capacity that leaves room to add a capacity without overflow
+            m_wrap = (uint32_t)((0x80000000u / capacity) * capacity);
+            reset();
+            return true;
+        }
+
+        void end()
+        {
+            free(m_buf);
+            m_buf = nullptr;
+            m_capacity = 0;
+        }
+
+        // `position` is where the empty ring starts, a multiple of the block size below getWrap(). Only
+        // tests start anywhere but 0, to get close to the wrap quickly
+        void reset(uint32_t position = 0)
+        {
+            m_head.store(position);
+            m_tail.store(position);
+            m_boundary.store(NO_BOUNDARY);
+            m_closed = false;
+            m_aborted = false;
+            m_highWater = 0;
+            m_flushed = 0;
+            m_flushUs = 0;
+        }
+
+        void setConsumer(TaskHandle_t consumer)
+        {
+            m_consumer = consumer;
+        }
+
+        size_t getCapacity()
+        {
+            return m_capacity;
+        }
+
+        size_t getBlockSize()
+        {
+            return m_blockSize;
+        }
+
+        size_t buffered()
+        {
+            uint32_t tail = m_tail.load();
+            return distance(tail, m_head.load());
+        }
+
+        size_t freeSpace()
+        {
+            return m_capacity - buffered();
+        }
+
+        // largest fill level seen since begin(), shows how close the card came to falling behind
+        size_t getHighWater()
+        {
+            return m_highWater;
+        }
+
+        uint64_t getBytesFlushed()
+        {
+            return m_flushed;
+        }
+
+        // average card throughput of the flushes so far in bytes per second
+        uint32_t getFlushRate()
+        {
+            return m_flushUs ? (uint32_t)(m_flushed * 1000000 / m_flushUs) : 0;
+        }
+
+        // running byte offsets of the producer and the consumer, the gap is what is still buffered.
+        // They start over at getWrap(), compare them with isFlushed()
+        uint32_t getWritePosition()
+        {
+            return m_head.load();
+        }
+
+        uint32_t getFlushPosition()
+        {
+            return m_tail.load();
+        }
+
+        uint32_t getWrap()
+        {
+            return m_wrap;
+        }
+
+        // the consumer is past `position`, a write position taken earlier
+        bool isFlushed(uint32_t position)
+        {
+            uint32_t tail = m_tail.load();
+            uint32_t ahead = distance(tail, position);
+            return ahead == 0 || ahead > distance(tail, m_head.load());
+        }
+
+        size_t write(uint8_t c) override
+        {
+            return write(&c, 1);
+        }
+
+        // copies `len` bytes in, waiting for the consumer when the ring is full
+        size_t write(const uint8_t *data, size_t len) override
+        {
+            size_t done = 0;
+            while (done < len && !m_aborted)
+            {
+                uint32_t head = m_head.load();
+                size_t space = m_capacity - distance(m_tail.load(), head);
+                if (space == 0)
+                {
+                    notifyConsumer();
+                    vTaskDelay(1);
+                    continue;
+                }
+
+                size_t pos = head % m_capacity;
+                size_t n = len - done;
+                if (n > space)
+                    n = space;
+                if (n > m_capacity - pos)
+                    n = m_capacity - pos;
+
+                memcpy(m_buf + pos, data + done, n);
+                m_head.store(advance(head, n));
+                done += n;
+            }
+
+            size_t fill = buffered();
+            if (fill > m_highWater)
+                m_highWater = fill;
+            if (fill >= m_blockSize)
+                notifyConsumer();
+            return done;
+        }
+
+        // ends the current segment after the bytes written so far and starts the next one on a block
+        // boundary, only one segment end can be pending at a time
+        bool markSegment()
+        {
+            if (segmentPending())
+                return false;
+
+            // the wrap is a multiple of the block size, so rounding up stays on the block grid across it
+            uint32_t head = m_head.load();
+            uint32_t nextStart = advance(head, (m_blockSize - head % m_blockSize) % m_blockSize);
+            while (distance(m_tail.load(), nextStart) > m_capacity && !m_aborted)
+            {
+                notifyConsumer();
+                vTaskDelay(1);
+            }
+
+            // the boundary has to be visible before head moves past it, see flushTo()
+            m_nextStart = nextStart;
+            m_boundary.store(head);
+            m_head.store(nextStart);
+            notifyConsumer();
+            return true;
+        }
+
+        bool segmentPending()
+        {
+            return m_boundary.load() != NO_BOUNDARY;
+        }
+
+        // consumer side: everything up to the pending segment end has been flushed
+        bool atSegmentEnd()
+        {
+            uint32_t boundary = m_boundary.load();
+            return boundary != NO_BOUNDARY && m_tail.load() == boundary;
+        }
+
+        // consumer side: skips the padding and continues with the next segment
+        void nextSegment()
+        {
+            m_tail.store(m_nextStart);
+            m_boundary.store(NO_BOUNDARY);
+        }
+
+        // producer is done, the consumer drains what is left including the last partial block
+        void close()
+        {
+            m_closed = true;
+            notifyConsumer();
+        }
+
+        // unblocks the producer when the consumer has nowhere to write
+        void abort()
+        {
+            m_aborted = true;
+        }
+
+        bool isClosed()
+        {
+            return m_closed;
+        }
+
+        bool isDrained()
+        {
+            return m_closed && buffered() == 0 && !segmentPending();
+        }
+
+        void waitForData(TickType_t timeout)
+        {
+            if (buffered() < m_blockSize && !m_closed && !segmentPending())
+            {
+                ulTaskNotifyTake(pdTRUE, timeout);
+            }
+        }
+
+        // writes every complete block to `file`, and the trailing partial block too once closed
+        // or at the end of a segment
+        bool flushTo(File &file)
+        {
+            while (true)
+            {
+                // closed before head before boundary: once closed the head no longer moves, and a
+                // head past a segment end implies the boundary is already visible
+                bool closed = m_closed;
+                uint32_t head = m_head.load();
+                uint32_t boundary = m_boundary.load();
+                uint32_t tail = m_tail.load();
+                bool segmentEnd = boundary != NO_BOUNDARY;
+                size_t available = distance(tail, segmentEnd ? boundary : head);
+                size_t n = m_blockSize;
+                if (available < m_blockSize)
+                {
+                    if (!(closed || segmentEnd) || available == 0)
+                        return true;
+                    n = available;
+                }
+
+                int64_t start = esp_timer_get_time();
+                size_t written = file.write(m_buf + (tail % m_capacity), n);
+                m_flushUs += esp_timer_get_time() - start;
+                m_flushed += written;
+                m_tail.store(advance(tail, written));
+                if (written != n)
+                    return false;
+            }
+        }
+    };
+}
+#endif
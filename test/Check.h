@@ -0,0 +1,62 @@
+#ifndef ESPCAMLIB_TEST_CHECK_H
+#define ESPCAMLIB_TEST_CHECK_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// minimal assertions for the host tests, a failed check prints where and ends the test with status 1
+static int checkFailures = 0;
+
+#define CHECK(cond)                                                              \
+    do                                                                           \
+    {                                                                            \
+        if (!(cond))                                                             \
+        {                                                                        \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            checkFailures++;                                                     \
+        }                                                                        \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                                                                     \
+    do                                                                                                     \
+    {                                                                                                      \
+        long long checkA = (long long)(a), checkB = (long long)(b);                                        \
+        if (checkA != checkB)                                                                              \
+        {                                                                                                  \
+            fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #a, #b, checkA, checkB); \
+            checkFailures++;                                                                               \
+        }                                                                                                  \
+    } while (0)
+
+#define CHECK_NEAR(a, b, tolerance)                                                                              \
+    do                                                                                                           \
+    {                                                                                                            \
+        double checkA = (double)(a), checkB = (double)(b);                                                       \
+        if (checkA - checkB > (tolerance) || checkB - checkA > (tolerance))                                      \
+        {                                                                                                        \
+            fprintf(stderr, "%s:%d: CHECK_NEAR(%s, %s) failed: %g vs %g\n", __FILE__, __LINE__, #a, #b, checkA, checkB); \
+            checkFailures++;                                                                                     \
+        }                                                                                                        \
+    } while (0)
+
+// fails the test right away, for checks later steps depend on
+#define REQUIRE(cond)                                                              \
+    do                                                                             \
+    {                                                                              \
+        if (!(cond))                                                               \
+        {                                                                          \
+            fprintf(stderr, "%s:%d: REQUIRE(%s) failed\n", __FILE__, __LINE__, #cond); \
+            exit(1);                                                               \
+        }                                                                          \
+    } while (0)
+
+static int checkResult(const char *name)
+{
+    if (checkFailures)
+        fprintf(stderr, "%s: %d check(s) failed\n", name, checkFailures);
+    else
+        printf("%s: ok\n", name);
+    return checkFailures ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,145 @@
+#ifndef ESPCAMLIB_TEST_LOOPBACKCLIENT_H
+#define ESPCAMLIB_TEST_LOOPBACKCLIENT_H
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// blocking TCP client for the host tests, reads responses out of one receive buffer so a stream can
+// be parsed part by part
+class LoopbackClient
+{
+private:
+    int m_fd = -1;
+    std::string m_rx;
+
+    bool fill()
+    {
+        char buf[16384];
+        ssize_t n = recv(m_fd, buf, sizeof(buf), 0);
+        if (n <= 0)
+            return false;
+        m_rx.append(buf, n);
+        return true;
+    }
+
+public:
+    ~LoopbackClient()
+    {
+        close();
+    }
+
+    // `receiveBuffer` shrinks the socket receive buffer, to make a slow reader fill up sooner
+    bool connect(int port, int receiveBuffer = 0, int timeoutMs = 5000)
+    {
+        close();
+        m_fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (receiveBuffer)
+            setsockopt(m_fd, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer));
+        struct timeval timeout = {timeoutMs / 1000, (timeoutMs % 1000) * 1000};
+        setsockopt(m_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        for (int attempt = 0; attempt < 50; attempt++)
+        {
+            if (::connect(m_fd, (struct sockaddr *)&addr, sizeof(addr)) == 0)
+                return true;
+            usleep(20000);
+        }
+        return false;
+    }
+
+    void close()
+    {
+        if (m_fd >= 0)
+            ::close(m_fd);
+        m_fd = -1;
+        m_rx.clear();
+    }
+
+    int fd()
+    {
+        return m_fd;
+    }
+
+    bool send(const std::string &data)
+    {
+        return ::send(m_fd, data.data(), data.size(), MSG_NOSIGNAL) == (ssize_t)data.size();
+    }
+
+    // everything up to and including the next `delimiter`, without it
+    bool readUntil(const char *delimiter, std::string &out)
+    {
+        size_t pos;
+        while ((pos = m_rx.find(delimiter)) == std::string::npos)
+        {
+            if (!fill())
+                return false;
+        }
+        out = m_rx.substr(0, pos);
+        m_rx.erase(0, pos + strlen(delimiter));
+        return true;
+    }
+
+    bool readBytes(size_t len, std::string &out)
+    {
+        while (m_rx.size() < len)
+        {
+            if (!fill())
+                return false;
+        }
+        out = m_rx.substr(0, len);
+        m_rx.erase(0, len);
+        return true;
+    }
+
+    // reads until the peer closes, or the receive timeout
+    std::string readAll()
+    {
+        while (fill())
+        {
+        }
+        std::string out;
+        out.swap(m_rx);
+        return out;
+    }
+
+    // value of `name` in a response head, empty when missing
+    static std::string header(const std::string &head, const char *name)
+    {
+        std::string key = std::string("\r\n") + name + ":";
+        size_t pos = head.find(key);
+        if (pos == std::string::npos)
+            return "";
+        pos = head.find_first_not_of(' ', pos + key.size());
+        size_t end = head.find("\r\n", pos);
+        return head.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+    }
+
+    // one request with a Content-Length response, `head` gets the status line and headers
+    bool request(int port, const std::string &method, const std::string &uri, std::string &head, std::string &body,
+                 const std::string &extraHeaders = "", const std::string &content = "")
+    {
+        if (!connect(port))
+            return false;
+        std::string req = method + " " + uri + " HTTP/1.1\r\nHost: 127.0.0.1\r\n" + extraHeaders;
+        if (!content.empty())
+            req += "Content-Length: " + std::to_string(content.size()) + "\r\n";
+        req += "\r\n" + content;
+        if (!send(req) || !readUntil("\r\n\r\n", head))
+            return false;
+        std::string length = header(head, "Content-Length");
+        bool ok = readBytes(length.empty() ? 0 : strtoul(length.c_str(), nullptr, 10), body);
+        close();
+        return ok;
+    }
+};
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef ESPCAMLIB_TEST_ALLOCCOUNT_H
+#define ESPCAMLIB_TEST_ALLOCCOUNT_H
+#include <stdlib.h>
+#include <stdint.h>
+#include <atomic>
+
+// counts heap allocations by taking over malloc, calloc and realloc from glibc, operator new goes through
+// malloc too. Include it in one benchmark source only, it defines the functions
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+
+static std::atomic<uint64_t> benchAllocs{0};
+static thread_local uint64_t benchThreadAllocs = 0;
+
+extern "C" void *malloc(size_t size)
+{
+    benchAllocs++;
+    benchThreadAllocs++;
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+    benchAllocs++;
+    benchThreadAllocs++;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+    benchAllocs++;
+    benchThreadAllocs++;
+    return __libc_realloc(ptr, size);
+}
+
+// all threads, e.g. for work done on an httpd task
+inline uint64_t benchAllocations()
+{
+    return benchAllocs.load();
+}
+
+// the calling thread only
+inline uint64_t benchThreadAllocations()
+{
+    return benchThreadAllocs;
+}
+
+#endif
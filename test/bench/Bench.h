@@ -0,0 +1,27 @@
+#ifndef ESPCAMLIB_TEST_BENCH_H
+#define ESPCAMLIB_TEST_BENCH_H
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <stdint.h>
+
+// shared by the host benchmarks. Numbers are host CPU numbers, useful to compare two versions of the
+// same code, not to predict ESP32 timings. --quick runs a short workload, as ctest does
+static bool benchQuick(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--quick") == 0)
+            return true;
+    }
+    return false;
+}
+
+static int64_t benchNowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+#endif
@@ -0,0 +1,67 @@
+#include "JpegEncoder.h"
+#include "Bench.h"
+#include <math.h>
+#include <vector>
+
+// software JPEG encode time per frame for the raw formats at QVGA and VGA, quality 80
+using namespace EspCam;
+
+int main(int argc, char **argv)
+{
+    int iterations = benchQuick(argc, argv) ? 5 : 100;
+    const int sizes[][2] = {{320, 240}, {640, 480}};
+    const pixformat_t formats[] = {PIXFORMAT_RGB565, PIXFORMAT_YUV422, PIXFORMAT_GRAYSCALE};
+    const char *names[] = {"rgb565", "yuv422", "gray"};
+    JpegEncoder encoder(80);
+
+    for (const int *size : sizes)
+    {
+        int w = size[0], h = size[1];
+        for (int f = 0; f < 3; f++)
+        {
+            int bpp = formats[f] == PIXFORMAT_GRAYSCALE ? 1 : 2;
+            std::vector<uint8_t> frame((size_t)w * h * bpp);
+            // smooth gradients with a checkerboard, roughly the entropy of a camera frame
+            for (int y = 0; y < h; y++)
+            {
+                for (int x = 0; x < w; x++)
+                {
+                    int r = (int)(127 + 120 * sin(x * 0.03 + y * 0.01)), g = x * 255 / w, b = y * 255 / h;
+                    if (((x / 40) + (y / 40)) & 1)
+                        r = 255 - r;
+                    uint8_t *p = &frame[((size_t)y * w + x) * bpp];
+                    int luma = (77 * r + 150 * g + 29 * b) >> 8;
+                    if (formats[f] == PIXFORMAT_RGB565)
+                    {
+                        uint16_t v = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+                        p[0] = v >> 8;
+                        p[1] = v & 0xFF;
+                    }
+                    else if (formats[f] == PIXFORMAT_YUV422)
+                    {
+                        p[0] = luma;
+                        p[1] = x & 1 ? ((128 * r - 107 * g - 21 * b) >> 8) + 128 : ((-43 * r - 85 * g + 128 * b) >> 8) + 128;
+                    }
+                    else
+                    {
+                        p[0] = luma;
+                    }
+                }
+            }
+
+            uint8_t *out = nullptr;
+            size_t capacity = 0, length = 0;
+            if (!encoder.encode(frame.data(), w, h, formats[f], out, capacity, length))
+                return 1;
+            int64_t start = benchNowNs();
+            for (int i = 0; i < iterations; i++)
+            {
+                encoder.encode(frame.data(), w, h, formats[f], out, capacity, length);
+            }
+            double ms = (benchNowNs() - start) / 1e6 / iterations;
+            printf("%-7s %dx%d  %6.2f ms/frame  %6zu bytes\n", names[f], w, h, ms, length);
+            free(out);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include "EspCamLib.h"
+#include "host_camera.h"
+#include "Bench.h"
+#include <vector>
+
+// MotionDetector::analyze() per frame size on JPEG frames from the synthetic sensor: the DC-only decode of
+// the luminance plus the cell grid and background compare. A few captured frames are analyzed in turn so
+// the background keeps changing
+using namespace EspCam;
+
+static const int FRAMES_PER_SIZE = 4;
+
+int main(int argc, char **argv)
+{
+    int iterations = benchQuick(argc, argv) ? 8 : 200;
+    const framesize_t sizes[] = {FRAMESIZE_QVGA, FRAMESIZE_VGA, FRAMESIZE_SVGA, FRAMESIZE_XGA, FRAMESIZE_SXGA, FRAMESIZE_UXGA};
+    const char *names[] = {"QVGA", "VGA", "SVGA", "XGA", "SXGA", "UXGA"};
+
+    Camera camera;
+    camera.setFrameSize(FRAMESIZE_QVGA);
+    if (!camera.begin() || !camera.getBroker()->begin())
+        return 1;
+    FrameBroker *broker = camera.getBroker();
+
+    for (int s = 0; s < (int)(sizeof(sizes) / sizeof(sizes[0])); s++)
+    {
+        // frame size changes are applied by the capture task, which only runs while frames are wanted.
+        // It stops again before the timing so it does not compete for the CPU
+        broker->addDemand();
+        uint32_t ticket = camera.setFrameSize(sizes[s]);
+        if (!camera.waitForSensor(ticket, pdMS_TO_TICKS(5000)))
+            return 1;
+
+        std::vector<FrameRef> frames;
+        uint32_t lastSeq = 0;
+        size_t bytes = 0;
+        while ((int)frames.size() < FRAMES_PER_SIZE)
+        {
+            FrameRef frame = broker->acquire(lastSeq, pdMS_TO_TICKS(5000));
+            if (!frame)
+                return 1;
+            lastSeq = frame.sequence();
+            if (frame.fb()->width != resolution[sizes[s]].width)
+                continue;
+            bytes += frame.length();
+            frames.push_back(frame);
+        }
+        broker->removeDemand();
+
+        MotionDetector detector(&camera);
+        MotionResult result;
+        if (!detector.analyze(frames[0], result))
+            return 1;
+        int64_t start = benchNowNs();
+        for (int i = 0; i < iterations; i++)
+        {
+            detector.analyze(frames[i % FRAMES_PER_SIZE], result);
+        }
+        double ms = (benchNowNs() - start) / 1e6 / iterations;
+        printf("%-5s %4dx%-4d %6zu bytes  %3dx%-3d cells  %7.3f ms/frame\n", names[s], resolution[sizes[s]].width,
+               resolution[sizes[s]].height, bytes / FRAMES_PER_SIZE, result.cellsX, result.cellsY, ms);
+    }
+
+    broker->stop();
+    return 0;
+}
@@ -0,0 +1,129 @@
+#include "Multipart.h"
+#include "Bench.h"
+#include "AllocCount.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+// MJPEG part framing over a loopback TCP socket with a reader draining it: the part built in a heap string
+// and sent as three HTTP chunks, as the stream handlers did before MultipartWriter, against one gathered
+// write per part. Allocations are counted on the sending thread only
+using namespace EspCam;
+
+static const size_t FRAME_BYTES = 24 * 1024;
+
+static std::atomic<bool> draining{true};
+
+static void drain(int fd)
+{
+    char buf[65536];
+    while (draining)
+    {
+        if (recv(fd, buf, sizeof(buf), 0) <= 0)
+            break;
+    }
+}
+
+static bool sendAll(int fd, const char *data, size_t len)
+{
+    while (len)
+    {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n <= 0)
+            return false;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+// httpd_resp_send_chunk(): the chunk size line, the data and the chunk's CRLF
+static bool sendChunk(int fd, const char *data, size_t len)
+{
+    char sizeLine[16];
+    int n = snprintf(sizeLine, sizeof(sizeLine), "%x\r\n", (unsigned)len);
+    return sendAll(fd, sizeLine, n) && sendAll(fd, data, len) && sendAll(fd, "\r\n", 2);
+}
+
+static bool stringPart(int fd, const uint8_t *frame, size_t len)
+{
+    std::string header = "--frame\r\nContent-Type: image/jpeg\r\nContent-Length: ";
+    header += std::to_string(len);
+    header += "\r\n\r\n";
+    return sendChunk(fd, header.c_str(), header.length()) && sendChunk(fd, (const char *)frame, len) &&
+           sendChunk(fd, "\r\n", 2);
+}
+
+// a connected loopback pair, `server` is the sending side
+static bool connectPair(int &server, int &client)
+{
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addrLen = sizeof(addr);
+    if (bind(listener, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listener, 1) != 0 ||
+        getsockname(listener, (struct sockaddr *)&addr, &addrLen) != 0)
+        return false;
+    client = socket(AF_INET, SOCK_STREAM, 0);
+    if (connect(client, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+        return false;
+    server = accept(listener, NULL, NULL);
+    close(listener);
+    return server >= 0;
+}
+
+template <typename SendPart>
+static bool run(const char *name, const std::vector<uint8_t> &frame, int frames, SendPart sendPart)
+{
+    int server, client;
+    if (!connectPair(server, client))
+        return false;
+    draining = true;
+    std::thread reader(drain, client);
+
+    // one part first so the socket buffers have grown
+    if (!sendPart(server, frame.data(), frame.size()))
+        return false;
+    uint64_t allocs = benchThreadAllocations();
+    int64_t start = benchNowNs();
+    for (int i = 0; i < frames; i++)
+    {
+        if (!sendPart(server, frame.data(), frame.size()))
+            return false;
+    }
+    double seconds = (benchNowNs() - start) / 1e9;
+    allocs = benchThreadAllocations() - allocs;
+
+    draining = false;
+    shutdown(server, SHUT_RDWR);
+    reader.join();
+    close(server);
+    close(client);
+    printf("%-16s %8.1f MB/s  %7.0f parts/s  %5.2f allocs/part\n", name, frames * frame.size() / seconds / 1e6,
+           frames / seconds, (double)allocs / frames);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    int frames = benchQuick(argc, argv) ? 200 : 5000;
+    std::vector<uint8_t> frame(FRAME_BYTES);
+    for (size_t i = 0; i < frame.size(); i++)
+    {
+        frame[i] = (uint8_t)(i * 131 + (i >> 8));
+    }
+
+    bool ok = run("string+chunks", frame, frames, stringPart);
+    ok = ok && run("MultipartWriter", frame, frames, [](int fd, const uint8_t *data, size_t len) {
+             MultipartWriter writer(fd);
+             return writer.writeFrame(data, len) == ESP_OK;
+         });
+    return ok ? 0 : 1;
+}
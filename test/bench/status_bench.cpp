@@ -0,0 +1,134 @@
+#include "EspCamLib.h"
+#include "host_camera.h"
+#include "Bench.h"
+#include "AllocCount.h"
+#include "../LoopbackClient.h"
+#include <string>
+
+// GET /status on one keep-alive loopback connection: the JSON built per request in a heap string from the
+// same sources, as the handler did before the sampled snapshot, against the snapshot WebServer serves now.
+// Allocations are the ones made on threads other than the client, which is the httpd stand-in and the
+// camera tasks, so both runs carry the stand-in's own per-request allocations
+using namespace EspCam;
+
+static const int PORT = 18100;
+static const int BASELINE_PORT = 18110;
+
+static WebServer *server = nullptr;
+static MetricsRate baselineRate;
+
+static std::string fixed(float value)
+{
+    char buf[24];
+    snprintf(buf, sizeof(buf), "%.1f", value);
+    return buf;
+}
+
+static esp_err_t stringStatusHandler(httpd_req_t *req)
+{
+    Camera *camera = static_cast<Camera *>(req->user_ctx);
+    baselineRate.update(camera->getBroker()->getMetrics()->snapshot());
+    float kbps = (baselineRate.getBytesPerSec() * 8.0f) / 1024.0f;
+    IPAddress ip = WiFi.localIP();
+    std::string json = "{";
+    json += "\"heap\":" + std::to_string(ESP.getFreeHeap() + ESP.getFreePsram()) + ",";
+    json += "\"rssi\":" + std::to_string(WiFi.RSSI()) + ",";
+    json += "\"kbps\":" + fixed(kbps) + ",";
+    json += "\"ip\":\"" + std::to_string(ip[0]) + "." + std::to_string(ip[1]) + "." + std::to_string(ip[2]) + "." +
+            std::to_string(ip[3]) + "\"";
+    StreamClientStats clients[StreamBroadcaster::MAX_CLIENTS];
+    int count = server->getStreamClientStats(clients, StreamBroadcaster::MAX_CLIENTS);
+    json += ",\"clients\":[";
+    for (int i = 0; i < count; i++)
+    {
+        if (i > 0)
+            json += ",";
+        json += "{\"fps\":" + fixed(clients[i].fps);
+        json += ",\"sent\":" + std::to_string(clients[i].framesSent);
+        json += ",\"dropped\":" + std::to_string(clients[i].framesDropped) + "}";
+    }
+    json += "]";
+    RateControlState rate = server->getRateState();
+    json += ",\"abr\":{\"enabled\":" + std::string(rate.enabled ? "true" : "false");
+    json += ",\"level\":" + std::to_string(rate.level);
+    json += ",\"maxLevel\":" + std::to_string(rate.maxLevel);
+    json += ",\"quality\":" + std::to_string(rate.quality);
+    json += ",\"framesize\":" + std::to_string(rate.frameSize);
+    json += ",\"fps\":" + fixed(rate.fps);
+    json += ",\"capacity\":" + fixed(rate.capacityFps);
+    json += ",\"sendUs\":" + std::to_string(rate.avgSendUs) + "}";
+    json += "}";
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    return httpd_resp_send(req, json.c_str(), json.length());
+}
+
+static bool get(LoopbackClient &client, std::string &body)
+{
+    std::string head;
+    if (!client.send("GET /status HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n") || !client.readUntil("\r\n\r\n", head))
+        return false;
+    std::string length = LoopbackClient::header(head, "Content-Length");
+    return client.readBytes(strtoul(length.c_str(), nullptr, 10), body);
+}
+
+static bool run(const char *name, int port, int requests)
+{
+    LoopbackClient client;
+    std::string body;
+    if (!client.connect(port) || !get(client, body))
+        return false;
+
+    uint64_t allocs = benchAllocations() - benchThreadAllocations();
+    int64_t start = benchNowNs();
+    for (int i = 0; i < requests; i++)
+    {
+        if (!get(client, body))
+            return false;
+    }
+    double seconds = (benchNowNs() - start) / 1e9;
+    allocs = benchAllocations() - benchThreadAllocations() - allocs;
+    printf("%-9s %8.0f requests/s  %5.1f server allocs/request  %zu bytes\n", name, requests / seconds,
+           (double)allocs / requests, body.size());
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    int requests = benchQuick(argc, argv) ? 300 : 20000;
+    Camera camera;
+    camera.setFrameSize(FRAMESIZE_QVGA);
+    if (!camera.begin())
+        return 1;
+
+    server = new WebServer(&camera);
+    server->setBroadcast(true);
+    server->setAdaptiveRate(true);
+    if (!server->begin(PORT))
+        return 1;
+
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = BASELINE_PORT;
+    httpd_handle_t baseline = NULL;
+    httpd_uri_t uri = {"/status", HTTP_GET, stringStatusHandler, &camera};
+    if (httpd_start(&baseline, &config) != ESP_OK || httpd_register_uri_handler(baseline, &uri) != ESP_OK)
+        return 1;
+
+    // the snapshot is published by the status task shortly after begin()
+    LoopbackClient client;
+    std::string body = "{}";
+    for (int i = 0; i < 100 && body == "{}"; i++)
+    {
+        vTaskDelay(pdMS_TO_TICKS(20));
+        if (!client.connect(PORT) || !get(client, body))
+            return 1;
+    }
+    client.close();
+
+    bool ok = run("string", BASELINE_PORT, requests) && run("snapshot", PORT, requests);
+    httpd_stop(baseline);
+    delete server;
+    return ok ? 0 : 1;
+}
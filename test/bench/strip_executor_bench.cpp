@@ -0,0 +1,95 @@
+#include "StripExecutor.h"
+#include "JpegEncoder.h"
+#include "Bench.h"
+#include <math.h>
+#include <vector>
+
+// one worker against two for the RGB565 conversions and the banded JPEG encode. The ratio only means
+// something with at least two host CPUs free, and the host has no PSRAM bandwidth limit like the ESP32
+using namespace EspCam;
+
+struct EncodeJob
+{
+    const JpegEncoder *encoder;
+    StripExecutor *executor;
+    const uint8_t *src;
+    int width;
+    int height;
+    uint8_t *out;
+    size_t capacity;
+    size_t length;
+    uint8_t *spill;
+    size_t spillCapacity;
+};
+
+static double timeKernel(StripExecutor &executor, StripKernel kernel, PixelJob &job, int rows, int iterations)
+{
+    executor.run(kernel, &job, rows);
+    int64_t start = benchNowNs();
+    for (int i = 0; i < iterations; i++)
+    {
+        executor.run(kernel, &job, rows);
+    }
+    return (benchNowNs() - start) / 1e6 / iterations;
+}
+
+static double timeEncode(EncodeJob &job, bool banded, int iterations)
+{
+    double ms = 0;
+    for (int i = -1; i < iterations; i++)
+    {
+        int64_t start = benchNowNs();
+        if (banded)
+            job.encoder->encode(job.src, job.width, job.height, PIXFORMAT_RGB565, job.out, job.capacity, job.length,
+                                *job.executor, job.spill, job.spillCapacity);
+        else
+            job.encoder->encode(job.src, job.width, job.height, PIXFORMAT_RGB565, job.out, job.capacity, job.length);
+        if (i >= 0)
+            ms += (benchNowNs() - start) / 1e6;
+    }
+    return ms / iterations;
+}
+
+int main(int argc, char **argv)
+{
+    int iterations = benchQuick(argc, argv) ? 3 : 50;
+    const int sizes[][2] = {{320, 240}, {640, 480}, {1600, 1200}};
+    StripExecutor single, dual;
+    if (!single.begin(1, 1600 * 2) || !dual.begin(2, 1600 * 2))
+        return 1;
+    JpegEncoder encoder(80);
+
+    for (const int *size : sizes)
+    {
+        int w = size[0], h = size[1];
+        std::vector<uint8_t> src((size_t)w * h * 2), dst((size_t)w * h * 3);
+        for (int y = 0; y < h; y++)
+        {
+            for (int x = 0; x < w; x++)
+            {
+                int r = (int)(127 + 120 * sin(x * 0.03 + y * 0.01)), g = x * 255 / w, b = y * 255 / h;
+                uint16_t v = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+                src[((size_t)y * w + x) * 2] = v >> 8;
+                src[((size_t)y * w + x) * 2 + 1] = v & 0xFF;
+            }
+        }
+
+        PixelJob job = {src.data(), dst.data(), (uint16_t)w};
+        double gray1 = timeKernel(single, PixelKernels::rgb565ToGray, job, h, iterations);
+        double gray2 = timeKernel(dual, PixelKernels::rgb565ToGray, job, h, iterations);
+        double rgb1 = timeKernel(single, PixelKernels::rgb565ToRgb888, job, h, iterations);
+        double rgb2 = timeKernel(dual, PixelKernels::rgb565ToRgb888, job, h, iterations);
+
+        EncodeJob encode = {&encoder, &dual, src.data(), w, h, nullptr, 0, 0, nullptr, 0};
+        double jpeg1 = timeEncode(encode, false, iterations);
+        double jpeg2 = timeEncode(encode, true, iterations);
+        free(encode.out);
+        free(encode.spill);
+
+        printf("%4dx%-4d gray %6.3f -> %6.3f ms (%.2fx)  rgb888 %6.3f -> %6.3f ms (%.2fx)  jpeg %6.2f -> %6.2f ms (%.2fx)\n",
+               w, h, gray1, gray2, gray1 / gray2, rgb1, rgb2, rgb1 / rgb2, jpeg1, jpeg2, jpeg1 / jpeg2);
+    }
+    single.stop();
+    dual.stop();
+    return 0;
+}
@@ -0,0 +1,205 @@
+#include "EspCamLib.h"
+#include "host_camera.h"
+#include "Bench.h"
+#include "../LoopbackClient.h"
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+// the same frames streamed by one broadcaster to a WebSocket viewer and a multipart viewer at once, each
+// read on its own thread. Latency is from the capture timestamp to the last byte of the frame arriving at
+// the client. Multipart parts carry no timestamp, so they are matched to the WebSocket message with the
+// same JPEG bytes afterwards. The host stand-in has no WebSocket support, so /ws skips the upgrade
+// handshake, a one-off cost per connection that does not change the per-frame numbers. The viewer never
+// acks, which leaves it limited by its socket like the multipart one
+using namespace EspCam;
+
+static const int PORT = 18120;
+static const int FPS = 20;
+
+static StreamBroadcaster *broadcaster = nullptr;
+
+struct Arrival
+{
+    uint64_t hash;
+    int64_t timestamp;
+    int64_t receivedUs;
+    size_t jpegBytes;
+    size_t wireBytes;
+};
+
+static esp_err_t wsHandler(httpd_req_t *req)
+{
+    return broadcaster->addClient(httpd_req_to_sockfd(req), true) ? ESP_OK : ESP_FAIL;
+}
+
+static esp_err_t streamHandler(httpd_req_t *req)
+{
+    MultipartWriter writer(req);
+    if (writer.begin(req) != ESP_OK)
+        return ESP_FAIL;
+    return broadcaster->addClient(writer.getSocket()) ? ESP_OK : ESP_FAIL;
+}
+
+static void closeHandler(httpd_handle_t hd, int sockfd)
+{
+    broadcaster->removeClient(sockfd);
+    close(sockfd);
+}
+
+static uint64_t hashBytes(const char *data, size_t len)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++)
+    {
+        hash = (hash ^ (uint8_t)data[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+static void readWebSocket(LoopbackClient *client, int64_t until, std::vector<Arrival> *arrivals)
+{
+    std::string head, ext, payload;
+    while (esp_timer_get_time() < until && client->readBytes(2, head))
+    {
+        uint64_t len = (uint8_t)head[1];
+        ext.clear();
+        if (len >= 126)
+        {
+            if (!client->readBytes(len == 126 ? 2 : 8, ext))
+                break;
+            len = 0;
+            for (char c : ext)
+            {
+                len = (len << 8) | (uint8_t)c;
+            }
+        }
+        if (len < WebSocketFraming::FRAME_HEADER_LEN || !client->readBytes(len, payload))
+            break;
+        int64_t now = esp_timer_get_time();
+        uint64_t timestamp = 0;
+        for (int i = 11; i >= 4; i--)
+        {
+            timestamp = (timestamp << 8) | (uint8_t)payload[i];
+        }
+        const char *jpeg = payload.data() + WebSocketFraming::FRAME_HEADER_LEN;
+        size_t jpegLen = len - WebSocketFraming::FRAME_HEADER_LEN;
+        arrivals->push_back({hashBytes(jpeg, jpegLen), (int64_t)timestamp, now, jpegLen, 2 + ext.size() + len});
+    }
+}
+
+static void readMultipart(LoopbackClient *client, int64_t until, std::vector<Arrival> *arrivals)
+{
+    std::string head, data;
+    while (esp_timer_get_time() < until && client->readUntil("\r\n\r\n", head))
+    {
+        std::string length = LoopbackClient::header("\r\n" + head, "Content-Length");
+        size_t len = strtoul(length.c_str(), nullptr, 10);
+        if (length.empty() || !client->readBytes(len + 2, data))
+            break;
+        arrivals->push_back({hashBytes(data.data(), len), 0, esp_timer_get_time(), len, head.size() + 4 + len + 2});
+    }
+}
+
+// the test pattern repeats every 16 frames: the frame a part carries is the newest WebSocket message with
+// the same bytes captured before the part arrived, and no more than half a pattern cycle earlier
+static bool match(const std::vector<Arrival> &ws, Arrival &part)
+{
+    const int64_t horizon = 8 * 1000000 / FPS;
+    for (auto it = ws.rbegin(); it != ws.rend(); ++it)
+    {
+        if (it->hash == part.hash && it->timestamp <= part.receivedUs)
+        {
+            part.timestamp = it->timestamp;
+            return part.receivedUs - it->timestamp < horizon;
+        }
+    }
+    return false;
+}
+
+static void report(const char *name, const std::vector<Arrival> &arrivals, size_t skipped)
+{
+    std::vector<int64_t> latency;
+    uint64_t jpegBytes = 0, wireBytes = 0;
+    for (const Arrival &arrival : arrivals)
+    {
+        if (!arrival.timestamp)
+            continue;
+        latency.push_back(arrival.receivedUs - arrival.timestamp);
+        jpegBytes += arrival.jpegBytes;
+        wireBytes += arrival.wireBytes;
+    }
+    if (latency.empty())
+    {
+        printf("%-9s no frames\n", name);
+        return;
+    }
+    std::sort(latency.begin(), latency.end());
+    int64_t sum = 0;
+    for (int64_t us : latency)
+    {
+        sum += us;
+    }
+    size_t n = latency.size();
+    printf("%-9s %5zu frames  latency avg %6.2f  p50 %6.2f  p95 %6.2f  max %6.2f ms  %7.0f bytes/frame  "
+           "%4.1f framing bytes/frame",
+           name, n, sum / 1000.0 / n, latency[n / 2] / 1000.0, latency[n * 95 / 100] / 1000.0, latency[n - 1] / 1000.0,
+           (double)wireBytes / n, (double)(wireBytes - jpegBytes) / n);
+    if (skipped)
+        printf("  (%zu unmatched)", skipped);
+    printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+    int seconds = benchQuick(argc, argv) ? 2 : 20;
+    HostCamera::setFrameRate(FPS);
+    Camera camera;
+    camera.setFrameSize(FRAMESIZE_VGA);
+    if (!camera.begin() || !camera.getBroker()->begin())
+        return 1;
+
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = PORT;
+    config.close_fn = closeHandler;
+    httpd_handle_t server = NULL;
+    httpd_uri_t ws = {"/ws", HTTP_GET, wsHandler, NULL};
+    httpd_uri_t stream = {"/stream", HTTP_GET, streamHandler, NULL};
+    if (httpd_start(&server, &config) != ESP_OK || httpd_register_uri_handler(server, &ws) != ESP_OK ||
+        httpd_register_uri_handler(server, &stream) != ESP_OK)
+        return 1;
+    broadcaster = new StreamBroadcaster(camera.getBroker());
+    if (!broadcaster->begin(server))
+        return 1;
+
+    LoopbackClient wsClient, streamClient;
+    std::string head;
+    if (!wsClient.connect(PORT) || !wsClient.send("GET /ws HTTP/1.1\r\n\r\n") || !streamClient.connect(PORT) ||
+        !streamClient.send("GET /stream HTTP/1.1\r\n\r\n") || !streamClient.readUntil("\r\n\r\n", head))
+        return 1;
+
+    std::vector<Arrival> wsArrivals, streamArrivals;
+    int64_t until = esp_timer_get_time() + (int64_t)seconds * 1000000;
+    std::thread wsReader(readWebSocket, &wsClient, until, &wsArrivals);
+    std::thread streamReader(readMultipart, &streamClient, until, &streamArrivals);
+    wsReader.join();
+    streamReader.join();
+
+    size_t skipped = 0;
+    for (Arrival &part : streamArrivals)
+    {
+        if (!match(wsArrivals, part))
+        {
+            part.timestamp = 0;
+            skipped++;
+        }
+    }
+    report("websocket", wsArrivals, 0);
+    report("multipart", streamArrivals, skipped);
+
+    broadcaster->stop();
+    httpd_stop(server);
+    delete broadcaster;
+    return wsArrivals.empty() || streamArrivals.size() == skipped ? 1 : 0;
+}
@@ -0,0 +1,144 @@
+#include "AviWriter.h"
+#include "WriteBuffer.h"
+#include "Bench.h"
+#include <SD.h>
+#include <vector>
+
+// AVI frames written to the directory backed SD card straight from the producer, as the Recorder did
+// before WriteBuffer, against the ring flushed in 32 KB blocks by a second task. stdio already buffers the
+// stand-in's writes, and the producer waits for room in 1 ms ticks, so host MB/s is far from a card's and
+// only shows neither side stalls. The card writes per frame is what carries over to the device, where
+// every write is its own SDMMC transaction
+using namespace EspCam;
+
+static const size_t BLOCK_SIZE = 32 * 1024;
+static const size_t BUFFER_SIZE = 256 * 1024;
+
+// forwards to the file and counts the calls that reach it
+class CountingPrint : public Print
+{
+public:
+    File *file;
+    uint32_t writes = 0;
+
+    size_t write(uint8_t c) override
+    {
+        return write(&c, 1);
+    }
+
+    size_t write(const uint8_t *data, size_t len) override
+    {
+        writes++;
+        return file->write(data, len);
+    }
+};
+
+struct Flusher
+{
+    WriteBuffer *buffer;
+    File *file;
+    volatile bool done;
+};
+
+static void flushTask(void *param)
+{
+    Flusher *flusher = static_cast<Flusher *>(param);
+    while (!flusher->buffer->isDrained())
+    {
+        flusher->buffer->waitForData(pdMS_TO_TICKS(100));
+        if (!flusher->buffer->flushTo(*flusher->file))
+        {
+            flusher->buffer->abort();
+            break;
+        }
+    }
+    flusher->done = true;
+    vTaskDelete(NULL);
+}
+
+static void report(const char *name, const std::vector<size_t> &lengths, int64_t ns, double writes)
+{
+    uint64_t bytes = 0;
+    for (size_t len : lengths)
+    {
+        bytes += len;
+    }
+    printf("%-12s %8.1f MB/s  %7.0f frames/s  %6.2f card writes/frame\n", name, bytes / (ns / 1e9) / 1e6,
+           lengths.size() / (ns / 1e9), writes / lengths.size());
+}
+
+static bool direct(const std::vector<uint8_t> &data, const std::vector<size_t> &lengths)
+{
+    File file = SD.open("/direct.avi", FILE_WRITE);
+    if (!file)
+        return false;
+    CountingPrint out;
+    out.file = &file;
+    AviWriter avi;
+    int64_t start = benchNowNs();
+    bool ok = avi.begin(&out, 640, 480, 20);
+    for (size_t len : lengths)
+    {
+        ok = ok && avi.addFrame(data.data(), len);
+    }
+    file.close();
+    report("direct", lengths, benchNowNs() - start, out.writes);
+    return ok;
+}
+
+static bool buffered(const std::vector<uint8_t> &data, const std::vector<size_t> &lengths)
+{
+    File file = SD.open("/buffered.avi", FILE_WRITE);
+    WriteBuffer buffer;
+    if (!file || !buffer.begin(BUFFER_SIZE, BLOCK_SIZE))
+        return false;
+    Flusher flusher = {&buffer, &file, false};
+    TaskHandle_t handle = NULL;
+    if (xTaskCreatePinnedToCore(flushTask, "Flush", 4096, &flusher, 5, &handle, 1) != pdPASS)
+        return false;
+    buffer.setConsumer(handle);
+
+    AviWriter avi;
+    int64_t start = benchNowNs();
+    bool ok = avi.begin(&buffer, 640, 480, 20);
+    for (size_t len : lengths)
+    {
+        ok = ok && avi.addFrame(data.data(), len);
+    }
+    buffer.close();
+    while (!flusher.done)
+    {
+        vTaskDelay(1);
+    }
+    int64_t ns = benchNowNs() - start;
+    file.close();
+    report("WriteBuffer", lengths, ns, (double)((buffer.getBytesFlushed() + BLOCK_SIZE - 1) / BLOCK_SIZE));
+    return ok && buffer.getBytesFlushed() == avi.getSize();
+}
+
+int main(int argc, char **argv)
+{
+    int frames = benchQuick(argc, argv) ? 300 : 5000;
+    char root[] = "/tmp/espcam_benchXXXXXX";
+    if (!mkdtemp(root) || !SD.begin(root))
+        return 1;
+
+    // VGA sized JPEGs, some with odd lengths that take a pad byte
+    std::vector<uint8_t> data(32 * 1024);
+    for (size_t i = 0; i < data.size(); i++)
+    {
+        data[i] = (uint8_t)(i * 7 + (i >> 9));
+    }
+    std::vector<size_t> lengths;
+    for (int i = 0; i < frames; i++)
+    {
+        lengths.push_back(20000 + (i * 2654435761u) % 8000);
+    }
+
+    bool ok = direct(data, lengths) && buffered(data, lengths);
+
+    char command[64];
+    snprintf(command, sizeof(command), "rm -rf %s", root);
+    ok = system(command) == 0 && ok;
+    return ok ? 0 : 1;
+}
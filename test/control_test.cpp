@@ -0,0 +1,83 @@
+#include "EspCamLib.h"
+#include "host_camera.h"
+#include "Check.h"
+#include "LoopbackClient.h"
+
+// the /control dispatch and the camera calls behind it, with the broker running so sensor writes are
+// queued and come back with tickets
+using namespace EspCam;
+
+static const uint32_t UNTOUCHED = 0xC0FFEE;
+static const int PORT = 18094;
+
+// settings the sensor driver has no setter for are reported instead of silently doing nothing
+static void checkUnsupported(Camera &camera)
+{
+    uint32_t ticket = UNTOUCHED;
+    CHECK_EQ(CameraControl::apply(&camera, "sharpness", 1, ticket), CONTROL_UNSUPPORTED);
+    CHECK_EQ(CameraControl::apply(&camera, "denoise", 1, ticket), CONTROL_UNSUPPORTED);
+    CHECK_EQ(ticket, UNTOUCHED);
+    CHECK_EQ(CameraControl::apply(&camera, "contrast", 1, ticket), CONTROL_OK);
+    CHECK(camera.waitForSensor(ticket));
+    CHECK_EQ(esp_camera_sensor_get()->status.contrast, 1);
+}
+
+// keys are echoed in the JSON reply, a key with quotes or backslashes must not break out of its string
+static void checkEchoedKeys(Camera &camera)
+{
+    WebServer server(&camera);
+    REQUIRE(server.begin(PORT));
+
+    LoopbackClient client;
+    std::string head, body;
+    REQUIRE(client.request(PORT, "GET", "/control?brightness=1&a\"b\\=1&sharpness=2", head, body));
+    CHECK(head.find("200 OK") != std::string::npos);
+    CHECK(body == "{\"brightness\":\"ok\",\"a\\\"b\\\\\":\"unknown\",\"sharpness\":\"unsupported\"}");
+}
+
+static void checkRegion(Camera &camera)
+{
+    uint32_t ticket = 0;
+    CHECK_EQ(CameraControl::apply(&camera, "roi_x", 1200, ticket), CONTROL_OK);
+    CHECK(ticket != 0);
+    CHECK(camera.waitForSensor(ticket));
+    CameraRegion active = camera.getRegionOfInterest();
+    CHECK(active.active);
+
+    // a rejected region keeps the current one and leaves the ticket of earlier keys alone
+    ticket = UNTOUCHED;
+    CHECK(!camera.setRegionOfInterest(0, 0, 400, 300, FRAMESIZE_INVALID, ticket));
+    CHECK_EQ(ticket, UNTOUCHED);
+    CHECK(camera.getRegionOfInterest().active);
+    CHECK_EQ(camera.getRegionOfInterest().x, active.x);
+    CHECK_EQ(CameraControl::apply(&camera, "roi_size", FRAMESIZE_INVALID, ticket), CONTROL_FAILED);
+    CHECK_EQ(ticket, UNTOUCHED);
+
+    CHECK_EQ(CameraControl::apply(&camera, "zoom", 200, ticket), CONTROL_OK);
+    CHECK(ticket != UNTOUCHED);
+    CHECK(camera.waitForSensor(ticket));
+    CHECK_EQ(camera.getRegionOfInterest().width, 800);
+
+    CHECK_EQ(CameraControl::apply(&camera, "roi", 0, ticket), CONTROL_OK);
+    CHECK(!camera.getRegionOfInterest().active);
+    // clearing again writes nothing to the sensor, so there is no ticket to replace
+    ticket = UNTOUCHED;
+    CHECK_EQ(CameraControl::apply(&camera, "roi", 0, ticket), CONTROL_OK);
+    CHECK_EQ(CameraControl::apply(&camera, "zoom", 100, ticket), CONTROL_OK);
+    CHECK_EQ(ticket, UNTOUCHED);
+}
+
+int main()
+{
+    Camera camera;
+    camera.setFrameSize(FRAMESIZE_QVGA);
+    REQUIRE(camera.begin());
+    REQUIRE(camera.getBroker()->begin());
+
+    checkRegion(camera);
+    checkUnsupported(camera);
+    checkEchoedKeys(camera);
+
+    camera.getBroker()->stop();
+    return checkResult("control_test");
+}
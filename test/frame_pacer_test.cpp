@@ -0,0 +1,115 @@
+#include "FramePacer.h"
+#include "Check.h"
+
+// the pacer fed synthetic capture timestamps: a faster sensor is thinned to the target rate, a slower
+// one is padded with repeats, jitter within half a slot neither drops nor repeats, and a frame that
+// comes too early or too late for its slot is counted where it belongs
+using namespace EspCam;
+
+// `frames` timestamps `intervalUs` apart from `start`, the slots they took in total
+static uint32_t feed(FramePacer &pacer, int64_t start, int64_t intervalUs, int frames)
+{
+    uint32_t slots = 0;
+    for (int i = 0; i < frames; i++)
+    {
+        int64_t timestamp = start + i * intervalUs;
+        uint32_t expected = pacer.slotsFor(timestamp);
+        uint32_t placed = pacer.place(timestamp);
+        CHECK_EQ(placed, expected);
+        slots += placed;
+    }
+    return slots;
+}
+
+// a 30 fps sensor recorded at 10 fps keeps one frame in three
+static void checkFaster()
+{
+    FramePacer pacer(10);
+    uint32_t slots = feed(pacer, 1000000, 1000000 / 30, 90);
+    FramePacerStats stats = pacer.getStats();
+    CHECK_EQ(stats.framesIn, 90);
+    // 89 intervals of 33.333 ms end at 2.966 s, which is nearest to slot 30
+    CHECK_EQ(stats.framesOut, 31);
+    CHECK_EQ(slots, 31);
+    CHECK_EQ(stats.dropped, 59);
+    CHECK_EQ(stats.duplicated, 0);
+    CHECK_NEAR(stats.inputFps, 30.0f, 0.01f);
+    // the first frame nearest to a slot is kept, which can be up to half a slot early
+    CHECK(stats.jitterMaxUs > 1000000 / 30);
+    CHECK(stats.jitterMaxUs < 1000000 / 20);
+}
+
+// a 5 fps sensor recorded at 10 fps shows every frame twice
+static void checkSlower()
+{
+    FramePacer pacer(10);
+    uint32_t slots = feed(pacer, 0, 200000, 20);
+    FramePacerStats stats = pacer.getStats();
+    CHECK_EQ(stats.dropped, 0);
+    CHECK_EQ(stats.duplicated, 19);
+    CHECK_EQ(stats.framesOut, 39);
+    CHECK_EQ(slots, 39);
+    CHECK_EQ(stats.jitterMaxUs, 0);
+}
+
+// up to just under half a slot early or late is still the frame's own slot
+static void checkJitter()
+{
+    FramePacer pacer(10);
+    const int64_t offsets[] = {0, 49000, -49000, 30000, -10000, 45000, -45000, 0};
+    for (int i = 0; i < 8; i++)
+    {
+        CHECK_EQ(pacer.place(i * 100000 + offsets[i]), 1);
+    }
+    FramePacerStats stats = pacer.getStats();
+    CHECK_EQ(stats.dropped, 0);
+    CHECK_EQ(stats.duplicated, 0);
+    CHECK_EQ(stats.framesOut, 8);
+    CHECK_EQ(stats.jitterMaxUs, 49000);
+    CHECK_EQ(stats.jitterAvgUs, (49000 * 2 + 30000 + 10000 + 45000 * 2) / 8);
+}
+
+static void checkDropsAndGaps()
+{
+    FramePacer pacer(10);
+    CHECK_EQ(pacer.place(5000000), 1);
+    // a second frame for the same slot, and one from before the timeline started, are dropped
+    CHECK_EQ(pacer.slotsFor(5030000), 0);
+    CHECK_EQ(pacer.place(5030000), 0);
+    CHECK_EQ(pacer.place(4000000), 0);
+    CHECK_EQ(pacer.getStats().dropped, 2);
+    // slotsFor() only looks
+    CHECK_EQ(pacer.slotsFor(5100000), 1);
+    CHECK_EQ(pacer.getStats().framesIn, 3);
+
+    // a missing frame is made up by one repeat
+    CHECK_EQ(pacer.place(5200000), 2);
+    CHECK_EQ(pacer.getStats().duplicated, 1);
+
+    // a stall longer than MAX_GAP_SECONDS starts a new timeline instead of filling it
+    int64_t resumed = 5200000 + (int64_t)(FramePacer::MAX_GAP_SECONDS + 1) * 1000000;
+    CHECK_EQ(pacer.place(resumed), 1);
+    CHECK_EQ(pacer.place(resumed + 100000), 1);
+    FramePacerStats stats = pacer.getStats();
+    CHECK_EQ(stats.duplicated, 1);
+    CHECK_EQ(stats.dropped, 2);
+    CHECK_EQ(stats.framesOut, 5);
+
+    // restart() begins a new timeline at the next frame, the counters carry on until resetStats()
+    pacer.restart();
+    CHECK_EQ(pacer.place(resumed + 130000), 1);
+    CHECK_EQ(pacer.getStats().dropped, 2);
+    pacer.resetStats();
+    stats = pacer.getStats();
+    CHECK_EQ(stats.framesIn, 0);
+    CHECK_EQ(stats.dropped, 0);
+}
+
+int main()
+{
+    checkFaster();
+    checkSlower();
+    checkJitter();
+    checkDropsAndGaps();
+    return checkResult("frame_pacer_test");
+}
@@ -0,0 +1,75 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "freertos/FreeRTOS.h"
+#include "esp_err.h"
+#include "esp_heap_caps.h"
+#include "esp_system.h"
+
+// the parts of the arduino-esp32 core the library uses, enough to build and run it on Linux
+#define IRAM_ATTR
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define LOW 0
+#define HIGH 1
+#define INPUT 0
+#define OUTPUT 1
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+
+// pins and the flash LED do nothing, the last values are kept for tests
+void pinMode(int pin, int mode);
+void digitalWrite(int pin, int value);
+void ledcSetup(int channel, int frequency, int resolution);
+void ledcAttachPin(int pin, int channel);
+void ledcWrite(int channel, int duty);
+int hostLedcDuty(int channel);
+
+// PSRAM is reported missing unless a test turns it on, allocations come from the heap either way
+bool psramFound();
+void hostSetPsram(bool present);
+void *ps_malloc(size_t size);
+void *ps_realloc(void *ptr, size_t size);
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *data, size_t len) = 0;
+};
+
+// goes to stdout
+class HardwareSerial
+{
+public:
+    void begin(unsigned long baud) {}
+    size_t print(const char *text);
+    size_t println(const char *text = "");
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+    operator bool() const { return true; }
+};
+extern HardwareSerial Serial;
+
+class EspClass
+{
+public:
+    uint32_t getFreeHeap();
+    uint32_t getFreePsram();
+    // exits the process, a test that expects it can catch the exit status
+    void restart();
+};
+extern EspClass ESP;
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef HOST_FS_H
+#define HOST_FS_H
+#include <Arduino.h>
+#include <memory>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+enum SeekMode
+{
+    SeekSet = 0,
+    SeekCur = 1,
+    SeekEnd = 2
+};
+
+namespace fs
+{
+    class FileImpl;
+
+    // a file or directory on the local file system, copies share the open handle like on the device
+    class File : public Print
+    {
+    private:
+        std::shared_ptr<FileImpl> m_impl;
+
+    public:
+        File() {}
+        File(std::shared_ptr<FileImpl> impl) : m_impl(impl) {}
+
+        size_t write(uint8_t c) override;
+        size_t write(const uint8_t *data, size_t len) override;
+        int read();
+        size_t read(uint8_t *buf, size_t len);
+        int available();
+        void flush();
+        bool seek(uint32_t pos, SeekMode mode = SeekSet);
+        size_t position() const;
+        size_t size() const;
+        void close();
+        operator bool() const;
+        const char *path() const;
+        const char *name() const;
+        bool isDirectory();
+        File openNextFile(const char *mode = FILE_READ);
+    };
+}
+
+using fs::File;
+
+#endif
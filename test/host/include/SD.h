@@ -0,0 +1,34 @@
+#ifndef HOST_SD_H
+#define HOST_SD_H
+#include "FS.h"
+
+typedef enum
+{
+    CARD_NONE,
+    CARD_MMC,
+    CARD_SD,
+    CARD_SDHC,
+    CARD_UNKNOWN
+} sdcard_type_t;
+
+// a card mounted on a local directory, paths are relative to it. Until begin() there is no card
+class SDFS
+{
+private:
+    char m_root[256] = "";
+
+public:
+    bool begin(const char *root);
+    void end();
+    // where "/" of the card is on the host, e.g. to build the VFS path Recorder trims files through
+    const char *root();
+    sdcard_type_t cardType();
+    File open(const char *path, const char *mode = FILE_READ);
+    bool exists(const char *path);
+    bool remove(const char *path);
+    bool mkdir(const char *path);
+    bool rmdir(const char *path);
+};
+extern SDFS SD;
+
+#endif
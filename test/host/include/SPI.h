@@ -0,0 +1,5 @@
+#ifndef HOST_SPI_H
+#define HOST_SPI_H
+#include <Arduino.h>
+
+#endif
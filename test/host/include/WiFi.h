@@ -0,0 +1,28 @@
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+#include <Arduino.h>
+
+class IPAddress
+{
+private:
+    uint8_t m_bytes[4];
+
+public:
+    IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) : m_bytes{a, b, c, d} {}
+    uint8_t operator[](int index) const { return m_bytes[index]; }
+};
+
+// always connected on loopback, RSSI is whatever a test sets
+class WiFiClass
+{
+private:
+    int m_rssi = -55;
+
+public:
+    IPAddress localIP() { return IPAddress(127, 0, 0, 1); }
+    int8_t RSSI() { return m_rssi; }
+    void hostSetRssi(int rssi) { m_rssi = rssi; }
+};
+extern WiFiClass WiFi;
+
+#endif
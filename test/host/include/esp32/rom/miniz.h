@@ -0,0 +1,32 @@
+#ifndef HOST_MINIZ_H
+#define HOST_MINIZ_H
+#include <stddef.h>
+#include <stdint.h>
+
+// the tinfl subset of the ROM miniz, on top of zlib's raw inflate. Only whole buffer decompression
+// with TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF is supported
+#define TINFL_FLAG_PARSE_ZLIB_HEADER 1
+#define TINFL_FLAG_HAS_MORE_INPUT 2
+#define TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF 4
+
+typedef enum
+{
+    TINFL_STATUS_BAD_PARAM = -3,
+    TINFL_STATUS_ADLER32_MISMATCH = -2,
+    TINFL_STATUS_FAILED = -1,
+    TINFL_STATUS_DONE = 0,
+    TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+    TINFL_STATUS_HAS_MORE_OUTPUT = 2
+} tinfl_status;
+
+typedef struct
+{
+    int state;
+} tinfl_decompressor;
+
+#define tinfl_init(r) ((r)->state = 0)
+
+tinfl_status tinfl_decompress(tinfl_decompressor *r, const uint8_t *in, size_t *inSize, uint8_t *outStart,
+                              uint8_t *outNext, size_t *outSize, uint32_t flags);
+
+#endif
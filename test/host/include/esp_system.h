@@ -0,0 +1,9 @@
+#ifndef HOST_ESP_SYSTEM_H
+#define HOST_ESP_SYSTEM_H
+#include <stdint.h>
+#include "esp_err.h"
+
+// seeded, so runs of a test see the same sequence
+uint32_t esp_random();
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef HOST_ESP_TIMER_H
+#define HOST_ESP_TIMER_H
+#include <stdint.h>
+
+// microseconds since the process started, on the monotonic clock
+int64_t esp_timer_get_time();
+
+#endif
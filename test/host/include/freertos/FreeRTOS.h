@@ -0,0 +1,56 @@
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+#include <stdint.h>
+#include <stddef.h>
+
+// the FreeRTOS calls the library makes, with tasks on pthreads. One tick is one millisecond like the
+// Arduino core. Priorities are ignored, the core a task is pinned to is only reported back by xPortGetCoreID()
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef void *TaskHandle_t;
+typedef void *SemaphoreHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define tskNO_AFFINITY 0x7fffffff
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char *name, uint32_t stackDepth, void *param,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core);
+// only a task deleting itself is supported
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t *previousWake, TickType_t increment);
+TickType_t xTaskGetTickCount();
+TaskHandle_t xTaskGetCurrentTaskHandle();
+BaseType_t xPortGetCoreID();
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t timeout);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+SemaphoreHandle_t xSemaphoreCreateBinary();
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t timeout);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+void vSemaphoreDelete(SemaphoreHandle_t semaphore);
+
+// critical sections share one process wide recursive lock, the spinlock itself is unused
+typedef struct
+{
+    uint32_t owner;
+    uint32_t count;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0, 0}
+void vPortEnterCritical(portMUX_TYPE *mux);
+void vPortExitCritical(portMUX_TYPE *mux);
+#define portENTER_CRITICAL(mux) vPortEnterCritical(mux)
+#define portEXIT_CRITICAL(mux) vPortExitCritical(mux)
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef HOST_CAMERA_H
+#define HOST_CAMERA_H
+#include "esp_camera.h"
+
+// knobs of the synthetic OV2640 behind esp_camera_* on the host. The sensor renders a moving test pattern
+// at the configured frame size and format, JPEG frames are encoded with EspCam::JpegEncoder at the
+// sensor quality, so their size follows frame size and quality like on the real sensor
+namespace HostCamera
+{
+    // frames per second esp_camera_fb_get() is paced to, 0 hands frames out as fast as they render
+    void setFrameRate(int fps);
+    // makes esp_camera_init() fail, as with no sensor attached
+    void setPresent(bool present);
+    // the sensor the next esp_camera_init() reports, OV2640_PID by default
+    void setSensorPid(uint16_t pid);
+    // frames handed out by esp_camera_fb_get() since init
+    uint32_t framesCaptured();
+    // arguments of the last set_res_raw(), all zero before the first
+    const int *lastWindow();
+    // SCCB register file behind get_reg()/set_reg(), bank 0 is the DSP and bank 1 the sensor
+    uint8_t *registers(int bank);
+}
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef HOST_IMG_CONVERTERS_H
+#define HOST_IMG_CONVERTERS_H
+#include "esp_camera.h"
+
+// encoded with EspCam::JpegEncoder on the host, the buffer in `out` is malloc'ed like in the driver
+bool fmt2jpg(uint8_t *src, size_t src_len, uint16_t width, uint16_t height, pixformat_t format, uint8_t quality,
+             uint8_t **out, size_t *out_len);
+bool frame2jpg(camera_fb_t *fb, uint8_t quality, uint8_t **out, size_t *out_len);
+
+#endif
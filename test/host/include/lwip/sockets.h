@@ -0,0 +1,25 @@
+#ifndef HOST_LWIP_SOCKETS_H
+#define HOST_LWIP_SOCKETS_H
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <string.h>
+#include <unistd.h>
+
+// lwip's BSD socket names map straight onto the host sockets
+#define lwip_accept accept
+#define lwip_sendmsg sendmsg
+#define lwip_writev writev
+#define lwip_recv recv
+#define lwip_send send
+#define lwip_close close
+
+static inline char *inet_ntoa_r(struct in_addr addr, char *buf, int len)
+{
+    return inet_ntop(AF_INET, &addr, buf, len) ? buf : NULL;
+}
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef HOST_RTC_CNTL_REG_H
+#define HOST_RTC_CNTL_REG_H
+
+#define RTC_CNTL_BROWN_OUT_REG 0x3ff480d4
+#define RTC_CNTL_BROWN_OUT_ENA (1u << 30)
+
+#endif
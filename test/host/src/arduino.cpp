@@ -0,0 +1,204 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include "esp_timer.h"
+#include "nvs.h"
+#include <signal.h>
+#include <stdarg.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// the Arduino core, heap and NVS stand-ins
+HardwareSerial Serial;
+EspClass ESP;
+WiFiClass WiFi;
+
+namespace
+{
+    bool psramPresent = false;
+    int ledcDuty[16];
+
+    // lwip reports a closed peer as a write error, the host would raise SIGPIPE instead
+    struct IgnoreSigpipe
+    {
+        IgnoreSigpipe()
+        {
+            signal(SIGPIPE, SIG_IGN);
+        }
+    } ignoreSigpipe;
+}
+
+unsigned long millis()
+{
+    return (unsigned long)(esp_timer_get_time() / 1000);
+}
+
+unsigned long micros()
+{
+    return (unsigned long)esp_timer_get_time();
+}
+
+void delay(unsigned long ms)
+{
+    vTaskDelay(ms);
+}
+
+void pinMode(int pin, int mode)
+{
+}
+
+void digitalWrite(int pin, int value)
+{
+}
+
+void ledcSetup(int channel, int frequency, int resolution)
+{
+}
+
+void ledcAttachPin(int pin, int channel)
+{
+}
+
+void ledcWrite(int channel, int duty)
+{
+    if (channel >= 0 && channel < 16)
+        ledcDuty[channel] = duty;
+}
+
+int hostLedcDuty(int channel)
+{
+    return channel >= 0 && channel < 16 ? ledcDuty[channel] : 0;
+}
+
+bool psramFound()
+{
+    return psramPresent;
+}
+
+void hostSetPsram(bool present)
+{
+    psramPresent = present;
+}
+
+void *ps_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+void *ps_realloc(void *ptr, size_t size)
+{
+    return realloc(ptr, size);
+}
+
+void *heap_caps_malloc(size_t size, uint32_t caps)
+{
+    return malloc(size);
+}
+
+size_t HardwareSerial::print(const char *text)
+{
+    return fputs(text, stdout) < 0 ? 0 : strlen(text);
+}
+
+size_t HardwareSerial::println(const char *text)
+{
+    size_t n = print(text);
+    fputc('\n', stdout);
+    return n + 1;
+}
+
+size_t HardwareSerial::printf(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int n = vprintf(format, args);
+    va_end(args);
+    return n < 0 ? 0 : n;
+}
+
+// fixed numbers, the host heap has nothing in common with the device's
+uint32_t EspClass::getFreeHeap()
+{
+    return 200 * 1024;
+}
+
+uint32_t EspClass::getFreePsram()
+{
+    return psramPresent ? 4000 * 1024 : 0;
+}
+
+void EspClass::restart()
+{
+    fflush(stdout);
+    exit(3);
+}
+
+namespace
+{
+    std::mutex nvsLock;
+    std::map<std::string, std::vector<uint8_t>> nvsBlobs;
+    std::vector<std::string> nvsNamespaces;
+
+    std::string nvsKey(nvs_handle_t handle, const char *key)
+    {
+        return nvsNamespaces[handle - 1] + "/" + key;
+    }
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t mode, nvs_handle_t *handle)
+{
+    std::lock_guard<std::mutex> guard(nvsLock);
+    for (size_t i = 0; i < nvsNamespaces.size(); i++)
+    {
+        if (nvsNamespaces[i] == name)
+        {
+            *handle = i + 1;
+            return ESP_OK;
+        }
+    }
+    nvsNamespaces.push_back(name);
+    *handle = nvsNamespaces.size();
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *value, size_t *length)
+{
+    std::lock_guard<std::mutex> guard(nvsLock);
+    auto it = nvsBlobs.find(nvsKey(handle, key));
+    if (it == nvsBlobs.end())
+        return ESP_ERR_NVS_NOT_FOUND;
+    if (!value)
+    {
+        *length = it->second.size();
+        return ESP_OK;
+    }
+    if (*length < it->second.size())
+        return ESP_ERR_INVALID_SIZE;
+    memcpy(value, it->second.data(), it->second.size());
+    *length = it->second.size();
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    std::lock_guard<std::mutex> guard(nvsLock);
+    const uint8_t *bytes = static_cast<const uint8_t *>(value);
+    nvsBlobs[nvsKey(handle, key)].assign(bytes, bytes + length);
+    return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    std::lock_guard<std::mutex> guard(nvsLock);
+    return nvsBlobs.erase(nvsKey(handle, key)) ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    return ESP_OK;
+}
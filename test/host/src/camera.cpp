@@ -0,0 +1,361 @@
+#include <Arduino.h>
+#include "esp_camera.h"
+#include "esp_timer.h"
+#include "host_camera.h"
+#include "img_converters.h"
+#include "JpegEncoder.h"
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+// a synthetic OV2640: the setters keep their values in the status like the real driver, frames are a
+// test pattern that moves every frame and follows size, format, quality, flips and the colour bar
+const resolution_info_t resolution[FRAMESIZE_INVALID] = {
+    {96, 96, 0}, {160, 120, 0}, {176, 144, 0}, {240, 176, 0}, {240, 240, 0}, {320, 240, 0}, {400, 296, 0},
+    {480, 320, 0}, {640, 480, 0}, {800, 600, 0}, {1024, 768, 0}, {1280, 720, 0}, {1280, 1024, 0}, {1600, 1200, 0}};
+
+namespace
+{
+    struct Buffer
+    {
+        camera_fb_t fb;
+        std::vector<uint8_t> data;
+        uint8_t *jpeg = nullptr;
+        size_t jpegCapacity = 0;
+        bool inUse = false;
+    };
+
+    std::mutex lock;
+    std::condition_variable released;
+    bool initialized = false;
+    bool present = true;
+    uint16_t sensorPid = OV2640_PID;
+    int frameRate = 25;
+    int64_t nextFrame = 0;
+    uint32_t frameCount = 0;
+    camera_config_t config;
+    sensor_t sensor;
+    uint8_t regs[2][256];
+    int window[12];
+    std::vector<Buffer> buffers;
+    std::vector<uint8_t> scratch;
+    EspCam::JpegEncoder encoder;
+
+    // the driver's 0..63 scale, lower is better, onto the encoder's 1..100
+    int encoderQuality(int quality)
+    {
+        int q = 100 - quality * 3 / 2;
+        return q < 1 ? 1 : q;
+    }
+
+    void pixel(int x, int y, int width, int height, uint32_t frame, uint8_t &r, uint8_t &g, uint8_t &b)
+    {
+        if (sensor.status.colorbar)
+        {
+            static const uint8_t bars[8][3] = {{255, 255, 255}, {255, 255, 0}, {0, 255, 255}, {0, 255, 0},
+                                               {255, 0, 255}, {255, 0, 0}, {0, 0, 255}, {0, 0, 0}};
+            const uint8_t *bar = bars[x * 8 / width];
+            r = bar[0];
+            g = bar[1];
+            b = bar[2];
+            return;
+        }
+        if (sensor.status.hmirror)
+            x = width - 1 - x;
+        if (sensor.status.vflip)
+            y = height - 1 - y;
+        // a gradient with a block that travels a sixteenth of the width per frame
+        int blockX = (int)((frame * width / 16) % width);
+        bool inBlock = x >= blockX && x < blockX + width / 8 && y >= height / 3 && y < height * 2 / 3;
+        r = inBlock ? 240 : x * 255 / width;
+        g = inBlock ? 240 : y * 255 / height;
+        b = inBlock ? 32 : 128;
+    }
+
+    void render(Buffer &buffer, int width, int height, pixformat_t format, uint32_t frame)
+    {
+        // JPEG frames are rendered as RGB565 and encoded
+        pixformat_t raw = format == PIXFORMAT_JPEG ? PIXFORMAT_RGB565 : format;
+        size_t bpp = raw == PIXFORMAT_GRAYSCALE ? 1 : (raw == PIXFORMAT_RGB888 ? 3 : 2);
+        std::vector<uint8_t> &out = format == PIXFORMAT_JPEG ? scratch : buffer.data;
+        out.resize((size_t)width * height * bpp);
+
+        for (int y = 0; y < height; y++)
+        {
+            uint8_t *row = out.data() + (size_t)y * width * bpp;
+            for (int x = 0; x < width; x++)
+            {
+                uint8_t r, g, b;
+                pixel(x, y, width, height, frame, r, g, b);
+                int luma = (77 * r + 150 * g + 29 * b) >> 8;
+                if (raw == PIXFORMAT_GRAYSCALE)
+                {
+                    row[x] = luma;
+                }
+                else if (raw == PIXFORMAT_RGB888)
+                {
+                    row[x * 3] = b;
+                    row[x * 3 + 1] = g;
+                    row[x * 3 + 2] = r;
+                }
+                else if (raw == PIXFORMAT_YUV422)
+                {
+                    int chroma = (x & 1) ? ((128 * r - 107 * g - 21 * b) >> 8) + 128 : ((-43 * r - 85 * g + 128 * b) >> 8) + 128;
+                    row[x * 2] = luma;
+                    row[x * 2 + 1] = chroma < 0 ? 0 : (chroma > 255 ? 255 : chroma);
+                }
+                else
+                {
+                    uint16_t p = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+                    row[x * 2] = p >> 8;
+                    row[x * 2 + 1] = p & 0xFF;
+                }
+            }
+        }
+
+        if (format == PIXFORMAT_JPEG)
+        {
+            size_t len = 0;
+            encoder.setQuality(encoderQuality(sensor.status.quality));
+            encoder.encode(scratch.data(), width, height, PIXFORMAT_RGB565, buffer.jpeg, buffer.jpegCapacity, len);
+            buffer.fb.buf = buffer.jpeg;
+            buffer.fb.len = len;
+        }
+        else
+        {
+            buffer.fb.buf = buffer.data.data();
+            buffer.fb.len = buffer.data.size();
+        }
+        buffer.fb.width = width;
+        buffer.fb.height = height;
+        buffer.fb.format = format;
+    }
+
+#define STATUS_SETTER(field) [](sensor_t *s, int value) { s->status.field = value; return 0; }
+
+    void resetSensor()
+    {
+        memset(&sensor, 0, sizeof(sensor));
+        memset(regs, 0, sizeof(regs));
+        memset(window, 0, sizeof(window));
+        sensor.id.PID = sensorPid;
+        sensor.pixformat = config.pixel_format;
+        sensor.xclk_freq_hz = config.xclk_freq_hz;
+        sensor.status.framesize = config.frame_size;
+        sensor.status.quality = config.jpeg_quality;
+        // driver defaults after init
+        sensor.status.awb = 1;
+        sensor.status.awb_gain = 1;
+        sensor.status.aec = 1;
+        sensor.status.agc = 1;
+        sensor.status.bpc = 0;
+        sensor.status.wpc = 1;
+        sensor.status.raw_gma = 1;
+        sensor.status.lenc = 1;
+        sensor.status.dcw = 1;
+
+        sensor.set_pixformat = [](sensor_t *s, pixformat_t format) {
+            s->pixformat = format;
+            return 0;
+        };
+        sensor.set_framesize = [](sensor_t *s, framesize_t size) {
+            if (size >= FRAMESIZE_INVALID)
+                return -1;
+            s->status.framesize = size;
+            return 0;
+        };
+        sensor.set_gainceiling = [](sensor_t *s, gainceiling_t ceiling) {
+            s->status.gainceiling = ceiling;
+            return 0;
+        };
+        sensor.set_quality = STATUS_SETTER(quality);
+        sensor.set_contrast = STATUS_SETTER(contrast);
+        sensor.set_brightness = STATUS_SETTER(brightness);
+        sensor.set_saturation = STATUS_SETTER(saturation);
+        sensor.set_colorbar = STATUS_SETTER(colorbar);
+        sensor.set_whitebal = STATUS_SETTER(awb);
+        sensor.set_gain_ctrl = STATUS_SETTER(agc);
+        sensor.set_exposure_ctrl = STATUS_SETTER(aec);
+        sensor.set_hmirror = STATUS_SETTER(hmirror);
+        sensor.set_vflip = STATUS_SETTER(vflip);
+        sensor.set_aec2 = STATUS_SETTER(aec2);
+        sensor.set_awb_gain = STATUS_SETTER(awb_gain);
+        sensor.set_agc_gain = STATUS_SETTER(agc_gain);
+        sensor.set_aec_value = STATUS_SETTER(aec_value);
+        sensor.set_special_effect = STATUS_SETTER(special_effect);
+        sensor.set_wb_mode = STATUS_SETTER(wb_mode);
+        sensor.set_ae_level = STATUS_SETTER(ae_level);
+        sensor.set_dcw = STATUS_SETTER(dcw);
+        sensor.set_bpc = STATUS_SETTER(bpc);
+        sensor.set_wpc = STATUS_SETTER(wpc);
+        sensor.set_raw_gma = STATUS_SETTER(raw_gma);
+        sensor.set_lenc = STATUS_SETTER(lenc);
+        // left unset as on sensors without these controls
+        sensor.set_sharpness = nullptr;
+        sensor.set_denoise = nullptr;
+        sensor.get_reg = [](sensor_t *s, int reg, int mask) { return regs[(reg >> 8) & 1][reg & 0xFF] & mask; };
+        sensor.set_reg = [](sensor_t *s, int reg, int mask, int value) {
+            uint8_t &r = regs[(reg >> 8) & 1][reg & 0xFF];
+            r = (r & ~mask) | (value & mask);
+            return 0;
+        };
+        if (sensorPid == OV2640_PID)
+        {
+            sensor.set_res_raw = [](sensor_t *s, int startX, int startY, int endX, int endY, int offsetX, int offsetY,
+                                    int totalX, int totalY, int outputX, int outputY, bool scale, bool binning) {
+                int args[12] = {startX, startY, endX, endY, offsetX, offsetY, totalX, totalY, outputX, outputY, scale, binning};
+                memcpy(window, args, sizeof(window));
+                return 0;
+            };
+        }
+    }
+
+#undef STATUS_SETTER
+}
+
+esp_err_t esp_camera_init(const camera_config_t *cameraConfig)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (!present)
+        return ESP_ERR_NOT_FOUND;
+    if (cameraConfig->frame_size >= FRAMESIZE_INVALID || cameraConfig->fb_count < 1)
+        return ESP_ERR_INVALID_ARG;
+
+    config = *cameraConfig;
+    resetSensor();
+    buffers.clear();
+    buffers.resize(config.fb_count);
+    for (Buffer &buffer : buffers)
+    {
+        memset(&buffer.fb, 0, sizeof(buffer.fb));
+    }
+    frameCount = 0;
+    nextFrame = esp_timer_get_time();
+    initialized = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_camera_deinit()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    for (Buffer &buffer : buffers)
+    {
+        free(buffer.jpeg);
+    }
+    buffers.clear();
+    initialized = false;
+    return ESP_OK;
+}
+
+// blocks like the driver until a buffer is free and the next frame is due, NULL after 4 s
+camera_fb_t *esp_camera_fb_get()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    Buffer *buffer = nullptr;
+    bool ready = released.wait_for(guard, std::chrono::seconds(4), [&] {
+        if (!initialized)
+            return true;
+        for (Buffer &b : buffers)
+        {
+            if (!b.inUse)
+            {
+                buffer = &b;
+                return true;
+            }
+        }
+        return false;
+    });
+    if (!ready || !initialized)
+        return nullptr;
+    buffer->inUse = true;
+
+    int64_t now = esp_timer_get_time();
+    int64_t due = nextFrame;
+    int fps = frameRate;
+    guard.unlock();
+    if (fps > 0 && due > now)
+        vTaskDelay((due - now + 999) / 1000);
+    guard.lock();
+
+    now = esp_timer_get_time();
+    nextFrame = fps > 0 ? (nextFrame + 1000000 / fps > now ? nextFrame + 1000000 / fps : now) : now;
+    framesize_t size = sensor.status.framesize;
+    render(*buffer, resolution[size].width, resolution[size].height, sensor.pixformat, frameCount++);
+    buffer->fb.timestamp.tv_sec = now / 1000000;
+    buffer->fb.timestamp.tv_usec = now % 1000000;
+    return &buffer->fb;
+}
+
+void esp_camera_fb_return(camera_fb_t *fb)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    for (Buffer &buffer : buffers)
+    {
+        if (&buffer.fb == fb)
+            buffer.inUse = false;
+    }
+    released.notify_all();
+}
+
+sensor_t *esp_camera_sensor_get()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return initialized ? &sensor : nullptr;
+}
+
+bool fmt2jpg(uint8_t *src, size_t src_len, uint16_t width, uint16_t height, pixformat_t format, uint8_t quality,
+             uint8_t **out, size_t *out_len)
+{
+    EspCam::JpegEncoder jpeg(quality);
+    uint8_t *buf = nullptr;
+    size_t capacity = 0;
+    if (!jpeg.encode(src, width, height, format, buf, capacity, *out_len))
+    {
+        free(buf);
+        return false;
+    }
+    *out = buf;
+    return true;
+}
+
+bool frame2jpg(camera_fb_t *fb, uint8_t quality, uint8_t **out, size_t *out_len)
+{
+    return fmt2jpg(fb->buf, fb->len, fb->width, fb->height, fb->format, quality, out, out_len);
+}
+
+namespace HostCamera
+{
+    void setFrameRate(int fps)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        frameRate = fps;
+    }
+
+    void setPresent(bool isPresent)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        present = isPresent;
+    }
+
+    void setSensorPid(uint16_t pid)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        sensorPid = pid;
+    }
+
+    uint32_t framesCaptured()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        return frameCount;
+    }
+
+    const int *lastWindow()
+    {
+        return window;
+    }
+
+    uint8_t *registers(int bank)
+    {
+        return regs[bank & 1];
+    }
+}
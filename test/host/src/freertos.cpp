@@ -0,0 +1,224 @@
+#include <Arduino.h>
+#include "esp_timer.h"
+#include <pthread.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <thread>
+
+// FreeRTOS on pthreads. Every task is a detached thread, blocking calls wait on condition variables
+namespace
+{
+    struct Semaphore
+    {
+        std::mutex lock;
+        std::condition_variable changed;
+        UBaseType_t count;
+        UBaseType_t max;
+    };
+
+    struct Task
+    {
+        TaskFunction_t function;
+        void *param;
+        BaseType_t core;
+        Semaphore notify;
+    };
+
+    thread_local Task *currentTask = nullptr;
+    std::recursive_mutex criticalLock;
+    const auto processStart = std::chrono::steady_clock::now();
+
+    // waits for `ready` up to `ticks`, portMAX_DELAY waits forever
+    template <typename Pred>
+    bool waitFor(std::unique_lock<std::mutex> &lock, std::condition_variable &cv, TickType_t ticks, Pred ready)
+    {
+        if (ticks == portMAX_DELAY)
+        {
+            cv.wait(lock, ready);
+            return true;
+        }
+        return cv.wait_for(lock, std::chrono::milliseconds(ticks), ready);
+    }
+
+    void *taskEntry(void *arg)
+    {
+        Task *task = static_cast<Task *>(arg);
+        currentTask = task;
+        task->function(task->param);
+        // returning from a task function is a bug on the device, end the thread the same way
+        vTaskDelete(NULL);
+        return nullptr;
+    }
+}
+
+int64_t esp_timer_get_time()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - processStart).count();
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stackDepth, void *param,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core)
+{
+    Task *task = new Task();
+    task->function = function;
+    task->param = param;
+    task->core = core == tskNO_AFFINITY ? 0 : core;
+    task->notify.count = 0;
+    task->notify.max = 0xffffffff;
+    // the handle is set before the task runs, some tasks read their own handle right away
+    if (handle)
+        *handle = task;
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_t thread;
+    int res = pthread_create(&thread, &attr, taskEntry, task);
+    pthread_attr_destroy(&attr);
+    if (res != 0)
+    {
+        if (handle)
+            *handle = NULL;
+        delete task;
+        return pdFAIL;
+    }
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    if (task != NULL && task != currentTask)
+    {
+        fprintf(stderr, "vTaskDelete: only a task deleting itself is supported on the host\n");
+        abort();
+    }
+    // the Task stays allocated, other tasks may still hold the handle and notify it
+    pthread_exit(nullptr);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+void vTaskDelayUntil(TickType_t *previousWake, TickType_t increment)
+{
+    *previousWake += increment;
+    int32_t wait = (int32_t)(*previousWake - xTaskGetTickCount());
+    if (wait > 0)
+        vTaskDelay(wait);
+}
+
+TickType_t xTaskGetTickCount()
+{
+    return (TickType_t)(esp_timer_get_time() / 1000);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+    // threads not started through xTaskCreatePinnedToCore, e.g. main(), get a handle on first use
+    if (!currentTask)
+    {
+        currentTask = new Task();
+        currentTask->core = 1;
+        currentTask->notify.count = 0;
+        currentTask->notify.max = 0xffffffff;
+    }
+    return currentTask;
+}
+
+BaseType_t xPortGetCoreID()
+{
+    return static_cast<Task *>(xTaskGetCurrentTaskHandle())->core;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t timeout)
+{
+    Semaphore &notify = static_cast<Task *>(xTaskGetCurrentTaskHandle())->notify;
+    std::unique_lock<std::mutex> lock(notify.lock);
+    if (!waitFor(lock, notify.changed, timeout, [&] { return notify.count > 0; }))
+        return 0;
+    uint32_t value = notify.count;
+    notify.count = clearOnExit ? 0 : value - 1;
+    return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t handle)
+{
+    if (!handle)
+        return pdFAIL;
+    Semaphore &notify = static_cast<Task *>(handle)->notify;
+    std::lock_guard<std::mutex> lock(notify.lock);
+    notify.count++;
+    notify.changed.notify_all();
+    return pdPASS;
+}
+
+static SemaphoreHandle_t createSemaphore(UBaseType_t max, UBaseType_t initial)
+{
+    Semaphore *semaphore = new Semaphore();
+    semaphore->count = initial;
+    semaphore->max = max;
+    return semaphore;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+    return createSemaphore(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary()
+{
+    return createSemaphore(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount)
+{
+    return createSemaphore(maxCount, initialCount);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t handle, TickType_t timeout)
+{
+    Semaphore *semaphore = static_cast<Semaphore *>(handle);
+    std::unique_lock<std::mutex> lock(semaphore->lock);
+    if (!waitFor(lock, semaphore->changed, timeout, [&] { return semaphore->count > 0; }))
+        return pdFALSE;
+    semaphore->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t handle)
+{
+    Semaphore *semaphore = static_cast<Semaphore *>(handle);
+    std::lock_guard<std::mutex> lock(semaphore->lock);
+    if (semaphore->count >= semaphore->max)
+        return pdFALSE;
+    semaphore->count++;
+    semaphore->changed.notify_one();
+    return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t handle)
+{
+    delete static_cast<Semaphore *>(handle);
+}
+
+void vPortEnterCritical(portMUX_TYPE *mux)
+{
+    criticalLock.lock();
+}
+
+void vPortExitCritical(portMUX_TYPE *mux)
+{
+    criticalLock.unlock();
+}
+
+uint32_t esp_random()
+{
+    static std::mt19937 generator(0x5eed);
+    static std::mutex lock;
+    std::lock_guard<std::mutex> guard(lock);
+    return generator();
+}
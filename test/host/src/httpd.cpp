@@ -0,0 +1,618 @@
+#include <Arduino.h>
+#include "esp_http_server.h"
+#include "lwip/sockets.h"
+#include <fcntl.h>
+#include <netinet/tcp.h>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// esp_http_server on loopback sockets, one thread per server instance that selects over the listening
+// socket and the open sessions and runs the handlers itself
+namespace
+{
+    const size_t HEADER_MAX = 4096;
+
+    struct Session
+    {
+        int fd;
+        std::string rx;
+    };
+
+    struct UriHandler
+    {
+        std::string uri;
+        httpd_uri_t handler;
+    };
+
+    struct Server
+    {
+        httpd_config_t config;
+        int listenFd = -1;
+        int wake[2] = {-1, -1};
+        std::vector<UriHandler> handlers;
+        std::vector<Session *> sessions;
+        std::vector<int> closeRequests;
+        std::mutex lock;
+        std::thread thread;
+        volatile bool running = false;
+    };
+
+    struct Request
+    {
+        httpd_req_t req;
+        Server *server;
+        Session *session;
+        std::vector<std::pair<std::string, std::string>> headers;
+        std::string query;
+        size_t bodyLeft;
+        const char *status;
+        const char *type;
+        std::vector<std::pair<const char *, const char *>> respHeaders;
+        bool chunked;
+    };
+
+    Request *requestOf(httpd_req_t *r)
+    {
+        return static_cast<Request *>(r->aux);
+    }
+
+    bool sendAll(int fd, const char *data, size_t len)
+    {
+        while (len > 0)
+        {
+            ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            data += n;
+            len -= n;
+        }
+        return true;
+    }
+
+    void closeSession(Server *server, Session *session)
+    {
+        {
+            std::lock_guard<std::mutex> guard(server->lock);
+            for (size_t i = 0; i < server->sessions.size(); i++)
+            {
+                if (server->sessions[i] == session)
+                {
+                    server->sessions.erase(server->sessions.begin() + i);
+                    break;
+                }
+            }
+        }
+        // like the real server, a close_fn takes over closing the socket
+        if (server->config.close_fn)
+            server->config.close_fn(server, session->fd);
+        else
+            close(session->fd);
+        delete session;
+    }
+
+    const char *statusText(httpd_err_code_t error)
+    {
+        switch (error)
+        {
+        case HTTPD_501_METHOD_NOT_IMPLEMENTED:
+            return "501 Method Not Implemented";
+        case HTTPD_505_VERSION_NOT_SUPPORTED:
+            return "505 Version Not Supported";
+        case HTTPD_400_BAD_REQUEST:
+            return "400 Bad Request";
+        case HTTPD_401_UNAUTHORIZED:
+            return "401 Unauthorized";
+        case HTTPD_403_FORBIDDEN:
+            return "403 Forbidden";
+        case HTTPD_404_NOT_FOUND:
+            return "404 Not Found";
+        case HTTPD_405_METHOD_NOT_ALLOWED:
+            return "405 Method Not Allowed";
+        case HTTPD_408_REQ_TIMEOUT:
+            return "408 Request Timeout";
+        case HTTPD_411_LENGTH_REQUIRED:
+            return "411 Length Required";
+        case HTTPD_414_URI_TOO_LONG:
+            return "414 URI Too Long";
+        case HTTPD_431_REQ_HDR_FIELDS_TOO_LARGE:
+            return "431 Request Header Fields Too Large";
+        default:
+            return "500 Internal Server Error";
+        }
+    }
+
+    int parseMethod(const std::string &method)
+    {
+        static const char *names[] = {"DELETE", "GET", "HEAD", "POST", "PUT"};
+        for (int i = 0; i < 5; i++)
+        {
+            if (method == names[i])
+                return i;
+        }
+        return -1;
+    }
+
+    // answers one request at the front of the session's buffer, false when the session has to be closed.
+    // `complete` is false when the buffer does not hold all of the request headers yet
+    bool handleRequest(Server *server, Session *session, bool &complete)
+    {
+        size_t end = session->rx.find("\r\n\r\n");
+        complete = end != std::string::npos;
+        if (!complete)
+            return session->rx.size() < HEADER_MAX;
+
+        std::string head = session->rx.substr(0, end);
+        session->rx.erase(0, end + 4);
+
+        Request request = {};
+        memset((void *)&request.req, 0, sizeof(request.req));
+        request.server = server;
+        request.session = session;
+        request.status = "200 OK";
+        request.type = "text/html";
+        request.req.handle = server;
+        request.req.aux = &request;
+
+        size_t lineEnd = head.find("\r\n");
+        std::string line = head.substr(0, lineEnd);
+        size_t sp1 = line.find(' ');
+        size_t sp2 = line.find(' ', sp1 + 1);
+        if (sp1 == std::string::npos || sp2 == std::string::npos)
+        {
+            httpd_resp_send_err(&request.req, HTTPD_400_BAD_REQUEST, NULL);
+            return false;
+        }
+        std::string uri = line.substr(sp1 + 1, sp2 - sp1 - 1);
+        if (uri.size() > HTTPD_MAX_URI_LEN)
+        {
+            httpd_resp_send_err(&request.req, HTTPD_414_URI_TOO_LONG, NULL);
+            return false;
+        }
+        memcpy(const_cast<char *>(request.req.uri), uri.c_str(), uri.size() + 1);
+        request.req.method = parseMethod(line.substr(0, sp1));
+
+        size_t pos = lineEnd == std::string::npos ? head.size() : lineEnd + 2;
+        while (pos < head.size())
+        {
+            size_t next = head.find("\r\n", pos);
+            if (next == std::string::npos)
+                next = head.size();
+            std::string field = head.substr(pos, next - pos);
+            size_t colon = field.find(':');
+            if (colon != std::string::npos)
+            {
+                size_t valueStart = field.find_first_not_of(' ', colon + 1);
+                request.headers.push_back({field.substr(0, colon), valueStart == std::string::npos ? "" : field.substr(valueStart)});
+                if (!strcasecmp(request.headers.back().first.c_str(), "Content-Length"))
+                    request.req.content_len = strtoul(request.headers.back().second.c_str(), nullptr, 10);
+            }
+            pos = next + 2;
+        }
+        request.bodyLeft = request.req.content_len;
+
+        size_t question = uri.find('?');
+        std::string path = uri.substr(0, question);
+        if (question != std::string::npos)
+            request.query = uri.substr(question + 1);
+
+        const httpd_uri_t *match = nullptr;
+        bool pathFound = false;
+        for (UriHandler &handler : server->handlers)
+        {
+            if (handler.uri == path)
+            {
+                pathFound = true;
+                if (handler.handler.method == request.req.method)
+                    match = &handler.handler;
+            }
+        }
+        if (!match)
+        {
+            httpd_resp_send_err(&request.req, pathFound ? HTTPD_405_METHOD_NOT_ALLOWED : HTTPD_404_NOT_FOUND, NULL);
+            return false;
+        }
+
+        request.req.user_ctx = match->user_ctx;
+        if (match->handler(&request.req) != ESP_OK)
+            return false;
+
+        // the part of the body the handler did not read is dropped, as the real server does
+        char discard[512];
+        while (request.bodyLeft > 0)
+        {
+            if (httpd_req_recv(&request.req, discard, sizeof(discard)) <= 0)
+                return false;
+        }
+        return true;
+    }
+
+    void serverTask(Server *server)
+    {
+        while (server->running)
+        {
+            fd_set readable;
+            FD_ZERO(&readable);
+            FD_SET(server->listenFd, &readable);
+            FD_SET(server->wake[0], &readable);
+            int maxFd = server->listenFd > server->wake[0] ? server->listenFd : server->wake[0];
+            std::vector<Session *> sessions;
+            {
+                std::lock_guard<std::mutex> guard(server->lock);
+                sessions = server->sessions;
+            }
+            for (Session *session : sessions)
+            {
+                FD_SET(session->fd, &readable);
+                maxFd = session->fd > maxFd ? session->fd : maxFd;
+            }
+
+            struct timeval timeout = {1, 0};
+            if (select(maxFd + 1, &readable, NULL, NULL, &timeout) < 0)
+                continue;
+            if (!server->running)
+                break;
+
+            if (FD_ISSET(server->wake[0], &readable))
+            {
+                char drain[64];
+                while (read(server->wake[0], drain, sizeof(drain)) > 0)
+                {
+                }
+            }
+
+            std::vector<int> closeRequests;
+            {
+                std::lock_guard<std::mutex> guard(server->lock);
+                closeRequests.swap(server->closeRequests);
+            }
+            for (int fd : closeRequests)
+            {
+                for (size_t i = 0; i < sessions.size(); i++)
+                {
+                    if (sessions[i] && sessions[i]->fd == fd)
+                    {
+                        closeSession(server, sessions[i]);
+                        sessions[i] = nullptr;
+                    }
+                }
+            }
+
+            for (Session *session : sessions)
+            {
+                if (!session || !FD_ISSET(session->fd, &readable))
+                    continue;
+                char buf[2048];
+                ssize_t n = recv(session->fd, buf, sizeof(buf), 0);
+                if (n <= 0)
+                {
+                    closeSession(server, session);
+                    continue;
+                }
+                session->rx.append(buf, n);
+                bool complete = true;
+                bool keep = true;
+                while (keep && complete && !session->rx.empty())
+                {
+                    keep = handleRequest(server, session, complete);
+                }
+                if (!keep)
+                    closeSession(server, session);
+            }
+
+            if (FD_ISSET(server->listenFd, &readable))
+            {
+                int fd = lwip_accept(server->listenFd, NULL, NULL);
+                if (fd < 0)
+                    continue;
+                std::lock_guard<std::mutex> guard(server->lock);
+                if (server->sessions.size() >= server->config.max_open_sockets)
+                {
+                    close(fd);
+                    continue;
+                }
+                struct timeval recvTimeout = {server->config.recv_wait_timeout, 0};
+                struct timeval sendTimeout = {server->config.send_wait_timeout, 0};
+                setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &recvTimeout, sizeof(recvTimeout));
+                setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &sendTimeout, sizeof(sendTimeout));
+                // a response goes out as head and body sends, with Nagle a keep-alive client would wait for
+                // its own delayed ACK before the body arrives
+                int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                if (server->config.open_fn && server->config.open_fn(server, fd) != ESP_OK)
+                {
+                    close(fd);
+                    continue;
+                }
+                server->sessions.push_back(new Session{fd, std::string()});
+            }
+        }
+    }
+
+    void wakeServer(Server *server)
+    {
+        char c = 0;
+        if (write(server->wake[1], &c, 1) < 0)
+        {
+            // the pipe is full, the server wakes up anyway
+        }
+    }
+}
+
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config)
+{
+    Server *server = new Server();
+    server->config = *config;
+    server->listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(server->listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(config->server_port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (server->listenFd < 0 || bind(server->listenFd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(server->listenFd, config->backlog_conn) != 0 || pipe(server->wake) != 0)
+    {
+        if (server->listenFd >= 0)
+            close(server->listenFd);
+        delete server;
+        return ESP_ERR_HTTPD_TASK;
+    }
+    fcntl(server->wake[0], F_SETFL, O_NONBLOCK);
+    fcntl(server->wake[1], F_SETFL, O_NONBLOCK);
+
+    server->running = true;
+    server->thread = std::thread(serverTask, server);
+    *handle = server;
+    return ESP_OK;
+}
+
+// sessions are shut down first so a handler blocked on its socket returns, then closed through close_fn
+esp_err_t httpd_stop(httpd_handle_t handle)
+{
+    Server *server = static_cast<Server *>(handle);
+    if (!server)
+        return ESP_ERR_INVALID_ARG;
+
+    server->running = false;
+    {
+        std::lock_guard<std::mutex> guard(server->lock);
+        for (Session *session : server->sessions)
+        {
+            shutdown(session->fd, SHUT_RDWR);
+        }
+    }
+    wakeServer(server);
+    server->thread.join();
+
+    while (!server->sessions.empty())
+    {
+        closeSession(server, server->sessions.back());
+    }
+    close(server->listenFd);
+    close(server->wake[0]);
+    close(server->wake[1]);
+    if (server->config.global_user_ctx_free_fn)
+        server->config.global_user_ctx_free_fn(server->config.global_user_ctx);
+    else
+        free(server->config.global_user_ctx);
+    delete server;
+    return ESP_OK;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler)
+{
+    Server *server = static_cast<Server *>(handle);
+    for (UriHandler &handler : server->handlers)
+    {
+        if (handler.uri == uri_handler->uri && handler.handler.method == uri_handler->method)
+            return ESP_ERR_HTTPD_HANDLER_EXISTS;
+    }
+    if (server->handlers.size() >= server->config.max_uri_handlers)
+        return ESP_ERR_HTTPD_HANDLERS_FULL;
+
+    server->handlers.push_back({uri_handler->uri, *uri_handler});
+    server->handlers.back().handler.uri = server->handlers.back().uri.c_str();
+    return ESP_OK;
+}
+
+void *httpd_get_global_user_ctx(httpd_handle_t handle)
+{
+    return static_cast<Server *>(handle)->config.global_user_ctx;
+}
+
+esp_err_t httpd_sess_trigger_close(httpd_handle_t handle, int sockfd)
+{
+    Server *server = static_cast<Server *>(handle);
+    {
+        std::lock_guard<std::mutex> guard(server->lock);
+        bool found = false;
+        for (Session *session : server->sessions)
+        {
+            found |= session->fd == sockfd;
+        }
+        if (!found)
+            return ESP_ERR_NOT_FOUND;
+        server->closeRequests.push_back(sockfd);
+    }
+    wakeServer(server);
+    return ESP_OK;
+}
+
+int httpd_req_to_sockfd(httpd_req_t *r)
+{
+    return requestOf(r)->session->fd;
+}
+
+int httpd_req_recv(httpd_req_t *r, char *buf, size_t buf_len)
+{
+    Request *request = requestOf(r);
+    if (request->bodyLeft == 0)
+        return 0;
+    size_t want = buf_len < request->bodyLeft ? buf_len : request->bodyLeft;
+
+    std::string &rx = request->session->rx;
+    if (!rx.empty())
+    {
+        size_t n = want < rx.size() ? want : rx.size();
+        memcpy(buf, rx.data(), n);
+        rx.erase(0, n);
+        request->bodyLeft -= n;
+        return n;
+    }
+
+    ssize_t n = recv(request->session->fd, buf, want, 0);
+    if (n < 0)
+        return errno == EAGAIN || errno == EWOULDBLOCK ? HTTPD_SOCK_ERR_TIMEOUT : HTTPD_SOCK_ERR_FAIL;
+    if (n == 0)
+        return HTTPD_SOCK_ERR_FAIL;
+    request->bodyLeft -= n;
+    return n;
+}
+
+static const std::string *findHeader(httpd_req_t *r, const char *field)
+{
+    for (auto &header : requestOf(r)->headers)
+    {
+        if (!strcasecmp(header.first.c_str(), field))
+            return &header.second;
+    }
+    return nullptr;
+}
+
+// copies with truncation like the real functions, which still fill the buffer when they return RESULT_TRUNC
+static esp_err_t copyResult(const std::string &value, char *buf, size_t buf_len)
+{
+    if (buf_len == 0)
+        return ESP_ERR_INVALID_ARG;
+    size_t n = value.size() < buf_len - 1 ? value.size() : buf_len - 1;
+    memcpy(buf, value.data(), n);
+    buf[n] = 0;
+    return n < value.size() ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+}
+
+size_t httpd_req_get_hdr_value_len(httpd_req_t *r, const char *field)
+{
+    const std::string *value = findHeader(r, field);
+    return value ? value->size() : 0;
+}
+
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *r, const char *field, char *val, size_t val_size)
+{
+    const std::string *value = findHeader(r, field);
+    return value ? copyResult(*value, val, val_size) : ESP_ERR_NOT_FOUND;
+}
+
+size_t httpd_req_get_url_query_len(httpd_req_t *r)
+{
+    return requestOf(r)->query.size();
+}
+
+esp_err_t httpd_req_get_url_query_str(httpd_req_t *r, char *buf, size_t buf_len)
+{
+    Request *request = requestOf(r);
+    if (strchr(r->uri, '?') == NULL)
+        return ESP_ERR_NOT_FOUND;
+    return copyResult(request->query, buf, buf_len);
+}
+
+esp_err_t httpd_query_key_value(const char *qry, const char *key, char *val, size_t val_size)
+{
+    size_t keyLen = strlen(key);
+    const char *p = qry;
+    while (p && *p)
+    {
+        const char *end = strchr(p, '&');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        if (len > keyLen && p[keyLen] == '=' && !strncmp(p, key, keyLen))
+            return copyResult(std::string(p + keyLen + 1, len - keyLen - 1), val, val_size);
+        p = end ? end + 1 : nullptr;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t *r, const char *status)
+{
+    requestOf(r)->status = status;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type)
+{
+    requestOf(r)->type = type;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t *r, const char *field, const char *value)
+{
+    Request *request = requestOf(r);
+    if (request->respHeaders.size() >= request->server->config.max_resp_headers)
+        return ESP_ERR_HTTPD_RESP_HDR;
+    request->respHeaders.push_back({field, value});
+    return ESP_OK;
+}
+
+static std::string responseHead(Request *request, const char *framing)
+{
+    std::string head = std::string("HTTP/1.1 ") + request->status + "\r\nContent-Type: " + request->type + "\r\n" + framing;
+    for (auto &header : request->respHeaders)
+    {
+        head += std::string(header.first) + ": " + header.second + "\r\n";
+    }
+    return head + "\r\n";
+}
+
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len)
+{
+    Request *request = requestOf(r);
+    if (buf_len == HTTPD_RESP_USE_STRLEN)
+        buf_len = buf ? strlen(buf) : 0;
+    char length[48];
+    snprintf(length, sizeof(length), "Content-Length: %d\r\n", (int)buf_len);
+    std::string head = responseHead(request, length);
+    int fd = request->session->fd;
+    if (!sendAll(fd, head.data(), head.size()) || (buf_len > 0 && !sendAll(fd, buf, buf_len)))
+        return ESP_ERR_HTTPD_RESP_SEND;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf, ssize_t buf_len)
+{
+    Request *request = requestOf(r);
+    if (buf_len == HTTPD_RESP_USE_STRLEN)
+        buf_len = buf ? strlen(buf) : 0;
+    int fd = request->session->fd;
+    if (!request->chunked)
+    {
+        std::string head = responseHead(request, "Transfer-Encoding: chunked\r\n");
+        if (!sendAll(fd, head.data(), head.size()))
+            return ESP_ERR_HTTPD_RESP_SEND;
+        request->chunked = true;
+    }
+    char size[16];
+    snprintf(size, sizeof(size), "%x\r\n", (unsigned)buf_len);
+    if (!sendAll(fd, size, strlen(size)) || (buf_len > 0 && !sendAll(fd, buf, buf_len)) || !sendAll(fd, "\r\n", 2))
+        return ESP_ERR_HTTPD_RESP_SEND;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_code_t error, const char *msg)
+{
+    Request *request = requestOf(req);
+    request->status = statusText(error);
+    request->type = "text/html";
+    return httpd_resp_send(req, msg ? msg : request->status, HTTPD_RESP_USE_STRLEN);
+}
+
+int httpd_send(httpd_req_t *r, const char *buf, size_t buf_len)
+{
+    ssize_t n = send(requestOf(r)->session->fd, buf, buf_len, MSG_NOSIGNAL);
+    if (n < 0)
+        return errno == EAGAIN || errno == EWOULDBLOCK ? HTTPD_SOCK_ERR_TIMEOUT : HTTPD_SOCK_ERR_FAIL;
+    return n;
+}
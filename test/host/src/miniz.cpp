@@ -0,0 +1,30 @@
+#include "esp32/rom/miniz.h"
+#include <zlib.h>
+
+tinfl_status tinfl_decompress(tinfl_decompressor *r, const uint8_t *in, size_t *inSize, uint8_t *outStart,
+                              uint8_t *outNext, size_t *outSize, uint32_t flags)
+{
+    if (!(flags & TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF) || outNext != outStart)
+        return TINFL_STATUS_BAD_PARAM;
+
+    z_stream stream = {};
+    stream.next_in = const_cast<Bytef *>(in);
+    stream.avail_in = *inSize;
+    stream.next_out = outNext;
+    stream.avail_out = *outSize;
+    // negative window bits is a raw deflate stream, unless the zlib header was asked for
+    if (inflateInit2(&stream, (flags & TINFL_FLAG_PARSE_ZLIB_HEADER) ? 15 : -15) != Z_OK)
+        return TINFL_STATUS_FAILED;
+    int res = inflate(&stream, Z_FINISH);
+    *inSize -= stream.avail_in;
+    *outSize -= stream.avail_out;
+    inflateEnd(&stream);
+
+    if (res == Z_STREAM_END)
+        return TINFL_STATUS_DONE;
+    if (res == Z_BUF_ERROR && stream.avail_out == 0)
+        return TINFL_STATUS_HAS_MORE_OUTPUT;
+    if (res == Z_BUF_ERROR)
+        return TINFL_STATUS_NEEDS_MORE_INPUT;
+    return TINFL_STATUS_FAILED;
+}
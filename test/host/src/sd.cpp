@@ -0,0 +1,213 @@
+#include <SD.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <string>
+
+// SD on a local directory
+SDFS SD;
+
+namespace fs
+{
+    class FileImpl
+    {
+    public:
+        std::string path;
+        std::string hostPath;
+        FILE *file = nullptr;
+        DIR *dir = nullptr;
+
+        ~FileImpl()
+        {
+            close();
+        }
+
+        void close()
+        {
+            if (file)
+                fclose(file);
+            if (dir)
+                closedir(dir);
+            file = nullptr;
+            dir = nullptr;
+        }
+    };
+
+    size_t File::write(uint8_t c)
+    {
+        return write(&c, 1);
+    }
+
+    size_t File::write(const uint8_t *data, size_t len)
+    {
+        if (!m_impl || !m_impl->file)
+            return 0;
+        return fwrite(data, 1, len, m_impl->file);
+    }
+
+    int File::read()
+    {
+        uint8_t c;
+        return read(&c, 1) == 1 ? c : -1;
+    }
+
+    size_t File::read(uint8_t *buf, size_t len)
+    {
+        if (!m_impl || !m_impl->file)
+            return 0;
+        return fread(buf, 1, len, m_impl->file);
+    }
+
+    int File::available()
+    {
+        return (int)(size() - position());
+    }
+
+    void File::flush()
+    {
+        if (m_impl && m_impl->file)
+            fflush(m_impl->file);
+    }
+
+    bool File::seek(uint32_t pos, SeekMode mode)
+    {
+        if (!m_impl || !m_impl->file)
+            return false;
+        int whence = mode == SeekSet ? SEEK_SET : (mode == SeekCur ? SEEK_CUR : SEEK_END);
+        return fseek(m_impl->file, pos, whence) == 0;
+    }
+
+    size_t File::position() const
+    {
+        if (!m_impl || !m_impl->file)
+            return 0;
+        return ftell(m_impl->file);
+    }
+
+    size_t File::size() const
+    {
+        if (!m_impl)
+            return 0;
+        if (m_impl->file)
+            fflush(m_impl->file);
+        struct stat st;
+        return stat(m_impl->hostPath.c_str(), &st) == 0 ? st.st_size : 0;
+    }
+
+    void File::close()
+    {
+        if (m_impl)
+            m_impl->close();
+        m_impl.reset();
+    }
+
+    File::operator bool() const
+    {
+        return m_impl && (m_impl->file || m_impl->dir);
+    }
+
+    const char *File::path() const
+    {
+        return m_impl ? m_impl->path.c_str() : nullptr;
+    }
+
+    const char *File::name() const
+    {
+        if (!m_impl)
+            return nullptr;
+        size_t slash = m_impl->path.rfind('/');
+        return m_impl->path.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+    }
+
+    bool File::isDirectory()
+    {
+        return m_impl && m_impl->dir;
+    }
+
+    File File::openNextFile(const char *mode)
+    {
+        if (!m_impl || !m_impl->dir)
+            return File();
+
+        struct dirent *entry;
+        while ((entry = readdir(m_impl->dir)) != nullptr)
+        {
+            if (strcmp(entry->d_name, ".") && strcmp(entry->d_name, ".."))
+            {
+                std::string child = m_impl->path == "/" ? "/" + std::string(entry->d_name) : m_impl->path + "/" + entry->d_name;
+                return SD.open(child.c_str(), mode);
+            }
+        }
+        return File();
+    }
+}
+
+bool SDFS::begin(const char *root)
+{
+    struct stat st;
+    if (stat(root, &st) != 0 && ::mkdir(root, 0755) != 0)
+        return false;
+    snprintf(m_root, sizeof(m_root), "%s", root);
+    return true;
+}
+
+void SDFS::end()
+{
+    m_root[0] = 0;
+}
+
+const char *SDFS::root()
+{
+    return m_root;
+}
+
+sdcard_type_t SDFS::cardType()
+{
+    return m_root[0] ? CARD_SDHC : CARD_NONE;
+}
+
+static std::string hostPath(const char *root, const char *path)
+{
+    return std::string(root) + (path[0] == '/' ? "" : "/") + path;
+}
+
+File SDFS::open(const char *path, const char *mode)
+{
+    if (!m_root[0])
+        return File();
+
+    std::shared_ptr<fs::FileImpl> impl = std::make_shared<fs::FileImpl>();
+    impl->path = path;
+    impl->hostPath = hostPath(m_root, path);
+
+    struct stat st;
+    if (stat(impl->hostPath.c_str(), &st) == 0 && S_ISDIR(st.st_mode))
+    {
+        impl->dir = opendir(impl->hostPath.c_str());
+        return impl->dir ? File(impl) : File();
+    }
+    // FILE_WRITE truncates and then allows seeking back, as on the device
+    const char *hostMode = !strcmp(mode, FILE_WRITE) ? "w+b" : (!strcmp(mode, FILE_APPEND) ? "ab" : "rb");
+    impl->file = fopen(impl->hostPath.c_str(), hostMode);
+    return impl->file ? File(impl) : File();
+}
+
+bool SDFS::exists(const char *path)
+{
+    struct stat st;
+    return m_root[0] && stat(hostPath(m_root, path).c_str(), &st) == 0;
+}
+
+bool SDFS::remove(const char *path)
+{
+    return m_root[0] && unlink(hostPath(m_root, path).c_str()) == 0;
+}
+
+bool SDFS::mkdir(const char *path)
+{
+    return m_root[0] && ::mkdir(hostPath(m_root, path).c_str(), 0755) == 0;
+}
+
+bool SDFS::rmdir(const char *path)
+{
+    return m_root[0] && ::rmdir(hostPath(m_root, path).c_str()) == 0;
+}
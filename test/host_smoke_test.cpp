@@ -0,0 +1,140 @@
+#include "EspCamLib.h"
+#include "host_camera.h"
+#include <SD.h>
+#include "Check.h"
+#include "LoopbackClient.h"
+
+// the host build end to end: frames from the synthetic sensor through the broker, the web server
+// endpoints and the stream on loopback, and a recording on the directory backed SD card
+using namespace EspCam;
+
+static const int PORT = 18080;
+
+static bool isJpeg(const std::string &data)
+{
+    return data.size() > 4 && (uint8_t)data[0] == 0xFF && (uint8_t)data[1] == 0xD8 &&
+           (uint8_t)data[data.size() - 2] == 0xFF && (uint8_t)data[data.size() - 1] == 0xD9;
+}
+
+static void checkBroker(Camera &camera)
+{
+    FrameBroker *broker = camera.getBroker();
+    REQUIRE(broker->begin());
+    FrameRef frame = broker->acquire(0, pdMS_TO_TICKS(2000));
+    REQUIRE(frame);
+    CHECK_EQ(frame.fb()->width, 320);
+    CHECK_EQ(frame.fb()->height, 240);
+    CHECK(isJpeg(std::string((const char *)frame.data(), frame.length())));
+
+    uint32_t first = frame.sequence();
+    frame.reset();
+    FrameRef next = broker->acquire(first, pdMS_TO_TICKS(2000));
+    REQUIRE(next);
+    CHECK(next.sequence() > first);
+}
+
+static void checkWebServer(WebServer &server)
+{
+    LoopbackClient client;
+    std::string head, body;
+
+    // the status task publishes its first sample shortly after begin(), until then the payload is {}
+    for (int i = 0; i < 50; i++)
+    {
+        REQUIRE(client.request(PORT, "GET", "/status", head, body));
+        if (body != "{}")
+            break;
+        vTaskDelay(pdMS_TO_TICKS(20));
+    }
+    CHECK(head.find("200 OK") != std::string::npos);
+    CHECK(body.find("\"heap\":") != std::string::npos);
+    CHECK(body.find("\"rssi\":-55") != std::string::npos);
+
+    REQUIRE(client.request(PORT, "GET", "/control?var=hmirror&val=1", head, body));
+    CHECK(head.find("200 OK") != std::string::npos);
+    CHECK_EQ(esp_camera_sensor_get()->status.hmirror, 1);
+
+    REQUIRE(client.request(PORT, "GET", "/capture", head, body));
+    CHECK_EQ(LoopbackClient::header(head, "Content-Type") == "image/jpeg", true);
+    CHECK(isJpeg(body));
+
+    REQUIRE(client.request(PORT, "GET", "/", head, body, "Accept-Encoding: gzip\r\n"));
+    CHECK_EQ(LoopbackClient::header(head, "Content-Encoding") == "gzip", true);
+    std::string etag = LoopbackClient::header(head, "ETag");
+    REQUIRE(client.request(PORT, "GET", "/", head, body, "If-None-Match: " + etag + "\r\n"));
+    CHECK(head.find("304") != std::string::npos);
+    // a client without gzip gets the page inflated
+    REQUIRE(client.request(PORT, "GET", "/", head, body));
+    CHECK(body.find("<html") != std::string::npos || body.find("<!DOCTYPE") != std::string::npos);
+
+    REQUIRE(client.request(PORT, "GET", "/missing", head, body));
+    CHECK(head.find("404") != std::string::npos);
+
+    // three parts of the multipart stream on the stream port
+    REQUIRE(client.connect(PORT + 1));
+    REQUIRE(client.send("GET /stream HTTP/1.1\r\n\r\n"));
+    REQUIRE(client.readUntil("\r\n\r\n", head));
+    CHECK(head.find("multipart/x-mixed-replace") != std::string::npos);
+    for (int i = 0; i < 3; i++)
+    {
+        std::string part, jpeg, trailer;
+        REQUIRE(client.readUntil("\r\n\r\n", part));
+        CHECK(part.find("--frame") != std::string::npos);
+        std::string length = LoopbackClient::header("\r\n" + part, "Content-Length");
+        REQUIRE(!length.empty());
+        REQUIRE(client.readBytes(strtoul(length.c_str(), nullptr, 10), jpeg));
+        CHECK(isJpeg(jpeg));
+        REQUIRE(client.readBytes(2, trailer));
+        CHECK(trailer == "\r\n");
+    }
+    client.close();
+}
+
+static void checkRecorder(Camera &camera, const char *root)
+{
+    REQUIRE(SD.begin(root));
+    Recorder recorder(&camera, 10);
+    recorder.setMountPoint(root);
+    recorder.setWriteBuffer(256 * 1024, 8 * 1024);
+    REQUIRE(recorder.start("/clip.avi"));
+    vTaskDelay(pdMS_TO_TICKS(1500));
+    recorder.stop();
+
+    RecorderStats stats = recorder.getStats();
+    CHECK(stats.framesWritten >= 5);
+
+    File file = SD.open("/clip.avi");
+    REQUIRE(file);
+    uint8_t header[12];
+    CHECK_EQ(file.read(header, sizeof(header)), sizeof(header));
+    CHECK(memcmp(header, "RIFF", 4) == 0);
+    CHECK(memcmp(header + 8, "AVI ", 4) == 0);
+    uint32_t riffSize = header[4] | (header[5] << 8) | (header[6] << 16) | ((uint32_t)header[7] << 24);
+    CHECK_EQ(riffSize + 8, file.size());
+    file.close();
+}
+
+int main()
+{
+    char root[] = "/tmp/espcam_sdXXXXXX";
+    REQUIRE(mkdtemp(root));
+
+    HostCamera::setFrameRate(20);
+    Camera camera;
+    camera.setFrameSize(FRAMESIZE_QVGA);
+    REQUIRE(camera.begin());
+    checkBroker(camera);
+
+    {
+        WebServer server(&camera);
+        REQUIRE(server.begin(PORT));
+        checkWebServer(server);
+    }
+
+    checkRecorder(camera, root);
+
+    char command[64];
+    snprintf(command, sizeof(command), "rm -rf %s", root);
+    CHECK_EQ(system(command), 0);
+    return checkResult("host_smoke_test");
+}
@@ -0,0 +1,248 @@
+#include "JpegEncoder.h"
+#include "JpegDc.h"
+#include "FrameBroker.h"
+#include "Check.h"
+#include <vector>
+
+// every raw format encodes to a baseline JPEG whose block averages match the source. The frames are
+// flat 16x8 tiles, so the DC of each block is the tile colour and can be compared exactly
+using namespace EspCam;
+
+static const uint8_t PALETTE[][3] = {
+    {0, 0, 0}, {255, 255, 255}, {200, 30, 30}, {30, 200, 30}, {30, 30, 200}, {128, 128, 128}, {240, 200, 40}, {60, 180, 220}};
+
+static const uint8_t *tileColor(int x, int y)
+{
+    return PALETTE[((x / 16) * 3 + (y / 8) * 5) % 8];
+}
+
+// the colour the encoder sees after the format's own quantization
+static void sourceColor(pixformat_t format, const uint8_t *rgb, int &r, int &g, int &b)
+{
+    r = rgb[0];
+    g = rgb[1];
+    b = rgb[2];
+    if (format == PIXFORMAT_RGB565)
+    {
+        r &= 0xF8;
+        g &= 0xFC;
+        b &= 0xF8;
+    }
+}
+
+static int lumaOf(int r, int g, int b)
+{
+    return (77 * r + 150 * g + 29 * b + 128) >> 8;
+}
+
+static std::vector<uint8_t> makeFrame(pixformat_t format, int width, int height)
+{
+    int bpp = format == PIXFORMAT_GRAYSCALE ? 1 : (format == PIXFORMAT_RGB888 ? 3 : 2);
+    std::vector<uint8_t> frame((size_t)width * height * bpp);
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            const uint8_t *c = tileColor(x, y);
+            uint8_t *p = &frame[((size_t)y * width + x) * bpp];
+            int luma = lumaOf(c[0], c[1], c[2]);
+            if (format == PIXFORMAT_RGB565)
+            {
+                uint16_t v = ((c[0] >> 3) << 11) | ((c[1] >> 2) << 5) | (c[2] >> 3);
+                p[0] = v >> 8;
+                p[1] = v & 0xFF;
+            }
+            else if (format == PIXFORMAT_RGB888)
+            {
+                p[0] = c[2];
+                p[1] = c[1];
+                p[2] = c[0];
+            }
+            else if (format == PIXFORMAT_YUV422)
+            {
+                int cb = ((-43 * c[0] - 85 * c[1] + 128 * c[2] + 128) >> 8) + 128;
+                int cr = ((128 * c[0] - 107 * c[1] - 21 * c[2] + 128) >> 8) + 128;
+                p[0] = luma;
+                p[1] = x & 1 ? cr : cb;
+            }
+            else
+            {
+                p[0] = luma;
+            }
+        }
+    }
+    return frame;
+}
+
+static void checkFormat(const JpegEncoder &encoder, pixformat_t format, int width, int height)
+{
+    std::vector<uint8_t> frame = makeFrame(format, width, height);
+    uint8_t *out = nullptr;
+    size_t capacity = 0, length = 0;
+    REQUIRE(encoder.encode(frame.data(), width, height, format, out, capacity, length));
+    REQUIRE(length > 4);
+    CHECK(out[0] == 0xFF && out[1] == 0xD8);
+    CHECK(out[length - 2] == 0xFF && out[length - 1] == 0xD9);
+
+    bool gray = format == PIXFORMAT_GRAYSCALE;
+    JpegDcDecoder decoder;
+    REQUIRE(decoder.decode(out, length));
+    CHECK_EQ(decoder.getWidth(), width);
+    CHECK_EQ(decoder.getHeight(), height);
+    CHECK_EQ(decoder.getComponentCount(), gray ? 1 : 3);
+    if (!gray)
+    {
+        // 4:2:2, two luma blocks across per chroma block
+        CHECK_EQ(decoder.getComponent(0).h, 2);
+        CHECK_EQ(decoder.getComponent(0).v, 1);
+    }
+
+    const uint8_t *luma = decoder.getMap(0);
+    int worst = 0;
+    for (int by = 0; by < (height + 7) / 8; by++)
+    {
+        for (int bx = 0; bx < (width + 7) / 8; bx++)
+        {
+            int r, g, b;
+            sourceColor(format, tileColor(bx * 8, by * 8), r, g, b);
+            int diff = abs(luma[by * decoder.getMapWidth(0) + bx] - lumaOf(r, g, b));
+            worst = diff > worst ? diff : worst;
+        }
+    }
+    // the DC quantizer step at quality 90 is 2, the decoder rounds down once more
+    CHECK(worst <= 3);
+
+    if (!gray)
+    {
+        const uint8_t *cb = decoder.getMap(1);
+        const uint8_t *cr = decoder.getMap(2);
+        int worstChroma = 0;
+        for (int my = 0; my < (height + 7) / 8; my++)
+        {
+            for (int mx = 0; mx < (width + 15) / 16; mx++)
+            {
+                int r, g, b;
+                sourceColor(format, tileColor(mx * 16, my * 8), r, g, b);
+                int expectCb = ((-43 * r - 85 * g + 128 * b + 128) >> 8) + 128;
+                int expectCr = ((128 * r - 107 * g - 21 * b + 128) >> 8) + 128;
+                size_t i = my * decoder.getMapWidth(1) + mx;
+                worstChroma = std::max(worstChroma, std::max(abs(cb[i] - expectCb), abs(cr[i] - expectCr)));
+            }
+        }
+        CHECK(worstChroma <= 4);
+    }
+
+    // the output buffer is reused and the result does not depend on what was in it
+    std::vector<uint8_t> first(out, out + length);
+    uint8_t *kept = out;
+    REQUIRE(encoder.encode(frame.data(), width, height, format, out, capacity, length));
+    CHECK(out == kept);
+    CHECK(length == first.size() && memcmp(out, first.data(), length) == 0);
+    free(out);
+}
+
+// split over two cores the scan carries a restart marker per MCU row and decodes to the same blocks
+static void checkBanded(const JpegEncoder &encoder, StripExecutor &executor, pixformat_t format, int width, int height)
+{
+    std::vector<uint8_t> frame = makeFrame(format, width, height);
+    uint8_t *plain = nullptr, *banded = nullptr, *spill = nullptr;
+    size_t plainCapacity = 0, bandedCapacity = 0, spillCapacity = 0, plainLength = 0, bandedLength = 0;
+    REQUIRE(encoder.encode(frame.data(), width, height, format, plain, plainCapacity, plainLength));
+    REQUIRE(encoder.encode(frame.data(), width, height, format, banded, bandedCapacity, bandedLength, executor, spill, spillCapacity));
+    CHECK(banded[bandedLength - 2] == 0xFF && banded[bandedLength - 1] == 0xD9);
+
+    JpegDcDecoder a, b;
+    REQUIRE(a.decode(plain, plainLength));
+    REQUIRE(b.decode(banded, bandedLength));
+    bool gray = format == PIXFORMAT_GRAYSCALE;
+    CHECK_EQ(a.getRestartInterval(), 0);
+    CHECK_EQ(b.getRestartInterval(), (width + (gray ? 7 : 15)) / (gray ? 8 : 16));
+    for (int c = 0; c < a.getComponentCount(); c++)
+    {
+        size_t size = (size_t)a.getMapWidth(c) * a.getMapHeight(c);
+        CHECK(memcmp(a.getMap(c), b.getMap(c), size) == 0);
+    }
+
+    // one marker per row boundary, numbered 0..7 in turn
+    size_t scan = b.getScanStart();
+    int markers = 0;
+    for (size_t i = scan; i + 1 < bandedLength; i++)
+    {
+        if (banded[i] == 0xFF && banded[i + 1] >= 0xD0 && banded[i + 1] <= 0xD7)
+        {
+            CHECK_EQ(banded[i + 1], 0xD0 + (markers & 7));
+            markers++;
+        }
+    }
+    CHECK_EQ(markers, (height + 7) / 8 - 1);
+    free(plain);
+    free(banded);
+    free(spill);
+}
+
+// raw frames are encoded once per slot and shared by every consumer
+static void checkBrokerEncodesOnce(StripExecutor *executor)
+{
+    Camera camera;
+    camera.setPixelFormat(PIXFORMAT_RGB565);
+    camera.setFrameSize(FRAMESIZE_QVGA);
+    REQUIRE(camera.begin());
+    FrameBroker *broker = camera.getBroker();
+    broker->setEncodeQuality(80);
+    broker->setEncodeExecutor(executor);
+    REQUIRE(broker->begin());
+
+    FrameRef a = broker->acquire(0, pdMS_TO_TICKS(2000));
+    REQUIRE(a);
+    FrameRef b = broker->acquire(a.sequence() - 1, pdMS_TO_TICKS(2000));
+    REQUIRE(b);
+    REQUIRE(a.sequence() == b.sequence());
+    CHECK_EQ(a.fb()->format, PIXFORMAT_RGB565);
+    const uint8_t *data = a.data();
+    REQUIRE(data && a.length() > 4);
+    CHECK(data[0] == 0xFF && data[1] == 0xD8);
+    CHECK(b.data() == data);
+    CHECK_EQ(broker->getLatency()->summarize(PipelineLatency::ENCODE).count, 1);
+
+    JpegDcDecoder decoder;
+    REQUIRE(decoder.decode(data, a.length()));
+    CHECK_EQ(decoder.getWidth(), 320);
+    CHECK_EQ(decoder.getRestartInterval(), executor ? 20 : 0);
+    a.reset();
+    b.reset();
+    broker->stop();
+}
+
+int main()
+{
+    JpegEncoder encoder(90);
+    const pixformat_t formats[] = {PIXFORMAT_RGB565, PIXFORMAT_YUV422, PIXFORMAT_RGB888, PIXFORMAT_GRAYSCALE};
+    for (pixformat_t format : formats)
+    {
+        checkFormat(encoder, format, 320, 240);
+        // edges that end inside an MCU, YUYV comes in pixel pairs
+        checkFormat(encoder, format, format == PIXFORMAT_YUV422 ? 102 : 101, 75);
+    }
+
+    uint8_t *out = nullptr;
+    size_t capacity = 0, length = 0;
+    uint8_t pixel[4] = {};
+    CHECK(!encoder.encode(pixel, 1, 1, PIXFORMAT_JPEG, out, capacity, length));
+    CHECK(!encoder.encode(pixel, 0, 1, PIXFORMAT_RGB565, out, capacity, length));
+    CHECK(!encoder.encode(pixel, 1, 1, PIXFORMAT_YUV422, out, capacity, length));
+    free(out);
+
+    StripExecutor executor;
+    REQUIRE(executor.begin(2));
+    for (pixformat_t format : formats)
+    {
+        checkBanded(encoder, executor, format, 320, 240);
+        checkBanded(encoder, executor, format, 102, 75);
+    }
+    checkBanded(encoder, executor, PIXFORMAT_RGB565, 640, 16);
+
+    checkBrokerEncodesOnce(nullptr);
+    checkBrokerEncodesOnce(&executor);
+    executor.stop();
+    return checkResult("jpeg_encoder_test");
+}
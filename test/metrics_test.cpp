@@ -0,0 +1,56 @@
+#include "EspCamLib.h"
+#include "Check.h"
+#include <thread>
+#include <vector>
+
+// byte totals kept in 32-bit atomics carry past 4 GiB, stay exact with several writers and never go
+// backwards between snapshots
+using namespace EspCam;
+
+int main()
+{
+    {
+        Metrics metrics;
+        metrics.addBytesSent(3000000000u);
+        metrics.addBytesSent(3000000000u);
+        metrics.addSdBytesWritten(4294967295u);
+        metrics.addSdBytesWritten(1);
+        MetricsSnapshot s = metrics.snapshot();
+        CHECK_EQ(s.bytesSent, 6000000000ULL);
+        CHECK_EQ(s.sdBytesWritten, 4294967296ULL);
+    }
+
+    {
+        // 16 wraps across four writers while a reader keeps taking snapshots
+        Metrics metrics;
+        const int WRITERS = 4;
+        const int ADDS = 1 << 16;
+        const uint32_t CHUNK = 1 << 18;
+        std::vector<std::thread> writers;
+        for (int w = 0; w < WRITERS; w++)
+        {
+            writers.emplace_back([&metrics] {
+                for (int i = 0; i < ADDS; i++)
+                {
+                    metrics.addBytesSent(CHUNK);
+                }
+            });
+        }
+        uint64_t last = 0;
+        bool monotonic = true;
+        for (int i = 0; i < 200000; i++)
+        {
+            uint64_t now = metrics.snapshot().bytesSent;
+            monotonic = monotonic && now >= last;
+            last = now;
+        }
+        for (std::thread &writer : writers)
+        {
+            writer.join();
+        }
+        CHECK(monotonic);
+        CHECK_EQ(metrics.snapshot().bytesSent, (uint64_t)WRITERS * ADDS * CHUNK);
+    }
+
+    return checkResult("metrics_test");
+}
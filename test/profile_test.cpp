@@ -0,0 +1,121 @@
+#include "EspCamLib.h"
+#include "host_camera.h"
+#include "Check.h"
+#include <sys/stat.h>
+#include <unistd.h>
+
+// a saved profile brings format, size, sensor settings and the converged exposure back at begin(),
+// an unchanged profile is not written again and a damaged one falls back to a cold start
+using namespace EspCam;
+
+static const char *PATH = "/tmp/espcam_profile_test.bin";
+
+static int64_t modifiedNs()
+{
+    struct stat st;
+    return stat(PATH, &st) == 0 ? (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec : -1;
+}
+
+int main()
+{
+    FileProfileStore store(PATH);
+    REQUIRE(store.erase());
+
+    {
+        Camera camera;
+        camera.setProfileStore(&store);
+        REQUIRE(camera.begin());
+        CHECK(!camera.getStartup().warm);
+
+        camera.setFrameSize(FRAMESIZE_SVGA);
+        camera.setJpegQuality(8);
+        camera.setVFlip(true);
+        camera.setHFlip(true);
+        camera.setSensor(SENSOR_BRIGHTNESS, 1);
+        camera.setSensor(SENSOR_AWB, 0);
+        // auto exposure converged somewhere away from the reset values
+        uint8_t *bank = HostCamera::registers(1);
+        bank[0x45] = 0x02;
+        bank[0x10] = 0x9A;
+        bank[0x04] = 0x01;
+        bank[0x00] = 0x17;
+        REQUIRE(camera.saveProfile());
+
+        int64_t stamp = modifiedNs();
+        usleep(10000);
+        CHECK(camera.saveProfile());
+        CHECK_EQ(modifiedNs(), stamp);
+        esp_camera_deinit();
+    }
+
+    struct stat st;
+    REQUIRE(stat(PATH, &st) == 0);
+    CHECK_EQ((size_t)st.st_size, sizeof(SensorProfile));
+
+    {
+        // the stored profile wins over what was set up before begin()
+        Camera camera;
+        camera.setProfileStore(&store);
+        camera.setFrameSize(FRAMESIZE_QVGA);
+        REQUIRE(camera.begin());
+        CHECK(camera.getStartup().warm);
+
+        sensor_t *s = esp_camera_sensor_get();
+        CHECK_EQ(s->status.framesize, FRAMESIZE_SVGA);
+        CHECK_EQ(s->status.quality, 8);
+        CHECK_EQ(s->status.vflip, 1);
+        CHECK_EQ(s->status.hmirror, 1);
+        CHECK_EQ(s->status.brightness, 1);
+        CHECK_EQ(s->status.awb, 0);
+        uint8_t *bank = HostCamera::registers(1);
+        CHECK_EQ(bank[0x45], 0x02);
+        CHECK_EQ(bank[0x10], 0x9A);
+        CHECK_EQ(bank[0x04], 0x01);
+        CHECK_EQ(bank[0x00], 0x17);
+
+        camera_fb_t *fb = camera.getFrame();
+        REQUIRE(fb);
+        CHECK_EQ(fb->width, 800);
+        camera.releaseFrame(fb);
+        esp_camera_deinit();
+    }
+
+    FILE *file = fopen(PATH, "r+b");
+    REQUIRE(file);
+    fseek(file, 20, SEEK_SET);
+    fputc(0x55, file);
+    fclose(file);
+
+    {
+        Camera camera;
+        camera.setProfileStore(&store);
+        REQUIRE(camera.begin());
+        CHECK(!camera.getStartup().warm);
+        CHECK_EQ(esp_camera_sensor_get()->status.framesize, FRAMESIZE_VGA);
+        esp_camera_deinit();
+    }
+
+    // a different sensor keeps its own defaults but still gets the stored config
+    {
+        Camera camera;
+        camera.setProfileStore(&store);
+        camera.setFrameSize(FRAMESIZE_SVGA);
+        REQUIRE(camera.begin());
+        camera.setHFlip(true);
+        REQUIRE(camera.saveProfile());
+        esp_camera_deinit();
+    }
+    HostCamera::setSensorPid(OV3660_PID);
+    {
+        Camera camera;
+        camera.setProfileStore(&store);
+        REQUIRE(camera.begin());
+        CHECK(camera.getStartup().warm);
+        CHECK_EQ(esp_camera_sensor_get()->status.framesize, FRAMESIZE_SVGA);
+        CHECK_EQ(esp_camera_sensor_get()->status.hmirror, 0);
+        esp_camera_deinit();
+    }
+
+    store.erase();
+    return checkResult("profile_test");
+}
@@ -0,0 +1,155 @@
+#include "EspCamLib.h"
+#include "host_camera.h"
+#include "Check.h"
+#include "LoopbackClient.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// adaptive rate end to end: a broadcast viewer on a loopback socket read at a capped byte rate makes the
+// controller step quality down, reading at full speed again lets it step back up. Also the frame sizes
+// the ladder steps through, which keep the aspect ratio of the base size
+using namespace EspCam;
+
+static const int PORT = 18096;
+static const int THROTTLED_BYTES_PER_SEC = 24 * 1024;
+
+static std::atomic<bool> throttled{true};
+static std::atomic<bool> reading{true};
+static std::atomic<uint64_t> received{0};
+
+// token bucket reader, 10 ms slices of the byte rate while throttled
+static void readStream(int fd)
+{
+    char buf[16384];
+    while (reading)
+    {
+        size_t want = sizeof(buf);
+        if (throttled)
+        {
+            want = THROTTLED_BYTES_PER_SEC / 100;
+            usleep(10000);
+        }
+        ssize_t n = recv(fd, buf, want, 0);
+        if (n == 0)
+            break;
+        if (n > 0)
+            received += n;
+    }
+}
+
+// frame sizes a controller without quality steps walks through with a viewer far below the target
+static std::vector<int> sizeLadder(framesize_t base, framesize_t min)
+{
+    RateController rate;
+    rate.setQualityRange(12);
+    rate.setBase(12, base);
+    rate.setMinFrameSize(min);
+    rate.setHysteresis(0.15f, 0.6f, 1, 1);
+    rate.setEnabled(true);
+    std::vector<int> sizes = {rate.getFrameSize()};
+    int64_t now = 0;
+    rate.update(now);
+    for (int i = 0; i < 100 && rate.getLevel() < rate.getMaxLevel(); i++)
+    {
+        rate.onFrameSent(1, 10000, 1000000);
+        now += 1000000;
+        if (rate.update(now))
+            sizes.push_back(rate.getFrameSize());
+    }
+    CHECK_EQ(rate.getMaxLevel(), (int)sizes.size() - 1);
+    return sizes;
+}
+
+static void checkSizeLadder()
+{
+    // 4:3 all the way, SXGA (5:4) and HD (16:9) are skipped
+    CHECK(sizeLadder(FRAMESIZE_UXGA, FRAMESIZE_QVGA) ==
+          std::vector<int>({FRAMESIZE_UXGA, FRAMESIZE_XGA, FRAMESIZE_SVGA, FRAMESIZE_VGA, FRAMESIZE_QVGA}));
+    // neither CIF nor HQVGA nor QCIF is 4:3
+    CHECK(sizeLadder(FRAMESIZE_VGA, FRAMESIZE_QQVGA) ==
+          std::vector<int>({FRAMESIZE_VGA, FRAMESIZE_QVGA, FRAMESIZE_QQVGA}));
+    // HVGA is the only 3:2 size and HD the only 16:9 one up to UXGA
+    CHECK(sizeLadder(FRAMESIZE_HVGA, FRAMESIZE_QVGA) == std::vector<int>({FRAMESIZE_HVGA}));
+    CHECK(sizeLadder(FRAMESIZE_HD, FRAMESIZE_QVGA) == std::vector<int>({FRAMESIZE_HD}));
+    // square stays square, as long as the minimum allows it
+    CHECK(sizeLadder(FRAMESIZE_240X240, FRAMESIZE_96X96) == std::vector<int>({FRAMESIZE_240X240, FRAMESIZE_96X96}));
+    CHECK(sizeLadder(FRAMESIZE_240X240, FRAMESIZE_QQVGA) == std::vector<int>({FRAMESIZE_240X240}));
+    // a minimum above the base leaves only the base
+    CHECK(sizeLadder(FRAMESIZE_QVGA, FRAMESIZE_VGA) == std::vector<int>({FRAMESIZE_QVGA}));
+}
+
+// polls the controller state until `done` holds or `timeoutMs` passes
+template <typename Done>
+static RateControlState waitFor(WebServer &server, int timeoutMs, Done done)
+{
+    RateControlState state = server.getRateState();
+    for (int waited = 0; waited < timeoutMs && !done(state); waited += 100)
+    {
+        vTaskDelay(pdMS_TO_TICKS(100));
+        state = server.getRateState();
+    }
+    return state;
+}
+
+int main()
+{
+    checkSizeLadder();
+
+    HostCamera::setFrameRate(20);
+    Camera camera;
+    camera.setFrameSize(FRAMESIZE_QVGA);
+    camera.setJpegQuality(12);
+    REQUIRE(camera.begin());
+
+    WebServer server(&camera);
+    server.setBroadcast(true);
+    // QVGA is also the smallest size, so the ladder is jpeg quality only
+    server.setAdaptiveRate(true, 15, FRAMESIZE_QVGA);
+    REQUIRE(server.begin(PORT));
+
+    LoopbackClient client;
+    REQUIRE(client.connect(PORT + 1, 8192));
+    REQUIRE(client.send("GET /stream HTTP/1.1\r\n\r\n"));
+    std::thread reader(readStream, client.fd());
+
+    // lwIP on the device has a send window of a few KB, the host's loopback would buffer megabytes
+    StreamClientStats stats;
+    int count = 0;
+    for (int i = 0; i < 100 && !count; i++)
+    {
+        vTaskDelay(pdMS_TO_TICKS(10));
+        count = server.getStreamClientStats(&stats, 1);
+    }
+    REQUIRE(count == 1);
+    int sendBuffer = 8192;
+    REQUIRE(setsockopt(stats.fd, SOL_SOCKET, SO_SNDBUF, &sendBuffer, sizeof(sendBuffer)) == 0);
+
+    // a few frames per second get through the capped socket, far below the 15 fps target
+    RateControlState down = waitFor(server, 20000, [](const RateControlState &s) { return s.level >= 2; });
+    CHECK(down.clients == 1);
+    CHECK(down.stepsDown >= 2);
+    CHECK(down.level >= 2);
+    CHECK(down.quality > 12);
+    CHECK(down.capacityFps < 15);
+    // the new quality goes to the sensor through the queue the capture task applies between frames
+    for (int i = 0; i < 100 && esp_camera_sensor_get()->status.quality != server.getRateState().quality; i++)
+    {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    CHECK_EQ(esp_camera_sensor_get()->status.quality, server.getRateState().quality);
+    CHECK(received.load() > 0);
+
+    // the same viewer at full speed has plenty of headroom, the controller walks back towards the base
+    throttled = false;
+    RateControlState up = waitFor(server, 30000, [&](const RateControlState &s) { return s.level < down.level; });
+    CHECK(up.stepsUp >= 1);
+    CHECK(up.level < down.level);
+    CHECK(up.quality < down.quality);
+    CHECK(up.capacityFps > 15);
+
+    reading = false;
+    shutdown(client.fd(), SHUT_RDWR);
+    reader.join();
+    return checkResult("rate_controller_test");
+}
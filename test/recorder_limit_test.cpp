@@ -0,0 +1,144 @@
+#include "EspCamLib.h"
+#include "host_camera.h"
+#include "Check.h"
+#include <SD.h>
+
+// the AVI size limit: the muxer refuses a frame that would take the finished file past 4 GiB, where the
+// 32 bit RIFF size wraps, and the recorder ends a single file or rotates a loop segment at its own limit
+// with every file still a complete AVI
+using namespace EspCam;
+
+static const uint32_t LIMIT = 48 * 1024;
+
+// counts what would be written to the card
+class CountingPrint : public Print
+{
+public:
+    uint64_t bytes = 0;
+
+    size_t write(uint8_t c) override
+    {
+        bytes++;
+        return 1;
+    }
+
+    size_t write(const uint8_t *data, size_t len) override
+    {
+        bytes += len;
+        return len;
+    }
+};
+
+static uint32_t get32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void checkMuxerLimit()
+{
+    static uint8_t frame[1024 * 1024];
+    CountingPrint out;
+    AviWriter avi;
+    REQUIRE(avi.begin(&out, 640, 480, 10));
+    uint32_t frames = 0;
+    while (avi.addFrame(frame, sizeof(frame)))
+    {
+        frames++;
+        REQUIRE(frames < 5000);
+    }
+    CHECK_EQ(avi.getFrameCount(), frames);
+    // the refused frame wrote nothing and the next one would have crossed the limit
+    CHECK_EQ(out.bytes, avi.getSize());
+    CHECK((uint64_t)avi.getFileSize() + 8 + sizeof(frame) + 16 > AviWriter::MAX_FILE_SIZE);
+    CHECK(!avi.hasRoomFor(sizeof(frame)));
+    CHECK(avi.hasRoomFor(1000));
+    CHECK(avi.addFrame(frame, 1000));
+
+    CHECK(avi.finish(&out));
+    CHECK_EQ(out.bytes, avi.getFileSize());
+    CHECK(out.bytes <= AviWriter::MAX_FILE_SIZE);
+    CHECK(out.bytes > AviWriter::MAX_FILE_SIZE - sizeof(frame) - 1024);
+}
+
+// size of the finished AVI at `path`, after checking the header against the index
+static size_t checkAvi(const char *path)
+{
+    File file = SD.open(path);
+    REQUIRE(file);
+    uint8_t header[AviWriter::HEADER_SIZE];
+    REQUIRE(file.read(header, sizeof(header)) == sizeof(header));
+    CHECK(memcmp(header, "RIFF", 4) == 0);
+    CHECK_EQ(get32(header + 4) + 8, file.size());
+    uint32_t frames = get32(header + 32 + 16);
+    uint32_t moviSize = get32(header + 216);
+    CHECK(frames > 0);
+    CHECK_EQ(212 + 8 + moviSize + 8 + frames * 16, file.size());
+    uint8_t idx[8];
+    CHECK(file.seek(212 + 8 + moviSize));
+    CHECK_EQ(file.read(idx, sizeof(idx)), sizeof(idx));
+    CHECK(memcmp(idx, "idx1", 4) == 0);
+    return file.size();
+}
+
+static void checkSingleFile(Camera &camera)
+{
+    Recorder recorder(&camera, 10);
+    recorder.setWriteBuffer(64 * 1024, 8 * 1024);
+    recorder.setMaxFileSize(LIMIT);
+    REQUIRE(recorder.start("/single.avi"));
+    for (int i = 0; i < 300 && recorder.isRecording(); i++)
+    {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    CHECK(!recorder.isRecording());
+    recorder.stop();
+
+    RecorderStats stats = recorder.getStats();
+    CHECK(stats.framesWritten > 0);
+    CHECK_EQ(stats.framesDropped, 0);
+    size_t size = checkAvi("/single.avi");
+    CHECK(size <= LIMIT);
+    CHECK(size > LIMIT / 2);
+}
+
+// a loop limited by time only still rotates before the size limit
+static void checkLoopSegments(Camera &camera)
+{
+    Recorder recorder(&camera, 10);
+    recorder.setWriteBuffer(64 * 1024, 8 * 1024);
+    recorder.setSegmentLimits(3600);
+    recorder.setMaxFileSize(LIMIT);
+    REQUIRE(recorder.startLoop("/loop"));
+    vTaskDelay(pdMS_TO_TICKS(2500));
+    CHECK(recorder.isRecording());
+    recorder.stop();
+
+    RecorderStats stats = recorder.getStats();
+    CHECK(stats.segments >= 3);
+    for (uint32_t i = 0; i < stats.segments; i++)
+    {
+        char path[32];
+        snprintf(path, sizeof(path), "/loop/seg%05u.avi", (unsigned)i);
+        CHECK(checkAvi(path) <= LIMIT);
+    }
+}
+
+int main()
+{
+    checkMuxerLimit();
+
+    char root[] = "/tmp/espcam_limitXXXXXX";
+    REQUIRE(mkdtemp(root) && SD.begin(root));
+    HostCamera::setFrameRate(20);
+    Camera camera;
+    camera.setFrameSize(FRAMESIZE_QVGA);
+    REQUIRE(camera.begin());
+
+    checkSingleFile(camera);
+    checkLoopSegments(camera);
+
+    char command[64];
+    snprintf(command, sizeof(command), "rm -rf %s", root);
+    CHECK(system(command) == 0);
+    return checkResult("recorder_limit_test");
+}
@@ -0,0 +1,111 @@
+#include "EspCamLib.h"
+#include "host_camera.h"
+#include "Check.h"
+#include <SD.h>
+#include <map>
+
+// loop recording on the directory backed SD card: segments rotate at the byte limit, every segment is a
+// complete AVI, the oldest ones are deleted to stay under the storage budget, and a second loop in the
+// same directory continues the numbering and counts the segments already there
+using namespace EspCam;
+
+static const size_t SEGMENT_BYTES = 32 * 1024;
+static const uint64_t BUDGET = 160 * 1024;
+
+static uint32_t get32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// index -> file size of the segments in /loop, every one checked to be a finished AVI
+static std::map<unsigned, size_t> checkSegments()
+{
+    std::map<unsigned, size_t> segments;
+    File dir = SD.open("/loop");
+    REQUIRE(dir && dir.isDirectory());
+    for (File entry = dir.openNextFile(); entry; entry = dir.openNextFile())
+    {
+        const char *name = strrchr(entry.name(), '/');
+        name = name ? name + 1 : entry.name();
+        unsigned index;
+        REQUIRE(sscanf(name, "seg%u.avi", &index) == 1);
+        segments[index] = entry.size();
+
+        uint8_t header[AviWriter::HEADER_SIZE];
+        CHECK_EQ(entry.read(header, sizeof(header)), sizeof(header));
+        CHECK(memcmp(header, "RIFF", 4) == 0 && memcmp(header + 8, "AVI ", 4) == 0);
+        CHECK_EQ(get32(header + 4) + 8, entry.size());
+        // the frame count in the header matches the index at the end of the file
+        uint32_t frames = get32(header + 32 + 16);
+        uint32_t moviSize = get32(header + 216);
+        CHECK(frames > 0);
+        CHECK_EQ(212 + 8 + moviSize + 8 + frames * 16, entry.size());
+        uint8_t idx[8];
+        CHECK(entry.seek(212 + 8 + moviSize));
+        CHECK_EQ(entry.read(idx, sizeof(idx)), sizeof(idx));
+        CHECK(memcmp(idx, "idx1", 4) == 0);
+        CHECK_EQ(get32(idx + 4), frames * 16);
+    }
+    return segments;
+}
+
+static uint64_t total(const std::map<unsigned, size_t> &segments)
+{
+    uint64_t bytes = 0;
+    for (const auto &segment : segments)
+    {
+        bytes += segment.second;
+    }
+    return bytes;
+}
+
+static void record(Camera &camera, uint32_t ms, RecorderStats &stats)
+{
+    Recorder recorder(&camera, 10);
+    recorder.setWriteBuffer(128 * 1024, 8 * 1024);
+    recorder.setSegmentLimits(0, SEGMENT_BYTES);
+    recorder.setStorageBudget(BUDGET);
+    REQUIRE(recorder.startLoop("/loop"));
+    vTaskDelay(pdMS_TO_TICKS(ms));
+    recorder.stop();
+    stats = recorder.getStats();
+}
+
+int main()
+{
+    char root[] = "/tmp/espcam_loopXXXXXX";
+    REQUIRE(mkdtemp(root) && SD.begin(root));
+    HostCamera::setFrameRate(20);
+    Camera camera;
+    camera.setFrameSize(FRAMESIZE_QVGA);
+    REQUIRE(camera.begin());
+
+    RecorderStats stats;
+    record(camera, 4000, stats);
+    std::map<unsigned, size_t> first = checkSegments();
+    CHECK(stats.segments >= 6);
+    CHECK_EQ(stats.framesDropped, 0);
+    // the budget deleted the oldest, what is left is the newest run of segments
+    REQUIRE(!first.empty());
+    CHECK(first.size() < stats.segments);
+    CHECK(total(first) <= BUDGET);
+    CHECK_EQ(first.begin()->first + first.size(), stats.segments);
+    CHECK_EQ(first.rbegin()->first, stats.segments - 1);
+
+    // a second loop picks up where the first one stopped, nothing is overwritten
+    record(camera, 2000, stats);
+    std::map<unsigned, size_t> second = checkSegments();
+    CHECK(stats.segments >= 3);
+    CHECK(total(second) <= BUDGET);
+    CHECK_EQ(second.rbegin()->first, first.rbegin()->first + stats.segments);
+    for (const auto &segment : second)
+    {
+        if (first.count(segment.first))
+            CHECK_EQ(segment.second, first[segment.first]);
+    }
+
+    char command[64];
+    snprintf(command, sizeof(command), "rm -rf %s", root);
+    CHECK(system(command) == 0);
+    return checkResult("recorder_loop_test");
+}
@@ -0,0 +1,363 @@
+#include "EspCamLib.h"
+#include "Check.h"
+#include "LoopbackClient.h"
+#include <string>
+#include <vector>
+
+// DESCRIBE, SETUP and PLAY against a loopback RtspServer, then the RTP/JPEG stream over UDP and interleaved
+// TCP: RFC 2435 headers, fragment offsets that add up to the scan, the marker bit on the last packet and
+// continuous sequence numbers. A TCP viewer that stops reading must not hold up the other sessions
+using namespace EspCam;
+
+static const int PORT = 18554;
+static const int RTP_PORT = 16970;
+
+// the same JPEG every 40 ms, so the reassembled scan can be compared with the bytes that went in
+class FixedJpegSource : public FrameSource
+{
+private:
+    camera_fb_t m_fbs[3];
+    int m_next = 0;
+    int64_t m_due = 0;
+
+public:
+    std::vector<uint8_t> jpeg;
+    int width = 0;
+    int height = 0;
+
+    bool begin(const camera_config_t *config) override
+    {
+        return true;
+    }
+
+    camera_fb_t *get() override
+    {
+        int64_t now = esp_timer_get_time();
+        if (m_due > now)
+            vTaskDelay(pdMS_TO_TICKS((m_due - now) / 1000));
+        m_due = esp_timer_get_time() + 40000;
+        camera_fb_t *fb = &m_fbs[m_next++ % 3];
+        memset(fb, 0, sizeof(*fb));
+        fb->buf = jpeg.data();
+        fb->len = jpeg.size();
+        fb->width = width;
+        fb->height = height;
+        fb->format = PIXFORMAT_JPEG;
+        int64_t t = esp_timer_get_time();
+        fb->timestamp.tv_sec = t / 1000000;
+        fb->timestamp.tv_usec = t % 1000000;
+        return fb;
+    }
+
+    void release(camera_fb_t *fb) override {}
+};
+
+// reassembles frames from RTP/JPEG packets and checks every header on the way
+struct FrameAssembler
+{
+    std::string scan;
+    int frames = 0;
+    int goodFrames = 0;
+    int packets = 0;
+    int sequenceGaps = 0;
+    bool haveSequence = false;
+    uint16_t lastSequence = 0;
+    uint32_t timestamp = 0;
+    uint32_t ssrc = 0;
+    uint8_t expectType = 0;
+    uint16_t expectRestart = 0;
+    const std::string *expectScan = nullptr;
+    int width8 = 0;
+    int height8 = 0;
+
+    void packet(const uint8_t *p, size_t len)
+    {
+        REQUIRE(len > 20);
+        packets++;
+        CHECK_EQ(p[0], 0x80);
+        CHECK_EQ(p[1] & 0x7F, RtpJpegPacketizer::PAYLOAD_TYPE);
+        bool marker = p[1] & 0x80;
+        uint16_t sequence = (p[2] << 8) | p[3];
+        uint32_t ts = (uint32_t)p[4] << 24 | p[5] << 16 | p[6] << 8 | p[7];
+        uint32_t source = (uint32_t)p[8] << 24 | p[9] << 16 | p[10] << 8 | p[11];
+        if (haveSequence && sequence != (uint16_t)(lastSequence + 1))
+            sequenceGaps++;
+        haveSequence = true;
+        lastSequence = sequence;
+
+        const uint8_t *j = p + 12;
+        uint32_t offset = j[1] << 16 | j[2] << 8 | j[3];
+        CHECK_EQ(j[4], expectType);
+        CHECK_EQ(j[5], 255);
+        CHECK_EQ(j[6], width8);
+        CHECK_EQ(j[7], height8);
+        size_t pos = 8;
+        if (expectType >= 64)
+        {
+            CHECK_EQ((j[8] << 8) | j[9], expectRestart);
+            pos += 4;
+        }
+
+        if (offset == 0)
+        {
+            // in-band tables with the first fragment, two 64 byte 8 bit tables
+            CHECK_EQ(j[pos], 0);
+            CHECK_EQ((j[pos + 2] << 8) | j[pos + 3], 128);
+            pos += 4 + 128;
+            scan.clear();
+            timestamp = ts;
+            ssrc = source;
+        }
+        else
+        {
+            CHECK_EQ(ts, timestamp);
+            CHECK_EQ(source, ssrc);
+        }
+        CHECK_EQ(offset, scan.size());
+        scan.append((const char *)j + pos, len - 12 - pos);
+
+        if (marker)
+        {
+            frames++;
+            if (expectScan && scan == *expectScan)
+                goodFrames++;
+        }
+    }
+};
+
+static std::string request(LoopbackClient &client, const char *method, const std::string &url, int cseq,
+                           const std::string &headers, std::string *body = nullptr)
+{
+    client.send(std::string(method) + " " + url + " RTSP/1.0\r\nCSeq: " + std::to_string(cseq) + "\r\n" + headers + "\r\n");
+    std::string head;
+    REQUIRE(client.readUntil("\r\n\r\n", head));
+    CHECK(head.find("RTSP/1.0 ") == 0);
+    CHECK_EQ(atoi(LoopbackClient::header(head, "CSeq").c_str()), cseq);
+    std::string length = LoopbackClient::header(head, "Content-Length");
+    std::string content;
+    if (!length.empty())
+        REQUIRE(client.readBytes(atoi(length.c_str()), content));
+    if (body)
+        *body = content;
+    return head;
+}
+
+static std::string sessionOf(const std::string &head)
+{
+    std::string session = LoopbackClient::header(head, "Session");
+    return session.substr(0, session.find(';'));
+}
+
+static void play(LoopbackClient &client, const std::string &transport, std::string &setupHead)
+{
+    std::string url = "rtsp://127.0.0.1:" + std::to_string(PORT) + "/mjpeg/1";
+    REQUIRE(client.connect(PORT));
+    std::string head = request(client, "OPTIONS", url, 1, "");
+    CHECK(LoopbackClient::header(head, "Public").find("PLAY") != std::string::npos);
+
+    std::string sdp;
+    head = request(client, "DESCRIBE", url, 2, "Accept: application/sdp\r\n", &sdp);
+    CHECK(head.find("200 OK") != std::string::npos);
+    CHECK(LoopbackClient::header(head, "Content-Base") == url + "/");
+    CHECK(sdp.find("m=video 0 RTP/AVP 26") != std::string::npos);
+    CHECK(sdp.find("a=control:track1") != std::string::npos);
+
+    setupHead = request(client, "SETUP", url + "/track1", 3, "Transport: " + transport + "\r\n");
+    CHECK(setupHead.find("200 OK") != std::string::npos);
+    std::string session = sessionOf(setupHead);
+    REQUIRE(!session.empty());
+
+    head = request(client, "PLAY", url, 4, "Session: " + session + "\r\n");
+    CHECK(head.find("200 OK") != std::string::npos);
+}
+
+static void checkUdp(FrameAssembler &frames)
+{
+    int udp = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    REQUIRE(bind(udp, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+    socklen_t addrLen = sizeof(addr);
+    getsockname(udp, (struct sockaddr *)&addr, &addrLen);
+    int buffer = 4 << 20;
+    setsockopt(udp, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+    struct timeval timeout = {2, 0};
+    setsockopt(udp, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    int port = ntohs(addr.sin_port);
+    LoopbackClient client;
+    std::string setup;
+    play(client, "RTP/AVP;unicast;client_port=" + std::to_string(port) + "-" + std::to_string(port + 1), setup);
+    std::string transport = LoopbackClient::header(setup, "Transport");
+    CHECK(transport.find("server_port=" + std::to_string(RTP_PORT)) != std::string::npos);
+
+    uint8_t packet[2048];
+    while (frames.frames < 10)
+    {
+        struct sockaddr_in from;
+        socklen_t fromLen = sizeof(from);
+        ssize_t n = recvfrom(udp, packet, sizeof(packet), 0, (struct sockaddr *)&from, &fromLen);
+        REQUIRE(n > 0);
+        CHECK_EQ(ntohs(from.sin_port), RTP_PORT);
+        frames.packet(packet, n);
+    }
+
+    std::string head = request(client, "TEARDOWN", "rtsp://127.0.0.1/mjpeg/1", 5, "Session: " + sessionOf(setup) + "\r\n");
+    CHECK(head.find("200 OK") != std::string::npos);
+    close(udp);
+}
+
+static void checkInterleaved(FrameAssembler &frames)
+{
+    LoopbackClient client;
+    std::string setup;
+    play(client, "RTP/AVP/TCP;unicast;interleaved=4-5", setup);
+    CHECK(LoopbackClient::header(setup, "Transport").find("interleaved=4-5") != std::string::npos);
+
+    while (frames.frames < 10)
+    {
+        std::string prefix, packet;
+        REQUIRE(client.readBytes(4, prefix));
+        REQUIRE(prefix[0] == '$');
+        CHECK_EQ((uint8_t)prefix[1], 4);
+        REQUIRE(client.readBytes((uint8_t)prefix[2] << 8 | (uint8_t)prefix[3], packet));
+        frames.packet((const uint8_t *)packet.data(), packet.size());
+    }
+
+    // the reply to a keepalive is not mixed into a packet
+    client.send("GET_PARAMETER rtsp://127.0.0.1/mjpeg/1 RTSP/1.0\r\nCSeq: 9\r\nSession: " + sessionOf(setup) + "\r\n\r\n");
+    bool answered = false;
+    for (int i = 0; i < 200 && !answered; i++)
+    {
+        std::string first;
+        REQUIRE(client.readBytes(1, first));
+        if (first[0] == '$')
+        {
+            std::string rest, packet;
+            REQUIRE(client.readBytes(3, rest));
+            REQUIRE(client.readBytes((uint8_t)rest[1] << 8 | (uint8_t)rest[2], packet));
+            continue;
+        }
+        std::string head;
+        REQUIRE(client.readUntil("\r\n\r\n", head));
+        head = first + head;
+        CHECK(head.find("RTSP/1.0 200 OK") == 0);
+        CHECK(LoopbackClient::header(head, "CSeq") == "9");
+        answered = true;
+    }
+    CHECK(answered);
+}
+
+// an interleaved viewer that stops reading blocks the stream task in its socket write, the control task
+// must keep answering everyone else meanwhile
+static void checkStalledViewer(RtspServer &rtsp)
+{
+    LoopbackClient stalled;
+    std::string setup;
+    {
+        std::string url = "rtsp://127.0.0.1:" + std::to_string(PORT) + "/mjpeg/1";
+        REQUIRE(stalled.connect(PORT, 4096));
+        setup = request(stalled, "SETUP", url + "/track1", 1, "Transport: RTP/AVP/TCP;unicast;interleaved=0-1\r\n");
+        request(stalled, "PLAY", url, 2, "Session: " + sessionOf(setup) + "\r\n");
+    }
+
+    int64_t worst = 0;
+    bool closed = false;
+    int64_t start = esp_timer_get_time();
+    while (esp_timer_get_time() - start < 10000000 && !closed)
+    {
+        LoopbackClient other;
+        int64_t t = esp_timer_get_time();
+        REQUIRE(other.connect(PORT));
+        std::string head = request(other, "OPTIONS", "rtsp://127.0.0.1/", 1, "");
+        CHECK(head.find("200 OK") != std::string::npos);
+        int64_t took = esp_timer_get_time() - t;
+        worst = took > worst ? took : worst;
+        other.close();
+        // the stalled session is dropped once a write runs into the 2 s send timeout
+        closed = rtsp.getStats().playing == 0;
+        vTaskDelay(pdMS_TO_TICKS(50));
+    }
+    CHECK(closed);
+    CHECK(worst < 500000);
+}
+
+int main()
+{
+    // a QVGA frame encoded here, plain and with restart markers
+    const int width = 320, height = 240;
+    std::vector<uint8_t> pixels(width * height * 2);
+    for (size_t i = 0; i < pixels.size(); i++)
+    {
+        pixels[i] = (uint8_t)((i * 7) ^ (i >> 9));
+    }
+    JpegEncoder encoder(70);
+    StripExecutor executor;
+    REQUIRE(executor.begin(2));
+
+    for (int restart = 0; restart < 2; restart++)
+    {
+        FixedJpegSource source;
+        source.width = width;
+        source.height = height;
+        uint8_t *out = nullptr, *spill = nullptr;
+        size_t capacity = 0, spillCapacity = 0, length = 0;
+        if (restart)
+            REQUIRE(encoder.encode(pixels.data(), width, height, PIXFORMAT_RGB565, out, capacity, length, executor, spill, spillCapacity));
+        else
+            REQUIRE(encoder.encode(pixels.data(), width, height, PIXFORMAT_RGB565, out, capacity, length));
+        source.jpeg.assign(out, out + length);
+        free(out);
+        free(spill);
+
+        JpegDcDecoder decoder;
+        REQUIRE(decoder.parseHeaders(source.jpeg.data(), source.jpeg.size()));
+        std::string scan((const char *)source.jpeg.data() + decoder.getScanStart(), source.jpeg.size() - decoder.getScanStart() - 2);
+
+        Camera camera;
+        camera.setFrameSource(&source);
+        REQUIRE(camera.begin());
+        RtspServer rtsp(&camera);
+        rtsp.setRtpPort(RTP_PORT);
+        REQUIRE(rtsp.begin(PORT));
+
+        // 4:2:2 is type 0, plus 64 with restart markers
+        FrameAssembler udp;
+        udp.expectType = restart ? 64 : 0;
+        udp.expectRestart = restart ? width / 16 : 0;
+        udp.expectScan = &scan;
+        udp.width8 = width / 8;
+        udp.height8 = height / 8;
+        FrameAssembler tcp = udp;
+
+        checkUdp(udp);
+        CHECK_EQ(udp.goodFrames, udp.frames);
+        CHECK(udp.packets > udp.frames);
+        CHECK_EQ(udp.sequenceGaps, 0);
+
+        checkInterleaved(tcp);
+        CHECK_EQ(tcp.goodFrames, tcp.frames);
+        CHECK_EQ(tcp.sequenceGaps, 0);
+
+        if (!restart)
+            checkStalledViewer(rtsp);
+
+        RtspStats stats = rtsp.getStats();
+        CHECK(stats.framesSent >= 20);
+        CHECK_EQ(stats.badFrames, 0);
+        rtsp.stop();
+        camera.getBroker()->stop();
+    }
+
+    // RFC 2435 has no single component type
+    Camera gray;
+    gray.setPixelFormat(PIXFORMAT_GRAYSCALE);
+    REQUIRE(gray.begin());
+    RtspServer rtsp(&gray);
+    CHECK(!rtsp.begin(PORT));
+
+    executor.stop();
+    return checkResult("rtsp_test");
+}
@@ -0,0 +1,61 @@
+#include "SensorQueue.h"
+#include "Check.h"
+#include <signal.h>
+#include <sys/time.h>
+
+// a timer signal stands in for the capture task and drains the queue at arbitrary points of post(),
+// also between raising the dirty bit and counting the ticket. Every ticket must still be completed
+using namespace EspCam;
+
+static SensorQueue queue;
+static volatile sig_atomic_t drains = 0;
+
+static void drain(int)
+{
+    if (queue.pending())
+    {
+        int values[SENSOR_SETTING_COUNT];
+        uint32_t ticket;
+        queue.take(values, ticket);
+        queue.complete(ticket);
+    }
+    drains = drains + 1;
+}
+
+int main()
+{
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = drain;
+    sigaction(SIGALRM, &action, NULL);
+    struct itimerval timer = {{0, 20}, {0, 20}};
+    setitimer(ITIMER_REAL, &timer, NULL);
+
+    int missed = 0;
+    for (int i = 0; i < 20000 && !missed; i++)
+    {
+        // posts until a drain comes, which then often lands inside the last post
+        sig_atomic_t start = drains;
+        uint32_t ticket;
+        do
+        {
+            ticket = queue.post(SENSOR_BRIGHTNESS, i & 1);
+        } while (drains == start);
+
+        start = drains;
+        while (!queue.isApplied(ticket))
+        {
+            // the drains that came since have all had their chance to complete it
+            if (drains - start > 100 && !queue.isApplied(ticket))
+            {
+                missed++;
+                break;
+            }
+        }
+    }
+
+    struct itimerval off = {};
+    setitimer(ITIMER_REAL, &off, NULL);
+    CHECK_EQ(missed, 0);
+    return checkResult("sensor_queue_test");
+}
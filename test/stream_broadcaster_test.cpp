@@ -0,0 +1,272 @@
+#include "EspCamLib.h"
+#include "host_camera.h"
+#include "Check.h"
+#include "LoopbackClient.h"
+
+// the broadcaster with a WebSocket client that acks late: frames it has in flight are held to the ack window
+// even though the frames skipped in between leave gaps in the sequence numbers. Also the broker demand the
+// broadcaster holds while it has clients, how clients are closed and removed, and that a viewer which stops
+// reading holds up neither the capture nor the other viewers
+using namespace EspCam;
+
+static const int PORT = 18090;
+static const int WEB_PORT = 18092;
+static const int STALL_PORT = 18102;
+static const uint32_t WINDOW = 2;
+
+static StreamBroadcaster *broadcaster = nullptr;
+static volatile int serverFd = -1;
+
+static esp_err_t wsHandler(httpd_req_t *req)
+{
+    serverFd = httpd_req_to_sockfd(req);
+    return broadcaster->addClient(serverFd, true) ? ESP_OK : ESP_FAIL;
+}
+
+static void closeHandler(httpd_handle_t hd, int sockfd)
+{
+    broadcaster->removeClient(sockfd);
+    close(sockfd);
+}
+
+// sequence of the next binary message, false when nothing arrives within the receive timeout
+static bool readFrame(LoopbackClient &client, uint32_t &sequence)
+{
+    std::string head, ext, payload;
+    if (!client.readBytes(2, head))
+        return false;
+    REQUIRE((uint8_t)head[0] == 0x82);
+    uint64_t len = (uint8_t)head[1];
+    if (len >= 126)
+    {
+        REQUIRE(client.readBytes(len == 126 ? 2 : 8, ext));
+        len = 0;
+        for (char c : ext)
+        {
+            len = (len << 8) | (uint8_t)c;
+        }
+    }
+    REQUIRE(client.readBytes(len, payload));
+    REQUIRE(payload.size() >= 4);
+    sequence = 0;
+    for (int i = 3; i >= 0; i--)
+    {
+        sequence = (sequence << 8) | (uint8_t)payload[i];
+    }
+    return true;
+}
+
+// frames that arrive until the stream goes quiet, `last` is the newest one
+static int drain(LoopbackClient &client, uint32_t &last)
+{
+    int count = 0;
+    uint32_t sequence;
+    while (readFrame(client, sequence))
+    {
+        CHECK(count == 0 || (int32_t)(sequence - last) > 0);
+        last = sequence;
+        count++;
+    }
+    return count;
+}
+
+static void checkAckWindow()
+{
+    LoopbackClient client;
+    REQUIRE(client.connect(PORT, 0, 400));
+    REQUIRE(client.send("GET /ws HTTP/1.1\r\n\r\n"));
+
+    // until the first ack the client is only limited by its socket
+    uint32_t first;
+    REQUIRE(readFrame(client, first));
+    broadcaster->ack(serverFd, first);
+    uint32_t last = first;
+    drain(client, last);
+
+    // with everything acked exactly the window goes out, although the camera ran on during the quiet
+    // period and the sequences of these frames are further apart than the window
+    broadcaster->ack(serverFd, last);
+    uint32_t acked = last;
+    CHECK_EQ(drain(client, last), WINDOW);
+    CHECK((int32_t)(last - acked) > (int32_t)WINDOW);
+
+    // acking the older of the two frames in flight frees one place
+    broadcaster->ack(serverFd, last - 1);
+    CHECK_EQ(drain(client, last), 1);
+
+    // acks for frames never sent change nothing
+    broadcaster->ack(serverFd, last + 100);
+    CHECK_EQ(drain(client, last), 0);
+}
+
+// the sensor runs while there is demand, without anybody waiting in acquire()
+static void checkDemand(FrameBroker *broker)
+{
+    vTaskDelay(pdMS_TO_TICKS(150));
+    uint32_t idle = broker->latest().sequence();
+    vTaskDelay(pdMS_TO_TICKS(300));
+    CHECK(broker->latest().sequence() - idle <= 1);
+
+    broker->addDemand();
+    vTaskDelay(pdMS_TO_TICKS(300));
+    CHECK(broker->latest().sequence() - idle >= 3);
+    broker->removeDemand();
+
+    vTaskDelay(pdMS_TO_TICKS(150));
+    idle = broker->latest().sequence();
+    vTaskDelay(pdMS_TO_TICKS(300));
+    CHECK(broker->latest().sequence() - idle <= 1);
+}
+
+// stop() hands the sockets back to httpd to close instead of leaving viewers hanging
+static void checkStopClosesClients()
+{
+    LoopbackClient client;
+    REQUIRE(client.connect(PORT, 0, 3000));
+    REQUIRE(client.send("GET /ws HTTP/1.1\r\n\r\n"));
+    uint32_t sequence;
+    REQUIRE(readFrame(client, sequence));
+    CHECK_EQ(broadcaster->getClientCount(), 1);
+
+    broadcaster->stop();
+    CHECK_EQ(broadcaster->getClientCount(), 0);
+    // whatever was queued, then the end of the stream rather than the receive timeout
+    char buf[4096];
+    ssize_t n;
+    unsigned long start = millis();
+    while ((n = recv(client.fd(), buf, sizeof(buf), 0)) > 0)
+    {
+    }
+    CHECK_EQ(n, 0);
+    CHECK(millis() - start < 2000);
+}
+
+class CountingWebServer : public WebServer
+{
+public:
+    std::atomic<int> removed{0};
+
+    CountingWebServer(Camera *camera) : WebServer(camera) {}
+
+    void onClientRemoved(int fd) override
+    {
+        removed++;
+        WebServer::onClientRemoved(fd);
+    }
+};
+
+// a broadcast viewer that leaves is removed from the rate controller once
+static void checkRemovedOnce(Camera &camera)
+{
+    CountingWebServer server(&camera);
+    server.setBroadcast(true);
+    REQUIRE(server.begin(WEB_PORT));
+
+    LoopbackClient client;
+    REQUIRE(client.connect(WEB_PORT + 1));
+    REQUIRE(client.send("GET /stream HTTP/1.1\r\n\r\n"));
+    std::string head, part;
+    REQUIRE(client.readUntil("\r\n\r\n", head));
+    REQUIRE(client.readUntil("\r\n\r\n", part));
+    client.close();
+
+    for (int i = 0; i < 200 && server.removed.load() == 0; i++)
+    {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    vTaskDelay(pdMS_TO_TICKS(200));
+    CHECK_EQ(server.removed.load(), 1);
+}
+
+// multipart parts a viewer receives within `ms`
+static int countParts(LoopbackClient &client, int ms)
+{
+    int parts = 0;
+    unsigned long start = millis();
+    std::string head, data;
+    while (millis() - start < (unsigned long)ms)
+    {
+        if (!client.readUntil("\r\n\r\n", head))
+            break;
+        std::string length = LoopbackClient::header("\r\n" + head, "Content-Length");
+        if (length.empty() || !client.readBytes(strtoul(length.c_str(), nullptr, 10) + 2, data))
+            break;
+        parts++;
+    }
+    return parts;
+}
+
+// one viewer stops reading with a full socket at the default two driver framebuffers
+static void checkStalledViewer(Camera &camera)
+{
+    HostCamera::setFrameRate(20);
+    uint32_t ticket = camera.setFrameSize(FRAMESIZE_VGA);
+    WebServer server(&camera);
+    server.setBroadcast(true);
+    REQUIRE(server.begin(STALL_PORT));
+
+    LoopbackClient stalled;
+    REQUIRE(stalled.connect(STALL_PORT + 1, 2048));
+    REQUIRE(stalled.send("GET /stream HTTP/1.1\r\n\r\n"));
+    // loopback would otherwise grow the server side buffer to take megabytes before the socket blocks
+    StreamClientStats stats;
+    int count = 0;
+    for (int i = 0; i < 100 && !count; i++)
+    {
+        vTaskDelay(pdMS_TO_TICKS(10));
+        count = server.getStreamClientStats(&stats, 1);
+    }
+    REQUIRE(count == 1);
+    int sendBuffer = 8192;
+    REQUIRE(setsockopt(stats.fd, SOL_SOCKET, SO_SNDBUF, &sendBuffer, sizeof(sendBuffer)) == 0);
+    REQUIRE(camera.waitForSensor(ticket, pdMS_TO_TICKS(2000)));
+    vTaskDelay(pdMS_TO_TICKS(1000));
+
+    Metrics *metrics = camera.getBroker()->getMetrics();
+    uint32_t captured = metrics->snapshot().framesCaptured;
+    LoopbackClient live;
+    REQUIRE(live.connect(STALL_PORT + 1));
+    REQUIRE(live.send("GET /stream HTTP/1.1\r\n\r\n"));
+    std::string head;
+    REQUIRE(live.readUntil("\r\n\r\n", head));
+    int parts = countParts(live, 2000);
+    captured = metrics->snapshot().framesCaptured - captured;
+
+    CHECK(captured >= 30);
+    CHECK(parts >= 20);
+    live.close();
+    stalled.close();
+}
+
+int main()
+{
+    // fast enough that frames are skipped while the client holds back its acks
+    HostCamera::setFrameRate(30);
+    Camera camera;
+    camera.setFrameSize(FRAMESIZE_QVGA);
+    REQUIRE(camera.begin());
+    REQUIRE(camera.getBroker()->begin());
+
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = PORT;
+    config.close_fn = closeHandler;
+    httpd_handle_t server = NULL;
+    REQUIRE(httpd_start(&server, &config) == ESP_OK);
+    httpd_uri_t uri = {"/ws", HTTP_GET, wsHandler, NULL};
+    REQUIRE(httpd_register_uri_handler(server, &uri) == ESP_OK);
+
+    broadcaster = new StreamBroadcaster(camera.getBroker());
+    broadcaster->setAckWindow(WINDOW);
+    REQUIRE(broadcaster->begin(server));
+
+    checkDemand(camera.getBroker());
+    checkAckWindow();
+    checkStopClosesClients();
+
+    httpd_stop(server);
+    delete broadcaster;
+
+    checkRemovedOnce(camera);
+    checkStalledViewer(camera);
+    return checkResult("stream_broadcaster_test");
+}
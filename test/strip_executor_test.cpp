@@ -0,0 +1,124 @@
+#include "StripExecutor.h"
+#include "Check.h"
+#include <vector>
+
+// bands cover every row exactly once on aligned edges, the helper really runs on its own task, and the
+// pixel kernels give the same result split as in one pass
+using namespace EspCam;
+
+struct Coverage
+{
+    int hits[256];
+    TaskHandle_t task[256];
+};
+
+static void mark(void *ctx, int rowStart, int rowEnd, uint8_t *scratch, size_t scratchSize)
+{
+    Coverage *coverage = static_cast<Coverage *>(ctx);
+    for (int row = rowStart; row < rowEnd; row++)
+    {
+        coverage->hits[row]++;
+        coverage->task[row] = xTaskGetCurrentTaskHandle();
+    }
+}
+
+static void checkCoverage(StripExecutor &executor, int rows, int align)
+{
+    Coverage coverage;
+    memset(&coverage, 0, sizeof(coverage));
+    REQUIRE(executor.run(mark, &coverage, rows, align));
+
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    int bands = 0;
+    for (int row = 0; row < rows; row++)
+    {
+        CHECK_EQ(coverage.hits[row], 1);
+        if (row == 0 || coverage.task[row] != coverage.task[row - 1])
+        {
+            bands++;
+            CHECK_EQ(row % align, 0);
+        }
+    }
+    // the caller always takes the last band
+    CHECK(coverage.task[rows - 1] == self);
+    int units = (rows + align - 1) / align;
+    CHECK_EQ(bands, units < executor.getWorkerCount() ? units : executor.getWorkerCount());
+}
+
+static void checkKernels(StripExecutor &executor, int width, int height)
+{
+    std::vector<uint8_t> src((size_t)width * height * 2);
+    for (size_t i = 0; i < src.size(); i++)
+    {
+        src[i] = (uint8_t)(i * 2654435761u >> 13);
+    }
+    std::vector<uint8_t> gray(width * height), grayRef(width * height);
+    std::vector<uint8_t> rgb(width * height * 3), rgbRef(width * height * 3);
+
+    PixelJob ref = {src.data(), grayRef.data(), (uint16_t)width};
+    PixelKernels::rgb565ToGray(&ref, 0, height, nullptr, 0);
+    ref.dst = rgbRef.data();
+    PixelKernels::rgb565ToRgb888(&ref, 0, height, nullptr, 0);
+
+    PixelJob job = {src.data(), gray.data(), (uint16_t)width};
+    REQUIRE(executor.run(PixelKernels::rgb565ToGray, &job, height));
+    job.dst = rgb.data();
+    REQUIRE(executor.run(PixelKernels::rgb565ToRgb888, &job, height));
+    CHECK(gray == grayRef);
+    CHECK(rgb == rgbRef);
+
+    // full scale white stays 255 after the bit replication
+    uint8_t white[2] = {0xFF, 0xFF};
+    uint8_t out[3];
+    PixelJob one = {white, out, 1};
+    PixelKernels::rgb565ToRgb888(&one, 0, 1, nullptr, 0);
+    CHECK(out[0] == 255 && out[1] == 255 && out[2] == 255);
+    PixelKernels::rgb565ToGray(&one, 0, 1, nullptr, 0);
+    CHECK_EQ(out[0], 255);
+
+    // gray is the luma of the colour rgb565ToRgb888 widens the pixel to
+    for (size_t i = 0; i < gray.size(); i++)
+    {
+        const uint8_t *c = &rgbRef[i * 3];
+        if (gray[i] != ((77 * c[2] + 150 * c[1] + 29 * c[0] + 128) >> 8))
+        {
+            CHECK_EQ(gray[i], (77 * c[2] + 150 * c[1] + 29 * c[0] + 128) >> 8);
+            break;
+        }
+    }
+}
+
+int main()
+{
+    StripExecutor executor;
+    CHECK(!executor.run(mark, nullptr, 10));
+
+    REQUIRE(executor.begin(2, 640 * 2));
+    CHECK_EQ(executor.getWorkerCount(), 2);
+    checkCoverage(executor, 240, 8);
+    checkCoverage(executor, 75, 8);
+    checkCoverage(executor, 7, 8);
+    checkCoverage(executor, 1, 1);
+    checkCoverage(executor, 101, 1);
+    CHECK(!executor.run(mark, nullptr, 0));
+    // the scratch row is used when it fits, and skipped when the rows are wider
+    checkKernels(executor, 320, 240);
+    checkKernels(executor, 1600, 37);
+    CHECK(executor.getRuns() > 0);
+    executor.stop();
+    CHECK(!executor.isRunning());
+    CHECK(!executor.run(mark, nullptr, 10));
+
+    // one worker runs every band on the caller
+    REQUIRE(executor.begin(1));
+    CHECK_EQ(executor.getWorkerCount(), 1);
+    checkCoverage(executor, 240, 8);
+    checkKernels(executor, 96, 64);
+    executor.stop();
+
+    // begin() again after stop() brings the helper back
+    REQUIRE(executor.begin(2));
+    checkCoverage(executor, 64, 16);
+    executor.stop();
+    return checkResult("strip_executor_test");
+}
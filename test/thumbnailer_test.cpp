@@ -0,0 +1,151 @@
+#include "EspCamLib.h"
+#include "Check.h"
+#include <vector>
+
+// the 1/8 preview of a known frame: flat 128x64 tiles become flat 16x8 tiles in the thumbnail, one MCU
+// each, so the DC values of the re-encoded thumbnail give the tile colours back. Also the thumbnail size
+// for a frame that is not a multiple of the block size, and that a cached thumbnail is only rebuilt for
+// a new frame
+using namespace EspCam;
+
+static const uint8_t PALETTE[][3] = {
+    {0, 0, 0}, {255, 255, 255}, {200, 30, 30}, {30, 200, 30}, {30, 30, 200}, {128, 128, 128}, {240, 200, 40}, {60, 180, 220}};
+
+static const uint8_t *tileColor(int x, int y)
+{
+    return PALETTE[((x / 128) * 3 + (y / 64) * 5) % 8];
+}
+
+// hands out the same encoded frame until it is replaced
+class FixedSource : public FrameSource
+{
+private:
+    camera_fb_t m_fb = {};
+    std::vector<uint8_t> m_jpeg;
+    SemaphoreHandle_t m_lock;
+
+public:
+    FixedSource()
+    {
+        m_lock = xSemaphoreCreateMutex();
+    }
+
+    void setFrame(int width, int height)
+    {
+        std::vector<uint8_t> rgb((size_t)width * height * 3);
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                const uint8_t *c = tileColor(x, y);
+                uint8_t *p = &rgb[((size_t)y * width + x) * 3];
+                p[0] = c[2];
+                p[1] = c[1];
+                p[2] = c[0];
+            }
+        }
+        JpegEncoder encoder(90);
+        uint8_t *out = nullptr;
+        size_t capacity = 0, length = 0;
+        REQUIRE(encoder.encode(rgb.data(), width, height, PIXFORMAT_RGB888, out, capacity, length));
+
+        xSemaphoreTake(m_lock, portMAX_DELAY);
+        m_jpeg.assign(out, out + length);
+        m_fb.width = width;
+        m_fb.height = height;
+        xSemaphoreGive(m_lock);
+        free(out);
+    }
+
+    bool begin(const camera_config_t *config) override
+    {
+        return true;
+    }
+
+    camera_fb_t *get() override
+    {
+        vTaskDelay(pdMS_TO_TICKS(40));
+        xSemaphoreTake(m_lock, portMAX_DELAY);
+        m_fb.buf = m_jpeg.data();
+        m_fb.len = m_jpeg.size();
+        m_fb.format = PIXFORMAT_JPEG;
+        return &m_fb;
+    }
+
+    void release(camera_fb_t *fb) override
+    {
+        xSemaphoreGive(m_lock);
+    }
+};
+
+static void checkTiles(const uint8_t *data, size_t len)
+{
+    JpegDcDecoder decoder;
+    REQUIRE(decoder.decode(data, len));
+    CHECK_EQ(decoder.getWidth(), 64);
+    CHECK_EQ(decoder.getHeight(), 32);
+    REQUIRE(decoder.getComponentCount() == 3);
+
+    const uint8_t *luma = decoder.getMap(0);
+    const uint8_t *cb = decoder.getMap(1);
+    const uint8_t *cr = decoder.getMap(2);
+    int worst = 0;
+    // one sample per source tile, the MCU in the middle of its 16x8 thumbnail tile
+    for (int ty = 0; ty < 4; ty++)
+    {
+        for (int tx = 0; tx < 4; tx++)
+        {
+            const uint8_t *c = tileColor(tx * 128, ty * 64);
+            int r = c[0], g = c[1], b = c[2];
+            int expectY = (77 * r + 150 * g + 29 * b + 128) >> 8;
+            int expectCb = ((-43 * r - 85 * g + 128 * b + 128) >> 8) + 128;
+            int expectCr = ((128 * r - 107 * g - 21 * b + 128) >> 8) + 128;
+            int y = luma[ty * decoder.getMapWidth(0) + tx * 2];
+            size_t i = ty * decoder.getMapWidth(1) + tx;
+            worst = std::max(worst, abs(y - expectY));
+            worst = std::max(worst, std::max(abs(cb[i] - expectCb), abs(cr[i] - expectCr)));
+        }
+    }
+    // two rounds of DC quantization at quality 90 and the integer colour conversion in between
+    CHECK(worst <= 6);
+}
+
+int main()
+{
+    FixedSource source;
+    source.setFrame(512, 256);
+    Camera camera;
+    camera.setFrameSource(&source);
+    REQUIRE(camera.begin());
+    REQUIRE(camera.getBroker()->begin());
+
+    Thumbnailer thumbnailer(camera.getBroker());
+    thumbnailer.setQuality(90);
+    thumbnailer.setMaxAge(0);
+    REQUIRE(thumbnailer.begin());
+
+    const uint8_t *data;
+    size_t len;
+    REQUIRE(thumbnailer.acquire(data, len));
+    CHECK_EQ(thumbnailer.getWidth(), 64);
+    CHECK_EQ(thumbnailer.getHeight(), 32);
+    checkTiles(data, len);
+    thumbnailer.release();
+    uint32_t conversions = thumbnailer.getConversions();
+    CHECK_EQ(conversions, 1);
+
+    // blocks that are only partly inside the frame still make a thumbnail pixel
+    source.setFrame(330, 250);
+    vTaskDelay(pdMS_TO_TICKS(200));
+    REQUIRE(thumbnailer.acquire(data, len));
+    CHECK_EQ(thumbnailer.getWidth(), 42);
+    CHECK_EQ(thumbnailer.getHeight(), 32);
+    JpegDcDecoder decoder;
+    CHECK(decoder.decode(data, len));
+    CHECK_EQ(decoder.getWidth(), 42);
+    CHECK_EQ(decoder.getHeight(), 32);
+    thumbnailer.release();
+    CHECK_EQ(thumbnailer.getConversions(), conversions + 1);
+
+    return checkResult("thumbnailer_test");
+}
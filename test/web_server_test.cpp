@@ -0,0 +1,141 @@
+#include "EspCamLib.h"
+#include "host_camera.h"
+#include "Check.h"
+#include "LoopbackClient.h"
+
+// WebServer responses on loopback: the index page with its ETag, gzip for clients that take it, the
+// page inflated for the ones that do not and 304 once the client has the current page. /capture sends
+// exactly one frame, also while a stream keeps the camera running, and the stream goes on around it
+using namespace EspCam;
+
+static const int PORT = 18104;
+
+static void checkIndex()
+{
+    LoopbackClient client;
+    std::string head, body;
+
+    REQUIRE(client.request(PORT, "GET", "/", head, body, "Accept-Encoding: deflate, gzip, br\r\n"));
+    CHECK(head.find("HTTP/1.1 200 OK") == 0);
+    CHECK(LoopbackClient::header(head, "Content-Type") == "text/html");
+    CHECK(LoopbackClient::header(head, "Content-Encoding") == "gzip");
+    CHECK(LoopbackClient::header(head, "Vary") == "Accept-Encoding");
+    CHECK(LoopbackClient::header(head, "ETag") == INDEX_HTML_ETAG);
+    CHECK_EQ(strtoul(LoopbackClient::header(head, "Content-Length").c_str(), nullptr, 10), INDEX_HTML_GZ_LENGTH);
+    CHECK(body.size() == INDEX_HTML_GZ_LENGTH && memcmp(body.data(), INDEX_HTML_GZ, INDEX_HTML_GZ_LENGTH) == 0);
+
+    // the same page inflated, with the same ETag since it is the same resource
+    REQUIRE(client.request(PORT, "GET", "/", head, body));
+    CHECK(head.find("HTTP/1.1 200 OK") == 0);
+    CHECK(LoopbackClient::header(head, "Content-Encoding").empty());
+    CHECK(LoopbackClient::header(head, "Vary") == "Accept-Encoding");
+    CHECK(LoopbackClient::header(head, "ETag") == INDEX_HTML_ETAG);
+    CHECK_EQ(strtoul(LoopbackClient::header(head, "Content-Length").c_str(), nullptr, 10), INDEX_HTML_LENGTH);
+    CHECK_EQ(body.size(), INDEX_HTML_LENGTH);
+    CHECK(body.find("<html") != std::string::npos);
+    CHECK(body.find("</html>") != std::string::npos);
+
+    // a matching ETag, alone or in a list, gets an empty 304 whatever the encoding
+    std::string tags[] = {INDEX_HTML_ETAG, std::string("\"0000\", ") + INDEX_HTML_ETAG};
+    for (const std::string &tag : tags)
+    {
+        REQUIRE(client.request(PORT, "GET", "/", head, body, "Accept-Encoding: gzip\r\nIf-None-Match: " + tag + "\r\n"));
+        CHECK(head.find("HTTP/1.1 304 Not Modified") == 0);
+        CHECK(LoopbackClient::header(head, "ETag") == INDEX_HTML_ETAG);
+        CHECK(LoopbackClient::header(head, "Content-Encoding").empty());
+        CHECK(LoopbackClient::header(head, "Content-Length") == "0");
+        CHECK(body.empty());
+    }
+
+    // an older page gets the current one
+    REQUIRE(client.request(PORT, "GET", "/", head, body, "Accept-Encoding: gzip\r\nIf-None-Match: \"0000\"\r\n"));
+    CHECK(head.find("HTTP/1.1 200 OK") == 0);
+    CHECK_EQ(body.size(), INDEX_HTML_GZ_LENGTH);
+}
+
+// one complete JPEG and nothing else, markers cannot appear inside the entropy coded data
+static bool isSingleJpeg(const std::string &data)
+{
+    if (data.size() < 4 || data.compare(0, 2, "\xFF\xD8") != 0 || data.compare(data.size() - 2, 2, "\xFF\xD9") != 0)
+        return false;
+    return data.find("\xFF\xD8", 2) == std::string::npos && data.find("\xFF\xD9") == data.size() - 2;
+}
+
+// sequence number of the frame in a /capture response
+static uint32_t capture(const char *uri)
+{
+    LoopbackClient client;
+    std::string head, body;
+    REQUIRE(client.request(PORT, "GET", uri, head, body));
+    CHECK(head.find("HTTP/1.1 200 OK") == 0);
+    CHECK(LoopbackClient::header(head, "Content-Type") == "image/jpeg");
+    CHECK(LoopbackClient::header(head, "Cache-Control") == "no-store");
+    CHECK_EQ(strtoul(LoopbackClient::header(head, "Content-Length").c_str(), nullptr, 10), body.size());
+    CHECK(isSingleJpeg(body));
+    std::string sequence = LoopbackClient::header(head, "X-Frame-Sequence");
+    CHECK(!sequence.empty());
+    return strtoul(sequence.c_str(), nullptr, 10);
+}
+
+static int readParts(LoopbackClient &client, int parts)
+{
+    std::string head, data;
+    for (int i = 0; i < parts; i++)
+    {
+        if (!client.readUntil("\r\n\r\n", head))
+            return i;
+        std::string length = LoopbackClient::header("\r\n" + head, "Content-Length");
+        if (length.empty() || !client.readBytes(strtoul(length.c_str(), nullptr, 10) + 2, data))
+            return i;
+        if (!isSingleJpeg(data.substr(0, data.size() - 2)))
+            return i;
+    }
+    return parts;
+}
+
+static void checkCapture(FrameBroker *broker)
+{
+    // idle, the broker has nothing recent and captures a frame for the request
+    uint32_t before = broker->sequence();
+    vTaskDelay(pdMS_TO_TICKS(600));
+    CHECK(capture("/capture") > before);
+
+    LoopbackClient stream;
+    REQUIRE(stream.connect(PORT + 1));
+    REQUIRE(stream.send("GET /stream HTTP/1.1\r\n\r\n"));
+    std::string head;
+    REQUIRE(stream.readUntil("\r\n\r\n", head));
+    CHECK_EQ(readParts(stream, 3), 3);
+
+    // while streaming the newest frame is served as it is, at most one frame behind the stream
+    uint32_t last = 0;
+    for (int i = 0; i < 10; i++)
+    {
+        uint32_t streamed = broker->sequence();
+        uint32_t sequence = capture("/capture");
+        CHECK(sequence + 1 >= streamed);
+        CHECK(sequence >= last);
+        last = sequence;
+    }
+    // ?fresh=1 waits for a frame captured after the request
+    before = broker->sequence();
+    CHECK(capture("/capture?fresh=1") > before);
+
+    // the stream never noticed
+    CHECK_EQ(readParts(stream, 5), 5);
+    stream.close();
+}
+
+int main()
+{
+    HostCamera::setFrameRate(20);
+    Camera camera;
+    camera.setFrameSize(FRAMESIZE_QVGA);
+    REQUIRE(camera.begin());
+
+    WebServer server(&camera);
+    REQUIRE(server.begin(PORT));
+    checkIndex();
+    checkCapture(camera.getBroker());
+    return checkResult("web_server_test");
+}
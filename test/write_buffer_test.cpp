@@ -0,0 +1,139 @@
+#include "WriteBuffer.h"
+#include "Check.h"
+#include <SD.h>
+#include <string>
+#include <vector>
+
+// the ring with its positions started a few blocks short of the wrap, at a block and capacity that are
+// not powers of two: what reaches the files is the stream as written, segments start on a block
+// boundary and flushed positions are told apart from buffered ones on both sides of the wrap
+using namespace EspCam;
+
+static const size_t BLOCK_SIZE = 48 * 1024;
+static const size_t CAPACITY = 300 * 1024;
+
+struct Flusher
+{
+    WriteBuffer *buffer;
+    File files[2];
+    int segment;
+    volatile bool done;
+    volatile bool ok;
+};
+
+static void flushTask(void *param)
+{
+    Flusher *flusher = static_cast<Flusher *>(param);
+    flusher->ok = true;
+    while (!flusher->buffer->isDrained())
+    {
+        flusher->buffer->waitForData(pdMS_TO_TICKS(100));
+        if (!flusher->buffer->flushTo(flusher->files[flusher->segment]))
+        {
+            flusher->ok = false;
+            flusher->buffer->abort();
+            break;
+        }
+        if (flusher->buffer->atSegmentEnd())
+        {
+            flusher->segment++;
+            flusher->buffer->nextSegment();
+        }
+    }
+    flusher->done = true;
+    vTaskDelete(NULL);
+}
+
+static std::string readFile(const char *path)
+{
+    File file = SD.open(path, FILE_READ);
+    std::string data;
+    uint8_t buf[4096];
+    int n;
+    while (file && (n = file.read(buf, sizeof(buf))) > 0)
+    {
+        data.append((const char *)buf, n);
+    }
+    return data;
+}
+
+int main()
+{
+    char root[] = "/tmp/espcam_write_bufferXXXXXX";
+    REQUIRE(mkdtemp(root) && SD.begin(root));
+
+    WriteBuffer buffer;
+    REQUIRE(buffer.begin(CAPACITY, BLOCK_SIZE));
+    CHECK_EQ(buffer.getCapacity(), 7 * BLOCK_SIZE);
+    CHECK_EQ(buffer.getWrap() % buffer.getCapacity(), 0);
+    uint32_t start = buffer.getWrap() - 5 * BLOCK_SIZE;
+    buffer.reset(start);
+
+    Flusher flusher;
+    flusher.buffer = &buffer;
+    flusher.files[0] = SD.open("/first.bin", FILE_WRITE);
+    flusher.files[1] = SD.open("/second.bin", FILE_WRITE);
+    flusher.segment = 0;
+    flusher.done = false;
+    REQUIRE(flusher.files[0] && flusher.files[1]);
+    TaskHandle_t handle = NULL;
+    REQUIRE(xTaskCreatePinnedToCore(flushTask, "Flush", 4096, &flusher, 5, &handle, 1) == pdPASS);
+    buffer.setConsumer(handle);
+
+    // odd sized chunks, the first segment ends past the wrap in the middle of a block
+    std::vector<uint8_t> data(12 * BLOCK_SIZE + 1234);
+    for (size_t i = 0; i < data.size(); i++)
+    {
+        data[i] = (uint8_t)(i * 7 + (i >> 11));
+    }
+    size_t split = 7 * BLOCK_SIZE + 777;
+    std::vector<uint32_t> ends;
+    for (size_t done = 0; done < data.size();)
+    {
+        size_t n = std::min<size_t>(5003, (done < split ? split : data.size()) - done);
+        REQUIRE(buffer.write(data.data() + done, n) == n);
+        done += n;
+        ends.push_back(buffer.getWritePosition());
+        if (done == split)
+        {
+            REQUIRE(buffer.markSegment());
+            // the next segment starts on the block grid on the far side of the wrap
+            CHECK(buffer.getWritePosition() < start);
+            CHECK_EQ(buffer.getWritePosition() % BLOCK_SIZE, 0);
+        }
+    }
+    buffer.close();
+    for (int i = 0; i < 500 && !flusher.done; i++)
+    {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    REQUIRE(flusher.done);
+    CHECK(flusher.ok);
+    flusher.files[0].close();
+    flusher.files[1].close();
+
+    CHECK_EQ(flusher.segment, 1);
+    CHECK(readFile("/first.bin") == std::string(data.begin(), data.begin() + split));
+    CHECK(readFile("/second.bin") == std::string(data.begin() + split, data.end()));
+    CHECK_EQ(buffer.getBytesFlushed(), data.size());
+    for (uint32_t end : ends)
+    {
+        CHECK(buffer.isFlushed(end));
+    }
+
+    // a position still in the ring is not flushed, also when the ring spans the wrap
+    buffer.reset(buffer.getWrap() - BLOCK_SIZE);
+    uint32_t before = buffer.getWritePosition();
+    REQUIRE(buffer.write(data.data(), 2 * BLOCK_SIZE) == 2 * BLOCK_SIZE);
+    uint32_t after = buffer.getWritePosition();
+    CHECK_EQ(after, BLOCK_SIZE);
+    CHECK_EQ(buffer.buffered(), 2 * BLOCK_SIZE);
+    CHECK(buffer.isFlushed(before));
+    CHECK(!buffer.isFlushed(after));
+    CHECK(!buffer.isFlushed(0));
+
+    char command[64];
+    snprintf(command, sizeof(command), "rm -rf %s", root);
+    CHECK(system(command) == 0);
+    return checkResult("write_buffer_test");
+}
@@ -0,0 +1,36 @@
+#!/usr/bin/env python3
+"""Regenerates src/EspCamLib/WebServer/Index.h from Index.html.
+
+The page is stored gzip compressed together with its uncompressed length and
+a content hash used as the ETag. Run it after every change to Index.html.
+"""
+import gzip
+import hashlib
+import os
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+WEB = os.path.join(HERE, "..", "src", "EspCamLib", "WebServer")
+
+with open(os.path.join(WEB, "Index.html"), "rb") as f:
+    html = f.read()
+
+# mtime 0 and no file name keep the output reproducible and the gzip header at 10 bytes
+blob = gzip.compress(html, compresslevel=9, mtime=0)
+etag = hashlib.sha1(html).hexdigest()[:16]
+
+lines = []
+for i in range(0, len(blob), 16):
+    lines.append("    " + ", ".join("0x%02x" % b for b in blob[i:i + 16]) + ",")
+
+with open(os.path.join(WEB, "Index.h"), "w", newline="\n") as f:
+    f.write("#ifndef WEB_INDEX_H\n#define WEB_INDEX_H\n\n")
+    f.write("// generated from Index.html by tools/embed_index.py, do not edit by hand\n\n")
+    f.write("const uint8_t INDEX_HTML_GZ[] PROGMEM = {\n")
+    f.write("\n".join(lines))
+    f.write("\n};\n\n")
+    f.write("const size_t INDEX_HTML_GZ_LENGTH = sizeof(INDEX_HTML_GZ);\n")
+    f.write("const size_t INDEX_HTML_LENGTH = %d;\n" % len(html))
+    f.write("const char INDEX_HTML_ETAG[] = \"\\\"%s\\\"\";\n" % etag)
+    f.write("\n#endif\n")
+
+print("Index.html %d bytes, gzip %d bytes, etag %s" % (len(html), len(blob), etag))